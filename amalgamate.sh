@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# Writes the single header version of the library to stdout:
+#   ./amalgamate.sh utils.h grid.h ... utils.c grid.c ... > utils_single.h
+# (`make utils_single.h` passes the library's headers and sources).
+#
+# Headers are pasted in the order given, sources after them inside
+# `#ifdef UTILS_IMPLEMENTATION`. Local `#include "..."` lines are dropped,
+# every header is already above, and so is each source's
+# `#define NO_MEMORY_DEBUG`, which the implementation section replaces, and
+# utils.c's `#define UTILS_DEFINE_ACCESSORS`, as the single header always
+# has the inline accessors.
+#
+
+# Prints a file without local includes, the NO_MEMORY_DEBUG define
+# (including its backslash continued comment) and UTILS_DEFINE_ACCESSORS.
+strip() {
+  printf '\n/*---- %s ----*/\n\n' "$1"
+  awk '
+    skip { skip = /\\$/; next }
+    /^#include "/ { next }
+    /^#define NO_MEMORY_DEBUG/ { skip = /\\$/; next }
+    /^#define UTILS_DEFINE_ACCESSORS/ { next }
+    { print }
+  ' "$1"
+}
+
+echo '/*utils_single.h: generated by amalgamate.sh, do not edit.'
+echo ' *'
+echo ' * Include it anywhere for the declarations and inline accessors. In'
+echo ' * exactly one file define UTILS_IMPLEMENTATION first to compile the'
+echo ' * library into it:'
+echo ' *   #define UTILS_IMPLEMENTATION'
+echo ' *   #include "utils_single.h"'
+echo ' * The implementation uses POSIX and GNU calls (clocks, mmap, mremap) and'
+echo ' * defines _GNU_SOURCE for them, so in that file include it before any'
+echo ' * system header, or compile that file with -std=gnu11 or later.*/'
+echo '#if defined(UTILS_IMPLEMENTATION) && !defined(_GNU_SOURCE)'
+echo '#define _GNU_SOURCE'
+echo '#endif'
+echo '#ifndef __UTILS_SINGLE_H__'
+echo '#define __UTILS_SINGLE_H__'
+echo '#ifndef UTILS_INLINE'
+echo '#define UTILS_INLINE'
+echo '#endif'
+for f in "$@"; do
+  case $f in *.h) strip "$f" ;; esac
+done
+echo
+echo '#endif // __UTILS_SINGLE_H__'
+echo
+echo '#if defined(UTILS_IMPLEMENTATION) && !defined(__UTILS_SINGLE_IMPLEMENTATION__)'
+echo '#define __UTILS_SINGLE_IMPLEMENTATION__'
+echo
+echo '/*The library never tracks its own allocations (each source defines'
+echo ' * NO_MEMORY_DEBUG in the regular build).*/'
+echo '#undef malloc'
+echo '#undef realloc'
+echo '#undef free'
+echo '#undef exit'
+strip simd.h
+for f in "$@"; do
+  case $f in *.c) strip "$f" ;; esac
+done
+echo
+echo '#endif // UTILS_IMPLEMENTATION'
@@ -0,0 +1,310 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "asynclog.h"
+
+#include <pthread.h>   /*Includes POSIX threads for the background writer.*/
+#include <sched.h>     /*Includes `sched_yield` for the blocking policy.*/
+#include <stdatomic.h> /*Includes atomics for the queue indices.*/
+#include <stdint.h>
+#include <time.h> /*Includes `clock_gettime`, `nanosleep` and `localtime_r`.*/
+
+#include "outbuf.h"
+
+/*ASYNC LOG*/
+
+typedef struct {
+  uint64_t timestamp; /*CLOCK_REALTIME nanoseconds*/
+  const char *file;
+  int line;
+  int level;
+  unsigned int len;
+  char text[ASYNC_LOG_TEXT];
+} AsyncLogRecord;
+
+/*A single producer single consumer ring. `tail` is written only by the owning
+ * thread and `head` only by the background thread; they live on separate
+ * cache lines so the two sides do not false share.*/
+typedef struct AsyncLogQueue {
+  _Alignas(64) atomic_size_t head;
+  _Alignas(64) atomic_size_t tail;
+  atomic_size_t dropped;
+  size_t reported; /*drops already reported, background thread only*/
+  atomic_bool closed; /*owning thread has exited*/
+  size_t mask;
+  AsyncLogRecord *records;
+  struct AsyncLogQueue *next;
+} AsyncLogQueue;
+
+static AsyncLogOptions log_options;
+static atomic_bool log_running;
+static atomic_bool log_stopping;
+static pthread_t log_thread;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*guarded by log_mutex*/
+static AsyncLogQueue *log_queues;
+static bool log_writer_alive;
+static size_t log_dropped_freed; /*drops counted in queues already freed*/
+
+/*Queues outlive `stop_async_log` and are reused by the next start; a queue
+ * is freed once its thread has exited and it has been drained.*/
+static pthread_key_t log_key;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static _Thread_local AsyncLogQueue *local_queue;
+
+static const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+static const char *level_colors[] = {CYAN, GREEN, YELLOW, RED BOLD};
+
+static uint64_t now_realtime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*Renders a record as one colored line into `out` and returns its length.*/
+static size_t format_record(const AsyncLogRecord *record, char *out,
+                            size_t size) {
+  time_t seconds = (time_t)(record->timestamp / 1000000000u);
+  struct tm tm;
+  int level = record->level < ASYNC_LOG_DEBUG   ? ASYNC_LOG_DEBUG
+              : record->level > ASYNC_LOG_ERROR ? ASYNC_LOG_ERROR
+                                                : record->level;
+  int n;
+  localtime_r(&seconds, &tm);
+  if (use_color_output_buffer())
+    n = snprintf(out, size,
+                 "%02d:%02d:%02d.%06u %s%-5s" RESET " F: " CYAN "%s" RESET
+                 " L: " MAGENTA "%d" RESET " O: %.*s\n",
+                 tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 (unsigned int)(record->timestamp % 1000000000u / 1000u),
+                 level_colors[level], level_names[level], record->file,
+                 record->line, (int)record->len, record->text);
+  else
+    n = snprintf(out, size, "%02d:%02d:%02d.%06u %-5s F: %s L: %d O: %.*s\n",
+                 tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 (unsigned int)(record->timestamp % 1000000000u / 1000u),
+                 level_names[level], record->file, record->line,
+                 (int)record->len, record->text);
+  if (n < 0)
+    return 0;
+  return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+static void write_record(const AsyncLogRecord *record) {
+  char line[ASYNC_LOG_TEXT + 512];
+  write_output_buffer(line, format_record(record, line, sizeof line), 1);
+}
+
+static void fill_record(AsyncLogRecord *record, int level, const char *file,
+                        int line, const char *format, va_list args) {
+  int n = vsnprintf(record->text, ASYNC_LOG_TEXT, format, args);
+  record->timestamp = now_realtime();
+  record->file = file;
+  record->line = line;
+  record->level = level;
+  record->len = n < 0 ? 0 : n >= ASYNC_LOG_TEXT ? ASYNC_LOG_TEXT - 1 : n;
+}
+
+static void free_queue(AsyncLogQueue *queue) {
+  log_dropped_freed +=
+      atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+  free(queue->records);
+  free(queue);
+}
+
+/*Thread exit: leave the queue to the background thread to drain, or free it
+ * now when there is none.*/
+static void close_queue(void *arg) {
+  AsyncLogQueue *queue = (AsyncLogQueue *)arg, **link;
+  pthread_mutex_lock(&log_mutex);
+  if (log_writer_alive) {
+    atomic_store_explicit(&queue->closed, true, memory_order_release);
+  } else {
+    for (link = &log_queues; *link != queue; link = &(*link)->next)
+      ;
+    *link = queue->next;
+    free_queue(queue);
+  }
+  pthread_mutex_unlock(&log_mutex);
+}
+
+static void init_log_key(void) { pthread_key_create(&log_key, close_queue); }
+
+/*The calling thread's queue, created and registered on first use.*/
+static AsyncLogQueue *get_queue(void) {
+  AsyncLogQueue *queue;
+  size_t capacity = 1;
+  if (local_queue != NULL)
+    return local_queue;
+  while (capacity < log_options.queue_records)
+    capacity <<= 1;
+  queue = (AsyncLogQueue *)aligned_alloc(64, sizeof(AsyncLogQueue));
+  if (queue == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return NULL;
+  }
+  queue->records = (AsyncLogRecord *)malloc(capacity * sizeof(AsyncLogRecord));
+  if (queue->records == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    free(queue);
+    return NULL;
+  }
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  atomic_init(&queue->dropped, 0);
+  queue->reported = 0;
+  atomic_init(&queue->closed, false);
+  queue->mask = capacity - 1;
+  pthread_once(&log_once, init_log_key);
+  pthread_setspecific(log_key, queue);
+  pthread_mutex_lock(&log_mutex);
+  queue->next = log_queues;
+  log_queues = queue;
+  pthread_mutex_unlock(&log_mutex);
+  local_queue = queue;
+  return queue;
+}
+
+/*Writes every pending record, reports new drops and frees closed, empty
+ * queues. Returns the number of records written.*/
+static size_t drain_queues(void) {
+  AsyncLogQueue **link, *queue;
+  size_t written = 0, dropped = 0;
+  pthread_mutex_lock(&log_mutex);
+  for (link = &log_queues; (queue = *link) != NULL;) {
+    bool closed = atomic_load_explicit(&queue->closed, memory_order_acquire);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    size_t drops = atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+    for (; head != tail; head++, written++)
+      write_record(&queue->records[head & queue->mask]);
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+    dropped += drops - queue->reported;
+    queue->reported = drops;
+    if (closed) {
+      *link = queue->next;
+      free_queue(queue);
+    } else {
+      link = &queue->next;
+    }
+  }
+  pthread_mutex_unlock(&log_mutex);
+  if (dropped > 0) {
+    AsyncLogRecord note;
+    note.timestamp = now_realtime();
+    note.file = __FILE__;
+    note.line = __LINE__;
+    note.level = ASYNC_LOG_WARN;
+    note.len = (unsigned int)snprintf(note.text, ASYNC_LOG_TEXT,
+                                      "%zu log records dropped", dropped);
+    write_record(&note);
+  }
+  return written;
+}
+
+static void *log_writer(void *arg) {
+  long backoff = 1000;
+  (void)arg;
+  for (;;) {
+    bool stopping = atomic_load_explicit(&log_stopping, memory_order_acquire);
+    if (drain_queues() > 0) {
+      backoff = 1000;
+      continue;
+    }
+    flush_output_buffer();
+    if (stopping)
+      break;
+    {
+      struct timespec ts = {0, backoff};
+      nanosleep(&ts, NULL);
+      if (backoff < 1000000)
+        backoff *= 2;
+    }
+  }
+  return NULL;
+}
+
+AsyncLogOptions default_async_log_options(void) {
+  AsyncLogOptions options;
+  options.queue_records = 1024;
+  options.policy = ASYNC_LOG_DROP;
+  options.min_level = ASYNC_LOG_DEBUG;
+  return options;
+}
+
+void start_async_log(const AsyncLogOptions *options) {
+  if (atomic_load(&log_running))
+    return;
+  log_options = options != NULL ? *options : default_async_log_options();
+  if (log_options.queue_records < 2)
+    log_options.queue_records = 2;
+  atomic_store(&log_stopping, false);
+  pthread_mutex_lock(&log_mutex);
+  log_writer_alive = true;
+  pthread_mutex_unlock(&log_mutex);
+  pthread_create(&log_thread, NULL, log_writer, NULL);
+  atomic_store_explicit(&log_running, true, memory_order_release);
+}
+
+/*Drains every queue and stops the background thread. Must not race with
+ * logging calls on other threads.*/
+void stop_async_log(void) {
+  if (!atomic_load(&log_running))
+    return;
+  atomic_store_explicit(&log_running, false, memory_order_release);
+  atomic_store_explicit(&log_stopping, true, memory_order_release);
+  pthread_join(log_thread, NULL);
+  pthread_mutex_lock(&log_mutex);
+  log_writer_alive = false;
+  pthread_mutex_unlock(&log_mutex);
+}
+
+size_t dropped_async_log(void) {
+  AsyncLogQueue *queue;
+  size_t dropped;
+  pthread_mutex_lock(&log_mutex);
+  dropped = log_dropped_freed;
+  for (queue = log_queues; queue != NULL; queue = queue->next)
+    dropped += atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+  pthread_mutex_unlock(&log_mutex);
+  return dropped;
+}
+
+void vasync_log(int level, const char *file, int line, const char *format,
+                va_list args) {
+  AsyncLogQueue *queue;
+  size_t tail;
+  if (level < log_options.min_level)
+    return;
+  if (!atomic_load_explicit(&log_running, memory_order_acquire) ||
+      (queue = get_queue()) == NULL) {
+    AsyncLogRecord record;
+    fill_record(&record, level, file, line, format, args);
+    write_record(&record);
+    flush_output_buffer();
+    return;
+  }
+  tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  while (tail - atomic_load_explicit(&queue->head, memory_order_acquire) >
+         queue->mask) {
+    if (log_options.policy == ASYNC_LOG_DROP) {
+      atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+      return;
+    }
+    sched_yield();
+  }
+  fill_record(&queue->records[tail & queue->mask], level, file, line, format,
+              args);
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+void async_log(int level, const char *file, int line, const char *format,
+               ...) {
+  va_list args;
+  va_start(args, format);
+  vasync_log(level, file, line, format, args);
+  va_end(args);
+}
+
+void async_debug_puts(char *str, int line, char *file) {
+  async_log(ASYNC_LOG_DEBUG, file, line, "%s", str);
+}
@@ -0,0 +1,61 @@
+#ifndef __ASYNCLOG_H__
+#define __ASYNCLOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+/*ASYNC LOG*/
+
+/*An asynchronous logger for the request path. A call formats its message
+ * into a fixed size record on a lock-free single producer queue owned by the
+ * calling thread and returns; a background thread drains every queue, adds
+ * the time and colors, and writes the lines through the output buffer (see
+ * `set_output_buffer` in outbuf.h for the destination).
+ *
+ * Memory is bounded by `queue_records` records per logging thread. When a
+ * queue is full the policy decides: ASYNC_LOG_DROP counts and drops the
+ * record (the count is reported in the log), ASYNC_LOG_BLOCK waits for the
+ * background thread to make room.
+ *
+ * Before `start_async_log` and after `stop_async_log` calls are written
+ * synchronously.*/
+#define ASYNC_LOG_TEXT 224 /*message bytes per record, longer ones are cut*/
+
+enum { ASYNC_LOG_DEBUG, ASYNC_LOG_INFO, ASYNC_LOG_WARN, ASYNC_LOG_ERROR };
+enum { ASYNC_LOG_DROP, ASYNC_LOG_BLOCK };
+
+typedef struct {
+  size_t queue_records; /*per thread, rounded up to a power of two*/
+  int policy;
+  int min_level; /*records below this level are discarded by the caller*/
+} AsyncLogOptions;
+
+AsyncLogOptions default_async_log_options(void);
+void start_async_log(const AsyncLogOptions *options);
+/*Drains every queue and stops the background thread. Must not race with
+ * logging calls on other threads.*/
+void stop_async_log(void);
+/*Records dropped under ASYNC_LOG_DROP since the program started.*/
+size_t dropped_async_log(void);
+
+void async_log(int level, const char *file, int line, const char *format,
+               ...);
+void vasync_log(int level, const char *file, int line, const char *format,
+                va_list args);
+/*Drop-in for `debug_puts` at ASYNC_LOG_DEBUG.*/
+void async_debug_puts(char *str, int line, char *file);
+
+#define ASYNC_LOG(level, ...) async_log(level, __FILE__, __LINE__, __VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ASYNCLOG_H__
@@ -0,0 +1,234 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /*for `sched_setaffinity` and the program name*/
+#endif
+
+#include <errno.h>  /*Includes `program_invocation_short_name`.*/
+#include <fcntl.h>  /*Includes `open` for muting stdout.*/
+#include <sched.h>  /*Includes `sched_setaffinity` for CPU pinning.*/
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>   /*Includes `clock_gettime` for the monotonic clock.*/
+#include <unistd.h> /*Includes `dup2`.*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> /*Includes `__rdtsc` for cycle counts.*/
+#endif
+
+#include "../utils.h"
+
+/*BENCHMARK HARNESS*/
+
+/*Every bench/bench_*.c is one suite. A suite either times its own loops and
+ * prints them with `bench_report`, or describes cases for `bench_case`, which
+ * pins the CPU, warms up, repeats the case, and reports the median and
+ * spread per item in nanoseconds and cycles.
+ *
+ * With BENCH_JSON set (`make bench BENCH_JSON=results.jsonl`) every result is
+ * also appended to that file as one JSON object per line, so two releases
+ * can be compared by a script.
+ *
+ * Suites that call `bench_options` accept:
+ *   --warmup N   untimed runs before measuring (default 3)
+ *   --reps N     timed runs (default 21)
+ *   --cpu N      CPU to pin to, -1 to leave the affinity alone (default: the
+ *                CPU the suite starts on)
+ *   --quick      1 warm-up and 5 repetitions*/
+
+typedef struct {
+  int warmup;
+  int repetitions;
+  int cpu;
+} BenchOptions;
+
+/*One case: `setup` (untimed, may be NULL) runs before every timed `run`,
+ * which processes `items` items of `unit`.*/
+typedef struct {
+  const char *name;
+  void (*setup)(void *ctx);
+  void (*run)(void *ctx);
+  double items;
+  const char *unit;
+} BenchCase;
+
+/*Per item statistics over the repetitions.*/
+typedef struct {
+  double median_ns, p10_ns, p90_ns, min_ns, max_ns;
+  double median_cycles; /*0 where no cycle counter is available*/
+} BenchResult;
+
+/*Seconds on the monotonic clock.*/
+static inline double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*Reference cycles, or 0 without a cycle counter.*/
+static inline uint64_t bench_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static inline const char *bench_suite(void) {
+#if defined(__linux__)
+  return program_invocation_short_name;
+#else
+  return getprogname();
+#endif
+}
+
+/*The BENCH_JSON file, opened for appending on first use.*/
+static inline FILE *bench_json(void) {
+  static FILE *file;
+  static bool opened;
+  if (!opened) {
+    const char *path = getenv("BENCH_JSON");
+    opened = true;
+    if (path != NULL && path[0] != '\0' && (file = fopen(path, "a")) == NULL)
+      fprintf(stderr, "ERROR: Cannot open %s.\n", path);
+  }
+  return file;
+}
+
+/*Prints one result line: name, rate and the unit it is counted in.*/
+static inline void bench_report(const char *name, double items,
+                                double seconds, const char *unit) {
+  FILE *json = bench_json();
+  color_print(CYAN, "", "", "%-28s", name);
+  printf(" %10.2f M%s/s  (%.3f s)\n", items / seconds * 1e-6, unit, seconds);
+  if (json != NULL) {
+    fprintf(json,
+            "{\"suite\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", "
+            "\"items\": %.0f, \"seconds\": %.9f, \"rate\": %.6g}\n",
+            bench_suite(), name, unit, items, seconds, items / seconds);
+    fflush(json);
+  }
+}
+
+static inline void bench_pin(int cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  if (cpu < 0)
+    return;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof set, &set) != 0)
+    fprintf(stderr, "ERROR: Cannot pin to CPU %d.\n", cpu);
+#else
+  (void)cpu; /*macOS has no hard affinity*/
+#endif
+}
+
+static inline BenchOptions bench_options(int argc, char **argv) {
+  BenchOptions options;
+  int i;
+  options.warmup = 3;
+  options.repetitions = 21;
+#if defined(__linux__)
+  options.cpu = sched_getcpu();
+#else
+  options.cpu = -1;
+#endif
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+      options.warmup = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      options.repetitions = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+      options.cpu = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--quick") == 0) {
+      options.warmup = 1;
+      options.repetitions = 5;
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--warmup N] [--reps N] [--cpu N] [--quick]\n",
+              argv[0]);
+      exit(2);
+    }
+  }
+  if (options.repetitions < 1)
+    options.repetitions = 1;
+  bench_pin(options.cpu);
+  return options;
+}
+
+static inline int bench_compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/*Nearest-rank percentile of sorted samples.*/
+static inline double bench_percentile(const double *sorted, int n, double q) {
+  int rank = (int)(q * n + 0.5);
+  if (rank >= n)
+    rank = n - 1;
+  return sorted[rank < 0 ? 0 : rank];
+}
+
+/*Runs a case with stdout muted (library code may print) and reports it.*/
+static inline BenchResult bench_case(const BenchOptions *options,
+                                     const BenchCase *c, void *ctx) {
+  BenchResult result;
+  FILE *json = bench_json();
+  int n = options->repetitions, i;
+  double *ns = (double *)malloc((size_t)n * sizeof(double));
+  double *cycles = (double *)malloc((size_t)n * sizeof(double));
+  int null = open("/dev/null", O_WRONLY), saved;
+
+  fflush(stdout);
+  saved = dup(STDOUT_FILENO);
+  dup2(null, STDOUT_FILENO);
+  for (i = -options->warmup; i < n; i++) {
+    double start;
+    uint64_t start_cycles;
+    if (c->setup != NULL)
+      c->setup(ctx);
+    start_cycles = bench_cycles();
+    start = bench_now();
+    c->run(ctx);
+    if (i >= 0) {
+      ns[i] = (bench_now() - start) * 1e9 / c->items;
+      cycles[i] = (double)(bench_cycles() - start_cycles) / c->items;
+    }
+  }
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  close(null);
+
+  qsort(ns, (size_t)n, sizeof(double), bench_compare_double);
+  qsort(cycles, (size_t)n, sizeof(double), bench_compare_double);
+  result.median_ns = bench_percentile(ns, n, 0.5);
+  result.p10_ns = bench_percentile(ns, n, 0.1);
+  result.p90_ns = bench_percentile(ns, n, 0.9);
+  result.min_ns = ns[0];
+  result.max_ns = ns[n - 1];
+  result.median_cycles = bench_percentile(cycles, n, 0.5);
+  free(ns);
+  free(cycles);
+
+  color_print(CYAN, "", "", "%-36s", c->name);
+  printf(" %10.2f ns/%-5s p10 %10.2f  p90 %10.2f  %9.1f cyc  %9.2f M/s\n",
+         result.median_ns, c->unit, result.p10_ns, result.p90_ns,
+         result.median_cycles, 1e3 / result.median_ns);
+  if (json != NULL) {
+    fprintf(json,
+            "{\"suite\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", "
+            "\"items\": %.0f, \"repetitions\": %d, \"median_ns\": %.4f, "
+            "\"p10_ns\": %.4f, \"p90_ns\": %.4f, \"min_ns\": %.4f, "
+            "\"max_ns\": %.4f, \"median_cycles\": %.4f}\n",
+            bench_suite(), c->name, c->unit, c->items, n, result.median_ns,
+            result.p10_ns, result.p90_ns, result.min_ns, result.max_ns,
+            result.median_cycles);
+    fflush(json);
+  }
+  return result;
+}
+
+#endif // __BENCH_H__
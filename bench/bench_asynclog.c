@@ -0,0 +1,97 @@
+#include "bench.h"
+#include "../asynclog.h"
+#include "../outbuf.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/*Caller side latency percentiles of debug_puts against the asynchronous
+ * logger, with every line going to /dev/null.*/
+
+#define CALLS 200000
+#define THREADS 4
+
+enum { DEBUG_PUTS, ASYNC_DEBUG_PUTS, ASYNC_LOG_FORMAT };
+
+static int mode;
+static double *latencies;
+
+static void *log_calls(void *arg) {
+  double *out = latencies + (size_t)arg * (CALLS / THREADS);
+  int i;
+  for (i = 0; i < CALLS / THREADS; i++) {
+    double start = bench_now();
+    switch (mode) {
+    case DEBUG_PUTS:
+      debug_puts("request handled", i, __FILE__);
+      break;
+    case ASYNC_DEBUG_PUTS:
+      async_debug_puts("request handled", i, __FILE__);
+      break;
+    default:
+      ASYNC_LOG(ASYNC_LOG_INFO, "request %d handled in %d us", i, i % 97);
+      break;
+    }
+    out[i] = bench_now() - start;
+  }
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void run(int threads, double *percentiles) {
+  pthread_t workers[THREADS];
+  size_t t, n = (size_t)(CALLS / THREADS) * (size_t)threads;
+  for (t = 0; t < (size_t)threads; t++)
+    pthread_create(&workers[t], NULL, log_calls, (void *)t);
+  for (t = 0; t < (size_t)threads; t++)
+    pthread_join(workers[t], NULL);
+  qsort(latencies, n, sizeof(double), compare_double);
+  percentiles[0] = latencies[n / 2];
+  percentiles[1] = latencies[n * 99 / 100];
+  percentiles[2] = latencies[n * 999 / 1000];
+  percentiles[3] = latencies[n - 1];
+}
+
+int main(void) {
+  static const char *names[] = {"debug_puts", "async_debug_puts",
+                                "ASYNC_LOG format"};
+  AsyncLogOptions options = default_async_log_options();
+  double results[3][2][4];
+  int terminal = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  int m, t;
+
+  latencies = (double *)malloc(CALLS * sizeof(double));
+  fflush(stdout);
+  dup2(null, STDOUT_FILENO);
+  set_output_buffer(STDOUT_FILENO, 0);
+  options.queue_records = 1 << 14;
+  options.policy = ASYNC_LOG_BLOCK;
+  start_async_log(&options);
+  for (m = DEBUG_PUTS; m <= ASYNC_LOG_FORMAT; m++)
+    for (t = 0; t < 2; t++) {
+      mode = m;
+      run(t == 0 ? 1 : THREADS, results[m][t]);
+    }
+  stop_async_log();
+  fflush(stdout);
+  flush_output_buffer();
+  dup2(terminal, STDOUT_FILENO);
+
+  for (m = DEBUG_PUTS; m <= ASYNC_LOG_FORMAT; m++)
+    for (t = 0; t < 2; t++) {
+      color_print(CYAN, "", "", "%-20s t=%d", names[m], t == 0 ? 1 : THREADS);
+      printf("  p50 %7.0f ns  p99 %7.0f ns  p99.9 %8.0f ns  max %9.0f ns\n",
+             results[m][t][0] * 1e9, results[m][t][1] * 1e9,
+             results[m][t][2] * 1e9, results[m][t][3] * 1e9);
+    }
+  free(latencies);
+  close(null);
+  close(terminal);
+  return 0;
+}
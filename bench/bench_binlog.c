@@ -0,0 +1,232 @@
+#include "bench.h"
+#include "../asynclog.h"
+#include "../binlog.h"
+#include "../outbuf.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <wchar.h>
+
+/*Checks that a file with more sites than fit in 16 bits decodes every event
+ * with its own site, that wide strings and characters decode as written, and
+ * that corrupted and truncated files decode without reading outside their
+ * records. Then measures the caller side cost of one log call: BINLOG
+ * against the asynchronous logger and a formatted color_print, all with two
+ * arguments and a string. The last binary log is then decoded to /dev/null
+ * and its record count checked.*/
+
+#define CALLS 200000
+#define SITES 70000
+#define CORRUPTIONS 2000
+#define PATH "/tmp/bench_binlog.blog"
+
+/*Site i logs once with line i + 1 and argument i + 1.*/
+static bool check_sites(void) {
+  BinLogSite *sites = (BinLogSite *)calloc(SITES, sizeof(BinLogSite));
+  FILE *text = tmpfile();
+  char line[256];
+  long decoded = -1, lines = 0;
+  bool ok = sites != NULL && text != NULL &&
+            open_binlog(PATH, (size_t)SITES * 64) == 0;
+  int i;
+  if (ok) {
+    for (i = 0; i < SITES; i++)
+      binlog_write(&sites[i], "site.c", i + 1, "site %d", i + 1);
+    close_binlog();
+    decoded = decode_binlog(PATH, text, false);
+    rewind(text);
+  }
+  ok = ok && decoded == SITES;
+  while (ok && fgets(line, sizeof line, text) != NULL) {
+    const char *at = strstr(line, " L: ");
+    unsigned int site_line;
+    int value;
+    ok = at != NULL &&
+         sscanf(at, " L: %u O: site %d", &site_line, &value) == 2 &&
+         site_line == (unsigned int)value && value == ++lines;
+  }
+  if (text != NULL)
+    fclose(text);
+  free(sites);
+  remove(PATH);
+  return ok && lines == SITES;
+}
+
+/*`%ls` and `%lc` with widths, precisions and a NULL string.*/
+static bool check_wide(void) {
+  FILE *text = tmpfile();
+  char line[256];
+  const char *at;
+  bool ok = text != NULL && open_binlog(PATH, 1 << 16) == 0;
+  if (ok) {
+    BINLOG("%ls|%lc|%-6ls|%.2ls|%ls|%d", L"wide string", (wint_t)L'w', L"ab",
+           L"xyz", (const wchar_t *)NULL, 7);
+    close_binlog();
+    ok = decode_binlog(PATH, text, false) == 1;
+    rewind(text);
+  }
+  ok = ok && fgets(line, sizeof line, text) != NULL &&
+       (at = strstr(line, " O: ")) != NULL &&
+       strcmp(at, " O: wide string|w|ab    |xy|(null)|7\n") == 0;
+  if (text != NULL)
+    fclose(text);
+  remove(PATH);
+  return ok;
+}
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+/*Writes a small log of every argument type, then decodes copies with random
+ * bytes overwritten or the tail cut off. Bad records go to stderr, which is
+ * silenced meanwhile.*/
+static bool check_corrupt(void) {
+  unsigned char *data = NULL, *copy = NULL;
+  FILE *file, *sink = fopen("/dev/null", "w");
+  int quiet = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+  long size = 0, decoded;
+  bool ok = sink != NULL && open_binlog(PATH, 1 << 16) == 0;
+  int i, k;
+  if (ok) {
+    for (i = 0; i < 40; i++) {
+      BINLOG("%d %*d %-*.*s|", i, 4, i, 8, 3, "strings");
+      BINLOG("%lld %zu %.2f %Lg %p %%", (long long)i, (size_t)i, i * 0.5,
+             (long double)i, (void *)&i);
+      BINLOG("%ls %lc %hhd %5.1e", L"wide", (wint_t)L'w', i, i * 1e6);
+    }
+    close_binlog();
+    file = fopen(PATH, "rb");
+    if (file != NULL) {
+      fseek(file, 0, SEEK_END);
+      size = ftell(file);
+      rewind(file);
+      data = (unsigned char *)malloc((size_t)size);
+      copy = (unsigned char *)malloc((size_t)size);
+      ok = data != NULL && copy != NULL &&
+           fread(data, 1, (size_t)size, file) == (size_t)size;
+      fclose(file);
+    }
+    ok = ok && decode_binlog(PATH, sink, false) == 120;
+  }
+  fflush(stderr);
+  dup2(null, STDERR_FILENO);
+  for (i = 0; ok && i < CORRUPTIONS; i++) {
+    long length = size;
+    memcpy(copy, data, (size_t)size);
+    if (i % 4 == 0)
+      length = 64 + (long)(next_random() % (unsigned int)(size - 64));
+    else
+      for (k = 0; k <= i % 8; k++)
+        copy[64 + next_random() % (unsigned int)(size - 64)] =
+            (unsigned char)next_random();
+    file = fopen(PATH, "wb");
+    ok = file != NULL && fwrite(copy, 1, (size_t)length, file) ==
+                             (size_t)length;
+    if (file != NULL)
+      fclose(file);
+    decoded = ok ? decode_binlog(PATH, sink, false) : -1;
+    ok = decoded >= 0 && decoded <= 120;
+  }
+  fflush(stderr);
+  dup2(quiet, STDERR_FILENO);
+  close(quiet);
+  close(null);
+  if (sink != NULL)
+    fclose(sink);
+  free(data);
+  free(copy);
+  remove(PATH);
+  return ok;
+}
+
+static AsyncLogOptions async_options;
+static long decoded;
+
+static void open_case(void *ctx) {
+  (void)ctx;
+  if (open_binlog(PATH, (size_t)CALLS * 64) != 0)
+    exit(1);
+}
+
+static void binlog_case(void *ctx) {
+  int i;
+  (void)ctx;
+  for (i = 0; i < CALLS; i++)
+    BINLOG("request %d handled in %.3f ms by %s", i, i * 0.001, "worker");
+}
+
+static void async_case(void *ctx) {
+  int i;
+  (void)ctx;
+  for (i = 0; i < CALLS; i++)
+    ASYNC_LOG(ASYNC_LOG_INFO, "request %d handled in %.3f ms by %s", i,
+              i * 0.001, "worker");
+}
+
+static void print_case(void *ctx) {
+  int i;
+  (void)ctx;
+  for (i = 0; i < CALLS; i++)
+    color_print(CYAN, "", "", "request %d handled in %.3f ms by %s\n", i,
+                i * 0.001, "worker");
+}
+
+static void decode_case(void *ctx) {
+  FILE *sink = fopen("/dev/null", "w");
+  (void)ctx;
+  decoded = sink != NULL ? decode_binlog(PATH, sink, false) : -1;
+  if (sink != NULL)
+    fclose(sink);
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  BenchCase cases[] = {
+      {"BINLOG", open_case, binlog_case, CALLS, "call"},
+      {"ASYNC_LOG", NULL, async_case, CALLS, "call"},
+      {"color_print", NULL, print_case, CALLS, "call"},
+  };
+  BenchCase decode = {"decode_binlog", NULL, decode_case, CALLS, "rec"};
+  int null = open("/dev/null", O_WRONLY);
+  size_t dropped;
+
+  if (!check_sites()) {
+    fprintf(stderr, "ERROR: events decoded with the wrong site.\n");
+    return 1;
+  }
+  if (!check_wide()) {
+    fprintf(stderr, "ERROR: wide arguments decoded wrong.\n");
+    return 1;
+  }
+  if (!check_corrupt()) {
+    fprintf(stderr, "ERROR: a corrupted log did not decode.\n");
+    return 1;
+  }
+
+  /*the asynchronous logger writes through the output buffer, so point that
+   * at /dev/null rather than at the muted stdout*/
+  set_output_buffer(null, 0);
+  async_options = default_async_log_options();
+  async_options.queue_records = 1 << 14;
+  async_options.policy = ASYNC_LOG_BLOCK;
+  start_async_log(&async_options);
+  bench_case(&options, &cases[0], NULL);
+  dropped = dropped_binlog();
+  close_binlog();
+  bench_case(&options, &cases[1], NULL);
+  stop_async_log();
+  flush_output_buffer();
+  bench_case(&options, &cases[2], NULL);
+  bench_case(&options, &decode, NULL);
+  remove(PATH);
+  close(null);
+  if (decoded != CALLS || dropped != 0) {
+    fprintf(stderr, "ERROR: decoded %ld of %d records\n", decoded, CALLS);
+    return 1;
+  }
+  return 0;
+}
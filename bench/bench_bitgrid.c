@@ -0,0 +1,62 @@
+#include "bench.h"
+#include "../bitgrid.h"
+#include "../stencil.h"
+
+/*Life generations on a BitGrid against the int Grid stencil. Both start from
+ * the same cells and must agree after every run.*/
+
+#define SIDE 4096
+#define STEPS 16
+
+int main(void) {
+  Grid cells = create_grid(SIDE, SIDE, GRID_ROW_MAJOR);
+  Grid check = create_grid(SIDE, SIDE, GRID_ROW_MAJOR);
+  BitGrid a = create_bitgrid(SIDE, SIDE), b = create_bitgrid(SIDE, SIDE);
+  StencilOptions options = default_stencil_options();
+  unsigned int state = 2024;
+  long r, c;
+  int step;
+  double start;
+
+  for (r = 0; r < SIDE; r++)
+    for (c = 0; c < SIDE; c++) {
+      state = state * 1103515245u + 12345u;
+      set_grid(&cells, r, c, (state >> 16) % 3 == 0);
+    }
+  load_grid_bitgrid(&a, &cells);
+
+  options.threads = 1;
+  start = bench_now();
+  run_stencil(&cells, stencil_life_kernel, STEPS, &options);
+  bench_report("int Grid life stencil", (double)SIDE * SIDE * STEPS,
+               bench_now() - start, "cells");
+
+  start = bench_now();
+  for (step = 0; step < STEPS; step++) {
+    BitGrid t;
+    step_bitgrid(&a, &b, BITGRID_LIFE_BIRTH, BITGRID_LIFE_SURVIVE);
+    t = a;
+    a = b;
+    b = t;
+  }
+  bench_report("BitGrid life step", (double)SIDE * SIDE * STEPS,
+               bench_now() - start, "cells");
+  printf("memory: int Grid %zu bytes, BitGrid %zu bytes\n",
+         cells.capacity * sizeof(int),
+         (a.rows + 2) * a.words_per_row * sizeof(uint64_t));
+
+  store_grid_bitgrid(&a, &check);
+  for (r = 0; r < SIDE; r++)
+    for (c = 0; c < SIDE; c++)
+      if (get_grid(&check, r, c) != get_grid(&cells, r, c)) {
+        fprintf(stderr, "ERROR: BitGrid differs from the int Grid at %ld %ld.\n",
+                r, c);
+        return 1;
+      }
+
+  destroy_grid(&cells);
+  destroy_grid(&check);
+  destroy_bitgrid(&a);
+  destroy_bitgrid(&b);
+  return 0;
+}
@@ -0,0 +1,438 @@
+#include "bench.h"
+#include "../bitset.h"
+
+/*Checks Bitset and Roaring against a plain bool array: membership, count,
+ * rank, the Vector conversions and and/or/xor/andnot, with Roaring sets that
+ * pair every container type (array, bitmap and run, before and after
+ * run_optimize_roaring) with every other. Then prints the memory of dense,
+ * sparse and clustered sets as a Vector, a Bitset and a Roaring, and measures
+ * intersections and lookups on each.*/
+
+#define KEYS 11 /*containers of the checked sets*/
+#define RANGE ((size_t)KEYS << 16)
+#define BITS ((size_t)1 << 24)
+#define LOOKUPS (1u << 18)
+#define MIN_SECONDS 0.2 /*each case repeats for at least this long*/
+
+enum { SPARSE, DENSE, RUNS };
+enum { OP_AND, OP_OR, OP_XOR, OP_ANDNOT };
+
+typedef struct {
+  Vector a, b; /*sorted members*/
+  Bitset ba, bb, dst;
+  Roaring ra, rb;
+  uint32_t *probes;
+} BitsetBench;
+
+typedef struct {
+  const char *name;
+  void (*run)(BitsetBench *b);
+  double items;
+  const char *unit;
+} BitsetCase;
+
+static volatile size_t sink;
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 4;
+}
+
+/*Fills container `key` of `set`: SPARSE gives an array container, DENSE a
+ * bitmap and RUNS a bitmap that run_optimize_roaring turns into runs.*/
+static void fill_container(bool *set, size_t key, int profile) {
+  size_t base = key << 16, v;
+  if (profile == SPARSE) {
+    set[base] = set[base + 65535] = true;
+    for (v = 0; v < 1000; v++)
+      set[base + next_random() % 65536] = true;
+  } else if (profile == DENSE) {
+    for (v = 0; v < 65536; v++)
+      set[base + v] = next_random() % 2 == 0;
+  } else {
+    for (v = 0; v < 65536;) {
+      size_t run = 50 + next_random() % 1000;
+      for (; run > 0 && v < 65536; run--)
+        set[base + v++] = true;
+      v += 50 + next_random() % 1000;
+    }
+  }
+}
+
+static size_t count_set(const bool *set) {
+  size_t i, count = 0;
+  for (i = 0; i < RANGE; i++)
+    count += set[i];
+  return count;
+}
+
+/*The members of `set`, ascending or shuffled.*/
+static Vector members(const bool *set, bool shuffle) {
+  Vector v = create_vector(count_set(set));
+  size_t i, n = 0;
+  for (i = 0; i < RANGE; i++)
+    if (set[i])
+      v.arr[n++] = (int)i;
+  for (i = v.size; shuffle && i > 1; i--) {
+    size_t j = next_random() % i;
+    int t = v.arr[i - 1];
+    v.arr[i - 1] = v.arr[j];
+    v.arr[j] = t;
+  }
+  return v;
+}
+
+/*True when `v` lists the members of `set` in ascending order.*/
+static bool same_members(const Vector *v, const bool *set) {
+  size_t i, n = 0;
+  for (i = 0; i < RANGE; i++)
+    if (set[i] && (n >= v->size || v->arr[n++] != (int)i))
+      return false;
+  return n == v->size;
+}
+
+static void combine(bool *out, const bool *a, const bool *b, int op) {
+  size_t i;
+  for (i = 0; i < RANGE; i++)
+    out[i] = op == OP_AND   ? a[i] && b[i]
+             : op == OP_OR  ? a[i] || b[i]
+             : op == OP_XOR ? a[i] != b[i]
+                            : a[i] && !b[i];
+}
+
+/*Rank is checked at sampled indices on the popcount loop, then at every
+ * index once the rank directory is built.*/
+static bool check_bitset(Bitset *bitset, const bool *set) {
+  size_t i, rank = 0;
+  bool ok = count_bitset(bitset) == count_set(set);
+  Vector v = to_vector_bitset(bitset);
+  ok = ok && same_members(&v, set);
+  destroy_vector(&v);
+  for (i = 0; ok && i < RANGE; i++) {
+    ok = test_bit_bitset(bitset, i) == set[i] &&
+         (i % 4099 != 0 || rank_bitset(bitset, i) == rank);
+    rank += set[i];
+  }
+  build_rank_bitset(bitset);
+  for (i = 0, rank = 0; ok && i < RANGE; i++) {
+    ok = rank_bitset(bitset, i) == rank;
+    rank += set[i];
+  }
+  return ok && rank_bitset(bitset, RANGE) == rank &&
+         !test_bit_bitset(bitset, RANGE);
+}
+
+static bool check_roaring(const Roaring *roaring, const bool *set) {
+  size_t i;
+  bool ok = count_roaring(roaring) == count_set(set);
+  Vector v = to_vector_roaring(roaring);
+  ok = ok && same_members(&v, set);
+  destroy_vector(&v);
+  for (i = 1; ok && i < roaring->size; i++)
+    ok = roaring->containers[i - 1].key < roaring->containers[i].key;
+  for (i = 0; ok && i < RANGE; i++)
+    ok = contains_roaring(roaring, (uint32_t)i) == set[i];
+  return ok && !contains_roaring(roaring, (uint32_t)RANGE) &&
+         !contains_roaring(roaring, UINT32_MAX);
+}
+
+static size_t count_type(const Roaring *roaring, int type) {
+  size_t i, n = 0;
+  for (i = 0; i < roaring->size; i++)
+    n += roaring->containers[i].type == type;
+  return n;
+}
+
+static bool check_roaring_ops(const Roaring *ra, const Roaring *rb,
+                              const bool *a, const bool *b, bool *expect) {
+  Roaring r = and_roaring(ra, rb);
+  bool ok;
+  combine(expect, a, b, OP_AND);
+  ok = check_roaring(&r, expect);
+  destroy_roaring(&r);
+  r = or_roaring(ra, rb);
+  combine(expect, a, b, OP_OR);
+  ok = ok && check_roaring(&r, expect);
+  destroy_roaring(&r);
+  return ok;
+}
+
+/*Container k of `a` and of `b` take profiles (k % 3, (k + k / 3) % 3) for
+ * k < 9, which pairs every profile with every other; key 9 is only in `a`
+ * and key 10 only in `b`.*/
+static bool check_all(void) {
+  bool *a = (bool *)calloc(RANGE, sizeof(bool));
+  bool *b = (bool *)calloc(RANGE, sizeof(bool));
+  bool *expect = (bool *)calloc(RANGE, sizeof(bool));
+  Vector va, vb;
+  Bitset ba, bb, dst, from;
+  Roaring ra, rb;
+  size_t k, i;
+  int op;
+  bool ok;
+  if (a == NULL || b == NULL || expect == NULL)
+    return false;
+  for (k = 0; k < 9; k++) {
+    fill_container(a, k, (int)(k % 3));
+    fill_container(b, k, (int)((k + k / 3) % 3));
+  }
+  fill_container(a, 9, DENSE);
+  fill_container(b, 10, SPARSE);
+  va = members(a, true);
+  vb = members(b, true);
+
+  ba = create_bitset(RANGE);
+  bb = create_bitset(RANGE);
+  dst = create_bitset(RANGE);
+  for (i = 0; i < va.size; i++)
+    set_bit_bitset(&ba, (size_t)va.arr[i]);
+  for (i = 0; i < vb.size; i++)
+    set_bit_bitset(&bb, (size_t)vb.arr[i]);
+  from = create_bitset_from_vector(&va);
+  ok = check_bitset(&ba, a) && check_bitset(&bb, b) &&
+       check_bitset(&from, a);
+  for (op = OP_AND; ok && op <= OP_ANDNOT; op++) {
+    void (*fn)(Bitset *, const Bitset *, const Bitset *) =
+        op == OP_AND   ? and_bitset
+        : op == OP_OR  ? or_bitset
+        : op == OP_XOR ? xor_bitset
+                       : andnot_bitset;
+    fn(&dst, &ba, &bb);
+    combine(expect, a, b, op);
+    ok = check_bitset(&dst, expect);
+    if (op == OP_AND)
+      ok = ok && and_count_bitset(&ba, &bb) == count_set(expect);
+  }
+
+  ra = create_roaring_from_vector(&va);
+  rb = create_roaring_from_vector(&vb);
+  ok = ok && check_roaring(&ra, a) && check_roaring(&rb, b) &&
+       count_type(&ra, ROARING_ARRAY) > 0 &&
+       count_type(&ra, ROARING_BITMAP) > 0 &&
+       check_roaring_ops(&ra, &rb, a, b, expect);
+  run_optimize_roaring(&ra);
+  run_optimize_roaring(&rb);
+  ok = ok && count_type(&ra, ROARING_RUN) == 3 &&
+       count_type(&rb, ROARING_RUN) == 3 && check_roaring(&ra, a) &&
+       check_roaring(&rb, b) && check_roaring_ops(&ra, &rb, a, b, expect);
+  /*adding to a run container turns it back into a bitmap*/
+  for (i = 2 << 16; ok && i < 3 << 16; i += 1 + next_random() % 64) {
+    add_roaring(&ra, (uint32_t)i);
+    a[i] = true;
+  }
+  ok = ok && count_type(&ra, ROARING_RUN) == 2 && check_roaring(&ra, a) &&
+       check_roaring_ops(&ra, &rb, a, b, expect);
+  /*clearing drops the rank directory built by the check*/
+  for (i = 0; ok && i < RANGE; i += 1 + next_random() % 512) {
+    clear_bit_bitset(&bb, i);
+    b[i] = false;
+  }
+  ok = ok && check_bitset(&bb, b);
+
+  destroy_vector(&va);
+  destroy_vector(&vb);
+  destroy_bitset(&ba);
+  destroy_bitset(&bb);
+  destroy_bitset(&dst);
+  destroy_bitset(&from);
+  destroy_roaring(&ra);
+  destroy_roaring(&rb);
+  free(a);
+  free(b);
+  free(expect);
+  return ok;
+}
+
+/*Sorted members below BITS: one value in four, one in 256, or runs and gaps
+ * of 64 to 1024 values. Writes them to `out` unless it is NULL and returns
+ * how many there are.*/
+static size_t generate_profile(int *out, int profile) {
+  size_t i = 0, n = 0;
+  while (i < BITS) {
+    if (profile == RUNS) {
+      size_t run = 64 + next_random() % 961;
+      for (; run > 0 && i < BITS; run--, i++) {
+        if (out != NULL)
+          out[n] = (int)i;
+        n++;
+      }
+      i += 64 + next_random() % 961;
+    } else {
+      if (next_random() % (profile == DENSE ? 4 : 256) == 0) {
+        if (out != NULL)
+          out[n] = (int)i;
+        n++;
+      }
+      i++;
+    }
+  }
+  return n;
+}
+
+/*Replaces `v` with a fresh set: one pass counts, a second with the same
+ * random numbers fills.*/
+static void fill_profile(Vector *v, int profile) {
+  unsigned int start = seed;
+  size_t n = generate_profile(NULL, profile);
+  destroy_vector(v);
+  seed = start;
+  *v = create_vector(n);
+  generate_profile(v->arr, profile);
+}
+
+static void build_sets(const Vector *v, Bitset *bitset, Roaring *roaring) {
+  size_t i;
+  *bitset = create_bitset(BITS);
+  *roaring = create_roaring();
+  for (i = 0; i < v->size; i++) {
+    set_bit_bitset(bitset, (size_t)v->arr[i]);
+    add_roaring(roaring, (uint32_t)v->arr[i]);
+  }
+  run_optimize_roaring(roaring);
+}
+
+static size_t merge_count(const Vector *a, const Vector *b) {
+  size_t i = 0, j = 0, count = 0;
+  while (i < a->size && j < b->size) {
+    if (a->arr[i] < b->arr[j]) {
+      i++;
+    } else if (a->arr[i] > b->arr[j]) {
+      j++;
+    } else {
+      count++;
+      i++;
+      j++;
+    }
+  }
+  return count;
+}
+
+static void run_merge(BitsetBench *b) {
+  sink = merge_count(&b->a, &b->b);
+}
+
+static void run_and_bitset(BitsetBench *b) {
+  and_bitset(&b->dst, &b->ba, &b->bb);
+  sink = b->dst.words[0];
+}
+
+static void run_and_count_bitset(BitsetBench *b) {
+  sink = and_count_bitset(&b->ba, &b->bb);
+}
+
+static void run_and_roaring(BitsetBench *b) {
+  Roaring r = and_roaring(&b->ra, &b->rb);
+  sink = r.size;
+  destroy_roaring(&r);
+}
+
+/*The binary search a sorted Vector needs for the same question.*/
+static void run_search(BitsetBench *b) {
+  size_t i, found = 0;
+  for (i = 0; i < LOOKUPS; i++) {
+    size_t lo = 0, hi = b->a.size;
+    int value = (int)b->probes[i];
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (b->a.arr[mid] < value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    found += lo < b->a.size && b->a.arr[lo] == value;
+  }
+  sink = found;
+}
+
+static void run_test_bit(BitsetBench *b) {
+  size_t i, found = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    found += test_bit_bitset(&b->ba, b->probes[i]);
+  sink = found;
+}
+
+static void run_contains(BitsetBench *b) {
+  size_t i, found = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    found += contains_roaring(&b->ra, b->probes[i]);
+  sink = found;
+}
+
+/*Runs `c` once to warm up, then repeatedly for MIN_SECONDS, and reports the
+ * rate.*/
+static void time_case(const BitsetCase *c, const char *profile,
+                      BitsetBench *b) {
+  char name[64];
+  double start, seconds;
+  long runs = 0;
+  snprintf(name, sizeof name, "%s %s", c->name, profile);
+  c->run(b);
+  start = bench_now();
+  do {
+    c->run(b);
+    runs++;
+  } while ((seconds = bench_now() - start) < MIN_SECONDS);
+  bench_report(name, c->items * (double)runs, seconds, c->unit);
+}
+
+int main(void) {
+  static const char *profiles[3] = {"sparse", "dense", "runs"};
+  BitsetBench b;
+  size_t i;
+  int p;
+
+  if (!check_all()) {
+    fprintf(stderr, "ERROR: Bitset or Roaring differs from the reference.\n");
+    return 1;
+  }
+  b.a = create_vector(0);
+  b.b = create_vector(0);
+  b.dst = create_bitset(BITS);
+  b.probes = (uint32_t *)malloc(LOOKUPS * sizeof(uint32_t));
+  for (i = 0; i < LOOKUPS; i++)
+    b.probes[i] = (uint32_t)(next_random() % BITS);
+  for (p = SPARSE; p <= RUNS; p++) {
+    BitsetCase cases[7] = {
+        {"merge sorted Vectors", run_merge, BITS / 64, "word"},
+        {"and_bitset", run_and_bitset, BITS / 64, "word"},
+        {"and_count_bitset", run_and_count_bitset, BITS / 64, "word"},
+        {"and_roaring", run_and_roaring, BITS / 64, "word"},
+        {"binary search", run_search, LOOKUPS, "probe"},
+        {"test_bit_bitset", run_test_bit, LOOKUPS, "probe"},
+        {"contains_roaring", run_contains, LOOKUPS, "probe"},
+    };
+    size_t c, vector_bytes, bitset_bytes, roaring_bytes, common;
+    Roaring r;
+    fill_profile(&b.a, p);
+    fill_profile(&b.b, p);
+    build_sets(&b.a, &b.ba, &b.ra);
+    build_sets(&b.b, &b.bb, &b.rb);
+    r = and_roaring(&b.ra, &b.rb);
+    common = merge_count(&b.a, &b.b);
+    if (and_count_bitset(&b.ba, &b.bb) != common ||
+        count_roaring(&r) != common) {
+      fprintf(stderr, "ERROR: %s intersections disagree.\n", profiles[p]);
+      return 1;
+    }
+    destroy_roaring(&r);
+    vector_bytes = b.a.size * sizeof(int);
+    bitset_bytes = b.ba.nwords * sizeof(uint64_t);
+    roaring_bytes = size_in_bytes_roaring(&b.ra);
+    printf("%s: %zu of %zu values, Vector %zu KiB, Bitset %zu KiB, Roaring "
+           "%zu KiB (%.1fx smaller than the Vector)\n",
+           profiles[p], b.a.size, BITS, vector_bytes >> 10, bitset_bytes >> 10,
+           roaring_bytes >> 10, (double)vector_bytes / (double)roaring_bytes);
+    for (c = 0; c < sizeof cases / sizeof cases[0]; c++)
+      time_case(&cases[c], profiles[p], &b);
+    destroy_bitset(&b.ba);
+    destroy_bitset(&b.bb);
+    destroy_roaring(&b.ra);
+    destroy_roaring(&b.rb);
+  }
+  free(b.probes);
+  destroy_vector(&b.a);
+  destroy_vector(&b.b);
+  destroy_bitset(&b.dst);
+  return 0;
+}
@@ -0,0 +1,212 @@
+#include "bench.h"
+#include "../convec.h"
+
+#include <pthread.h>
+
+/*Checks that concurrent pushes land exactly once, in per thread order, with
+ * element pointers that survive growth, while a reader follows the writers,
+ * then compares appending from 1 to 8 threads against a Vector behind a
+ * mutex.*/
+
+#define ITEMS (4u << 20)
+#define CHECK_ITEMS (1u << 20)
+#define THREADS 8
+#define BATCH 64
+
+typedef struct ConvecBench ConvecBench;
+
+typedef struct {
+  ConvecBench *bench;
+  size_t thread;
+} ConvecWorker;
+
+struct ConvecBench {
+  ConcurrentVector cv;
+  Vector v;
+  pthread_mutex_t lock;
+  size_t threads, per_thread;
+  void *(*body)(void *);
+  ConvecWorker workers[THREADS];
+  size_t published[THREADS]; /*last index pushed by each thread, plus 1*/
+  int stop_reader;
+};
+
+static void *push_concurrent(void *arg) {
+  ConvecWorker *w = (ConvecWorker *)arg;
+  ConvecBench *b = w->bench;
+  size_t i;
+  for (i = 0; i < b->per_thread; i++) {
+    size_t index = push_back_concurrent_vector(
+        &b->cv, (int)(w->thread << 24 | i));
+    __atomic_store_n(&b->published[w->thread], index + 1, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+static void *append_concurrent(void *arg) {
+  ConvecWorker *w = (ConvecWorker *)arg;
+  ConvecBench *b = w->bench;
+  int values[BATCH];
+  size_t i, j;
+  for (i = 0; i < b->per_thread; i += BATCH) {
+    for (j = 0; j < BATCH; j++)
+      values[j] = (int)(w->thread << 24 | (i + j));
+    append_concurrent_vector(&b->cv, values, BATCH);
+  }
+  return NULL;
+}
+
+static void *push_locked(void *arg) {
+  ConvecWorker *w = (ConvecWorker *)arg;
+  ConvecBench *b = w->bench;
+  size_t i;
+  for (i = 0; i < b->per_thread; i++) {
+    pthread_mutex_lock(&b->lock);
+    push_back_vector(&b->v, (int)(w->thread << 24 | i));
+    pthread_mutex_unlock(&b->lock);
+  }
+  return NULL;
+}
+
+/*Reads the last element each writer published, which must be its own;
+ * returns NULL if one is not.*/
+static void *follow_writers(void *arg) {
+  ConvecBench *b = (ConvecBench *)arg;
+  size_t reads = 1, t;
+  while (!__atomic_load_n(&b->stop_reader, __ATOMIC_ACQUIRE))
+    for (t = 0; t < b->threads; t++) {
+      size_t last = __atomic_load_n(&b->published[t], __ATOMIC_ACQUIRE);
+      if (last > 0 &&
+          (size_t)get_index_concurrent_vector(&b->cv, last - 1) >> 24 != t)
+        return NULL;
+      reads++;
+    }
+  return (void *)reads;
+}
+
+static void run_threads(ConvecBench *b) {
+  pthread_t threads[THREADS];
+  size_t t;
+  for (t = 0; t < b->threads; t++) {
+    b->workers[t].bench = b;
+    b->workers[t].thread = t;
+    pthread_create(&threads[t], NULL, b->body, &b->workers[t]);
+  }
+  for (t = 0; t < b->threads; t++)
+    pthread_join(threads[t], NULL);
+}
+
+/*Every value once, and each thread's values at increasing indices.*/
+static bool check_contents(ConvecBench *b) {
+  size_t *next = (size_t *)calloc(b->threads, sizeof(size_t));
+  size_t k, i, seen = 0;
+  bool ok = get_size_concurrent_vector(&b->cv) == b->threads * b->per_thread;
+  for (k = 0; ok && k < CONCURRENT_VECTOR_SEGMENTS; k++) {
+    VectorSpan span = get_segment_concurrent_vector(&b->cv, k);
+    for (i = 0; ok && i < span.size; i++) {
+      size_t t = (size_t)span.data[i] >> 24;
+      ok = t < b->threads && (size_t)(span.data[i] & 0xffffff) == next[t]++;
+    }
+    seen += span.size;
+  }
+  free(next);
+  return ok && seen == b->threads * b->per_thread;
+}
+
+static bool check_concurrent(ConvecBench *b) {
+  pthread_t reader;
+  void *reads;
+  int *first;
+  size_t i;
+  bool ok;
+  /*the first element does not move while the vector grows 1000 times over*/
+  create_concurrent_vector(&b->cv);
+  push_back_concurrent_vector(&b->cv, 42);
+  first = get_pointer_concurrent_vector(&b->cv, 0);
+  for (i = 1; i < CHECK_ITEMS; i++)
+    push_back_concurrent_vector(&b->cv, (int)i);
+  ok = first == get_pointer_concurrent_vector(&b->cv, 0) && *first == 42 &&
+       get_index_concurrent_vector(&b->cv, CHECK_ITEMS - 1) ==
+           (int)CHECK_ITEMS - 1;
+  destroy_concurrent_vector(&b->cv);
+
+  b->threads = 4;
+  b->per_thread = CHECK_ITEMS / 4;
+  b->body = push_concurrent;
+  b->stop_reader = 0;
+  memset(b->published, 0, sizeof b->published);
+  create_concurrent_vector(&b->cv);
+  pthread_create(&reader, NULL, follow_writers, b);
+  run_threads(b);
+  __atomic_store_n(&b->stop_reader, 1, __ATOMIC_RELEASE);
+  pthread_join(reader, &reads);
+  ok &= reads != NULL && check_contents(b);
+  destroy_concurrent_vector(&b->cv);
+
+  /*appends straddle segment boundaries; reserve allocates up front*/
+  create_concurrent_vector(&b->cv);
+  ok &= reserve_concurrent_vector(&b->cv, CHECK_ITEMS) == 0 &&
+        b->cv.segments[CONCURRENT_VECTOR_SEGMENTS - 1] == NULL;
+  b->body = append_concurrent;
+  run_threads(b);
+  ok &= check_contents(b);
+  destroy_concurrent_vector(&b->cv);
+  return ok;
+}
+
+static void empty_concurrent(void *ctx) {
+  ConvecBench *b = (ConvecBench *)ctx;
+  destroy_concurrent_vector(&b->cv);
+  create_concurrent_vector(&b->cv);
+}
+
+/*The Vector keeps its capacity between runs, so the locked baseline does
+ * not pay for reallocation.*/
+static void empty_locked(void *ctx) {
+  ((ConvecBench *)ctx)->v.size = 0;
+}
+
+static void run(void *ctx) { run_threads((ConvecBench *)ctx); }
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  static ConvecBench b;
+  void *(*bodies[3])(void *) = {push_locked, push_concurrent,
+                                append_concurrent};
+  size_t threads;
+  int c;
+
+  pthread_mutex_init(&b.lock, NULL);
+  if (!check_concurrent(&b)) {
+    fprintf(stderr, "ERROR: concurrent vector lost or moved elements.\n");
+    return 1;
+  }
+  b.v = create_vector(ITEMS);
+  create_concurrent_vector(&b.cv);
+  for (threads = 1; threads <= THREADS; threads *= 2) {
+    BenchCase cases[3] = {
+        {"mutex + push_back_vector", empty_locked, run, ITEMS, "elem"},
+        {"push_back_concurrent_vector", empty_concurrent, run, ITEMS, "elem"},
+        {"append_concurrent_vector x64", empty_concurrent, run, ITEMS,
+         "elem"},
+    };
+    char names[3][64];
+    b.threads = threads;
+    b.per_thread = ITEMS / threads;
+    for (c = 0; c < 3; c++) {
+      snprintf(names[c], sizeof names[c], "%s threads=%zu", cases[c].name,
+               threads);
+      cases[c].name = names[c];
+      b.body = bodies[c];
+      bench_case(&options, &cases[c], &b);
+    }
+    if (!check_contents(&b)) {
+      fprintf(stderr, "ERROR: concurrent vector lost or moved elements.\n");
+      return 1;
+    }
+  }
+  destroy_concurrent_vector(&b.cv);
+  destroy_vector(&b.v);
+  pthread_mutex_destroy(&b.lock);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "bench.h"
+#include "../grid.h"
+
+/*8-neighbor sum stencil over a hand-rolled `int **` grid with bounds checks
+ * against the same stencil over a Grid, through the iterator and through the
+ * neighbor offsets.*/
+
+#define SIDE 2048
+#define STEPS 10
+
+static int **create_pointer_grid(size_t rows, size_t cols) {
+  size_t r;
+  int **grid = (int **)malloc(rows * sizeof(int *));
+  for (r = 0; r < rows; r++)
+    grid[r] = (int *)calloc(cols, sizeof(int));
+  return grid;
+}
+
+static void destroy_pointer_grid(int **grid, size_t rows) {
+  size_t r;
+  for (r = 0; r < rows; r++)
+    free(grid[r]);
+  free(grid);
+}
+
+static long long stencil_pointer_grid(int **src, int **dst, long rows,
+                                      long cols) {
+  long r, c, k;
+  long long checksum = 0;
+  for (r = 0; r < rows; r++)
+    for (c = 0; c < cols; c++) {
+      int sum = 0;
+      for (k = 0; k < 8; k++) {
+        long nr = r + grid_neighbor_dr[k], nc = c + grid_neighbor_dc[k];
+        if (nr >= 0 && nr < rows && nc >= 0 && nc < cols)
+          sum += src[nr][nc];
+      }
+      dst[r][c] = sum & 0xff;
+      checksum += dst[r][c];
+    }
+  return checksum;
+}
+
+static long long stencil_grid(const Grid *src, Grid *dst) {
+  long long checksum = 0;
+  GridIterator it = begin_grid(src);
+  while (next_grid(&it)) {
+    int value = sum_neighbors_grid(&it) & 0xff;
+    dst->cells[it.index] = value;
+    checksum += value;
+  }
+  return checksum;
+}
+
+/*The same stencil written directly against the row-major storage, the way a
+ * hot loop would use `neighbor_offsets`.*/
+static long long stencil_offsets_grid(const Grid *src, Grid *dst) {
+  const ptrdiff_t *off = src->neighbor_offsets;
+  long long checksum = 0;
+  size_t r, c;
+  for (r = 1; r <= src->rows; r++) {
+    const int *row = src->cells + r * src->stride;
+    int *out = dst->cells + r * dst->stride;
+    for (c = 1; c <= src->cols; c++) {
+      const int *p = row + c;
+      int value = (p[off[0]] + p[off[1]] + p[off[2]] + p[off[3]] + p[off[4]] +
+                   p[off[5]] + p[off[6]] + p[off[7]]) &
+                  0xff;
+      out[c] = value;
+      checksum += value;
+    }
+  }
+  return checksum;
+}
+
+static long long run_pointer(void) {
+  int **a = create_pointer_grid(SIDE, SIDE);
+  int **b = create_pointer_grid(SIDE, SIDE);
+  long r, c;
+  int step;
+  long long checksum = 0;
+  double start;
+  for (r = 0; r < SIDE; r++)
+    for (c = 0; c < SIDE; c++)
+      a[r][c] = (int)((r * 31 + c * 17) & 7);
+  start = bench_now();
+  for (step = 0; step < STEPS; step++) {
+    checksum = stencil_pointer_grid(a, b, SIDE, SIDE);
+    {
+      int **t = a;
+      a = b;
+      b = t;
+    }
+  }
+  bench_report("int** with bounds checks", (double)SIDE * SIDE * STEPS,
+               bench_now() - start, "cells");
+  destroy_pointer_grid(a, SIDE);
+  destroy_pointer_grid(b, SIDE);
+  return checksum;
+}
+
+static long long run_grid(int layout, bool offsets, const char *name) {
+  Grid a = create_grid(SIDE, SIDE, layout), b = create_grid(SIDE, SIDE, layout);
+  long r, c;
+  int step;
+  long long checksum = 0;
+  double start;
+  for (r = 0; r < SIDE; r++)
+    for (c = 0; c < SIDE; c++)
+      set_grid(&a, r, c, (int)((r * 31 + c * 17) & 7));
+  start = bench_now();
+  for (step = 0; step < STEPS; step++) {
+    checksum = offsets ? stencil_offsets_grid(&a, &b) : stencil_grid(&a, &b);
+    {
+      Grid t = a;
+      a = b;
+      b = t;
+    }
+  }
+  bench_report(name, (double)SIDE * SIDE * STEPS, bench_now() - start,
+               "cells");
+  destroy_grid(&a);
+  destroy_grid(&b);
+  return checksum;
+}
+
+int main(void) {
+  long long expected = run_pointer();
+  if (run_grid(GRID_ROW_MAJOR, false, "Grid row-major") != expected ||
+      run_grid(GRID_ROW_MAJOR, true, "Grid row-major offsets") != expected) {
+    fprintf(stderr, "ERROR: Grid stencil does not match int** stencil.\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,215 @@
+#include "bench.h"
+#include "../label.h"
+
+/*Checks labels, sizes and bounding boxes against a breadth-first flood fill
+ * over random grids, for several block sizes and thread counts, and checks
+ * `flood_fill_grid` against the labels. Then labels 100 megapixel grids: salt
+ * and pepper noise that breaks into millions of small components, denser
+ * noise that percolates into one, and a few large blobs.*/
+
+#define SIDE 10000
+
+enum { SPARSE, DENSE, BLOBS, CLASSES };
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+/*0/1 noise at 30% and 60%, blocky blobs with 1% noise, or 0..3.*/
+static void seed_grid(Grid *grid, int kind) {
+  long r, c;
+  for (r = 0; r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++) {
+      int value;
+      switch (kind) {
+      case SPARSE:
+        value = next_random() % 100 < 30;
+        break;
+      case DENSE:
+        value = next_random() % 100 < 60;
+        break;
+      case BLOBS:
+        value = ((r / 97) * 7 + (c / 89) * 3) % 5 < 2 ||
+                next_random() % 100 == 0;
+        break;
+      default:
+        value = (int)(next_random() % 4);
+        break;
+      }
+      set_grid(grid, r, c, value);
+    }
+}
+
+/*The breadth-first reference: a new component at each unlabeled cell in
+ * row-major order. The label halo is -1 while it runs, so neighbors past the
+ * edge look labeled.*/
+static void reference_labels(const Grid *grid, GridLabels *labels,
+                             int background) {
+  size_t stride = grid->stride, components = 0, capacity = 16, i;
+  int *queue = (int *)malloc((grid->rows * grid->cols + 1) * sizeof(int));
+  int *out;
+  labels->labels = create_grid(grid->rows, grid->cols, GRID_ROW_MAJOR);
+  labels->components =
+      (GridComponent *)malloc(capacity * sizeof(GridComponent));
+  out = labels->labels.cells;
+  fill_halo_grid(&labels->labels, -1);
+  for (i = 0; i < grid->capacity; i++) {
+    int value = grid->cells[i];
+    size_t head = 0, tail = 0;
+    GridComponent *component;
+    if (out[i] != 0 || value == background)
+      continue;
+    if (components == capacity) {
+      capacity *= 2;
+      labels->components = (GridComponent *)realloc(
+          labels->components, capacity * sizeof(GridComponent));
+    }
+    component = &labels->components[components++];
+    component->value = value;
+    component->cells = 0;
+    component->top = component->bottom = (long)(i / stride) - 1;
+    component->left = component->right = (long)(i % stride) - 1;
+    out[i] = (int)components;
+    queue[tail++] = (int)i;
+    while (head < tail) {
+      size_t at = (size_t)queue[head++];
+      long r = (long)(at / stride) - 1, c = (long)(at % stride) - 1;
+      int k;
+      component->cells++;
+      component->top = r < component->top ? r : component->top;
+      component->bottom = r > component->bottom ? r : component->bottom;
+      component->left = c < component->left ? c : component->left;
+      component->right = c > component->right ? c : component->right;
+      for (k = 0; k < 8; k++) {
+        size_t n = (size_t)((ptrdiff_t)at + grid->neighbor_offsets[k]);
+        if (out[n] == 0 && grid->cells[n] == value) {
+          out[n] = (int)components;
+          queue[tail++] = (int)n;
+        }
+      }
+    }
+  }
+  fill_halo_grid(&labels->labels, 0);
+  labels->count = components;
+  free(queue);
+}
+
+static bool same_labels(const GridLabels *a, const GridLabels *b) {
+  size_t i;
+  if (a->count != b->count ||
+      memcmp(a->labels.cells, b->labels.cells,
+             a->labels.capacity * sizeof(int)) != 0)
+    return false;
+  for (i = 0; i < a->count; i++) {
+    const GridComponent *x = &a->components[i], *y = &b->components[i];
+    if (x->value != y->value || x->cells != y->cells || x->top != y->top ||
+        x->left != y->left || x->bottom != y->bottom || x->right != y->right)
+      return false;
+  }
+  return true;
+}
+
+/*Refills one component and checks that exactly its cells changed.*/
+static bool check_flood_fill(Grid *grid, const GridLabels *labels) {
+  const GridComponent *component;
+  long r, c, row, col;
+  int label;
+  bool ok;
+  if (labels->count == 0)
+    return true;
+  label = (int)(next_random() % labels->count) + 1;
+  component = &labels->components[label - 1];
+  row = component->top;
+  for (col = component->left; get_grid(&labels->labels, row, col) != label;)
+    col++;
+  ok = flood_fill_grid(grid, row, col, 1000) == component->cells;
+  for (r = 0; ok && r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++)
+      if ((get_grid(grid, r, c) == 1000) !=
+          (get_grid(&labels->labels, r, c) == label))
+        ok = false;
+  return ok;
+}
+
+static bool check_grid(size_t rows, size_t cols, int kind, int background) {
+  static const size_t block_rows[3] = {1, 3, 64};
+  Grid grid = create_grid(rows, cols, GRID_ROW_MAJOR);
+  LabelOptions options = default_label_options();
+  GridLabels expected, actual;
+  int b, threads;
+  bool ok = true;
+  seed_grid(&grid, kind);
+  fill_halo_grid(&grid, kind == CLASSES ? 2 : 1); /*must not leak in*/
+  reference_labels(&grid, &expected, background);
+  options.background = background;
+  for (b = 0; ok && b < 3; b++)
+    for (threads = 1; ok && threads <= 4; threads += 3) {
+      options.block_rows = block_rows[b];
+      options.threads = threads;
+      ok = label_grid(&grid, &actual, &options) == 0 &&
+           same_labels(&expected, &actual);
+      destroy_grid_labels(&actual);
+    }
+  ok &= check_flood_fill(&grid, &expected);
+  destroy_grid_labels(&expected);
+  destroy_grid(&grid);
+  return ok;
+}
+
+static bool check_all(void) {
+  static const size_t shapes[6][2] = {{1, 1},  {1, 97},   {97, 1},
+                                      {2, 2},  {37, 53},  {300, 211}};
+  int s, kind;
+  bool ok = true;
+  for (s = 0; s < 6; s++)
+    for (kind = SPARSE; kind <= CLASSES; kind++)
+      ok &= check_grid(shapes[s][0], shapes[s][1], kind, 0);
+  ok &= check_grid(300, 211, CLASSES, -1); /*every cell is labeled*/
+  return ok;
+}
+
+/*The same breadth-first fill, timed as the single threaded baseline.*/
+static void bench_reference(const Grid *grid, const char *name) {
+  GridLabels labels;
+  char label[64];
+  double start = bench_now();
+  reference_labels(grid, &labels, 0);
+  snprintf(label, sizeof label, "%s bfs", name);
+  bench_report(label, (double)SIDE * SIDE, bench_now() - start, "cells");
+  destroy_grid_labels(&labels);
+}
+
+static void bench_labels(const Grid *grid, const char *name, int threads) {
+  LabelOptions options = default_label_options();
+  GridLabels labels;
+  char label[64];
+  double start;
+  options.threads = threads;
+  start = bench_now();
+  label_grid(grid, &labels, &options);
+  snprintf(label, sizeof label, "%s t=%d (%zu)", name, threads, labels.count);
+  bench_report(label, (double)SIDE * SIDE, bench_now() - start, "cells");
+  destroy_grid_labels(&labels);
+}
+
+int main(void) {
+  static const char *names[] = {"sparse", "dense", "blobs"};
+  int cpus = default_label_options().threads, kind, threads;
+
+  if (!check_all()) {
+    fprintf(stderr, "ERROR: labels differ from the reference.\n");
+    return 1;
+  }
+  for (kind = SPARSE; kind <= BLOBS; kind++) {
+    Grid grid = create_grid(SIDE, SIDE, GRID_ROW_MAJOR);
+    seed_grid(&grid, kind);
+    bench_reference(&grid, names[kind]);
+    for (threads = 1; threads <= cpus; threads *= 2)
+      bench_labels(&grid, names[kind], threads);
+    destroy_grid(&grid);
+  }
+  return 0;
+}
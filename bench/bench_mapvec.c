@@ -0,0 +1,150 @@
+#include "bench.h"
+#include "../mapvec.h"
+#include "../vecops.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*Checks that a mapped vector survives close and reopen (read only, grown,
+ * resized) and rejects foreign files, then compares rebuilding a Vector
+ * from text with fscanf against opening the mapped file and summing it.*/
+
+#define ITEMS (4u << 20)
+#define TEXT_ITEMS (1u << 20)
+#define PATH "/tmp/bench_mapvec.vec"
+#define TEXT_PATH "/tmp/bench_mapvec.txt"
+
+typedef struct {
+  MappedVector m;
+  Vector v;
+} MapvecBench;
+
+static volatile long long sink;
+
+static bool check_mapped(void) {
+  MappedVector m;
+  FILE *garbage;
+  int terminal = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+  size_t i;
+  bool ok = true;
+  if (open_mapped_vector(&m, PATH,
+                         MAPPED_VECTOR_CREATE | MAPPED_VECTOR_TRUNCATE) != 0)
+    return false;
+  for (i = 0; i < ITEMS; i++)
+    ok &= push_back_mapped_vector(&m, (int)(i * 7)) == 0;
+  ok &= close_mapped_vector(&m) == 0;
+
+  ok &= open_mapped_vector(&m, PATH, MAPPED_VECTOR_READ_ONLY) == 0;
+  ok &= m.vector.size == ITEMS && m.vector.capacity == ITEMS;
+  for (i = 0; ok && i < ITEMS; i++)
+    ok &= m.vector.arr[i] == (int)(i * 7);
+  close_mapped_vector(&m);
+
+  /*shrink, then grow again: the old values must come back as 0*/
+  ok &= open_mapped_vector(&m, PATH, 0) == 0;
+  ok &= resize_mapped_vector(&m, 10) == 0 &&
+        resize_mapped_vector(&m, ITEMS + 10) == 0;
+  for (i = 10; ok && i < ITEMS + 10; i++)
+    ok &= m.vector.arr[i] == 0;
+  m.vector.arr[ITEMS + 9] = -1;
+  ok &= sync_mapped_vector(&m, true) == 0;
+  ok &= advise_mapped_vector(&m, 0, m.vector.size,
+                             MAPPED_VECTOR_SEQUENTIAL) == 0;
+  ok &= sum_vector(&m.vector, NULL) == 7 * 45 - 1;
+  close_mapped_vector(&m);
+  ok &= open_mapped_vector(&m, PATH, MAPPED_VECTOR_READ_ONLY) == 0 &&
+        m.vector.size == ITEMS + 10 && m.vector.arr[ITEMS + 9] == -1;
+  close_mapped_vector(&m);
+
+  garbage = fopen(TEXT_PATH, "w");
+  fprintf(garbage, "not a vector\n");
+  fclose(garbage);
+  /*mute the expected errors*/
+  fflush(stderr);
+  dup2(null, STDERR_FILENO);
+  ok &= open_mapped_vector(&m, PATH, MAPPED_VECTOR_READ_ONLY) == 0 &&
+        push_back_mapped_vector(&m, 1) == -1;
+  close_mapped_vector(&m);
+  ok &= open_mapped_vector(&m, TEXT_PATH, MAPPED_VECTOR_READ_ONLY) == -1;
+  dup2(terminal, STDERR_FILENO);
+  close(terminal);
+  close(null);
+  return ok;
+}
+
+static void write_files(void) {
+  MappedVector m;
+  FILE *text = fopen(TEXT_PATH, "w");
+  size_t i;
+  for (i = 0; i < TEXT_ITEMS; i++)
+    fprintf(text, "%d\n", (int)(i * 2654435761u) >> 4);
+  fclose(text);
+  open_mapped_vector(&m, PATH, MAPPED_VECTOR_CREATE | MAPPED_VECTOR_TRUNCATE);
+  resize_mapped_vector(&m, ITEMS);
+  for (i = 0; i < ITEMS; i++)
+    m.vector.arr[i] = (int)(i * 2654435761u) >> 4;
+  close_mapped_vector(&m);
+}
+
+static void run_fscanf(void *ctx) {
+  MapvecBench *b = (MapvecBench *)ctx;
+  FILE *text = fopen(TEXT_PATH, "r");
+  b->v.size = 0;
+  while (b->v.size < b->v.capacity &&
+         fscanf(text, "%d", &b->v.arr[b->v.size]) == 1)
+    b->v.size++;
+  fclose(text);
+}
+
+static void run_open(void *ctx) {
+  MapvecBench *b = (MapvecBench *)ctx;
+  open_mapped_vector(&b->m, PATH, MAPPED_VECTOR_READ_ONLY);
+  close_mapped_vector(&b->m);
+}
+
+static void run_open_sum(void *ctx) {
+  MapvecBench *b = (MapvecBench *)ctx;
+  open_mapped_vector(&b->m, PATH, MAPPED_VECTOR_READ_ONLY);
+  advise_mapped_vector(&b->m, 0, b->m.vector.size, MAPPED_VECTOR_SEQUENTIAL);
+  sink = sum_vector(&b->m.vector, NULL);
+  close_mapped_vector(&b->m);
+}
+
+static void truncate_file(void *ctx) {
+  MapvecBench *b = (MapvecBench *)ctx;
+  open_mapped_vector(&b->m, PATH,
+                     MAPPED_VECTOR_CREATE | MAPPED_VECTOR_TRUNCATE);
+}
+
+static void run_push_back(void *ctx) {
+  MapvecBench *b = (MapvecBench *)ctx;
+  size_t i;
+  for (i = 0; i < ITEMS; i++)
+    push_back_mapped_vector(&b->m, (int)i);
+  close_mapped_vector(&b->m);
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  MapvecBench b;
+  BenchCase cases[] = {
+      {"fscanf text load", NULL, run_fscanf, TEXT_ITEMS, "elem"},
+      {"open_mapped_vector", NULL, run_open, 1, "open"},
+      {"open + sequential sum", NULL, run_open_sum, ITEMS, "elem"},
+      {"push_back_mapped_vector", truncate_file, run_push_back, ITEMS, "elem"},
+  };
+  size_t c;
+
+  if (!check_mapped()) {
+    fprintf(stderr, "ERROR: mapped vector lost or changed its contents.\n");
+    return 1;
+  }
+  write_files();
+  b.v = create_vector(TEXT_ITEMS);
+  for (c = 0; c < sizeof cases / sizeof cases[0]; c++)
+    bench_case(&options, &cases[c], &b);
+  destroy_vector(&b.v);
+  remove(PATH);
+  remove(TEXT_PATH);
+  return 0;
+}
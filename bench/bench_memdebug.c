@@ -0,0 +1,102 @@
+#include "bench.h"
+
+/*The memory debugger's malloc/free/realloc path (what MEMORY_DEBUG turns
+ * malloc, free and realloc into) with a live set of tracked allocations of
+ * growing size: the debugger keeps its records in per-line arrays, so the
+ * cost of free and realloc depends on how much is live.*/
+
+#define OPS 1024
+
+/*Declared by utils.h only under MEMORY_DEBUG, which would also redirect this
+ * file's own malloc and free.*/
+extern void debug_memory_init(void (*lock)(void *mutex),
+                              void (*unlock)(void *mutex), void *mutex);
+extern void *debug_mem_malloc(unsigned int size, char *file,
+                              unsigned int line);
+extern void *debug_mem_realloc(void *pointer, unsigned int size, char *file,
+                               unsigned int line);
+extern void debug_mem_free(void *buf);
+extern void debug_mem_reset(void);
+extern bool debug_memory(void);
+
+typedef struct {
+  void **live;
+  size_t live_count;
+  void *ops[OPS];
+} MemBench;
+
+static void live_set(MemBench *b, size_t count) {
+  size_t i;
+  debug_mem_reset();
+  b->live = (void **)calloc(count > 0 ? count : 1, sizeof(void *));
+  for (i = 0; i < count; i++)
+    b->live[i] = debug_mem_malloc(32, __FILE__, __LINE__);
+  b->live_count = count;
+}
+
+static void release_live_set(MemBench *b) {
+  size_t i;
+  for (i = 0; i < b->live_count; i++)
+    debug_mem_free(b->live[i]);
+  free(b->live);
+}
+
+static void run_malloc_free(void *ctx) {
+  MemBench *b = (MemBench *)ctx;
+  int i;
+  for (i = 0; i < OPS; i++)
+    b->ops[i] = debug_mem_malloc(48, __FILE__, __LINE__);
+  for (i = OPS - 1; i >= 0; i--)
+    debug_mem_free(b->ops[i]);
+}
+
+static void alloc_ops(void *ctx) {
+  MemBench *b = (MemBench *)ctx;
+  int i;
+  for (i = 0; i < OPS; i++)
+    b->ops[i] = debug_mem_malloc(48, __FILE__, __LINE__);
+}
+
+static void run_realloc(void *ctx) {
+  MemBench *b = (MemBench *)ctx;
+  int i;
+  for (i = 0; i < OPS; i++)
+    b->ops[i] = debug_mem_realloc(b->ops[i], 96, __FILE__, __LINE__);
+  for (i = OPS - 1; i >= 0; i--)
+    debug_mem_free(b->ops[i]);
+}
+
+static void run_libc_malloc_free(void *ctx) {
+  MemBench *b = (MemBench *)ctx;
+  int i;
+  for (i = 0; i < OPS; i++)
+    b->ops[i] = malloc(48);
+  for (i = OPS - 1; i >= 0; i--)
+    free(b->ops[i]);
+}
+
+int main(int argc, char **argv) {
+  static const size_t live_sizes[] = {0, 1000, 10000, 100000};
+  BenchOptions options = bench_options(argc, argv);
+  MemBench b;
+  char name[64];
+  size_t s;
+
+  debug_memory_init(NULL, NULL, NULL);
+  {
+    BenchCase c = {"libc malloc+free", NULL, run_libc_malloc_free, 2 * OPS,
+                   "call"};
+    bench_case(&options, &c, &b);
+  }
+  for (s = 0; s < sizeof live_sizes / sizeof live_sizes[0]; s++) {
+    BenchCase malloc_free = {name, NULL, run_malloc_free, 2 * OPS, "call"};
+    BenchCase realloc_free = {name, alloc_ops, run_realloc, 2 * OPS, "call"};
+    live_set(&b, live_sizes[s]);
+    snprintf(name, sizeof name, "malloc+free/live=%zu", live_sizes[s]);
+    bench_case(&options, &malloc_free, &b);
+    snprintf(name, sizeof name, "realloc+free/live=%zu", live_sizes[s]);
+    bench_case(&options, &realloc_free, &b);
+    release_live_set(&b);
+  }
+  return debug_memory() ? 1 : 0;
+}
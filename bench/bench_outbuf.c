@@ -0,0 +1,143 @@
+#include "bench.h"
+#include "../outbuf.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/*Checks that buffered lines carry escape codes when the buffer's file
+ * descriptor is a terminal and none when it is a file, even with stdout on a
+ * terminal. Then measures lines per second of color_print/debug_puts against
+ * the buffered versions with 1 to 32 threads. Output goes to /dev/null so the
+ * terminal is not the bottleneck being measured.*/
+
+#define LINES 100000
+
+enum { COLOR_PRINT, COLOR_PRINT_BUFFERED, DEBUG_PUTS, DEBUG_PUTS_BUFFERED };
+
+static int mode;
+static int lines_per_thread;
+
+static void *print_lines(void *arg) {
+  int i;
+  (void)arg;
+  for (i = 0; i < lines_per_thread; i++) {
+    switch (mode) {
+    case COLOR_PRINT:
+      color_print(RED, BG_BLACK, BOLD, "Warning: %s %d\n", "disk", i);
+      break;
+    case COLOR_PRINT_BUFFERED:
+      color_print_buffered(RED, BG_BLACK, BOLD, "Warning: %s %d\n", "disk", i);
+      break;
+    case DEBUG_PUTS:
+      debug_puts("loop", i, __FILE__);
+      break;
+    default:
+      debug_puts_buffered("loop", i, __FILE__);
+      break;
+    }
+  }
+  if (mode == COLOR_PRINT_BUFFERED || mode == DEBUG_PUTS_BUFFERED)
+    flush_output_buffer();
+  return NULL;
+}
+
+/*Prints one buffered line of each kind to `fd` and reads back what `in`
+ * received. Returns whether it held an escape code, or -1 on failure.*/
+static int escapes_printed(int fd, int in) {
+  char text[512];
+  ssize_t n;
+  set_output_buffer(fd, 1);
+  color_print_buffered(RED, BG_BLACK, BOLD, "Warning: %s\n", "disk");
+  debug_puts_buffered("loop", 1, __FILE__);
+  flush_output_buffer();
+  n = read(in, text, sizeof text - 1);
+  if (n <= 0)
+    return -1;
+  return memchr(text, '\033', (size_t)n) != NULL;
+}
+
+/*Stdout goes to a pseudo-terminal while the buffer writes to a file, then the
+ * buffer writes to the terminal too. Passes without a pseudo-terminal.*/
+static bool check_colors(void) {
+  char path[] = "/tmp/bench_outbuf_XXXXXX";
+  int master = posix_openpt(O_RDWR | O_NOCTTY), terminal, file, slave = -1;
+  bool ok = true;
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0 ||
+      (slave = open(ptsname(master), O_RDWR | O_NOCTTY)) < 0) {
+    if (master >= 0)
+      close(master);
+    return true;
+  }
+  terminal = dup(STDOUT_FILENO);
+  file = mkstemp(path);
+  fflush(stdout);
+  dup2(slave, STDOUT_FILENO);
+  if (file < 0 || !use_color()) {
+    ok = false;
+  } else {
+    int in = open(path, O_RDONLY);
+    ok = in >= 0 && escapes_printed(file, in) == 0 &&
+         escapes_printed(slave, master) == 1;
+    if (in >= 0)
+      close(in);
+  }
+  set_output_buffer(STDOUT_FILENO, 1);
+  dup2(terminal, STDOUT_FILENO);
+  close(terminal);
+  set_color_mode(COLOR_AUTO); /*stdout is no longer the pseudo-terminal*/
+  if (file >= 0) {
+    close(file);
+    remove(path);
+  }
+  close(slave);
+  close(master);
+  return ok;
+}
+
+static double run(int threads) {
+  pthread_t workers[32];
+  double start = bench_now();
+  int t;
+  lines_per_thread = LINES / threads;
+  for (t = 0; t < threads; t++)
+    pthread_create(&workers[t], NULL, print_lines, NULL);
+  for (t = 0; t < threads; t++)
+    pthread_join(workers[t], NULL);
+  fflush(stdout);
+  return bench_now() - start;
+}
+
+int main(void) {
+  static const char *names[] = {"color_print", "color_print_buffered",
+                                "debug_puts", "debug_puts_buffered"};
+  double seconds[4][6];
+  int terminal = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  int threads, i, m;
+
+  if (!check_colors()) {
+    fprintf(stderr, "ERROR: escape codes do not follow the descriptor.\n");
+    return 1;
+  }
+  fflush(stdout);
+  dup2(null, STDOUT_FILENO);
+  set_output_buffer(STDOUT_FILENO, 0);
+  for (m = COLOR_PRINT; m <= DEBUG_PUTS_BUFFERED; m++)
+    for (threads = 1, i = 0; threads <= 32; threads *= 2, i++) {
+      mode = m;
+      seconds[m][i] = run(threads);
+    }
+  dup2(terminal, STDOUT_FILENO);
+
+  for (m = COLOR_PRINT; m <= DEBUG_PUTS_BUFFERED; m++)
+    for (threads = 1, i = 0; threads <= 32; threads *= 2, i++) {
+      char label[64];
+      snprintf(label, sizeof label, "%s t=%d", names[m], threads);
+      bench_report(label, (double)(LINES / threads * threads), seconds[m][i],
+                   "lines");
+    }
+  close(null);
+  close(terminal);
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include "bench.h"
+#include "../packvec.h"
+#include "../vecops.h"
+
+/*Checks that packed vectors round trip (sorted and random data, outliers,
+ * every tail length) and answer get_index, sum and lower_bound like the
+ * plain Vector, then measures decode speed and size for sorted id lists
+ * with 4 and 8 bit gaps.*/
+
+#define ITEMS (8u << 20)
+#define LOOKUPS (1u << 16)
+#define SEARCHES 16
+
+typedef struct {
+  Vector ids, out;
+  PackedVector packed;
+  size_t *positions;
+  int *keys;
+} PackvecBench;
+
+static volatile long long sink;
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 4;
+}
+
+/*Sorted ids: gaps of 1 to `gap`, and a gap of `gap` << 8 every `outlier`
+ * elements (0 for none).*/
+static void fill_sorted(Vector *v, size_t n, unsigned int gap,
+                        unsigned int outlier) {
+  unsigned int id = 0;
+  size_t i;
+  v->size = n;
+  for (i = 0; i < n; i++) {
+    id += 1 + next_random() % gap;
+    if (outlier > 0 && i % outlier == outlier - 1)
+      id += gap << 8;
+    v->arr[i] = (int)id;
+  }
+}
+
+static size_t lower_bound(const Vector *v, int value) {
+  size_t lo = 0, hi = v->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (v->arr[mid] < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static bool check_packed(Vector *v, bool sorted) {
+  PackedVector packed;
+  PackedVectorIterator it;
+  Vector out = create_vector(1);
+  long long sum = 0;
+  size_t i, seen = 0;
+  bool ok = create_packed_vector(&packed, v) == 0;
+  ok &= unpack_vector(&out, &packed) == 0 && out.size == v->size &&
+        (v->size == 0 ||
+         memcmp(out.arr, v->arr, v->size * sizeof(int)) == 0);
+  for (i = 0; ok && i < v->size; i += 1 + next_random() % 97)
+    ok &= get_index_packed_vector(&packed, i) == v->arr[i];
+  for (i = 0; i < v->size; i++)
+    sum += v->arr[i];
+  ok &= sum_packed_vector(&packed) == sum;
+  begin_packed_vector(&it, &packed, 0);
+  while (ok && next_packed_vector(&it)) {
+    ok &= memcmp(it.view.arr, v->arr + seen, it.view.size * sizeof(int)) == 0;
+    seen += it.view.size;
+  }
+  ok &= seen == v->size;
+  for (i = 0; sorted && ok && i < 1000; i++) {
+    int key = v->size > 0 ? v->arr[next_random() % v->size] +
+                                (int)(next_random() % 3) - 1
+                          : 0;
+    ok &= lower_bound_packed_vector(&packed, key) == lower_bound(v, key);
+  }
+  if (sorted && v->size > 0)
+    ok &= lower_bound_packed_vector(&packed, v->arr[v->size - 1] + 1) ==
+              v->size &&
+          lower_bound_packed_vector(&packed, v->arr[0] - 1) == 0;
+  destroy_packed_vector(&packed);
+  destroy_vector(&out);
+  return ok;
+}
+
+static bool check_all(void) {
+  static const size_t sizes[] = {0, 1, 2, 255, 256, 257, 1000, 100003};
+  Vector v = create_vector(100003);
+  size_t s, i;
+  for (s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+    fill_sorted(&v, sizes[s], 16, 0);
+    if (!check_packed(&v, true))
+      return false;
+    fill_sorted(&v, sizes[s], 3000, 50);
+    if (!check_packed(&v, true))
+      return false;
+    /*full range random values: differences need all 32 bits*/
+    v.size = sizes[s];
+    for (i = 0; i < sizes[s]; i++)
+      v.arr[i] = (int)(next_random() << 4 ^ next_random());
+    if (!check_packed(&v, false))
+      return false;
+    /*constant, then decreasing with rare jumps*/
+    for (i = 0; i < sizes[s]; i++)
+      v.arr[i] = -7;
+    if (!check_packed(&v, true))
+      return false;
+    for (i = 0; i < sizes[s]; i++)
+      v.arr[i] = (int)(1000000 - i * 3 + (i % 300 == 0 ? 100000 : 0));
+    if (!check_packed(&v, false))
+      return false;
+  }
+  destroy_vector(&v);
+  return true;
+}
+
+static void run_unpack(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  unpack_vector(&b->out, &b->packed);
+}
+
+static void run_copy(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  memcpy(b->out.arr, b->ids.arr, b->ids.size * sizeof(int));
+}
+
+/*Decoding alone, into a buffer that stays in L1.*/
+static void run_decode_block(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  int buffer[PACKED_VECTOR_BLOCK];
+  long long sum = 0;
+  size_t block;
+  for (block = 0; block < b->packed.block_count; block++) {
+    decode_block_packed_vector(&b->packed, block, buffer);
+    sum += buffer[block % PACKED_VECTOR_BLOCK];
+  }
+  sink = sum;
+}
+
+static void run_sum_packed(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  sink = sum_packed_vector(&b->packed);
+}
+
+static void run_sum(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  sink = sum_vector(&b->ids, NULL);
+}
+
+static void run_get_index(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  long long sum = 0;
+  size_t i;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += get_index_packed_vector(&b->packed, b->positions[i]);
+  sink = sum;
+}
+
+static void run_lower_bound_packed(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += lower_bound_packed_vector(&b->packed, b->keys[i]);
+  sink = (long long)sum;
+}
+
+static void run_lower_bound(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += lower_bound(&b->ids, b->keys[i]);
+  sink = (long long)sum;
+}
+
+static void run_find_value(void *ctx) {
+  PackvecBench *b = (PackvecBench *)ctx;
+  long long sum = 0;
+  size_t i;
+  for (i = 0; i < SEARCHES; i++)
+    sum += find_value_vector(&b->ids, b->keys[i]);
+  sink = sum;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  PackvecBench b;
+  unsigned int gaps[2] = {16, 256};
+  size_t i;
+  int g;
+
+  if (!check_all()) {
+    fprintf(stderr, "ERROR: packed vector differs from the original.\n");
+    return 1;
+  }
+  b.ids = create_vector(ITEMS);
+  b.out = create_vector(ITEMS);
+  b.positions = (size_t *)malloc(LOOKUPS * sizeof(size_t));
+  b.keys = (int *)malloc(LOOKUPS * sizeof(int));
+  for (g = 0; g < 2; g++) {
+    char names[9][64];
+    BenchCase cases[9] = {
+        {"memcpy", NULL, run_copy, ITEMS, "elem"},
+        {"unpack_vector", NULL, run_unpack, ITEMS, "elem"},
+        {"decode_block_packed_vector", NULL, run_decode_block, ITEMS, "elem"},
+        {"sum_vector", NULL, run_sum, ITEMS, "elem"},
+        {"sum_packed_vector", NULL, run_sum_packed, ITEMS, "elem"},
+        {"get_index_packed_vector", NULL, run_get_index, LOOKUPS, "lookup"},
+        {"binary search", NULL, run_lower_bound, LOOKUPS, "lookup"},
+        {"lower_bound_packed_vector", NULL, run_lower_bound_packed, LOOKUPS,
+         "lookup"},
+        {"find_value_vector", NULL, run_find_value, SEARCHES, "search"},
+    };
+    size_t c;
+    fill_sorted(&b.ids, ITEMS, gaps[g], 1000);
+    for (i = 0; i < LOOKUPS; i++) {
+      b.positions[i] = next_random() % ITEMS;
+      b.keys[i] = b.ids.arr[b.positions[i]];
+    }
+    create_packed_vector(&b.packed, &b.ids);
+    printf("gaps up to %u: %.2f bytes/elem, %.1fx smaller\n", gaps[g],
+           (double)get_bytes_packed_vector(&b.packed) / ITEMS,
+           (double)(ITEMS * sizeof(int)) /
+               (double)get_bytes_packed_vector(&b.packed));
+    for (c = 0; c < sizeof cases / sizeof cases[0]; c++) {
+      snprintf(names[c], sizeof names[c], "%s gap=%u", cases[c].name,
+               gaps[g]);
+      cases[c].name = names[c];
+      bench_case(&options, &cases[c], &b);
+    }
+    destroy_packed_vector(&b.packed);
+  }
+  free(b.positions);
+  free(b.keys);
+  destroy_vector(&b.ids);
+  destroy_vector(&b.out);
+  return 0;
+}
@@ -0,0 +1,322 @@
+#include "bench.h"
+#include "../path.h"
+
+/*Checks A*, JPS and JPS+ against Dijkstra on small maps of each kind: same
+ * cost, and a path that only takes legal moves, adds up to that cost and
+ * runs from start to goal. Batched answers must match single ones. Then
+ * measures milliseconds per query, and nodes taken off the heap per second,
+ * on 512 x 512 maps like the standard benchmark sets, generated here: random
+ * obstacles, a maze with 1 cell corridors and 32 x 32 rooms joined by
+ * doors.*/
+
+#define SIDE 512
+#define QUERIES 1000
+#define CHECK_QUERIES 300
+
+enum { RANDOM, MAZE, ROOMS };
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static void carve_maze(Grid *grid) {
+  long rows = (long)grid->rows, cols = (long)grid->cols, size = 0;
+  long *stack = (long *)malloc((size_t)(rows * cols) * sizeof(long));
+  fill_grid(grid, -1);
+  set_grid(grid, 1, 1, 0);
+  stack[size++] = 1 * cols + 1;
+  while (size > 0) {
+    long r = stack[size - 1] / cols, c = stack[size - 1] % cols;
+    long options[4];
+    int k, count = 0;
+    for (k = 0; k < 4; k++) {
+      long nr = r + (k == 0 ? -2 : k == 1 ? 2 : 0);
+      long nc = c + (k == 2 ? -2 : k == 3 ? 2 : 0);
+      if (nr > 0 && nr < rows - 1 && nc > 0 && nc < cols - 1 &&
+          get_grid(grid, nr, nc) < 0)
+        options[count++] = nr * cols + nc;
+    }
+    if (count == 0) {
+      size--;
+      continue;
+    }
+    k = (int)(next_random() % (unsigned int)count);
+    set_grid(grid, (r + options[k] / cols) / 2, (c + options[k] % cols) / 2,
+             0);
+    set_grid(grid, options[k] / cols, options[k] % cols, 0);
+    stack[size++] = options[k];
+  }
+  free(stack);
+}
+
+/*Walls every 32 cells with one to three doors in each side of a room.*/
+static void build_rooms(Grid *grid) {
+  long rows = (long)grid->rows, cols = (long)grid->cols, r, c;
+  fill_grid(grid, 0);
+  for (r = 0; r < rows; r++)
+    for (c = 0; c < cols; c++)
+      if (r % 32 == 31 || c % 32 == 31)
+        set_grid(grid, r, c, -1);
+  for (r = 0; r < rows; r += 32)
+    for (c = 0; c < cols; c += 32) {
+      int doors = 1 + (int)(next_random() % 3), d;
+      for (d = 0; d < doors; d++) {
+        long along = (long)(next_random() % 31);
+        if (r + 31 < rows && c + along < cols)
+          set_grid(grid, r + 31, c + along, 0);
+        if (c + 31 < cols && r + along < rows)
+          set_grid(grid, r + along, c + 31, 0);
+      }
+    }
+}
+
+static void build_map(Grid *grid, int kind) {
+  long r, c;
+  if (kind == MAZE) {
+    carve_maze(grid);
+  } else if (kind == ROOMS) {
+    build_rooms(grid);
+  } else {
+    for (r = 0; r < (long)grid->rows; r++)
+      for (c = 0; c < (long)grid->cols; c++)
+        set_grid(grid, r, c, next_random() % 100 < 20 ? -1 : 0);
+  }
+}
+
+static void random_queries(const Grid *grid, PathQuery *queries, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    PathQuery *q = &queries[i];
+    do {
+      q->start_row = (long)(next_random() % grid->rows);
+      q->start_col = (long)(next_random() % grid->cols);
+    } while (get_grid(grid, q->start_row, q->start_col) < 0);
+    do {
+      q->goal_row = (long)(next_random() % grid->rows);
+      q->goal_col = (long)(next_random() % grid->cols);
+    } while (get_grid(grid, q->goal_row, q->goal_col) < 0);
+  }
+}
+
+static bool open_cell(const Grid *grid, long r, long c) {
+  return r >= 0 && r < (long)grid->rows && c >= 0 && c < (long)grid->cols &&
+         get_grid(grid, r, c) >= 0;
+}
+
+/*Fixed-point cost of the move from (r, c) by (dr, dc), 0 if not allowed.*/
+static uint64_t move_cost(const Grid *grid, long r, long c, int dr, int dc) {
+  if (!open_cell(grid, r + dr, c + dc))
+    return 0;
+  if (dr == 0 || dc == 0)
+    return PATH_STRAIGHT;
+  return open_cell(grid, r + dr, c) && open_cell(grid, r, c + dc)
+             ? PATH_DIAGONAL
+             : 0;
+}
+
+typedef struct {
+  uint64_t cost;
+  long cell;
+} DijkstraEntry;
+
+/*Plain Dijkstra with a binary heap and fresh arrays every query. Returns
+ * UINT64_MAX when the goal cannot be reached and counts settled cells in
+ * `settled`.*/
+static uint64_t dijkstra(const Grid *grid, const PathQuery *q,
+                         size_t *settled) {
+  long cols = (long)grid->cols, cells = (long)grid->rows * cols;
+  uint64_t *dist = (uint64_t *)malloc((size_t)cells * sizeof(uint64_t));
+  DijkstraEntry *heap =
+      (DijkstraEntry *)malloc((size_t)cells * 8 * sizeof(DijkstraEntry));
+  size_t size = 0;
+  long goal = q->goal_row * cols + q->goal_col, i;
+  uint64_t found = UINT64_MAX;
+  for (i = 0; i < cells; i++)
+    dist[i] = UINT64_MAX;
+  dist[q->start_row * cols + q->start_col] = 0;
+  heap[size].cost = 0;
+  heap[size++].cell = q->start_row * cols + q->start_col;
+  while (size > 0) {
+    DijkstraEntry top = heap[0];
+    size_t at = 0;
+    int k;
+    heap[0] = heap[--size];
+    for (;;) { /*sift down*/
+      size_t child = 2 * at + 1;
+      DijkstraEntry t;
+      if (child >= size)
+        break;
+      if (child + 1 < size && heap[child + 1].cost < heap[child].cost)
+        child++;
+      if (heap[at].cost <= heap[child].cost)
+        break;
+      t = heap[at];
+      heap[at] = heap[child];
+      heap[child] = t;
+      at = child;
+    }
+    if (top.cost > dist[top.cell])
+      continue;
+    (*settled)++;
+    if (top.cell == goal) {
+      found = top.cost;
+      break;
+    }
+    for (k = 0; k < 8; k++) {
+      long r = top.cell / cols, c = top.cell % cols, next;
+      uint64_t cost = move_cost(grid, r, c, grid_neighbor_dr[k],
+                                grid_neighbor_dc[k]);
+      if (cost == 0)
+        continue;
+      next = (r + grid_neighbor_dr[k]) * cols + c + grid_neighbor_dc[k];
+      if (top.cost + cost < dist[next]) {
+        dist[next] = top.cost + cost;
+        at = size++;
+        heap[at].cost = dist[next];
+        heap[at].cell = next;
+        while (at > 0 && heap[(at - 1) / 2].cost > heap[at].cost) {
+          DijkstraEntry t = heap[at];
+          heap[at] = heap[(at - 1) / 2];
+          heap[(at - 1) / 2] = t;
+          at = (at - 1) / 2;
+        }
+      }
+    }
+  }
+  free(dist);
+  free(heap);
+  return found;
+}
+
+/*The path runs from start to goal by legal moves that add up to `cost`.*/
+static bool check_cells(const Grid *grid, const PathQuery *q,
+                        const Vector *path, uint64_t cost) {
+  long cols = (long)grid->cols;
+  uint64_t sum = 0;
+  size_t i;
+  if (path->size == 0 ||
+      path->arr[0] != q->start_row * cols + q->start_col ||
+      path->arr[path->size - 1] != q->goal_row * cols + q->goal_col)
+    return false;
+  for (i = 1; i < path->size; i++) {
+    long r = path->arr[i - 1] / cols, c = path->arr[i - 1] % cols;
+    long dr = path->arr[i] / cols - r, dc = path->arr[i] % cols - c;
+    uint64_t step;
+    if (dr < -1 || dr > 1 || dc < -1 || dc > 1 || (dr == 0 && dc == 0))
+      return false;
+    if ((step = move_cost(grid, r, c, (int)dr, (int)dc)) == 0)
+      return false;
+    sum += step;
+  }
+  return sum == cost;
+}
+
+static bool check_map(size_t rows, size_t cols, int kind) {
+  static const int methods[3] = {PATH_ASTAR, PATH_JPS, PATH_JPS_PLUS};
+  Grid grid = create_grid(rows, cols, GRID_ROW_MAJOR);
+  PathQuery queries[CHECK_QUERIES];
+  PathResult results[3][CHECK_QUERIES], batch[CHECK_QUERIES];
+  PathOptions options = default_path_options();
+  PathMap map;
+  PathSearch *search = NULL;
+  Vector path = create_vector(0);
+  size_t i;
+  int m;
+  bool ok;
+  build_map(&grid, kind);
+  random_queries(&grid, queries, CHECK_QUERIES);
+  ok = create_path_map(&map, &grid) == 0 &&
+       build_jump_table_path_map(&map) == 0 &&
+       (search = create_path_search(&map)) != NULL;
+  for (i = 0; ok && i < CHECK_QUERIES; i++) {
+    size_t settled = 0;
+    uint64_t expected = dijkstra(&grid, &queries[i], &settled);
+    for (m = 0; ok && m < 3; m++) {
+      PathResult *result = &results[m][i];
+      ok = find_path(search, &queries[i], methods[m], result, &path) == 0 &&
+           result->found == (expected != UINT64_MAX);
+      if (ok && result->found)
+        ok = result->cost == (double)expected / PATH_STRAIGHT &&
+             check_cells(&grid, &queries[i], &path, expected);
+    }
+  }
+  options.threads = 4;
+  for (m = 0; ok && m < 3; m++) {
+    ok = find_paths(&map, queries, CHECK_QUERIES, methods[m], batch,
+                    &options) == 0;
+    for (i = 0; ok && i < CHECK_QUERIES; i++)
+      ok = batch[i].found == results[m][i].found &&
+           batch[i].cost == results[m][i].cost &&
+           batch[i].expanded == results[m][i].expanded;
+  }
+  if (search != NULL)
+    destroy_path_search(search);
+  destroy_path_map(&map);
+  destroy_vector(&path);
+  destroy_grid(&grid);
+  return ok;
+}
+
+static void bench_method(const PathMap *map, const PathQuery *queries,
+                         const char *name, int method, int threads) {
+  static PathResult results[QUERIES];
+  PathOptions options = default_path_options();
+  size_t i, expanded = 0;
+  char label[64];
+  double start, seconds;
+  options.threads = threads;
+  start = bench_now();
+  find_paths(map, queries, QUERIES, method, results, &options);
+  seconds = bench_now() - start;
+  for (i = 0; i < QUERIES; i++)
+    expanded += results[i].expanded;
+  snprintf(label, sizeof label, "%s t=%d %.3f ms/q", name, threads,
+           seconds * 1e3 / QUERIES);
+  bench_report(label, (double)expanded, seconds, "nodes");
+}
+
+int main(void) {
+  static const char *maps[] = {"random", "maze", "rooms"};
+  static const char *methods[] = {"astar", "jps", "jps+"};
+  static PathQuery queries[QUERIES];
+  int cpus = default_path_options().threads, kind, m, threads;
+
+  for (kind = RANDOM; kind <= ROOMS; kind++)
+    if (!check_map(61, 83, kind) || !check_map(128, 128, kind)) {
+      fprintf(stderr, "ERROR: %s paths differ from Dijkstra.\n", maps[kind]);
+      return 1;
+    }
+  for (kind = RANDOM; kind <= ROOMS; kind++) {
+    Grid grid = create_grid(SIDE, SIDE, GRID_ROW_MAJOR);
+    PathMap map;
+    char label[64];
+    double start, seconds;
+    size_t i, settled = 0;
+    build_map(&grid, kind);
+    random_queries(&grid, queries, QUERIES);
+    create_path_map(&map, &grid);
+    start = bench_now();
+    build_jump_table_path_map(&map);
+    snprintf(label, sizeof label, "%s jump table", maps[kind]);
+    bench_report(label, (double)SIDE * SIDE, bench_now() - start, "cells");
+    start = bench_now();
+    for (i = 0; i < QUERIES / 20; i++)
+      dijkstra(&grid, &queries[i], &settled);
+    seconds = bench_now() - start;
+    snprintf(label, sizeof label, "%s dijkstra %.3f ms/q", maps[kind],
+             seconds * 1e3 / (QUERIES / 20));
+    bench_report(label, (double)settled, seconds, "nodes");
+    for (m = PATH_ASTAR; m <= PATH_JPS_PLUS; m++)
+      for (threads = 1; threads <= cpus; threads *= 2) {
+        char name[32];
+        snprintf(name, sizeof name, "%s %s", maps[kind], methods[m]);
+        bench_method(&map, queries, name, m, threads);
+      }
+    destroy_path_map(&map);
+    destroy_grid(&grid);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "../perfcount.h"
+
+/*Hardware counters around Vector rotation at a cache resident and a DRAM
+ * sized vector, and around a pointer chase, next to the timing of the same
+ * regions. Prints why when counters are not permitted.*/
+
+#define ROTATIONS 16
+
+extern bool debug_memory(void);
+
+static volatile long sink;
+
+static void rotate(Vector *v) {
+  PERF_SCOPE("right_rotate_n_times_vector");
+  right_rotate_n_times_vector(v, ROTATIONS);
+}
+
+/*Randomly linked cycle through `n` slots: one likely cache miss per step.*/
+static long chase(const size_t *next, size_t steps) {
+  size_t i, at = 0;
+  PERF_SCOPE("pointer chase");
+  for (i = 0; i < steps; i++)
+    at = next[at];
+  return (long)at;
+}
+
+int main(void) {
+  static const size_t sizes[] = {4096, 1 << 22};
+  size_t s, i, n = 1 << 22, *next = (size_t *)malloc(n * sizeof(size_t));
+  size_t *order = (size_t *)malloc(n * sizeof(size_t));
+  double start;
+  unsigned int seed = 12345;
+
+  if (!perf_available())
+    color_print(YELLOW, "", "", "hardware counters unavailable: %s\n",
+                perf_unavailable_reason());
+  for (s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+    Vector v = create_vector(sizes[s]);
+    char name[64];
+    for (i = 0; i < sizes[s]; i++)
+      set_index_vector(&v, i, (int)i);
+    start = bench_now();
+    for (i = 0; i < 8; i++)
+      rotate(&v);
+    snprintf(name, sizeof name, "rotate %zu x%d", sizes[s], ROTATIONS * 8);
+    bench_report(name, (double)sizes[s] * ROTATIONS * 8, bench_now() - start,
+                 "elem");
+    destroy_vector(&v);
+  }
+
+  /*Sattolo's shuffle gives a single cycle*/
+  for (i = 0; i < n; i++)
+    order[i] = i;
+  for (i = n - 1; i > 0; i--) {
+    size_t j, t;
+    seed = seed * 1103515245u + 12345u;
+    j = ((size_t)seed << 16 ^ (size_t)(seed >> 8)) % i;
+    t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (i = 0; i < n; i++)
+    next[order[i]] = order[(i + 1) % n];
+  start = bench_now();
+  sink = chase(next, n);
+  bench_report("pointer chase 32 MiB", (double)n, bench_now() - start, "step");
+
+  {
+    PERF_SCOPE("debug_memory");
+    sink = debug_memory();
+  }
+  report_perf_counters();
+  free(next);
+  free(order);
+  return 0;
+}
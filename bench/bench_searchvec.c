@@ -0,0 +1,205 @@
+#include "bench.h"
+#include "../searchvec.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*Checks lower_bound, find and the batched search against a binary search
+ * on every size up to 600 and on larger arrays with duplicates, then
+ * measures random lookups from an L1 sized array (16 KiB) to one far past
+ * the last level cache (128 MiB).*/
+
+#define LOOKUPS (1u << 16)
+#define SEARCHES 16
+#define SIZES 5
+
+typedef struct {
+  Vector sorted;
+  SearchIndex index;
+  int *keys;
+  size_t *positions;
+} SearchBench;
+
+static volatile size_t sink;
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 4;
+}
+
+/*Sorted, with steps of 0 to `gap` - 1 so small gaps repeat values.*/
+static void fill_sorted(Vector *v, size_t n, unsigned int gap) {
+  int value = -(int)(n / 2);
+  size_t i;
+  v->size = n;
+  for (i = 0; i < n; i++) {
+    value += (int)(next_random() % gap);
+    v->arr[i] = value;
+  }
+}
+
+static size_t lower_bound(const Vector *v, int value) {
+  size_t lo = 0, hi = v->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (v->arr[mid] < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/*The usual branchless form: halve the range with a conditional move.*/
+static size_t lower_bound_branchless(const Vector *v, int value) {
+  const int *base = v->arr;
+  size_t n = v->size;
+  if (n == 0)
+    return 0;
+  while (n > 1) {
+    size_t half = n / 2;
+    base = base[half - 1] < value ? base + half : base;
+    n -= half;
+  }
+  return (size_t)(base - v->arr) + (size_t)(*base < value);
+}
+
+static bool check_index(Vector *v) {
+  SearchIndex index;
+  int keys[100];
+  size_t positions[100], i;
+  bool ok = true;
+  if (create_search_index(&index, v) != 0)
+    return false;
+  for (i = 0; ok && i < 100; i++) {
+    if (v->size == 0)
+      keys[i] = (int)i;
+    else if (i < 2) /*below the first and above the last*/
+      keys[i] = i == 0 ? v->arr[0] - 1 : v->arr[v->size - 1] + 1;
+    else
+      keys[i] =
+          v->arr[next_random() % v->size] + (int)(next_random() % 3) - 1;
+    ok = lower_bound_search_index(&index, keys[i]) ==
+             lower_bound(v, keys[i]) &&
+         lower_bound_branchless(v, keys[i]) == lower_bound(v, keys[i]);
+    if (find_search_index(&index, keys[i]) < v->size)
+      ok &= v->arr[find_search_index(&index, keys[i])] == keys[i];
+    else
+      ok &= lower_bound(v, keys[i]) == v->size ||
+            v->arr[lower_bound(v, keys[i])] != keys[i];
+  }
+  lower_bound_batch_search_index(&index, keys, i, positions);
+  for (i = 0; ok && i < 100; i++)
+    ok = positions[i] == lower_bound(v, keys[i]);
+  destroy_search_index(&index);
+  return ok;
+}
+
+static bool check_all(void) {
+  Vector v = create_vector(1000003);
+  SearchIndex unsorted;
+  int terminal = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+  size_t n;
+  bool ok = true;
+  for (n = 0; ok && n <= 600; n++) {
+    fill_sorted(&v, n, n % 2 == 0 ? 3 : 1000);
+    ok = check_index(&v);
+  }
+  fill_sorted(&v, 1000003, 2);
+  ok &= check_index(&v);
+  fill_sorted(&v, 1000003, 1000);
+  ok &= check_index(&v);
+  /*mute the expected error*/
+  v.arr[5] = v.arr[6] + 1;
+  fflush(stderr);
+  dup2(null, STDERR_FILENO);
+  ok &= create_search_index(&unsorted, &v) == -1;
+  dup2(terminal, STDERR_FILENO);
+  close(terminal);
+  close(null);
+  destroy_vector(&v);
+  return ok;
+}
+
+static void run_lower_bound(void *ctx) {
+  SearchBench *b = (SearchBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += lower_bound(&b->sorted, b->keys[i]);
+  sink = sum;
+}
+
+static void run_branchless(void *ctx) {
+  SearchBench *b = (SearchBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += lower_bound_branchless(&b->sorted, b->keys[i]);
+  sink = sum;
+}
+
+static void run_index(void *ctx) {
+  SearchBench *b = (SearchBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < LOOKUPS; i++)
+    sum += lower_bound_search_index(&b->index, b->keys[i]);
+  sink = sum;
+}
+
+static void run_batch(void *ctx) {
+  SearchBench *b = (SearchBench *)ctx;
+  lower_bound_batch_search_index(&b->index, b->keys, LOOKUPS, b->positions);
+  sink = b->positions[LOOKUPS - 1];
+}
+
+static void run_find_value(void *ctx) {
+  SearchBench *b = (SearchBench *)ctx;
+  size_t i, sum = 0;
+  for (i = 0; i < SEARCHES; i++)
+    sum += (size_t)find_value_vector(&b->sorted, b->keys[i]);
+  sink = sum;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  static const size_t sizes[SIZES] = {4u << 10, 64u << 10, 1u << 20, 8u << 20,
+                                      32u << 20};
+  SearchBench b;
+  size_t s, i;
+
+  if (!check_all()) {
+    fprintf(stderr, "ERROR: search index disagrees with binary search.\n");
+    return 1;
+  }
+  b.sorted = create_vector(sizes[SIZES - 1]);
+  b.keys = (int *)malloc(LOOKUPS * sizeof(int));
+  b.positions = (size_t *)malloc(LOOKUPS * sizeof(size_t));
+  for (s = 0; s < SIZES; s++) {
+    BenchCase cases[5] = {
+        {"binary search", NULL, run_lower_bound, LOOKUPS, "lookup"},
+        {"branchless binary search", NULL, run_branchless, LOOKUPS,
+         "lookup"},
+        {"lower_bound_search_index", NULL, run_index, LOOKUPS, "lookup"},
+        {"lower_bound_batch_search_index", NULL, run_batch, LOOKUPS,
+         "lookup"},
+        {"find_value_vector", NULL, run_find_value, SEARCHES, "search"},
+    };
+    char names[5][80];
+    size_t c;
+    fill_sorted(&b.sorted, sizes[s], 16);
+    for (i = 0; i < LOOKUPS; i++)
+      b.keys[i] = b.sorted.arr[next_random() % sizes[s]];
+    create_search_index(&b.index, &b.sorted);
+    for (c = 0; c < 5; c++) {
+      snprintf(names[c], sizeof names[c], "%s n=%zuK", cases[c].name,
+               sizes[s] >> 10);
+      cases[c].name = names[c];
+      bench_case(&options, &cases[c], &b);
+    }
+    destroy_search_index(&b.index);
+  }
+  free(b.keys);
+  free(b.positions);
+  destroy_vector(&b.sorted);
+  return 0;
+}
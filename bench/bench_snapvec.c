@@ -0,0 +1,210 @@
+#include "bench.h"
+#include "../snapvec.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+/*Checks that readers only ever see whole versions, in publish order, while
+ * a writer replaces the table as fast as it can (run it under ASan to catch
+ * a version freed too early), and that offline readers do not hold writers
+ * up. Then measures lookups in a 1024 entry table from 1 to 4 threads, with
+ * a writer publishing every 100 us, against a rwlock and a mutex.*/
+
+#define TABLE 1024
+#define LOOKUPS (1u << 20)
+#define THREADS 4
+#define QUIESCE_EVERY 16 /*lookups per request*/
+#define WRITE_PAUSE_NS 100000
+
+enum { MODE_SNAPSHOT, MODE_RWLOCK, MODE_MUTEX };
+
+typedef struct {
+  SnapshotVector snapshot;
+  Vector table; /*for the locked modes*/
+  pthread_rwlock_t rwlock;
+  pthread_mutex_t mutex;
+  int mode;
+  size_t threads, per_thread;
+  long long pause_ns;
+  atomic_int readers_left;
+  atomic_int failed;
+  volatile long long sinks[THREADS * 16]; /*one cache line per reader*/
+} SnapvecBench;
+
+typedef struct {
+  SnapvecBench *bench;
+  size_t thread;
+} SnapvecReader;
+
+static void fill_table(Vector *v, int version) {
+  size_t i;
+  v->size = TABLE;
+  for (i = 0; i < TABLE; i++)
+    v->arr[i] = version;
+}
+
+/*A version is whole when every entry holds its number.*/
+static bool whole(const Vector *v) {
+  return v->size == TABLE && v->arr[0] == v->arr[TABLE / 2] &&
+         v->arr[0] == v->arr[TABLE - 1];
+}
+
+static void *read_table(void *arg) {
+  SnapvecReader *r = (SnapvecReader *)arg;
+  SnapvecBench *b = r->bench;
+  int reader = b->mode == MODE_SNAPSHOT
+                   ? register_snapshot_vector(&b->snapshot)
+                   : 0;
+  unsigned int index = (unsigned int)r->thread * 7919u;
+  long long sum = 0;
+  int last = -1;
+  size_t i;
+  for (i = 0; i < b->per_thread; i++) {
+    Vector *table;
+    index = index * 1103515245u + 12345u;
+    if (b->mode == MODE_SNAPSHOT) {
+      table = read_snapshot_vector(&b->snapshot);
+      sum += table->arr[(index >> 8) % TABLE];
+      if (i % QUIESCE_EVERY == QUIESCE_EVERY - 1) {
+        if (!whole(table) || table->arr[0] < last)
+          atomic_store(&b->failed, 1);
+        last = table->arr[0];
+        quiescent_snapshot_vector(&b->snapshot, reader);
+      }
+    } else if (b->mode == MODE_RWLOCK) {
+      pthread_rwlock_rdlock(&b->rwlock);
+      sum += b->table.arr[(index >> 8) % TABLE];
+      pthread_rwlock_unlock(&b->rwlock);
+    } else {
+      pthread_mutex_lock(&b->mutex);
+      sum += b->table.arr[(index >> 8) % TABLE];
+      pthread_mutex_unlock(&b->mutex);
+    }
+  }
+  if (b->mode == MODE_SNAPSHOT)
+    unregister_snapshot_vector(&b->snapshot, reader);
+  b->sinks[r->thread * 16] = sum;
+  atomic_fetch_sub(&b->readers_left, 1);
+  return NULL;
+}
+
+static int next_version(Vector *copy, void *ctx) {
+  fill_table(copy, copy->arr[0] + 1);
+  (void)ctx;
+  return 0;
+}
+
+/*Replaces the table until the readers are done.*/
+static void write_tables(SnapvecBench *b) {
+  struct timespec pause = {0, 0};
+  int version = 0;
+  pause.tv_nsec = b->pause_ns;
+  while (atomic_load(&b->readers_left) > 0) {
+    version++;
+    if (b->mode == MODE_SNAPSHOT) {
+      update_snapshot_vector(&b->snapshot, next_version, NULL);
+    } else if (b->mode == MODE_RWLOCK) {
+      pthread_rwlock_wrlock(&b->rwlock);
+      fill_table(&b->table, version);
+      pthread_rwlock_unlock(&b->rwlock);
+    } else {
+      pthread_mutex_lock(&b->mutex);
+      fill_table(&b->table, version);
+      pthread_mutex_unlock(&b->mutex);
+    }
+    if (b->pause_ns > 0)
+      nanosleep(&pause, NULL);
+  }
+}
+
+static void run(void *ctx) {
+  SnapvecBench *b = (SnapvecBench *)ctx;
+  pthread_t threads[THREADS];
+  SnapvecReader readers[THREADS];
+  size_t t;
+  atomic_store(&b->readers_left, (int)b->threads);
+  for (t = 0; t < b->threads; t++) {
+    readers[t].bench = b;
+    readers[t].thread = t;
+    pthread_create(&threads[t], NULL, read_table, &readers[t]);
+  }
+  write_tables(b);
+  for (t = 0; t < b->threads; t++)
+    pthread_join(threads[t], NULL);
+}
+
+static bool check_snapshots(SnapvecBench *b) {
+  Vector next = create_vector(TABLE);
+  int reader, i;
+  bool ok;
+  /*a writer with no pause against 4 readers*/
+  b->mode = MODE_SNAPSHOT;
+  b->threads = THREADS;
+  b->per_thread = LOOKUPS / 4;
+  b->pause_ns = 0;
+  run(b);
+  ok = !atomic_load(&b->failed);
+  synchronize_snapshot_vector(&b->snapshot);
+  ok &= reclaim_snapshot_vector(&b->snapshot) == 0;
+
+  /*an offline reader does not block publishing; an online one keeps the
+   * versions it may hold*/
+  reader = register_snapshot_vector(&b->snapshot);
+  offline_snapshot_vector(&b->snapshot, reader);
+  for (i = 0; i < 3 * SNAPSHOT_VECTOR_PENDING; i++) {
+    fill_table(&next, 1000 + i);
+    ok &= publish_snapshot_vector(&b->snapshot, &next) == 0 &&
+          next.arr == NULL;
+    next = create_vector(TABLE);
+  }
+  online_snapshot_vector(&b->snapshot, reader);
+  ok &= read_snapshot_vector(&b->snapshot)->arr[0] ==
+        1000 + 3 * SNAPSHOT_VECTOR_PENDING - 1;
+  ok &= update_snapshot_vector(&b->snapshot, next_version, NULL) == 0 &&
+        reclaim_snapshot_vector(&b->snapshot) == 1;
+  quiescent_snapshot_vector(&b->snapshot, reader);
+  ok &= reclaim_snapshot_vector(&b->snapshot) == 0;
+  unregister_snapshot_vector(&b->snapshot, reader);
+  destroy_vector(&next);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  static SnapvecBench b;
+  static const char *modes[3] = {"read_snapshot_vector", "pthread_rwlock",
+                                 "pthread_mutex"};
+  size_t threads;
+  int m;
+
+  b.table = create_vector(TABLE);
+  fill_table(&b.table, 0);
+  pthread_rwlock_init(&b.rwlock, NULL);
+  pthread_mutex_init(&b.mutex, NULL);
+  if (create_snapshot_vector(&b.snapshot, &b.table) != 0 ||
+      !check_snapshots(&b)) {
+    fprintf(stderr, "ERROR: a reader saw a torn or stale version.\n");
+    return 1;
+  }
+  b.pause_ns = WRITE_PAUSE_NS;
+  for (threads = 1; threads <= THREADS; threads *= 2)
+    for (m = 0; m < 3; m++) {
+      char name[64];
+      BenchCase c = {NULL, NULL, run, LOOKUPS, "lookup"};
+      snprintf(name, sizeof name, "%s threads=%zu", modes[m], threads);
+      c.name = name;
+      b.mode = m;
+      b.threads = threads;
+      b.per_thread = LOOKUPS / threads;
+      bench_case(&options, &c, &b);
+    }
+  if (atomic_load(&b.failed)) {
+    fprintf(stderr, "ERROR: a reader saw a torn or stale version.\n");
+    return 1;
+  }
+  destroy_snapshot_vector(&b.snapshot);
+  destroy_vector(&b.table);
+  pthread_rwlock_destroy(&b.rwlock);
+  pthread_mutex_destroy(&b.mutex);
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include "bench.h"
+#include "../stencil.h"
+
+/*Checks every built-in kernel against a naive scalar reference, then
+ * measures cells per second over thread counts and time tiling depths.*/
+
+#define CHECK_ROWS 301
+#define CHECK_COLS 517
+#define CHECK_STEPS 9
+#define SIDE 4096
+#define STEPS 8
+
+enum { LIFE, BLUR, FLOOD };
+
+static int reference_cell(const Grid *g, long r, long c, int kind) {
+  static const int weights[3][3] = {{1, 2, 1}, {2, 4, 2}, {1, 2, 1}};
+  int dr, dc, sum = 0, alive = 0, max = get_grid(g, r, c);
+  for (dr = -1; dr <= 1; dr++)
+    for (dc = -1; dc <= 1; dc++) {
+      int v = get_grid(g, r + dr, c + dc);
+      sum += weights[dr + 1][dc + 1] * v;
+      if (dr != 0 || dc != 0)
+        alive += v;
+      if (v > max)
+        max = v;
+    }
+  switch (kind) {
+  case LIFE:
+    return alive == 3 || (alive == 2 && get_grid(g, r, c) == 1);
+  case BLUR:
+    return sum >> 4;
+  default:
+    return get_grid(g, r, c) < 0 ? get_grid(g, r, c) : max;
+  }
+}
+
+static void reference_stencil(Grid *grid, int kind, int steps) {
+  Grid next = create_grid(grid->rows, grid->cols, GRID_ROW_MAJOR);
+  long r, c;
+  int step;
+  memcpy(next.cells, grid->cells, grid->capacity * sizeof(int));
+  for (step = 0; step < steps; step++) {
+    Grid t;
+    for (r = 0; r < (long)grid->rows; r++)
+      for (c = 0; c < (long)grid->cols; c++)
+        set_grid(&next, r, c, reference_cell(grid, r, c, kind));
+    t = *grid;
+    *grid = next;
+    next = t;
+  }
+  destroy_grid(&next);
+}
+
+static void seed_grid(Grid *grid, int kind) {
+  long r, c;
+  unsigned int state = 12345;
+  for (r = 0; r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++) {
+      state = state * 1103515245u + 12345u;
+      switch (kind) {
+      case LIFE:
+        set_grid(grid, r, c, (state >> 16) % 3 == 0);
+        break;
+      case BLUR:
+        set_grid(grid, r, c, (int)((state >> 16) & 255));
+        break;
+      default:
+        set_grid(grid, r, c, (state >> 16) % 4 == 0 ? -1 : (int)(r * c % 7));
+        break;
+      }
+    }
+}
+
+static const StencilKernel *kernel_for(int kind) {
+  return kind == LIFE   ? &stencil_life_kernel
+         : kind == BLUR ? &stencil_blur_kernel
+                        : &stencil_flood_kernel;
+}
+
+static bool check_kernel(int kind, const StencilOptions *options) {
+  Grid expected = create_grid(CHECK_ROWS, CHECK_COLS, GRID_ROW_MAJOR);
+  Grid actual = create_grid(CHECK_ROWS, CHECK_COLS, GRID_ROW_MAJOR);
+  bool same;
+  seed_grid(&expected, kind);
+  seed_grid(&actual, kind);
+  reference_stencil(&expected, kind, CHECK_STEPS);
+  run_stencil(&actual, *kernel_for(kind), CHECK_STEPS, options);
+  same = memcmp(expected.cells, actual.cells,
+                expected.capacity * sizeof(int)) == 0;
+  destroy_grid(&expected);
+  destroy_grid(&actual);
+  return same;
+}
+
+static void bench_kernel(int kind, const char *name,
+                         const StencilOptions *options) {
+  Grid grid = create_grid(SIDE, SIDE, GRID_ROW_MAJOR);
+  char label[64];
+  double start;
+  seed_grid(&grid, kind);
+  start = bench_now();
+  run_stencil(&grid, *kernel_for(kind), STEPS, options);
+  snprintf(label, sizeof label, "%s t=%d tile=%d", name, options->threads,
+           options->time_steps);
+  bench_report(label, (double)SIDE * SIDE * STEPS, bench_now() - start,
+               "cells");
+  destroy_grid(&grid);
+}
+
+int main(void) {
+  StencilOptions options = default_stencil_options();
+  int cpus = options.threads, kind, threads, depth;
+  static const char *names[] = {"life", "blur", "flood"};
+
+  for (kind = LIFE; kind <= FLOOD; kind++)
+    for (depth = 1; depth <= 4; depth += 3)
+      for (threads = 1; threads <= 4; threads += 3) {
+        options.threads = threads;
+        options.time_steps = depth;
+        options.block_rows = 32;
+        if (!check_kernel(kind, &options)) {
+          fprintf(stderr, "ERROR: %s stencil differs from the reference.\n",
+                  names[kind]);
+          return 1;
+        }
+      }
+
+  options.block_rows = 64;
+  for (kind = LIFE; kind <= FLOOD; kind++)
+    for (threads = 1; threads <= cpus; threads *= 2)
+      for (depth = 1; depth <= 4; depth += 3) {
+        options.threads = threads;
+        options.time_steps = depth;
+        bench_kernel(kind, names[kind], &options);
+      }
+  return 0;
+}
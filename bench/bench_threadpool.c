@@ -0,0 +1,175 @@
+#include "bench.h"
+#include "../threadpool.h"
+
+/*Checks parallel_for and parallel_reduce against serial loops (including
+ * nested loops and an oversubscribed pool), then measures sum and transform
+ * over a Vector from 1 thread to every CPU, and the cost of an empty
+ * loop.*/
+
+#define ITEMS (16u << 20)
+#define CHECK_ITEMS 100003
+#define OVERHEAD_LOOPS 1000
+
+typedef struct {
+  ThreadPool *pool;
+  Vector v;
+  long long sum;
+} PoolBench;
+
+static void add(size_t begin, size_t end, void *partial, void *ctx) {
+  VectorSpan span = get_span_vector((Vector *)ctx, begin, end);
+  long long sum = 0;
+  size_t i;
+  for (i = 0; i < span.size; i++)
+    sum += span.data[i];
+  *(long long *)partial += sum;
+}
+
+static void join(void *into, const void *from, void *ctx) {
+  (void)ctx;
+  *(long long *)into += *(const long long *)from;
+}
+
+static void transform(size_t begin, size_t end, void *ctx) {
+  VectorSpan span = get_span_vector((Vector *)ctx, begin, end);
+  size_t i;
+  for (i = 0; i < span.size; i++)
+    span.data[i] = (span.data[i] * 3 + 1) & 0xffff;
+}
+
+static void nothing(size_t begin, size_t end, void *ctx) {
+  (void)begin;
+  (void)end;
+  (void)ctx;
+}
+
+/*Each item runs an inner parallel_for over its own slice.*/
+typedef struct {
+  ThreadPool *pool;
+  Vector *v;
+  size_t slice;
+} NestedCheck;
+
+static void nested(size_t begin, size_t end, void *ctx) {
+  NestedCheck *check = (NestedCheck *)ctx;
+  size_t i;
+  for (i = begin; i < end; i++) {
+    size_t lo = i * check->slice, hi = lo + check->slice;
+    if (hi > check->v->size)
+      hi = check->v->size;
+    if (lo < hi)
+      parallel_for(check->pool, lo, hi, 7, transform, check->v);
+  }
+}
+
+static void fill_vector(Vector *v, size_t n) {
+  size_t i;
+  v->size = n;
+  for (i = 0; i < n; i++)
+    v->arr[i] = (int)(i % 1000) - 500;
+}
+
+static bool check_pool(ThreadPool *pool) {
+  Vector v = create_vector(CHECK_ITEMS);
+  NestedCheck check;
+  long long expected = 0, sum = 0, zero = 0;
+  size_t i, grain;
+  int round;
+  for (grain = 0; grain <= 64; grain += 13) {
+    fill_vector(&v, CHECK_ITEMS);
+    for (i = 0, expected = 0; i < CHECK_ITEMS; i++)
+      expected += v.arr[i];
+    parallel_reduce(pool, 0, v.size, grain, sizeof sum, &zero, add, join,
+                    &sum, &v);
+    if (sum != expected)
+      return false;
+    parallel_for(pool, 0, v.size, grain, transform, &v);
+    for (i = 0; i < CHECK_ITEMS; i++)
+      if (v.arr[i] != ((((int)(i % 1000) - 500) * 3 + 1) & 0xffff))
+        return false;
+  }
+  fill_vector(&v, CHECK_ITEMS);
+  check.pool = pool;
+  check.v = &v;
+  check.slice = 1000;
+  parallel_for(pool, 0, (CHECK_ITEMS + 999) / 1000, 1, nested, &check);
+  for (i = 0; i < CHECK_ITEMS; i++)
+    if (v.arr[i] != ((((int)(i % 1000) - 500) * 3 + 1) & 0xffff))
+      return false;
+  /*many short loops exercise parking and waking*/
+  for (round = 0; round < 200; round++) {
+    fill_vector(&v, 5000);
+    parallel_reduce(pool, 0, v.size, 64, sizeof sum, &zero, add, join, &sum,
+                    &v);
+    if (sum != -2500)
+      return false;
+  }
+  destroy_vector(&v);
+  return true;
+}
+
+static void run_sum(void *ctx) {
+  PoolBench *b = (PoolBench *)ctx;
+  long long zero = 0;
+  parallel_reduce(b->pool, 0, b->v.size, 0, sizeof b->sum, &zero, add, join,
+                  &b->sum, &b->v);
+}
+
+static void run_transform(void *ctx) {
+  PoolBench *b = (PoolBench *)ctx;
+  parallel_for(b->pool, 0, b->v.size, 0, transform, &b->v);
+}
+
+static void run_empty(void *ctx) {
+  PoolBench *b = (PoolBench *)ctx;
+  int i;
+  for (i = 0; i < OVERHEAD_LOOPS; i++)
+    parallel_for(b->pool, 0, (size_t)get_threads_thread_pool(b->pool) * 8, 1,
+                 nothing, NULL);
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  ThreadPool *pool;
+  PoolBench b;
+  double base[3] = {0, 0, 0};
+  char names[3][64];
+  int cpus = get_threads_thread_pool(default_thread_pool()), threads, c;
+
+  for (threads = 1; threads <= 4; threads++) {
+    pool = create_thread_pool(threads);
+    if (pool == NULL || !check_pool(pool)) {
+      fprintf(stderr, "ERROR: thread pool of %d differs from serial loops.\n",
+              threads);
+      return 1;
+    }
+    destroy_thread_pool(pool);
+  }
+
+  b.v = create_vector(ITEMS);
+  fill_vector(&b.v, ITEMS);
+  /*1, 2, 4, ... and every CPU*/
+  for (threads = 1;; threads = threads * 2 < cpus ? threads * 2 : cpus) {
+    BenchCase cases[3] = {
+        {"parallel_reduce sum", NULL, run_sum, ITEMS, "elem"},
+        {"parallel_for transform", NULL, run_transform, ITEMS, "elem"},
+        {"parallel_for empty", NULL, run_empty, OVERHEAD_LOOPS, "loop"},
+    };
+    b.pool = create_thread_pool(threads);
+    for (c = 0; c < 3; c++) {
+      BenchResult result;
+      snprintf(names[c], sizeof names[c], "%s t=%d", cases[c].name, threads);
+      cases[c].name = names[c];
+      result = bench_case(&options, &cases[c], &b);
+      if (threads == 1)
+        base[c] = result.median_ns;
+      else
+        printf("  speedup %.2fx over 1 thread\n", base[c] / result.median_ns);
+    }
+    destroy_thread_pool(b.pool);
+    if (threads >= cpus)
+      break;
+  }
+  destroy_vector(&b.v);
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "../timing.h"
+
+/*Cost of a scoped timer around an empty block, then Vector operations timed
+ * with it and the report printed.*/
+
+#define LOOP 10000000
+#define PUSHES 1000000
+
+static volatile unsigned long sink;
+
+int main(void) {
+  TimerReport reports[4];
+  Vector v = create_vector(PUSHES);
+  double start, plain_s, timed_s;
+  unsigned long i;
+  int n, failed = 0;
+
+  start = bench_now();
+  for (i = 0; i < LOOP; i++)
+    sink += i;
+  plain_s = bench_now() - start;
+  start = bench_now();
+  for (i = 0; i < LOOP; i++) {
+    TIMER_SCOPE("empty scope");
+    sink += i;
+  }
+  timed_s = bench_now() - start;
+
+  v.size = 0; /*keep the capacity so no push reallocates*/
+  for (i = 0; i < PUSHES; i++) {
+    TIMER_BEGIN(push, "push_back_vector");
+    push_back_vector(&v, (int)i);
+    TIMER_END(push);
+  }
+  for (i = 0; i < PUSHES; i++) {
+    TIMER_SCOPE("get_index_vector");
+    sink += (unsigned long)get_index_vector(&v, i);
+  }
+  destroy_vector(&v);
+
+  color_print(CYAN, "", "", "%-28s", "TIMER_SCOPE overhead");
+  printf(" %8.1f ns/scope\n", (timed_s - plain_s) / LOOP * 1e9);
+  report_timers();
+  n = collect_timers(reports, 4);
+  if (n != 3 || reports[0].count != LOOP || reports[1].count != PUSHES ||
+      reports[2].count != PUSHES)
+    failed = 1;
+  for (i = 0; i < (unsigned long)n; i++)
+    if (!(reports[i].min <= reports[i].p50 && reports[i].p50 <= reports[i].p99 &&
+          reports[i].p99 <= reports[i].max))
+      failed = 1;
+  if (failed) {
+    fprintf(stderr, "ERROR: timer counts or percentiles are inconsistent\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,228 @@
+#include "bench.h"
+#include "../vecio.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+/*Checks that text and binary files round trip with and without io_uring
+ * (small chunks, so tokens straddle them), that odd spacing and signs parse
+ * and malformed files fail, then compares loading and saving text against
+ * fscanf and fprintf.*/
+
+#define ITEMS (4u << 20)
+#define CHECK_ITEMS 100003
+#define TEXT_PATH "/tmp/bench_vecio.txt"
+#define BINARY_PATH "/tmp/bench_vecio.bin"
+
+typedef struct {
+  Vector v, out;
+  VectorIOOptions read, ring;
+} VecioBench;
+
+static volatile long long sink;
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 4;
+}
+
+/*Values of every length from 1 to 11 characters.*/
+static void fill_values(Vector *v, size_t n) {
+  size_t i;
+  v->size = n;
+  for (i = 0; i < n; i++)
+    v->arr[i] = (int)(next_random() << 4 ^ next_random()) >> (i % 31);
+}
+
+static void write_file(const char *path, const char *text) {
+  FILE *file = fopen(path, "w");
+  fputs(text, file);
+  fclose(file);
+}
+
+static bool same(const Vector *a, const Vector *b) {
+  return a->size == b->size &&
+         (a->size == 0 || memcmp(a->arr, b->arr, a->size * sizeof(int)) == 0);
+}
+
+static int stop_after_first(const int *values, size_t count, void *ctx) {
+  (void)values;
+  (void)count;
+  (void)ctx;
+  return 1;
+}
+
+static long long first_batch(size_t size, size_t chunk) {
+  if (chunk > VECTOR_IO_BATCH)
+    chunk = VECTOR_IO_BATCH;
+  return (long long)(size < chunk ? size : chunk);
+}
+
+static bool check_round_trips(void) {
+  Vector v = create_vector(CHECK_ITEMS), out = create_vector(1);
+  VectorIOOptions options = default_vector_io_options();
+  size_t chunks[2] = {4096, VECTOR_IO_CHUNK}, sizes[3] = {0, 1, CHECK_ITEMS};
+  size_t c, s;
+  int ring;
+  bool ok = true;
+  for (s = 0; s < 3; s++) {
+    fill_values(&v, sizes[s]);
+    if (sizes[s] > 2) {
+      v.arr[0] = INT_MIN;
+      v.arr[1] = INT_MAX;
+    }
+    for (c = 0; c < 2; c++)
+      for (ring = 0; ring < 2; ring++) {
+        options.chunk = chunks[c];
+        options.io_uring = ring;
+        ok &= save_text_vector(&v, TEXT_PATH, &options) == 0 &&
+              load_text_vector(&out, TEXT_PATH, &options) == 0 &&
+              same(&v, &out);
+        ok &= save_binary_vector(&v, BINARY_PATH, &options) == 0 &&
+              load_binary_vector(&out, BINARY_PATH, &options) == 0 &&
+              same(&v, &out);
+        /*binary batches also end with the chunk*/
+        ok &= stream_binary_vector(BINARY_PATH, stop_after_first, NULL,
+                                   &options) ==
+              first_batch(v.size, chunks[c] / sizeof(int));
+        ok &= stream_text_vector(TEXT_PATH, stop_after_first, NULL,
+                                 &options) ==
+              first_batch(v.size, VECTOR_IO_BATCH);
+      }
+  }
+  destroy_vector(&v);
+  destroy_vector(&out);
+  return ok;
+}
+
+static bool check_text(void) {
+  static const char *const malformed[] = {
+      "1 2 x",     "2147483648", "-2147483649", "-",   "12-3",
+      "99999999999999999999",   "1\n2\n+",     "7;8", "0x10"};
+  static const int expected[] = {12, -7, 3, 42, INT_MIN, INT_MAX, 0};
+  Vector out = create_vector(1);
+  int terminal = dup(STDERR_FILENO), null = open("/dev/null", O_WRONLY);
+  size_t i;
+  bool ok;
+  write_file(TEXT_PATH, "  12,-7\t+3\r\n0000000000042 -2147483648 "
+                        "2147483647\n-0");
+  ok = load_text_vector(&out, TEXT_PATH, NULL) == 0 && out.size == 7 &&
+       memcmp(out.arr, expected, sizeof expected) == 0;
+  /*mute the expected errors*/
+  fflush(stderr);
+  dup2(null, STDERR_FILENO);
+  for (i = 0; i < sizeof malformed / sizeof malformed[0]; i++) {
+    write_file(TEXT_PATH, malformed[i]);
+    ok &= load_text_vector(&out, TEXT_PATH, NULL) == -1;
+  }
+  write_file(BINARY_PATH, "12345");
+  ok &= load_binary_vector(&out, BINARY_PATH, NULL) == -1;
+  ok &= stream_binary_vector(BINARY_PATH, stop_after_first, NULL, NULL) == -1;
+  ok &= load_text_vector(&out, "/tmp/bench_vecio.missing", NULL) == -1;
+  dup2(terminal, STDERR_FILENO);
+  close(terminal);
+  close(null);
+  destroy_vector(&out);
+  return ok;
+}
+
+static void run_fprintf(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  FILE *text = fopen(TEXT_PATH, "w");
+  size_t i;
+  for (i = 0; i < b->v.size; i++)
+    fprintf(text, "%d\n", b->v.arr[i]);
+  fclose(text);
+}
+
+static void run_fscanf(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  FILE *text = fopen(TEXT_PATH, "r");
+  b->out.size = 0;
+  while (b->out.size < b->out.capacity &&
+         fscanf(text, "%d", &b->out.arr[b->out.size]) == 1)
+    b->out.size++;
+  fclose(text);
+}
+
+static void run_save_text(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  save_text_vector(&b->v, TEXT_PATH, &b->read);
+}
+
+static void run_load_text(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  load_text_vector(&b->out, TEXT_PATH, &b->read);
+}
+
+static void run_load_text_ring(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  load_text_vector(&b->out, TEXT_PATH, &b->ring);
+}
+
+static void run_save_binary(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  save_binary_vector(&b->v, BINARY_PATH, &b->read);
+}
+
+static void run_load_binary(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  load_binary_vector(&b->out, BINARY_PATH, &b->read);
+}
+
+static int sum_batch(const int *values, size_t count, void *ctx) {
+  long long *sum = (long long *)ctx;
+  size_t i;
+  for (i = 0; i < count; i++)
+    *sum += values[i];
+  return 0;
+}
+
+static void run_stream_binary(void *ctx) {
+  VecioBench *b = (VecioBench *)ctx;
+  long long sum = 0;
+  stream_binary_vector(BINARY_PATH, sum_batch, &sum, &b->ring);
+  sink = sum;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  VecioBench b;
+  BenchCase cases[] = {
+      {"fprintf", NULL, run_fprintf, ITEMS, "elem"},
+      {"save_text_vector", NULL, run_save_text, ITEMS, "elem"},
+      {"fscanf", NULL, run_fscanf, ITEMS, "elem"},
+      {"load_text_vector read", NULL, run_load_text, ITEMS, "elem"},
+      {"load_text_vector io_uring", NULL, run_load_text_ring, ITEMS, "elem"},
+      {"save_binary_vector", NULL, run_save_binary, ITEMS, "elem"},
+      {"load_binary_vector", NULL, run_load_binary, ITEMS, "elem"},
+      {"stream_binary_vector io_uring", NULL, run_stream_binary, ITEMS,
+       "elem"},
+  };
+  size_t c;
+
+  if (!check_round_trips() || !check_text()) {
+    fprintf(stderr, "ERROR: vector files differ from the vector.\n");
+    return 1;
+  }
+  b.v = create_vector(ITEMS);
+  b.out = create_vector(ITEMS);
+  b.read = default_vector_io_options();
+  b.read.io_uring = false;
+  b.ring = default_vector_io_options();
+  fill_values(&b.v, ITEMS);
+  for (c = 0; c < sizeof cases / sizeof cases[0]; c++)
+    bench_case(&options, &cases[c], &b);
+  run_load_text_ring(&b);
+  if (!same(&b.v, &b.out)) {
+    fprintf(stderr, "ERROR: vector files differ from the vector.\n");
+    return 1;
+  }
+  destroy_vector(&b.v);
+  destroy_vector(&b.out);
+  remove(TEXT_PATH);
+  remove(BINARY_PATH);
+  return 0;
+}
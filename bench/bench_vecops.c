@@ -0,0 +1,258 @@
+#include "bench.h"
+#include "../vecops.h"
+
+#include <limits.h>
+
+/*Checks every kernel against a naive loop, serially and on pools of 1 to 4
+ * threads (odd sizes, in place), then measures the naive loop, the kernel on
+ * the calling thread and the kernel on the default pool in GB/s.*/
+
+#define ITEMS (16u << 20)
+#define BINS 64
+
+typedef struct {
+  Vector src, dst;
+  ThreadPool *pool;
+  size_t counts[BINS];
+} VecopsBench;
+
+static volatile long long sink;
+
+static int triple(int value, void *ctx) {
+  (void)ctx;
+  return value * 3;
+}
+
+static void fill_vector(Vector *v, size_t n, unsigned int seed) {
+  size_t i;
+  v->size = n;
+  for (i = 0; i < n; i++) {
+    seed = seed * 1103515245u + 12345u;
+    v->arr[i] = (int)(seed >> 8) - (1 << 23);
+  }
+}
+
+static bool same_vector(const Vector *a, const Vector *b) {
+  return a->size == b->size &&
+         (a->size == 0 || memcmp(a->arr, b->arr, a->size * sizeof(int)) == 0);
+}
+
+/*Naive versions, wrapping through unsigned like the kernels.*/
+static void naive_scan(Vector *dst, const Vector *src, bool inclusive) {
+  unsigned int carry = 0;
+  size_t i;
+  dst->size = src->size;
+  for (i = 0; i < src->size; i++) {
+    unsigned int value = (unsigned int)src->arr[i];
+    dst->arr[i] = (int)(inclusive ? carry + value : carry);
+    carry += value;
+  }
+}
+
+static void naive_filter(Vector *dst, const Vector *src, int lo, int hi) {
+  size_t i;
+  dst->size = 0;
+  for (i = 0; i < src->size; i++)
+    if (src->arr[i] >= lo && src->arr[i] <= hi)
+      dst->arr[dst->size++] = src->arr[i];
+}
+
+static bool check_size(ThreadPool *pool, size_t n) {
+  Vector src = create_vector(n), want = create_vector(n);
+  Vector dst = create_vector(1);
+  size_t counts[BINS], expected[BINS];
+  long long sum = 0;
+  int min = INT_MAX, max = INT_MIN, got_min, got_max;
+  bool ok = true;
+  size_t i;
+  fill_vector(&src, n, (unsigned int)n);
+  for (i = 0; i < n; i++) {
+    sum += src.arr[i];
+    if (src.arr[i] < min)
+      min = src.arr[i];
+    if (src.arr[i] > max)
+      max = src.arr[i];
+  }
+  ok &= sum_vector(&src, pool) == sum;
+  ok &= n == 0 ? min_max_vector(&src, &got_min, &got_max, pool) == -1
+               : min_max_vector(&src, &got_min, &got_max, pool) == 0 &&
+                     got_min == min && got_max == max;
+
+  want.size = n;
+  for (i = 0; i < n; i++)
+    want.arr[i] = (int)((unsigned int)src.arr[i] * 3u);
+  ok &= map_vector(&dst, &src, triple, NULL, pool) == 0 &&
+        same_vector(&dst, &want);
+  for (i = 0; i < n; i++)
+    want.arr[i] = (int)((unsigned int)src.arr[i] * 1000003u + 7u);
+  ok &= affine_vector(&dst, &src, 1000003, 7, pool) == 0 &&
+        same_vector(&dst, &want);
+
+  naive_scan(&want, &src, true);
+  ok &= inclusive_scan_vector(&dst, &src, pool) == 0 &&
+        same_vector(&dst, &want);
+  naive_scan(&want, &src, false);
+  ok &= exclusive_scan_vector(&dst, &src, pool) == 0 &&
+        same_vector(&dst, &want);
+
+  memset(expected, 0, sizeof expected);
+  for (i = 0; i < n; i++)
+    if (src.arr[i] >= -(1 << 22) &&
+        (size_t)((src.arr[i] + (1 << 22)) >> 16) < BINS)
+      expected[(src.arr[i] + (1 << 22)) >> 16]++;
+  ok &= histogram_vector(&src, -(1 << 22), 16, counts, BINS, pool) == 0 &&
+        memcmp(counts, expected, sizeof counts) == 0;
+
+  naive_filter(&want, &src, -(1 << 20), 1 << 21);
+  ok &= filter_vector(&dst, &src, -(1 << 20), 1 << 21, pool) == 0 &&
+        same_vector(&dst, &want);
+
+  /*in place*/
+  naive_scan(&want, &src, true);
+  ok &= inclusive_scan_vector(&src, &src, pool) == 0 &&
+        same_vector(&src, &want);
+  fill_vector(&src, n, (unsigned int)n);
+  naive_filter(&want, &src, 0, INT_MAX);
+  ok &= filter_vector(&src, &src, 0, INT_MAX, pool) == 0 &&
+        same_vector(&src, &want);
+
+  destroy_vector(&src);
+  destroy_vector(&dst);
+  destroy_vector(&want);
+  return ok;
+}
+
+static bool check_kernels(ThreadPool *pool) {
+  static const size_t sizes[] = {0, 1, 7, 8, 9, 1000, VECTOR_PARALLEL_MIN - 1,
+                                 VECTOR_PARALLEL_MIN, 300007};
+  size_t s;
+  for (s = 0; s < sizeof sizes / sizeof sizes[0]; s++)
+    if (!check_size(pool, sizes[s]))
+      return false;
+  return true;
+}
+
+static void run_naive_sum(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  long long sum = 0;
+  size_t i;
+  for (i = 0; i < b->src.size; i++)
+    sum += b->src.arr[i];
+  sink = sum;
+}
+
+static void run_sum(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  sink = sum_vector(&b->src, b->pool);
+}
+
+static void run_naive_affine(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  size_t i;
+  b->dst.size = b->src.size;
+  for (i = 0; i < b->src.size; i++)
+    b->dst.arr[i] = (int)((unsigned int)b->src.arr[i] * 3u + 1u);
+}
+
+static void run_affine(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  affine_vector(&b->dst, &b->src, 3, 1, b->pool);
+}
+
+static void run_naive_scan(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  naive_scan(&b->dst, &b->src, true);
+}
+
+static void run_scan(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  inclusive_scan_vector(&b->dst, &b->src, b->pool);
+}
+
+static void run_naive_histogram(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  size_t i;
+  memset(b->counts, 0, sizeof b->counts);
+  for (i = 0; i < b->src.size; i++)
+    if (b->src.arr[i] >= -(1 << 23) &&
+        (size_t)(b->src.arr[i] + (1 << 23)) >> 18 < BINS)
+      b->counts[(size_t)(b->src.arr[i] + (1 << 23)) >> 18]++;
+}
+
+static void run_histogram(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  histogram_vector(&b->src, -(1 << 23), 18, b->counts, BINS, b->pool);
+}
+
+static void run_naive_filter(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  naive_filter(&b->dst, &b->src, 0, 1 << 22);
+}
+
+static void run_filter(void *ctx) {
+  VecopsBench *b = (VecopsBench *)ctx;
+  filter_vector(&b->dst, &b->src, 0, 1 << 22, b->pool);
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = bench_options(argc, argv);
+  VecopsBench b;
+  ThreadPool *pool;
+  int threads, c;
+  /*naive, serial kernel, kernel on the default pool; bytes read and written
+   * per element*/
+  struct {
+    const char *name;
+    void (*naive)(void *ctx);
+    void (*kernel)(void *ctx);
+    double bytes;
+  } kernels[] = {
+      {"sum", run_naive_sum, run_sum, 4},
+      {"affine", run_naive_affine, run_affine, 8},
+      {"inclusive scan", run_naive_scan, run_scan, 8},
+      {"histogram", run_naive_histogram, run_histogram, 4},
+      {"filter 1/4", run_naive_filter, run_filter, 5},
+  };
+
+  if (!check_kernels(NULL)) {
+    fprintf(stderr, "ERROR: vector kernels differ from naive loops.\n");
+    return 1;
+  }
+  for (threads = 1; threads <= 4; threads++) {
+    pool = create_thread_pool(threads);
+    if (pool == NULL || !check_kernels(pool)) {
+      fprintf(stderr,
+              "ERROR: vector kernels on %d threads differ from naive loops.\n",
+              threads);
+      return 1;
+    }
+    destroy_thread_pool(pool);
+  }
+
+  b.src = create_vector(ITEMS);
+  b.dst = create_vector(ITEMS);
+  fill_vector(&b.src, ITEMS, 1);
+  for (c = 0; c < (int)(sizeof kernels / sizeof kernels[0]); c++) {
+    char names[3][64];
+    BenchCase cases[3];
+    int k;
+    snprintf(names[0], sizeof names[0], "%s naive", kernels[c].name);
+    snprintf(names[1], sizeof names[1], "%s", kernels[c].name);
+    snprintf(names[2], sizeof names[2], "%s pool t=%d", kernels[c].name,
+             get_threads_thread_pool(default_thread_pool()));
+    for (k = 0; k < 3; k++) {
+      BenchResult result;
+      cases[k].name = names[k];
+      cases[k].setup = NULL;
+      cases[k].run = k == 0 ? kernels[c].naive : kernels[c].kernel;
+      cases[k].items = ITEMS;
+      cases[k].unit = "elem";
+      b.pool = k == 2 ? default_thread_pool() : NULL;
+      result = bench_case(&options, &cases[k], &b);
+      printf("  %.2f GB/s\n", kernels[c].bytes / result.median_ns);
+    }
+  }
+  destroy_vector(&b.src);
+  destroy_vector(&b.dst);
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include "bench.h"
+
+/*Every Vector operation at three sizes, per element or per call.*/
+
+typedef struct {
+  Vector v;
+  size_t n;
+} VectorBench;
+
+static volatile long sink;
+
+/*A fresh vector of n elements 0..n-1.*/
+static void fill(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  destroy_vector(&b->v);
+  b->v = create_vector(b->n);
+  for (i = 0; i < b->n; i++)
+    set_index_vector(&b->v, i, (int)i);
+}
+
+static void empty(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  destroy_vector(&b->v);
+  b->v = create_vector(1);
+  b->v.size = 0;
+}
+
+static void run_create_destroy(void *ctx) {
+  Vector v = create_vector(((VectorBench *)ctx)->n);
+  destroy_vector(&v);
+}
+
+static void run_expand_capacity(void *ctx) {
+  expand_capacity_vector(&((VectorBench *)ctx)->v);
+}
+
+static void run_get_size(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  long sum = 0;
+  for (i = 0; i < b->n; i++)
+    sum += (long)get_size_vector(&b->v);
+  sink = sum;
+}
+
+static void run_get_index(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  long sum = 0;
+  for (i = 0; i < b->n; i++)
+    sum += get_index_vector(&b->v, i);
+  sink = sum;
+}
+
+static void run_span(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  VectorSpan span = get_span_vector(&b->v, 0, b->n);
+  size_t i;
+  long sum = 0;
+  for (i = 0; i < span.size; i++)
+    sum += span.data[i];
+  sink = sum;
+}
+
+static void run_set_index(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  for (i = 0; i < b->n; i++)
+    set_index_vector(&b->v, i, (int)i);
+}
+
+static void run_get_front(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  long sum = 0;
+  for (i = 0; i < b->n; i++)
+    sum += get_front_vector(&b->v);
+  sink = sum;
+}
+
+static void run_get_back(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  long sum = 0;
+  for (i = 0; i < b->n; i++)
+    sum += get_back_vector(&b->v);
+  sink = sum;
+}
+
+static void run_find_value(void *ctx) {
+  sink = find_value_vector(&((VectorBench *)ctx)->v, -7); /*scans it all*/
+}
+
+static void run_find_transposition(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  sink = find_transposition_vector(&b->v, (int)b->n - 1);
+}
+
+static void run_push_back(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  size_t i;
+  for (i = 0; i < b->n; i++)
+    push_back_vector(&b->v, (int)i);
+}
+
+#define SHIFTS 8
+
+static void run_insert(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  int i;
+  for (i = 0; i < SHIFTS; i++)
+    insert_vector(&b->v, 0, i);
+}
+
+static void run_pop(void *ctx) {
+  VectorBench *b = (VectorBench *)ctx;
+  int i;
+  long sum = 0;
+  for (i = 0; i < SHIFTS; i++)
+    sum += pop_vector(&b->v, 0);
+  sink = sum;
+}
+
+static void run_right_rotate(void *ctx) {
+  right_rotate_vector(&((VectorBench *)ctx)->v);
+}
+
+static void run_left_rotate(void *ctx) {
+  left_rotate_vector(&((VectorBench *)ctx)->v);
+}
+
+static void run_right_rotate_n(void *ctx) {
+  right_rotate_n_times_vector(&((VectorBench *)ctx)->v, SHIFTS);
+}
+
+static void run_print(void *ctx) { print_vector(&((VectorBench *)ctx)->v); }
+
+int main(int argc, char **argv) {
+  static const size_t sizes[] = {1024, 65536, 1 << 20};
+  BenchOptions options = bench_options(argc, argv);
+  VectorBench b;
+  char names[17][64];
+  size_t s;
+  int c;
+
+  b.v = create_vector(1);
+  for (s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+    double n = (double)sizes[s];
+    BenchCase cases[17] = {
+        {"create_destroy_vector", NULL, run_create_destroy, 1, "call"},
+        {"expand_capacity_vector", fill, run_expand_capacity, 1, "call"},
+        {"get_size_vector", fill, run_get_size, n, "call"},
+        {"get_index_vector", NULL, run_get_index, n, "elem"},
+        {"get_span_vector sum", NULL, run_span, n, "elem"},
+        {"set_index_vector", NULL, run_set_index, n, "elem"},
+        {"get_front_vector", NULL, run_get_front, n, "call"},
+        {"get_back_vector", NULL, run_get_back, n, "call"},
+        {"find_value_vector", NULL, run_find_value, n, "elem"},
+        {"find_transposition_vector", fill, run_find_transposition, n, "elem"},
+        {"push_back_vector", empty, run_push_back, n, "elem"},
+        {"insert_vector front", fill, run_insert, SHIFTS, "call"},
+        {"pop_vector front", fill, run_pop, SHIFTS, "call"},
+        {"right_rotate_vector", fill, run_right_rotate, 1, "call"},
+        {"left_rotate_vector", fill, run_left_rotate, 1, "call"},
+        {"right_rotate_n_times_vector", fill, run_right_rotate_n, SHIFTS,
+         "turn"},
+        {"print_vector", fill, run_print, n, "elem"},
+    };
+    b.n = sizes[s];
+    fill(&b);
+    for (c = 0; c < 17; c++) {
+      snprintf(names[c], sizeof names[c], "%s/%zu", cases[c].name, b.n);
+      cases[c].name = names[c];
+      bench_case(&options, &cases[c], &b);
+    }
+  }
+  destroy_vector(&b.v);
+  return 0;
+}
@@ -0,0 +1,760 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "binlog.h"
+
+#include <fcntl.h>     /*Includes `open`.*/
+#include <pthread.h>   /*Includes the mutex that serializes site registration.*/
+#include <stdatomic.h> /*Includes the atomic file offset and drop count.*/
+#include <sys/mman.h>  /*Includes `mmap` and `msync` for the log file.*/
+#include <time.h>      /*Includes `clock_gettime` and `localtime_r`.*/
+#include <unistd.h>    /*Includes `ftruncate`, `close` and `sysconf`.*/
+#include <wchar.h>     /*Includes `wcslen` for `%ls` arguments.*/
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(BINLOG_USE_CLOCK)
+#include <x86intrin.h> /*Includes `__rdtsc` for the event timestamps.*/
+#define BINLOG_TSC
+#endif
+
+/*BINARY LOG*/
+
+/*File layout: a 64 byte BinLogHeader, then records. Every record starts with
+ * a 4 byte size (written last, 0 marks the end) and a 4 byte site id, and is
+ * padded to a multiple of 4 bytes.
+ *  - site id 0 defines a site: u32 id, u32 line, u8 nargs, nargs type codes,
+ *    u16 file length, file, u16 format length, format. Ids count up from 1
+ *    in each file.
+ *  - any other id is an event of that site: u64 ticks of the event clock,
+ *    then the arguments packed in order.*/
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t realtime;  /*CLOCK_REALTIME at open, nanoseconds*/
+  uint64_t ticks;     /*event clock at open*/
+  uint64_t tick_rate; /*event clock ticks per second, measured at open and
+                         again over the whole log at close*/
+  uint64_t capacity;
+  uint64_t reserved[2];
+} BinLogHeader;
+
+static const char binlog_magic[8] = {'U', 'T', 'I', 'L', 'B', 'L', 'O', 'G'};
+
+/*The hot path only reads these; open and close must not race with logging.*/
+static unsigned char *binlog_base;
+static size_t binlog_capacity;
+static int binlog_fd = -1;
+static uint32_t binlog_generation; /*never 0, which marks a new site*/
+static atomic_size_t binlog_offset;
+static atomic_size_t binlog_dropped;
+static uint32_t binlog_next_id;
+static uint64_t binlog_open_ticks, binlog_open_ns; /*for the tick rate*/
+static pthread_mutex_t binlog_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t clock_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*The event clock: the TSC where there is one, else CLOCK_MONOTONIC
+ * nanoseconds.*/
+static inline uint64_t binlog_ticks(void) {
+#ifdef BINLOG_TSC
+  return __rdtsc();
+#else
+  return clock_ns(CLOCK_MONOTONIC);
+#endif
+}
+
+/*Event clock ticks per second since `binlog_open_ticks`.*/
+static uint64_t tick_rate_binlog(void) {
+#ifdef BINLOG_TSC
+  uint64_t ticks = binlog_ticks() - binlog_open_ticks;
+  uint64_t ns = clock_ns(CLOCK_MONOTONIC) - binlog_open_ns;
+  if (ns == 0 || ticks == 0)
+    return 1000000000u;
+  return (uint64_t)((double)ticks * 1e9 / (double)ns);
+#else
+  return 1000000000u;
+#endif
+}
+
+int parse_format_binlog(const char *format, unsigned char *types, int max) {
+  const char *f = format;
+  int n = 0;
+#define PUSH_TYPE(t)                                                           \
+  do {                                                                         \
+    if (n == max)                                                              \
+      return -1;                                                               \
+    types[n++] = (t);                                                          \
+  } while (0)
+  while (*f != '\0') {
+    char length = 0;
+    if (*f++ != '%')
+      continue;
+    if (*f == '%') {
+      f++;
+      continue;
+    }
+    while (*f != '\0' && strchr("-+ #0'", *f) != NULL)
+      f++;
+    if (*f == '*') {
+      PUSH_TYPE(BINLOG_INT);
+      f++;
+    }
+    while (*f >= '0' && *f <= '9')
+      f++;
+    if (*f == '.') {
+      f++;
+      if (*f == '*') {
+        PUSH_TYPE(BINLOG_INT);
+        f++;
+      }
+      while (*f >= '0' && *f <= '9')
+        f++;
+    }
+    /*h and hh promote to int; l, ll, j, z and t are 8 bytes on the LP64
+     * targets this library supports*/
+    while (*f != '\0' && strchr("hljztL", *f) != NULL) {
+      if (*f != 'h')
+        length = *f;
+      f++;
+    }
+    switch (*f++) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      PUSH_TYPE(length == 0 ? BINLOG_INT : BINLOG_LONG);
+      break;
+    case 'c': /*`%lc` takes a wint_t, which is int sized*/
+      PUSH_TYPE(BINLOG_INT);
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      PUSH_TYPE(length == 'L' ? BINLOG_LONG_DOUBLE : BINLOG_DOUBLE);
+      break;
+    case 's':
+      PUSH_TYPE(length == 'l' ? BINLOG_WIDE_STRING : BINLOG_STRING);
+      break;
+    case 'p':
+    case 'n':
+      PUSH_TYPE(BINLOG_POINTER);
+      break;
+    default:
+      return n;
+    }
+  }
+#undef PUSH_TYPE
+  return n;
+}
+
+/*Bytes an argument of `type` takes before any string contents.*/
+static size_t fixed_size_binlog(int type) {
+  if (type == BINLOG_INT)
+    return 4;
+  return type == BINLOG_STRING || type == BINLOG_WIDE_STRING ? 2 : 8;
+}
+
+/*Claims `size` bytes of the file, or counts a drop when it is full.*/
+static unsigned char *reserve_binlog(size_t size) {
+  size_t offset =
+      atomic_fetch_add_explicit(&binlog_offset, size, memory_order_relaxed);
+  if (offset + size > binlog_capacity) {
+    atomic_fetch_add_explicit(&binlog_dropped, 1, memory_order_relaxed);
+    return NULL;
+  }
+  return binlog_base + offset;
+}
+
+static void commit_binlog(unsigned char *record, uint32_t size) {
+  __atomic_store_n((uint32_t *)record, size, __ATOMIC_RELEASE);
+}
+
+static void register_site(BinLogSite *site, const char *file, int line,
+                          const char *format) {
+  unsigned char types[BINLOG_MAX_ARGS];
+  size_t file_len = strlen(file), format_len = strlen(format), size;
+  uint16_t len16;
+  unsigned char *record, *p;
+  uint32_t id, line32 = (uint32_t)line, zero = 0;
+  int nargs, i;
+  pthread_mutex_lock(&binlog_mutex);
+  if (__atomic_load_n(&site->state, __ATOMIC_RELAXED) >> 32 ==
+          binlog_generation ||
+      binlog_next_id == UINT32_MAX) {
+    pthread_mutex_unlock(&binlog_mutex);
+    return;
+  }
+  nargs = parse_format_binlog(format, types, BINLOG_MAX_ARGS);
+  if (nargs < 0) {
+    fprintf(stderr, "ERROR: More than %d log arguments at %s:%d.\n",
+            BINLOG_MAX_ARGS, file, line);
+    nargs = 0;
+  }
+  if (file_len > UINT16_MAX)
+    file_len = UINT16_MAX;
+  if (format_len > UINT16_MAX)
+    format_len = UINT16_MAX;
+  id = ++binlog_next_id;
+  size = (4 + 4 + 4 + 4 + 1 + (size_t)nargs + 2 + file_len + 2 + format_len +
+          3) & ~(size_t)3;
+  record = reserve_binlog(size);
+  if (record != NULL) {
+    p = record + 4;
+    memcpy(p, &zero, 4);
+    memcpy(p + 4, &id, 4);
+    memcpy(p + 8, &line32, 4);
+    p[12] = (unsigned char)nargs;
+    memcpy(p + 13, types, (size_t)nargs);
+    p += 13 + nargs;
+    len16 = (uint16_t)file_len;
+    memcpy(p, &len16, 2);
+    memcpy(p + 2, file, file_len);
+    p += 2 + file_len;
+    len16 = (uint16_t)format_len;
+    memcpy(p, &len16, 2);
+    memcpy(p + 2, format, format_len);
+    commit_binlog(record, (uint32_t)size);
+  }
+  site->size = 16;
+  for (i = 0; i < nargs; i++)
+    site->size += (uint32_t)fixed_size_binlog(types[i]);
+  site->nargs = (unsigned char)nargs;
+  memcpy(site->types, types, (size_t)nargs);
+  __atomic_store_n(&site->state, (uint64_t)binlog_generation << 32 | id,
+                   __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&binlog_mutex);
+}
+
+/*One argument read from the va_list, kept until the record is reserved.*/
+typedef union {
+  int i;
+  long long ll;
+  double d;
+  uint64_t u;
+  const void *bytes; /*string contents*/
+} BinLogValue;
+
+void binlog_write(BinLogSite *site, const char *file, int line,
+                  const char *format, ...) {
+  va_list args;
+  BinLogValue values[BINLOG_MAX_ARGS];
+  uint16_t lengths[BINLOG_MAX_ARGS];
+  unsigned char *record, *p;
+  size_t size;
+  uint64_t now, state;
+  uint32_t id;
+  int i;
+  if (binlog_base == NULL)
+    return;
+  state = __atomic_load_n(&site->state, __ATOMIC_ACQUIRE);
+  if (state >> 32 != binlog_generation) {
+    register_site(site, file, line, format);
+    state = __atomic_load_n(&site->state, __ATOMIC_ACQUIRE);
+    if (state >> 32 != binlog_generation) /*out of site ids*/
+      return;
+  }
+  id = (uint32_t)state;
+  now = binlog_ticks();
+
+  /*one pass over the arguments: the fixed sizes are known from the site, so
+   * only the strings add to the size*/
+  size = site->size;
+  va_start(args, format);
+  for (i = 0; i < site->nargs; i++) {
+    switch (site->types[i]) {
+    case BINLOG_INT:
+      values[i].i = va_arg(args, int);
+      break;
+    case BINLOG_LONG:
+      values[i].ll = va_arg(args, long long);
+      break;
+    case BINLOG_DOUBLE:
+      values[i].d = va_arg(args, double);
+      break;
+    case BINLOG_LONG_DOUBLE:
+      values[i].d = (double)va_arg(args, long double);
+      break;
+    case BINLOG_POINTER:
+      values[i].u = (uint64_t)(uintptr_t)va_arg(args, void *);
+      break;
+    case BINLOG_STRING: {
+      const char *s = va_arg(args, const char *);
+      size_t len;
+      if (s == NULL)
+        s = "(null)";
+      len = strlen(s);
+      lengths[i] = (uint16_t)(len > UINT16_MAX ? UINT16_MAX : len);
+      values[i].bytes = s;
+      size += lengths[i];
+      break;
+    }
+    default: {
+      const wchar_t *s = va_arg(args, const wchar_t *);
+      size_t len, max = UINT16_MAX - UINT16_MAX % sizeof(wchar_t);
+      if (s == NULL)
+        s = L"(null)";
+      len = wcslen(s) * sizeof(wchar_t);
+      lengths[i] = (uint16_t)(len > max ? max : len);
+      values[i].bytes = s;
+      size += lengths[i];
+      break;
+    }
+    }
+  }
+  va_end(args);
+  size = (size + 3) & ~(size_t)3;
+
+  record = reserve_binlog(size);
+  if (record == NULL)
+    return;
+  memcpy(record + 4, &id, 4);
+  memcpy(record + 8, &now, 8);
+  p = record + 16;
+  for (i = 0; i < site->nargs; i++) {
+    switch (site->types[i]) {
+    case BINLOG_INT:
+      memcpy(p, &values[i].i, 4);
+      p += 4;
+      break;
+    case BINLOG_STRING:
+    case BINLOG_WIDE_STRING:
+      memcpy(p, &lengths[i], 2);
+      memcpy(p + 2, values[i].bytes, lengths[i]);
+      p += 2 + lengths[i];
+      break;
+    default:
+      memcpy(p, &values[i], 8);
+      p += 8;
+      break;
+    }
+  }
+  commit_binlog(record, (uint32_t)size);
+}
+
+int open_binlog(const char *path, size_t capacity) {
+  BinLogHeader header;
+  size_t page, page_size = (size_t)sysconf(_SC_PAGESIZE);
+  void *base;
+  int fd;
+  if (binlog_base != NULL)
+    close_binlog();
+  capacity += sizeof(BinLogHeader);
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: Cannot open log file %s.\n", path);
+    return -1;
+  }
+  if (ftruncate(fd, (off_t)capacity) != 0) {
+    fprintf(stderr, "ERROR: Cannot size log file %s.\n", path);
+    close(fd);
+    return -1;
+  }
+  base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Cannot map log file %s.\n", path);
+    close(fd);
+    return -1;
+  }
+  /*write to every page now so the hot path takes no write faults*/
+  for (page = 0; page < capacity; page += page_size)
+    ((volatile unsigned char *)base)[page] = 0;
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, binlog_magic, sizeof binlog_magic);
+  header.version = BINLOG_VERSION;
+  header.header_size = sizeof(BinLogHeader);
+  /*a first tick rate over about a millisecond, so a log that is never closed
+   * still decodes; close measures it again over the whole log*/
+  binlog_open_ns = clock_ns(CLOCK_MONOTONIC);
+  binlog_open_ticks = binlog_ticks();
+  header.realtime = clock_ns(CLOCK_REALTIME);
+  header.ticks = binlog_open_ticks;
+  while (clock_ns(CLOCK_MONOTONIC) - binlog_open_ns < 1000000u)
+    ;
+  header.tick_rate = tick_rate_binlog();
+  header.capacity = capacity;
+  memcpy(base, &header, sizeof header);
+
+  binlog_fd = fd;
+  binlog_capacity = capacity;
+  binlog_next_id = 0;
+  if (++binlog_generation == 0)
+    binlog_generation++;
+  atomic_store(&binlog_offset, sizeof(BinLogHeader));
+  atomic_store(&binlog_dropped, 0);
+  binlog_base = (unsigned char *)base;
+  return 0;
+}
+
+void close_binlog(void) {
+  size_t used = atomic_load(&binlog_offset);
+  uint64_t rate;
+  if (binlog_base == NULL)
+    return;
+  if (used > binlog_capacity)
+    used = binlog_capacity;
+  rate = tick_rate_binlog();
+  memcpy(binlog_base + offsetof(BinLogHeader, tick_rate), &rate, sizeof rate);
+  msync(binlog_base, binlog_capacity, MS_SYNC);
+  munmap(binlog_base, binlog_capacity);
+  binlog_base = NULL;
+  if (ftruncate(binlog_fd, (off_t)used) != 0)
+    fprintf(stderr, "ERROR: Cannot truncate log file.\n");
+  close(binlog_fd);
+  binlog_fd = -1;
+}
+
+size_t dropped_binlog(void) { return atomic_load(&binlog_dropped); }
+
+/*DECODER*/
+
+/*The decoder trusts nothing in the file: every read is bounded by the end of
+ * its record, and a record that does not parse is reported and skipped.*/
+
+#define BINLOG_MIN_SITE 24 /*bytes in the smallest site record*/
+
+typedef struct {
+  uint32_t line;
+  unsigned char nargs;
+  unsigned char types[BINLOG_MAX_ARGS];
+  char *file;
+  char *format;
+} DecodedSite;
+
+/*The `len` bytes at `p` as a new string, NULL if memory runs out.*/
+static char *copy_string_binlog(const unsigned char *p, size_t len) {
+  char *s = (char *)malloc(len + 1);
+  if (s == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return NULL;
+  }
+  memcpy(s, p, len);
+  s[len] = '\0';
+  return s;
+}
+
+/*Reads the site record body from `p` to `end` into `site` and returns its
+ * id, or 0 if the record is malformed or memory runs out. The types must be
+ * the ones the format asks for, which `print_event` relies on.*/
+static uint32_t read_site(const unsigned char *p, const unsigned char *end,
+                          DecodedSite *site) {
+  unsigned char types[BINLOG_MAX_ARGS];
+  uint16_t file_len, format_len;
+  uint32_t id;
+  int parsed;
+  site->file = site->format = NULL;
+  if (end - p < 9)
+    return 0;
+  memcpy(&id, p, 4);
+  memcpy(&site->line, p + 4, 4);
+  site->nargs = p[8];
+  p += 9;
+  if (id == 0 || site->nargs > BINLOG_MAX_ARGS ||
+      (size_t)(end - p) < (size_t)site->nargs + 2)
+    return 0;
+  memcpy(site->types, p, site->nargs);
+  p += site->nargs;
+  memcpy(&file_len, p, 2);
+  if ((size_t)(end - p) < 2 + (size_t)file_len + 2)
+    return 0;
+  memcpy(&format_len, p + 2 + file_len, 2);
+  if ((size_t)(end - p) < 2 + (size_t)file_len + 2 + format_len)
+    return 0;
+  site->file = copy_string_binlog(p + 2, file_len);
+  site->format = copy_string_binlog(p + 2 + file_len + 2, format_len);
+  if (site->file == NULL || site->format == NULL)
+    return 0;
+  /*a format with too many arguments is registered with none*/
+  parsed = parse_format_binlog(site->format, types, BINLOG_MAX_ARGS);
+  if (parsed < 0 ? site->nargs != 0
+                 : parsed != site->nargs ||
+                       memcmp(types, site->types, site->nargs) != 0)
+    return 0;
+  return id;
+}
+
+/*Whether the arguments of an event of `site` fit between `p` and `end`.*/
+static bool event_fits(const DecodedSite *site, const unsigned char *p,
+                       const unsigned char *end) {
+  int i;
+  for (i = 0; i < site->nargs; i++) {
+    size_t need = fixed_size_binlog(site->types[i]);
+    if ((size_t)(end - p) < need)
+      return false;
+    if (need == 2) { /*a string*/
+      uint16_t len;
+      memcpy(&len, p, 2);
+      need += len;
+      if ((size_t)(end - p) < need)
+        return false;
+    }
+    p += need;
+  }
+  return true;
+}
+
+/*Stores `site` as site `id`, growing `*sites` as needed. Returns -1 if
+ * memory runs out.*/
+static int store_site(DecodedSite **sites, size_t *count, size_t *capacity,
+                      uint32_t id, const DecodedSite *site) {
+  if (id > *capacity) {
+    size_t grown = *capacity > 0 ? *capacity * 2 : 64;
+    DecodedSite *resized;
+    while (grown < id)
+      grown *= 2;
+    resized = (DecodedSite *)realloc(*sites, grown * sizeof(DecodedSite));
+    if (resized == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    *sites = resized;
+    *capacity = grown;
+  }
+  if (id > *count) {
+    memset(*sites + *count, 0, (id - *count) * sizeof(DecodedSite));
+    *count = id;
+  }
+  free((*sites)[id - 1].file);
+  free((*sites)[id - 1].format);
+  (*sites)[id - 1] = *site;
+  return 0;
+}
+
+/*Prints one conversion `spec` (the text from '%' to the conversion letter)
+ * with up to two `*` values and the argument at `*p`, advancing `*p`.*/
+static void print_spec(FILE *out, const char *spec, int stars,
+                        const int *star_values, int type,
+                        const unsigned char **p) {
+  size_t n = strlen(spec);
+  char conversion = spec[n - 1], length = n >= 2 ? spec[n - 2] : 0;
+  int s0 = star_values[0], s1 = star_values[1];
+#define PRINT_ARG(x)                                                           \
+  (stars == 0   ? fprintf(out, spec, x)                                        \
+   : stars == 1 ? fprintf(out, spec, s0, x)                                    \
+                : fprintf(out, spec, s0, s1, x))
+  switch (type) {
+  case BINLOG_INT: {
+    int v;
+    memcpy(&v, *p, 4);
+    *p += 4;
+    PRINT_ARG(v);
+    break;
+  }
+  case BINLOG_LONG: {
+    long long v;
+    memcpy(&v, *p, 8);
+    *p += 8;
+    if (length == 'z')
+      PRINT_ARG((size_t)v);
+    else if (length == 'j')
+      PRINT_ARG((intmax_t)v);
+    else if (length == 't')
+      PRINT_ARG((ptrdiff_t)v);
+    else if (length == 'l' && !(n >= 3 && spec[n - 3] == 'l'))
+      PRINT_ARG((long)v);
+    else
+      PRINT_ARG(v);
+    break;
+  }
+  case BINLOG_DOUBLE: {
+    double v;
+    memcpy(&v, *p, 8);
+    *p += 8;
+    PRINT_ARG(v);
+    break;
+  }
+  case BINLOG_LONG_DOUBLE: {
+    double v;
+    memcpy(&v, *p, 8);
+    *p += 8;
+    PRINT_ARG((long double)v);
+    break;
+  }
+  case BINLOG_POINTER: {
+    uint64_t v;
+    memcpy(&v, *p, 8);
+    *p += 8;
+    if (conversion == 'p')
+      PRINT_ARG((void *)(uintptr_t)v);
+    break;
+  }
+  case BINLOG_WIDE_STRING: {
+    uint16_t len;
+    wchar_t *s;
+    memcpy(&len, *p, 2);
+    s = (wchar_t *)malloc((len / sizeof(wchar_t) + 1) * sizeof(wchar_t));
+    if (s == NULL) {
+      fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+      *p += 2 + len;
+      break;
+    }
+    memcpy(s, *p + 2, len / sizeof(wchar_t) * sizeof(wchar_t));
+    s[len / sizeof(wchar_t)] = L'\0';
+    *p += 2 + len;
+    PRINT_ARG(s);
+    free(s);
+    break;
+  }
+  default: {
+    uint16_t len;
+    char *s;
+    memcpy(&len, *p, 2);
+    s = copy_string_binlog(*p + 2, len);
+    *p += 2 + len;
+    if (s == NULL)
+      break;
+    PRINT_ARG(s);
+    free(s);
+    break;
+  }
+  }
+#undef PRINT_ARG
+}
+
+/*Walks the format again, printing literal text as is and each conversion
+ * with its recorded argument. `event_fits` has checked the arguments.*/
+static void print_event(FILE *out, const DecodedSite *site,
+                        const unsigned char *p) {
+  const char *f = site->format;
+  char spec[64];
+  int arg = 0;
+  while (*f != '\0') {
+    const char *start = f;
+    int stars = 0, star_values[2] = {0, 0};
+    size_t n;
+    if (*f != '%') {
+      while (*f != '\0' && *f != '%')
+        f++;
+      fwrite(start, 1, (size_t)(f - start), out);
+      continue;
+    }
+    if (f[1] == '%') {
+      fputc('%', out);
+      f += 2;
+      continue;
+    }
+    for (f++; *f != '\0' && strchr("diouxXcfFeEgGaAspn", *f) == NULL; f++)
+      if (*f == '*' && stars < 2 && arg < site->nargs) {
+        memcpy(&star_values[stars++], p, 4);
+        p += 4;
+        arg++;
+      }
+    n = (size_t)(f + 1 - start);
+    if (*f == '\0' || arg >= site->nargs || n >= sizeof spec) {
+      fputs(start, out);
+      return;
+    }
+    f++;
+    memcpy(spec, start, n);
+    spec[n] = '\0';
+    print_spec(out, spec, stars, star_values, site->types[arg++], &p);
+  }
+}
+
+long decode_binlog(const char *path, FILE *out, bool color) {
+  FILE *in = fopen(path, "rb");
+  unsigned char *data = NULL;
+  BinLogHeader header;
+  DecodedSite *sites = NULL;
+  size_t size = 0, offset, site_count = 0, site_capacity = 0, i;
+  long events = 0, length;
+  if (in == NULL) {
+    fprintf(stderr, "ERROR: Cannot open log file %s.\n", path);
+    return -1;
+  }
+  if (fseek(in, 0, SEEK_END) == 0 && (length = ftell(in)) >= 0 &&
+      fseek(in, 0, SEEK_SET) == 0) {
+    size = (size_t)length;
+    data = (unsigned char *)malloc(size > 0 ? size : 1);
+  }
+  if (data == NULL || fread(data, 1, size, in) != size ||
+      size < sizeof header) {
+    fprintf(stderr, "ERROR: Cannot read log file %s.\n", path);
+    free(data);
+    fclose(in);
+    return -1;
+  }
+  fclose(in);
+  memcpy(&header, data, sizeof header);
+  if (memcmp(header.magic, binlog_magic, sizeof binlog_magic) != 0 ||
+      header.version != BINLOG_VERSION || header.tick_rate == 0) {
+    fprintf(stderr, "ERROR: %s is not a version %d binary log.\n", path,
+            BINLOG_VERSION);
+    free(data);
+    return -1;
+  }
+
+  for (offset = header.header_size; offset + 8 <= size;) {
+    uint32_t record_size, id;
+    const unsigned char *p = data + offset, *end;
+    memcpy(&record_size, p, 4);
+    memcpy(&id, p + 4, 4);
+    if (record_size == 0) /*the end of the log*/
+      break;
+    if (record_size < 8 || record_size > size - offset) {
+      fprintf(stderr, "ERROR: Truncated record at offset %zu of %s.\n",
+              offset, path);
+      break;
+    }
+    end = p + record_size;
+    if (id == 0) {
+      DecodedSite site;
+      uint32_t site_id = read_site(p + 8, end, &site);
+      /*ids count up from 1, so none is larger than the number of site
+       * records the file has room for*/
+      if (site_id == 0 || site_id > size / BINLOG_MIN_SITE ||
+          store_site(&sites, &site_count, &site_capacity, site_id,
+                     &site) != 0) {
+        fprintf(stderr, "ERROR: Bad site record at offset %zu of %s.\n",
+                offset, path);
+        free(site.file);
+        free(site.format);
+      }
+    } else if (id <= site_count && sites[id - 1].format != NULL &&
+               record_size >= 16 &&
+               event_fits(&sites[id - 1], p + 16, end)) {
+      const DecodedSite *site = &sites[id - 1];
+      uint64_t now, ticks, wall;
+      time_t seconds;
+      struct tm tm;
+      memcpy(&now, p + 8, 8);
+      /*split so the nanoseconds cannot overflow; TSCs of different cores
+       * may be a little behind the one that opened the log*/
+      ticks = now > header.ticks ? now - header.ticks : 0;
+      wall = header.realtime + ticks / header.tick_rate * 1000000000u +
+             ticks % header.tick_rate * 1000000000u / header.tick_rate;
+      seconds = (time_t)(wall / 1000000000u);
+      localtime_r(&seconds, &tm);
+      fprintf(out, "%02d:%02d:%02d.%06u ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+              (unsigned int)(wall % 1000000000u / 1000u));
+      if (color)
+        fprintf(out, "F: " CYAN "%s" RESET " L: " MAGENTA "%u" RESET " O: ",
+                site->file, site->line);
+      else
+        fprintf(out, "F: %s L: %u O: ", site->file, site->line);
+      print_event(out, site, p + 16);
+      fputc('\n', out);
+      events++;
+    } else {
+      fprintf(stderr, "ERROR: Bad event record at offset %zu of %s.\n",
+              offset, path);
+    }
+    offset += record_size;
+  }
+  for (i = 0; i < site_count; i++) {
+    free(sites[i].file);
+    free(sites[i].format);
+  }
+  free(sites);
+  free(data);
+  return events;
+}
@@ -0,0 +1,92 @@
+#ifndef __BINLOG_H__
+#define __BINLOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "utils.h"
+
+/*BINARY LOG*/
+
+/*A deferred-format log in the style of NanoLog. The hot path formats
+ * nothing: it copies a call site id, a timestamp and the raw argument bytes
+ * into a memory-mapped file. The format string, file and line of each call
+ * site are written once, the first time the site logs. `binlog_decode`
+ * renders the file later with the debug_puts colors.
+ *
+ * Argument types come from the format string: integer, floating point, `%s`
+ * and `%ls` (the string bytes are copied), `%lc` and `%p` conversions are
+ * supported, including `*` widths and precisions. `%n` is ignored. Events
+ * are stamped with the TSC on x86 and with CLOCK_MONOTONIC elsewhere or with
+ * -DBINLOG_USE_CLOCK; the file records the tick rate for the decoder.
+ *
+ * Usage:
+ *   open_binlog("app.blog", 64 << 20);
+ *   BINLOG("request %d took %.3f ms on %s", id, ms, host);
+ *   close_binlog();
+ *   $ ./binlog_decode app.blog*/
+#define BINLOG_MAX_ARGS 16
+#define BINLOG_VERSION 3
+
+/*Argument encodings: 4 byte int (also `%lc`, as wint_t is int sized), 8 byte
+ * integer, 8 byte double, 8 byte pointer, a string stored as a 2 byte length
+ * plus its bytes, a long double stored as an 8 byte double, and a wide string
+ * stored as a 2 byte length in bytes plus its wchar_t units.*/
+enum {
+  BINLOG_INT = 1,
+  BINLOG_LONG,
+  BINLOG_DOUBLE,
+  BINLOG_POINTER,
+  BINLOG_STRING,
+  BINLOG_LONG_DOUBLE,
+  BINLOG_WIDE_STRING
+};
+
+typedef struct {
+  /*the file generation in the high 32 bits and the site id in the low 32,
+   * 0 until the site is registered, so a site registers again after
+   * `open_binlog`; accessed with __atomic builtins*/
+  uint64_t state;
+  uint32_t size; /*event bytes before the string contents are added*/
+  unsigned char nargs;
+  unsigned char types[BINLOG_MAX_ARGS];
+} BinLogSite;
+
+#define BINLOG(...)                                                            \
+  do {                                                                         \
+    static BinLogSite binlog_site_;                                            \
+    binlog_write(&binlog_site_, __FILE__, __LINE__, __VA_ARGS__);              \
+  } while (0)
+
+/*Creates `path` with room for `capacity` bytes of records and touches every
+ * page of it, so logging calls take no page faults. Records that do not fit
+ * are dropped and counted. Returns -1 on error.*/
+int open_binlog(const char *path, size_t capacity);
+/*Syncs and truncates the file to the bytes used. Must not race with
+ * logging calls.*/
+void close_binlog(void);
+size_t dropped_binlog(void);
+
+void binlog_write(BinLogSite *site, const char *file, int line,
+                  const char *format, ...);
+
+/*Fills `types` with one BINLOG_* code per argument consumed by `format` and
+ * returns how many, or -1 for more than `max`.*/
+int parse_format_binlog(const char *format, unsigned char *types, int max);
+
+/*Renders every record of `path` to `out`, one line per record. Returns the
+ * number of records or -1 if the file cannot be read.*/
+long decode_binlog(const char *path, FILE *out, bool color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BINLOG_H__
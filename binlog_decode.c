@@ -0,0 +1,31 @@
+#define NO_MEMORY_DEBUG
+#include "binlog.h"
+
+#include <locale.h> /*Includes `setlocale` so `%ls` prints the locale's
+                       characters.*/
+
+/*Renders binary logs written with BINLOG as text.
+ *
+ * Usage: binlog_decode [--color | --no-color] file...
+ * Colors default to on when stdout is a terminal and NO_COLOR is unset.*/
+int main(int argc, char **argv) {
+  bool color = use_color();
+  int i, files = 0, status = 0;
+  setlocale(LC_CTYPE, "");
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--color") == 0) {
+      color = true;
+    } else if (strcmp(argv[i], "--no-color") == 0) {
+      color = false;
+    } else {
+      files++;
+      if (decode_binlog(argv[i], stdout, color) < 0)
+        status = 1;
+    }
+  }
+  if (files == 0) {
+    fprintf(stderr, "Usage: %s [--color | --no-color] file...\n", argv[0]);
+    return 2;
+  }
+  return status;
+}
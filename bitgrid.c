@@ -0,0 +1,187 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "bitgrid.h"
+
+/*BITGRID*/
+
+/*Pointer to the first word of user row `row` (-1 and `rows` are the zero
+ * padding rows).*/
+static uint64_t *row_words(const BitGrid *grid, long row) {
+  return grid->words + (size_t)(row + 1) * grid->words_per_row;
+}
+
+/*Mask of the valid bits in the last word of a row.*/
+static uint64_t tail_mask(const BitGrid *grid) {
+  size_t tail = grid->cols % 64;
+  return tail == 0 ? ~UINT64_C(0) : (UINT64_C(1) << tail) - 1;
+}
+
+BitGrid create_bitgrid(size_t rows, size_t cols) {
+  BitGrid grid;
+  grid.rows = rows;
+  grid.cols = cols;
+  grid.words_per_row = (cols + 63) / 64;
+  if (grid.words_per_row == 0)
+    grid.words_per_row = 1;
+  grid.words =
+      (uint64_t *)calloc((rows + 2) * grid.words_per_row, sizeof(uint64_t));
+  if (grid.words == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+  }
+  return grid;
+}
+
+void destroy_bitgrid(BitGrid *grid) {
+  free(grid->words);
+  grid->words = NULL;
+  grid->rows = 0;
+  grid->cols = 0;
+  grid->words_per_row = 0;
+}
+
+bool get_bitgrid(const BitGrid *grid, size_t row, size_t col) {
+  if (row >= grid->rows || col >= grid->cols)
+    return false;
+  return (row_words(grid, (long)row)[col / 64] >> (col % 64)) & 1;
+}
+
+void set_bitgrid(BitGrid *grid, size_t row, size_t col, bool value) {
+  uint64_t *word;
+  if (row >= grid->rows || col >= grid->cols) {
+    fprintf(stderr, "ERROR: Index out of range.\n");
+    return;
+  }
+  word = &row_words(grid, (long)row)[col / 64];
+  if (value)
+    *word |= UINT64_C(1) << (col % 64);
+  else
+    *word &= ~(UINT64_C(1) << (col % 64));
+}
+
+size_t count_bitgrid(const BitGrid *grid) {
+  size_t i, count = 0;
+  for (i = 0; i < grid->rows * grid->words_per_row; i++)
+    count += (size_t)__builtin_popcountll(grid->words[grid->words_per_row + i]);
+  return count;
+}
+
+/*One bit-sliced full adder: `*sum` and `*carry` of three 64 lane inputs.*/
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum,
+                            uint64_t *carry) {
+  uint64_t t = a ^ b;
+  *sum = t ^ c;
+  *carry = (a & b) | (t & c);
+}
+
+/*The west and east neighbors of the 64 cells in `row[w]`, pulling the edge
+ * bit in from the adjacent words.*/
+static inline uint64_t west_of(const uint64_t *row, size_t w) {
+  return (row[w] << 1) | (w > 0 ? row[w - 1] >> 63 : 0);
+}
+
+static inline uint64_t east_of(const uint64_t *row, size_t w, size_t n) {
+  return (row[w] >> 1) | (w + 1 < n ? row[w + 1] << 63 : 0);
+}
+
+/*Lanes whose 4 bit count (b0 is the low bit) equals `n`.*/
+static inline uint64_t count_equals(uint64_t b0, uint64_t b1, uint64_t b2,
+                                    uint64_t b3, unsigned int n) {
+  return (n & 1 ? b0 : ~b0) & (n & 2 ? b1 : ~b1) & (n & 4 ? b2 : ~b2) &
+         (n & 8 ? b3 : ~b3);
+}
+
+void step_bitgrid(const BitGrid *src, BitGrid *dst, unsigned int birth,
+                  unsigned int survive) {
+  size_t n = src->words_per_row, w;
+  uint64_t mask = tail_mask(src);
+  long r;
+  if (dst->rows != src->rows || dst->cols != src->cols) {
+    fprintf(stderr, "ERROR: BitGrid sizes differ.\n");
+    return;
+  }
+  for (r = 0; r < (long)src->rows; r++) {
+    const uint64_t *up = row_words(src, r - 1);
+    const uint64_t *mid = row_words(src, r);
+    const uint64_t *down = row_words(src, r + 1);
+    uint64_t *out = row_words(dst, r);
+    for (w = 0; w < n; w++) {
+      uint64_t s1, c1, s2, c2, s3, c3, b0, c4, t1, d1, b1, d2, b2, b3;
+      uint64_t born = 0, kept = 0, self = mid[w];
+      unsigned int k;
+      /*8 one bit inputs -> weights 1 (s*), 2 (c*) and 4 (d*)*/
+      full_add(west_of(up, w), up[w], east_of(up, w, n), &s1, &c1);
+      full_add(west_of(mid, w), east_of(mid, w, n), west_of(down, w), &s2,
+               &c2);
+      s3 = down[w] ^ east_of(down, w, n);
+      c3 = down[w] & east_of(down, w, n);
+      full_add(s1, s2, s3, &b0, &c4);
+      full_add(c1, c2, c3, &t1, &d1);
+      b1 = t1 ^ c4;
+      d2 = t1 & c4;
+      b2 = d1 ^ d2;
+      b3 = d1 & d2;
+      for (k = 0; k <= 8; k++) {
+        if (birth & (1u << k))
+          born |= count_equals(b0, b1, b2, b3, k);
+        if (survive & (1u << k))
+          kept |= count_equals(b0, b1, b2, b3, k);
+      }
+      out[w] = (born & ~self) | (kept & self);
+    }
+    out[n - 1] &= mask;
+  }
+}
+
+void load_grid_bitgrid(BitGrid *grid, const Grid *cells) {
+  size_t r, c;
+  if (cells->rows != grid->rows || cells->cols != grid->cols) {
+    fprintf(stderr, "ERROR: Grid size does not match BitGrid size.\n");
+    return;
+  }
+  for (r = 0; r < grid->rows; r++) {
+    uint64_t *row = row_words(grid, (long)r);
+    memset(row, 0, grid->words_per_row * sizeof(uint64_t));
+    for (c = 0; c < grid->cols; c++)
+      if (get_grid(cells, (long)r, (long)c) != 0)
+        row[c / 64] |= UINT64_C(1) << (c % 64);
+  }
+}
+
+void store_grid_bitgrid(const BitGrid *grid, Grid *cells) {
+  size_t r, c;
+  if (cells->rows != grid->rows || cells->cols != grid->cols) {
+    fprintf(stderr, "ERROR: Grid size does not match BitGrid size.\n");
+    return;
+  }
+  for (r = 0; r < grid->rows; r++) {
+    const uint64_t *row = row_words(grid, (long)r);
+    for (c = 0; c < grid->cols; c++)
+      set_grid(cells, (long)r, (long)c, (int)((row[c / 64] >> (c % 64)) & 1));
+  }
+}
+
+void load_vector_bitgrid(BitGrid *grid, Vector *vector) {
+  size_t r, c, i = 0;
+  if (vector->size != grid->rows * grid->cols) {
+    fprintf(stderr, "ERROR: Vector size does not match BitGrid size.\n");
+    return;
+  }
+  for (r = 0; r < grid->rows; r++) {
+    uint64_t *row = row_words(grid, (long)r);
+    memset(row, 0, grid->words_per_row * sizeof(uint64_t));
+    for (c = 0; c < grid->cols; c++)
+      if (vector->arr[i++] != 0)
+        row[c / 64] |= UINT64_C(1) << (c % 64);
+  }
+}
+
+Vector to_vector_bitgrid(const BitGrid *grid) {
+  size_t r, c, i = 0;
+  Vector vector = create_vector(grid->rows * grid->cols);
+  for (r = 0; r < grid->rows; r++) {
+    const uint64_t *row = row_words(grid, (long)r);
+    for (c = 0; c < grid->cols; c++)
+      vector.arr[i++] = (int)((row[c / 64] >> (c % 64)) & 1);
+  }
+  return vector;
+}
@@ -0,0 +1,55 @@
+#ifndef __BITGRID_H__
+#define __BITGRID_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "utils.h"
+
+/*BITGRID*/
+
+/*A binary grid (alive/dead, wall/open) with one bit per cell, 64 cells per
+ * word. Column `c` of a row is bit `c % 64` of word `c / 64`. There is one
+ * all zero row above and below the user rows, and the bits past `cols` in the
+ * last word of a row are kept zero, so everything outside the grid is dead.*/
+typedef struct {
+  uint64_t *words;
+  size_t rows, cols;
+  size_t words_per_row;
+} BitGrid;
+
+/*Outer-totalistic rules are given as bit masks over the neighbor count 0..8:
+ * a dead cell with n live neighbors is born if `birth & (1 << n)`, a live one
+ * survives if `survive & (1 << n)`.*/
+#define BITGRID_LIFE_BIRTH (1u << 3)
+#define BITGRID_LIFE_SURVIVE ((1u << 2) | (1u << 3))
+
+BitGrid create_bitgrid(size_t rows, size_t cols);
+void destroy_bitgrid(BitGrid *grid);
+bool get_bitgrid(const BitGrid *grid, size_t row, size_t col);
+void set_bitgrid(BitGrid *grid, size_t row, size_t col, bool value);
+size_t count_bitgrid(const BitGrid *grid);
+
+/*Computes one generation of `src` into `dst`, which must have the same size.
+ * Neighbor counts are formed 64 cells at a time with bit-sliced adders.*/
+void step_bitgrid(const BitGrid *src, BitGrid *dst, unsigned int birth,
+                  unsigned int survive);
+
+/*Any nonzero int is a live cell. The int grid and the vector are row-major
+ * with `rows * cols` user cells; exported cells are 0 or 1.*/
+void load_grid_bitgrid(BitGrid *grid, const Grid *cells);
+void store_grid_bitgrid(const BitGrid *grid, Grid *cells);
+void load_vector_bitgrid(BitGrid *grid, Vector *vector);
+Vector to_vector_bitgrid(const BitGrid *grid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BITGRID_H__
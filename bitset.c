@@ -0,0 +1,739 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "bitset.h"
+
+#include "simd.h"
+
+#if !SIMD_AVX2 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*BITSET*/
+
+static inline size_t popcount64(uint64_t x) {
+  return (size_t)__builtin_popcountll(x);
+}
+
+static void drop_rank_bitset(Bitset *bitset) {
+  free(bitset->rank);
+  bitset->rank = NULL;
+}
+
+Bitset create_bitset(size_t nbits) {
+  Bitset bitset;
+  bitset.nbits = nbits;
+  bitset.nwords = (nbits + 63) / 64;
+  if (bitset.nwords == 0)
+    bitset.nwords = 1;
+  bitset.words = (uint64_t *)calloc(bitset.nwords, sizeof(uint64_t));
+  bitset.rank = NULL;
+  if (bitset.words == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+  }
+  return bitset;
+}
+
+void destroy_bitset(Bitset *bitset) {
+  free(bitset->words);
+  drop_rank_bitset(bitset);
+  bitset->words = NULL;
+  bitset->nbits = 0;
+  bitset->nwords = 0;
+}
+
+void set_bit_bitset(Bitset *bitset, size_t index) {
+  if (index >= bitset->nbits) {
+    fprintf(stderr, "ERROR: Index out of range.\n");
+    return;
+  }
+  if (bitset->rank != NULL)
+    drop_rank_bitset(bitset);
+  bitset->words[index / 64] |= UINT64_C(1) << (index % 64);
+}
+
+void clear_bit_bitset(Bitset *bitset, size_t index) {
+  if (index >= bitset->nbits) {
+    fprintf(stderr, "ERROR: Index out of range.\n");
+    return;
+  }
+  if (bitset->rank != NULL)
+    drop_rank_bitset(bitset);
+  bitset->words[index / 64] &= ~(UINT64_C(1) << (index % 64));
+}
+
+bool test_bit_bitset(const Bitset *bitset, size_t index) {
+  if (index >= bitset->nbits)
+    return false;
+  return (bitset->words[index / 64] >> (index % 64)) & 1;
+}
+
+#if SIMD_AVX2
+/*Popcount of `n` words (of `a & b` when `b` is not NULL), 256 bits at a time:
+ * each nibble is looked up in a 16 entry table with vpshufb and the byte
+ * counts are summed with vpsadbw. Adds the total to `*count` and returns how
+ * many words it did.*/
+static SIMD_AVX2_TARGET size_t popcount_avx2(const uint64_t *a,
+                                             const uint64_t *b, size_t n,
+                                             size_t *count) {
+  const __m256i table =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  uint64_t lanes[4];
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i lo, hi;
+    if (b != NULL)
+      x = _mm256_and_si256(x, _mm256_loadu_si256((const __m256i *)(b + i)));
+    lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble));
+    hi = _mm256_shuffle_epi8(table,
+                             _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+                                                    _mm256_setzero_si256()));
+  }
+  _mm256_storeu_si256((__m256i *)lanes, total);
+  *count += (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+  return i;
+}
+#endif
+
+size_t count_bitset(const Bitset *bitset) {
+  size_t i = 0, count = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = popcount_avx2(bitset->words, NULL, bitset->nwords, &count);
+#endif
+  for (; i < bitset->nwords; i++)
+    count += popcount64(bitset->words[i]);
+  return count;
+}
+
+/*`rank[b]` holds the number of set bits in the words before block `b`.*/
+void build_rank_bitset(Bitset *bitset) {
+  size_t blocks = bitset->nwords / BITSET_RANK_BLOCK + 1;
+  size_t b, i;
+  uint64_t total = 0;
+  free(bitset->rank);
+  bitset->rank = (uint64_t *)malloc(blocks * sizeof(uint64_t));
+  if (bitset->rank == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return;
+  }
+  for (b = 0; b < blocks; b++) {
+    bitset->rank[b] = total;
+    for (i = b * BITSET_RANK_BLOCK;
+         i < (b + 1) * BITSET_RANK_BLOCK && i < bitset->nwords; i++)
+      total += popcount64(bitset->words[i]);
+  }
+}
+
+/*Number of set bits strictly below `index`.*/
+size_t rank_bitset(const Bitset *bitset, size_t index) {
+  size_t word, i, count = 0;
+  if (index > bitset->nbits)
+    index = bitset->nbits;
+  word = index / 64;
+  i = 0;
+  if (bitset->rank != NULL) {
+    count = bitset->rank[word / BITSET_RANK_BLOCK];
+    i = word - word % BITSET_RANK_BLOCK;
+  }
+  for (; i < word; i++)
+    count += popcount64(bitset->words[i]);
+  if (index % 64 != 0)
+    count += popcount64(bitset->words[word] &
+                        ((UINT64_C(1) << (index % 64)) - 1));
+  return count;
+}
+
+/*The four binary operations share one loop shape: a SIMD body over 256 (AVX2)
+ * or 128 (NEON) bits at a time, then a scalar tail.*/
+enum { BITSET_AND, BITSET_OR, BITSET_XOR, BITSET_ANDNOT };
+
+#if SIMD_AVX2
+/*The AVX2 body; returns how many words it did.*/
+static SIMD_AVX2_TARGET size_t binary_op_avx2(Bitset *dst, const Bitset *a,
+                                              const Bitset *b, int op) {
+  size_t i = 0, n = dst->nwords;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a->words + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b->words + i));
+    __m256i r;
+    switch (op) {
+    case BITSET_AND:
+      r = _mm256_and_si256(x, y);
+      break;
+    case BITSET_OR:
+      r = _mm256_or_si256(x, y);
+      break;
+    case BITSET_XOR:
+      r = _mm256_xor_si256(x, y);
+      break;
+    default:
+      r = _mm256_andnot_si256(y, x); /* x & ~y */
+      break;
+    }
+    _mm256_storeu_si256((__m256i *)(dst->words + i), r);
+  }
+  return i;
+}
+#endif
+
+static void binary_op_bitset(Bitset *dst, const Bitset *a, const Bitset *b,
+                             int op) {
+  size_t i = 0, n = dst->nwords;
+  if (a->nwords != n || b->nwords != n) {
+    fprintf(stderr, "ERROR: Bitset sizes differ.\n");
+    return;
+  }
+  if (dst->rank != NULL)
+    drop_rank_bitset(dst);
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = binary_op_avx2(dst, a, b, op);
+#elif defined(__ARM_NEON)
+  for (; i + 2 <= n; i += 2) {
+    uint64x2_t x = vld1q_u64(a->words + i);
+    uint64x2_t y = vld1q_u64(b->words + i);
+    uint64x2_t r;
+    switch (op) {
+    case BITSET_AND:
+      r = vandq_u64(x, y);
+      break;
+    case BITSET_OR:
+      r = vorrq_u64(x, y);
+      break;
+    case BITSET_XOR:
+      r = veorq_u64(x, y);
+      break;
+    default:
+      r = vbicq_u64(x, y); /* x & ~y */
+      break;
+    }
+    vst1q_u64(dst->words + i, r);
+  }
+#endif
+  for (; i < n; i++) {
+    switch (op) {
+    case BITSET_AND:
+      dst->words[i] = a->words[i] & b->words[i];
+      break;
+    case BITSET_OR:
+      dst->words[i] = a->words[i] | b->words[i];
+      break;
+    case BITSET_XOR:
+      dst->words[i] = a->words[i] ^ b->words[i];
+      break;
+    default:
+      dst->words[i] = a->words[i] & ~b->words[i];
+      break;
+    }
+  }
+}
+
+void and_bitset(Bitset *dst, const Bitset *a, const Bitset *b) {
+  binary_op_bitset(dst, a, b, BITSET_AND);
+}
+
+void or_bitset(Bitset *dst, const Bitset *a, const Bitset *b) {
+  binary_op_bitset(dst, a, b, BITSET_OR);
+}
+
+void xor_bitset(Bitset *dst, const Bitset *a, const Bitset *b) {
+  binary_op_bitset(dst, a, b, BITSET_XOR);
+}
+
+void andnot_bitset(Bitset *dst, const Bitset *a, const Bitset *b) {
+  binary_op_bitset(dst, a, b, BITSET_ANDNOT);
+}
+
+/*Size of the intersection without materializing it.*/
+size_t and_count_bitset(const Bitset *a, const Bitset *b) {
+  size_t i = 0, count = 0;
+  size_t n = a->nwords < b->nwords ? a->nwords : b->nwords;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = popcount_avx2(a->words, b->words, n, &count);
+#endif
+  for (; i < n; i++)
+    count += popcount64(a->words[i] & b->words[i]);
+  return count;
+}
+
+Bitset create_bitset_from_vector(Vector *vector) {
+  size_t i;
+  int max = -1;
+  Bitset bitset;
+  for (i = 0; i < vector->size; i++)
+    if (vector->arr[i] > max)
+      max = vector->arr[i];
+  bitset = create_bitset((size_t)max + 1);
+  for (i = 0; i < vector->size; i++) {
+    int value = vector->arr[i];
+    if (value < 0) {
+      fprintf(stderr, "ERROR: Negative value %d skipped.\n", value);
+      continue;
+    }
+    bitset.words[value / 64] |= UINT64_C(1) << (value % 64);
+  }
+  return bitset;
+}
+
+/*Members in ascending order.*/
+Vector to_vector_bitset(const Bitset *bitset) {
+  size_t i, n = 0;
+  Vector vector = create_vector(count_bitset(bitset));
+  for (i = 0; i < bitset->nwords; i++) {
+    uint64_t word = bitset->words[i];
+    while (word != 0) {
+      vector.arr[n++] = (int)(i * 64 + (size_t)__builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+  return vector;
+}
+
+/*ROARING BITMAP*/
+
+static void *alloc_container_data(uint8_t type, uint32_t capacity) {
+  void *data;
+  if (type == ROARING_BITMAP)
+    data = calloc(ROARING_BITMAP_WORDS, sizeof(uint64_t));
+  else if (type == ROARING_RUN)
+    data = malloc((size_t)capacity * 2 * sizeof(uint16_t));
+  else
+    data = malloc((size_t)capacity * sizeof(uint16_t));
+  if (data == NULL)
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+  return data;
+}
+
+/*Index of the first element of `arr[0..n)` that is >= `value`.*/
+static uint32_t lower_bound_u16(const uint16_t *arr, uint32_t n,
+                                uint16_t value) {
+  uint32_t lo = 0, hi = n;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (arr[mid] < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static bool container_contains(const RoaringContainer *c, uint16_t low) {
+  if (c->type == ROARING_BITMAP) {
+    const uint64_t *words = (const uint64_t *)c->data;
+    return (words[low / 64] >> (low % 64)) & 1;
+  }
+  if (c->type == ROARING_ARRAY) {
+    const uint16_t *arr = (const uint16_t *)c->data;
+    uint32_t i = lower_bound_u16(arr, c->count, low);
+    return i < c->count && arr[i] == low;
+  }
+  {
+    const uint16_t *runs = (const uint16_t *)c->data;
+    uint32_t lo = 0, hi = c->count;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (runs[2 * mid] <= low)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo > 0 && low - runs[2 * (lo - 1)] <= runs[2 * (lo - 1) + 1];
+  }
+}
+
+/*Expands any container into a 65536 bit word array.*/
+static void container_to_words(const RoaringContainer *c, uint64_t *words) {
+  uint32_t i, v;
+  if (c->type == ROARING_BITMAP) {
+    memcpy(words, c->data, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    return;
+  }
+  memset(words, 0, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+  if (c->type == ROARING_ARRAY) {
+    const uint16_t *arr = (const uint16_t *)c->data;
+    for (i = 0; i < c->count; i++)
+      words[arr[i] / 64] |= UINT64_C(1) << (arr[i] % 64);
+    return;
+  }
+  for (i = 0; i < c->count; i++) {
+    const uint16_t *runs = (const uint16_t *)c->data;
+    uint32_t start = runs[2 * i], end = start + runs[2 * i + 1];
+    for (v = start; v <= end; v++)
+      words[v / 64] |= UINT64_C(1) << (v % 64);
+  }
+}
+
+/*Builds the smaller of an array or bitmap container from a word array.
+ * Returns false for an empty result.*/
+static bool container_from_words(RoaringContainer *c, uint16_t key,
+                                 const uint64_t *words) {
+  uint32_t i, cardinality = 0;
+  for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+    cardinality += (uint32_t)popcount64(words[i]);
+  if (cardinality == 0)
+    return false;
+  c->key = key;
+  c->cardinality = cardinality;
+  if (cardinality > ROARING_ARRAY_MAX) {
+    c->type = ROARING_BITMAP;
+    c->count = c->capacity = 0;
+    c->data = alloc_container_data(ROARING_BITMAP, 0);
+    memcpy(c->data, words, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+  } else {
+    uint16_t *arr;
+    uint32_t n = 0;
+    c->type = ROARING_ARRAY;
+    c->count = c->capacity = cardinality;
+    arr = (uint16_t *)alloc_container_data(ROARING_ARRAY, cardinality);
+    c->data = arr;
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++) {
+      uint64_t word = words[i];
+      while (word != 0) {
+        arr[n++] = (uint16_t)(i * 64 + (uint32_t)__builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  }
+  return true;
+}
+
+static void container_array_to_bitmap(RoaringContainer *c) {
+  uint64_t *words = (uint64_t *)alloc_container_data(ROARING_BITMAP, 0);
+  container_to_words(c, words);
+  free(c->data);
+  c->data = words;
+  c->type = ROARING_BITMAP;
+  c->count = c->capacity = 0;
+}
+
+static void container_add(RoaringContainer *c, uint16_t low) {
+  if (c->type == ROARING_RUN) {
+    /*runs are read-mostly; fall back to a bitmap and re-optimize later*/
+    if (container_contains(c, low))
+      return;
+    container_array_to_bitmap(c);
+  }
+  if (c->type == ROARING_BITMAP) {
+    uint64_t *words = (uint64_t *)c->data;
+    uint64_t bit = UINT64_C(1) << (low % 64);
+    if (!(words[low / 64] & bit)) {
+      words[low / 64] |= bit;
+      c->cardinality++;
+    }
+    return;
+  }
+  {
+    uint16_t *arr = (uint16_t *)c->data;
+    uint32_t i = lower_bound_u16(arr, c->count, low);
+    if (i < c->count && arr[i] == low)
+      return;
+    if (c->count == ROARING_ARRAY_MAX) {
+      container_array_to_bitmap(c);
+      container_add(c, low);
+      return;
+    }
+    if (c->count == c->capacity) {
+      c->capacity = c->capacity < 8 ? 8 : c->capacity * 2;
+      if (c->capacity > ROARING_ARRAY_MAX)
+        c->capacity = ROARING_ARRAY_MAX;
+      c->data = realloc(c->data, c->capacity * sizeof(uint16_t));
+      arr = (uint16_t *)c->data;
+    }
+    memmove(arr + i + 1, arr + i, (c->count - i) * sizeof(uint16_t));
+    arr[i] = low;
+    c->count++;
+    c->cardinality++;
+  }
+}
+
+/*Index of the container with `key`, or of where it would be inserted.*/
+static size_t find_container(const Roaring *roaring, uint16_t key) {
+  size_t lo = 0, hi = roaring->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (roaring->containers[mid].key < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void push_container(Roaring *roaring, RoaringContainer c) {
+  if (roaring->size == roaring->capacity) {
+    roaring->capacity = roaring->capacity == 0 ? 4 : roaring->capacity * 2;
+    roaring->containers = (RoaringContainer *)realloc(
+        roaring->containers, roaring->capacity * sizeof(RoaringContainer));
+  }
+  roaring->containers[roaring->size++] = c;
+}
+
+Roaring create_roaring(void) {
+  Roaring roaring;
+  roaring.containers = NULL;
+  roaring.size = 0;
+  roaring.capacity = 0;
+  return roaring;
+}
+
+void destroy_roaring(Roaring *roaring) {
+  size_t i;
+  for (i = 0; i < roaring->size; i++)
+    free(roaring->containers[i].data);
+  free(roaring->containers);
+  roaring->containers = NULL;
+  roaring->size = 0;
+  roaring->capacity = 0;
+}
+
+void add_roaring(Roaring *roaring, uint32_t value) {
+  uint16_t key = (uint16_t)(value >> 16);
+  size_t i = find_container(roaring, key);
+  if (i == roaring->size || roaring->containers[i].key != key) {
+    RoaringContainer c;
+    c.key = key;
+    c.type = ROARING_ARRAY;
+    c.cardinality = 0;
+    c.count = 0;
+    c.capacity = 8;
+    c.data = alloc_container_data(ROARING_ARRAY, c.capacity);
+    push_container(roaring, c);
+    memmove(roaring->containers + i + 1, roaring->containers + i,
+            (roaring->size - 1 - i) * sizeof(RoaringContainer));
+    roaring->containers[i] = c;
+  }
+  container_add(&roaring->containers[i], (uint16_t)value);
+}
+
+bool contains_roaring(const Roaring *roaring, uint32_t value) {
+  uint16_t key = (uint16_t)(value >> 16);
+  size_t i = find_container(roaring, key);
+  if (i == roaring->size || roaring->containers[i].key != key)
+    return false;
+  return container_contains(&roaring->containers[i], (uint16_t)value);
+}
+
+size_t count_roaring(const Roaring *roaring) {
+  size_t i, count = 0;
+  for (i = 0; i < roaring->size; i++)
+    count += roaring->containers[i].cardinality;
+  return count;
+}
+
+/*Converts each container to run form when that is its smallest encoding.*/
+void run_optimize_roaring(Roaring *roaring) {
+  uint64_t words[ROARING_BITMAP_WORDS];
+  size_t i;
+  for (i = 0; i < roaring->size; i++) {
+    RoaringContainer *c = &roaring->containers[i];
+    uint32_t runs = 0, n = 0, v;
+    size_t current;
+    uint16_t *pairs;
+    if (c->type == ROARING_RUN)
+      continue;
+    container_to_words(c, words);
+    for (v = 0; v < 65536; v++) {
+      bool set = (words[v / 64] >> (v % 64)) & 1;
+      bool prev = v > 0 && ((words[(v - 1) / 64] >> ((v - 1) % 64)) & 1);
+      if (set && !prev)
+        runs++;
+    }
+    current = c->type == ROARING_BITMAP
+                  ? ROARING_BITMAP_WORDS * sizeof(uint64_t)
+                  : c->cardinality * sizeof(uint16_t);
+    if ((size_t)runs * 2 * sizeof(uint16_t) >= current)
+      continue;
+    pairs = (uint16_t *)alloc_container_data(ROARING_RUN, runs);
+    for (v = 0; v < 65536; v++) {
+      bool set = (words[v / 64] >> (v % 64)) & 1;
+      bool prev = v > 0 && ((words[(v - 1) / 64] >> ((v - 1) % 64)) & 1);
+      if (set && !prev) {
+        pairs[2 * n] = (uint16_t)v;
+        pairs[2 * n + 1] = 0;
+        n++;
+      } else if (set) {
+        pairs[2 * (n - 1) + 1]++;
+      }
+    }
+    free(c->data);
+    c->data = pairs;
+    c->type = ROARING_RUN;
+    c->count = c->capacity = runs;
+  }
+}
+
+size_t size_in_bytes_roaring(const Roaring *roaring) {
+  size_t i, bytes = sizeof(Roaring) + roaring->size * sizeof(RoaringContainer);
+  for (i = 0; i < roaring->size; i++) {
+    const RoaringContainer *c = &roaring->containers[i];
+    if (c->type == ROARING_BITMAP)
+      bytes += ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    else if (c->type == ROARING_RUN)
+      bytes += c->capacity * 2 * sizeof(uint16_t);
+    else
+      bytes += c->capacity * sizeof(uint16_t);
+  }
+  return bytes;
+}
+
+/*Intersection of two containers with equal keys. Array/array uses a merge,
+ * array/other probes the other side, everything else goes through words.*/
+static bool container_and(const RoaringContainer *a, const RoaringContainer *b,
+                          RoaringContainer *out) {
+  uint64_t wa[ROARING_BITMAP_WORDS], wb[ROARING_BITMAP_WORDS];
+  uint32_t i, j, n = 0;
+  if (a->type != ROARING_ARRAY && b->type == ROARING_ARRAY) {
+    const RoaringContainer *t = a;
+    a = b;
+    b = t;
+  }
+  if (a->type == ROARING_ARRAY) {
+    const uint16_t *x = (const uint16_t *)a->data;
+    uint16_t *arr = (uint16_t *)alloc_container_data(ROARING_ARRAY, a->count);
+    if (b->type == ROARING_ARRAY) {
+      const uint16_t *y = (const uint16_t *)b->data;
+      for (i = 0, j = 0; i < a->count && j < b->count;) {
+        if (x[i] < y[j])
+          i++;
+        else if (x[i] > y[j])
+          j++;
+        else {
+          arr[n++] = x[i];
+          i++;
+          j++;
+        }
+      }
+    } else {
+      for (i = 0; i < a->count; i++)
+        if (container_contains(b, x[i]))
+          arr[n++] = x[i];
+    }
+    if (n == 0) {
+      free(arr);
+      return false;
+    }
+    out->key = a->key;
+    out->type = ROARING_ARRAY;
+    out->cardinality = out->count = out->capacity = n;
+    out->data = arr;
+    return true;
+  }
+  container_to_words(a, wa);
+  container_to_words(b, wb);
+  for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+    wa[i] &= wb[i];
+  return container_from_words(out, a->key, wa);
+}
+
+Roaring and_roaring(const Roaring *a, const Roaring *b) {
+  Roaring result = create_roaring();
+  size_t i = 0, j = 0;
+  while (i < a->size && j < b->size) {
+    uint16_t ka = a->containers[i].key, kb = b->containers[j].key;
+    if (ka < kb)
+      i++;
+    else if (ka > kb)
+      j++;
+    else {
+      RoaringContainer c;
+      if (container_and(&a->containers[i], &b->containers[j], &c))
+        push_container(&result, c);
+      i++;
+      j++;
+    }
+  }
+  return result;
+}
+
+/*Copies the used part of `c`. Returns false if memory runs out.*/
+static bool copy_container(const RoaringContainer *c, RoaringContainer *out) {
+  size_t bytes;
+  *out = *c;
+  if (c->type == ROARING_BITMAP)
+    bytes = ROARING_BITMAP_WORDS * sizeof(uint64_t);
+  else if (c->type == ROARING_RUN)
+    bytes = c->count * 2 * sizeof(uint16_t);
+  else
+    bytes = c->count * sizeof(uint16_t);
+  out->data = alloc_container_data(c->type, c->capacity);
+  if (out->data == NULL)
+    return false;
+  memcpy(out->data, c->data, bytes);
+  return true;
+}
+
+Roaring or_roaring(const Roaring *a, const Roaring *b) {
+  uint64_t wa[ROARING_BITMAP_WORDS], wb[ROARING_BITMAP_WORDS];
+  Roaring result = create_roaring();
+  size_t i = 0, j = 0, k;
+  while (i < a->size || j < b->size) {
+    RoaringContainer c;
+    bool copied = true;
+    if (j == b->size ||
+        (i < a->size && a->containers[i].key < b->containers[j].key)) {
+      copied = copy_container(&a->containers[i++], &c);
+    } else if (i == a->size || b->containers[j].key < a->containers[i].key) {
+      copied = copy_container(&b->containers[j++], &c);
+    } else {
+      container_to_words(&a->containers[i++], wa);
+      container_to_words(&b->containers[j++], wb);
+      for (k = 0; k < ROARING_BITMAP_WORDS; k++)
+        wa[k] |= wb[k];
+      container_from_words(&c, a->containers[i - 1].key, wa);
+    }
+    if (!copied) {
+      destroy_roaring(&result);
+      return result;
+    }
+    push_container(&result, c);
+  }
+  return result;
+}
+
+Roaring create_roaring_from_vector(Vector *vector) {
+  Roaring roaring = create_roaring();
+  size_t i;
+  for (i = 0; i < vector->size; i++) {
+    if (vector->arr[i] < 0) {
+      fprintf(stderr, "ERROR: Negative value %d skipped.\n", vector->arr[i]);
+      continue;
+    }
+    add_roaring(&roaring, (uint32_t)vector->arr[i]);
+  }
+  return roaring;
+}
+
+/*Members in ascending order.*/
+Vector to_vector_roaring(const Roaring *roaring) {
+  uint64_t words[ROARING_BITMAP_WORDS];
+  size_t i, n = 0;
+  uint32_t w;
+  Vector vector = create_vector(count_roaring(roaring));
+  for (i = 0; i < roaring->size; i++) {
+    const RoaringContainer *c = &roaring->containers[i];
+    int high = (int)((uint32_t)c->key << 16);
+    if (c->type == ROARING_ARRAY) {
+      const uint16_t *arr = (const uint16_t *)c->data;
+      for (w = 0; w < c->count; w++)
+        vector.arr[n++] = high | arr[w];
+      continue;
+    }
+    container_to_words(c, words);
+    for (w = 0; w < ROARING_BITMAP_WORDS; w++) {
+      uint64_t word = words[w];
+      while (word != 0) {
+        vector.arr[n++] =
+            high | (int)(w * 64 + (uint32_t)__builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  }
+  return vector;
+}
@@ -0,0 +1,96 @@
+#ifndef __BITSET_H__
+#define __BITSET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h> /*Includes `uint64_t` for the bit words.*/
+
+#include "utils.h"
+
+/*BITSET*/
+
+/*A dense bitset for sets of small non-negative ints. Bit `i` is set when `i`
+ * is a member. `rank` is an optional directory of cumulative popcounts (one
+ * entry per `BITSET_RANK_BLOCK` words) that makes `rank_bitset` O(1); it is
+ * dropped by every modification and rebuilt by `build_rank_bitset`.*/
+#define BITSET_RANK_BLOCK 8
+
+typedef struct {
+  uint64_t *words;
+  size_t nbits;  /*number of addressable bits*/
+  size_t nwords; /*number of 64 bit words*/
+  uint64_t *rank;
+} Bitset;
+
+Bitset create_bitset(size_t nbits);
+void destroy_bitset(Bitset *bitset);
+void set_bit_bitset(Bitset *bitset, size_t index);
+void clear_bit_bitset(Bitset *bitset, size_t index);
+bool test_bit_bitset(const Bitset *bitset, size_t index);
+size_t count_bitset(const Bitset *bitset);
+void build_rank_bitset(Bitset *bitset);
+size_t rank_bitset(const Bitset *bitset, size_t index);
+
+/*`dst` may alias `a` or `b`. All three must have the same `nbits`.*/
+void and_bitset(Bitset *dst, const Bitset *a, const Bitset *b);
+void or_bitset(Bitset *dst, const Bitset *a, const Bitset *b);
+void xor_bitset(Bitset *dst, const Bitset *a, const Bitset *b);
+void andnot_bitset(Bitset *dst, const Bitset *a, const Bitset *b);
+size_t and_count_bitset(const Bitset *a, const Bitset *b);
+
+/*Negative values in the vector are reported and skipped.*/
+Bitset create_bitset_from_vector(Vector *vector);
+Vector to_vector_bitset(const Bitset *bitset);
+
+/*ROARING BITMAP*/
+
+/*A compressed bitmap for sparse values over a large range, in the style of
+ * Roaring. Values are split on their high 16 bits into containers kept sorted
+ * by `key`. A container stores its low 16 bits as:
+ *  - ROARING_ARRAY:  sorted `uint16_t` values, up to ROARING_ARRAY_MAX of them
+ *  - ROARING_BITMAP: 1024 `uint64_t` words (65536 bits)
+ *  - ROARING_RUN:    sorted (start, length - 1) `uint16_t` pairs
+ * Run containers are only produced by `run_optimize_roaring`.*/
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_BITMAP_WORDS 1024
+
+enum { ROARING_ARRAY, ROARING_BITMAP, ROARING_RUN };
+
+typedef struct {
+  uint16_t key;
+  uint8_t type;
+  uint32_t cardinality;
+  uint32_t count;    /*used array values or run pairs*/
+  uint32_t capacity; /*allocated array values or run pairs*/
+  void *data;
+} RoaringContainer;
+
+typedef struct {
+  RoaringContainer *containers;
+  size_t size;
+  size_t capacity;
+} Roaring;
+
+Roaring create_roaring(void);
+void destroy_roaring(Roaring *roaring);
+void add_roaring(Roaring *roaring, uint32_t value);
+bool contains_roaring(const Roaring *roaring, uint32_t value);
+size_t count_roaring(const Roaring *roaring);
+void run_optimize_roaring(Roaring *roaring);
+size_t size_in_bytes_roaring(const Roaring *roaring);
+Roaring and_roaring(const Roaring *a, const Roaring *b);
+Roaring or_roaring(const Roaring *a, const Roaring *b);
+
+/*Negative values in the vector are reported and skipped.*/
+Roaring create_roaring_from_vector(Vector *vector);
+Vector to_vector_roaring(const Roaring *roaring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BITSET_H__
@@ -0,0 +1,95 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "convec.h"
+
+/*CONCURRENT VECTOR*/
+
+void create_concurrent_vector(ConcurrentVector *vector) {
+  memset(vector, 0, sizeof *vector);
+}
+
+void destroy_concurrent_vector(ConcurrentVector *vector) {
+  size_t k;
+  for (k = 0; k < CONCURRENT_VECTOR_SEGMENTS; k++)
+    free(vector->segments[k]);
+  memset(vector, 0, sizeof *vector);
+}
+
+/*Segment `segment`, allocated by whichever thread gets here first; NULL if
+ * it is past the directory or memory runs out.*/
+static int *load_segment(ConcurrentVector *vector, size_t segment) {
+  int *data, *expected = NULL;
+  if (segment >= CONCURRENT_VECTOR_SEGMENTS)
+    return NULL;
+  data = __atomic_load_n(&vector->segments[segment], __ATOMIC_ACQUIRE);
+  if (data != NULL)
+    return data;
+  /*calloc gets large segments as fresh zero pages, touched on first use*/
+  data = (int *)calloc(CONCURRENT_VECTOR_FIRST << segment, sizeof(int));
+  if (data == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return NULL;
+  }
+  if (!__atomic_compare_exchange_n(&vector->segments[segment], &expected,
+                                   data, false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    free(data); /*another thread published it first*/
+    data = expected;
+  }
+  return data;
+}
+
+size_t push_back_concurrent_vector(ConcurrentVector *vector, int value) {
+  size_t index = __atomic_fetch_add(&vector->size, 1, __ATOMIC_RELAXED);
+  size_t offset, segment = locate_concurrent_vector(index, &offset);
+  int *data = load_segment(vector, segment);
+  if (data == NULL)
+    return CONCURRENT_VECTOR_FULL;
+  data[offset] = value;
+  return index;
+}
+
+size_t append_concurrent_vector(ConcurrentVector *vector, const int *values,
+                                size_t count) {
+  size_t first = __atomic_fetch_add(&vector->size, count, __ATOMIC_RELAXED);
+  size_t done = 0;
+  while (done < count) {
+    size_t offset, segment = locate_concurrent_vector(first + done, &offset);
+    size_t n = (CONCURRENT_VECTOR_FIRST << segment) - offset;
+    int *data = load_segment(vector, segment);
+    if (data == NULL)
+      return CONCURRENT_VECTOR_FULL;
+    if (n > count - done)
+      n = count - done;
+    memcpy(data + offset, values + done, n * sizeof(int));
+    done += n;
+  }
+  return first;
+}
+
+int reserve_concurrent_vector(ConcurrentVector *vector, size_t capacity) {
+  size_t offset, last, k;
+  if (capacity == 0)
+    return 0;
+  last = locate_concurrent_vector(capacity - 1, &offset);
+  for (k = 0; k <= last; k++)
+    if (load_segment(vector, k) == NULL)
+      return -1;
+  return 0;
+}
+
+VectorSpan get_segment_concurrent_vector(ConcurrentVector *vector,
+                                         size_t segment) {
+  VectorSpan span = {NULL, 0};
+  size_t size = get_size_concurrent_vector(vector), begin;
+  if (segment >= CONCURRENT_VECTOR_SEGMENTS)
+    return span;
+  begin = CONCURRENT_VECTOR_FIRST * (((size_t)1 << segment) - 1);
+  span.data = __atomic_load_n(&vector->segments[segment], __ATOMIC_ACQUIRE);
+  if (span.data == NULL || size <= begin)
+    return span;
+  span.size = size - begin;
+  if (span.size > CONCURRENT_VECTOR_FIRST << segment)
+    span.size = CONCURRENT_VECTOR_FIRST << segment;
+  return span;
+}
@@ -0,0 +1,111 @@
+#ifndef __CONVEC_H__
+#define __CONVEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*CONCURRENT VECTOR*/
+
+/*A Vector that many threads append to without a lock. Elements live in a
+ * fixed directory of segments: segment k holds CONCURRENT_VECTOR_FIRST << k
+ * elements, so a handful of segments reach any size and an index maps to its
+ * segment with one count-leading-zeros. A push claims its slot with one
+ * atomic fetch-add; the thread that first needs a segment allocates it and
+ * publishes it with a compare-and-swap (a thread losing the race frees its
+ * copy). Segments are never moved or freed before the vector, so element
+ * pointers stay valid while it grows, and reads take no lock.
+ *
+ * A slot belongs to the thread that claimed it until that push returns:
+ * `get_size_concurrent_vector` counts claimed slots, and other threads may
+ * read an element once they have synchronized with its push (joined the
+ * thread, or seen a flag it released afterwards). Unwritten slots read 0;
+ * the slot of a push that failed stays claimed and must not be read.
+ *
+ * Usage:
+ *   ConcurrentVector ids;
+ *   create_concurrent_vector(&ids);
+ *   ... on any thread: push_back_concurrent_vector(&ids, id);
+ *   ... after joining:
+ *   for (k = 0; k < CONCURRENT_VECTOR_SEGMENTS; k++) {
+ *     VectorSpan span = get_segment_concurrent_vector(&ids, k);
+ *     for (i = 0; i < span.size; i++)
+ *       sum += span.data[i];
+ *   }
+ *   destroy_concurrent_vector(&ids);*/
+#define CONCURRENT_VECTOR_FIRST_BITS 10
+#define CONCURRENT_VECTOR_FIRST ((size_t)1 << CONCURRENT_VECTOR_FIRST_BITS)
+#define CONCURRENT_VECTOR_SEGMENTS 40
+#define CONCURRENT_VECTOR_FULL SIZE_MAX /*returned when a push fails*/
+
+/*`segments` is read by every access, `size` written by every push: they
+ * sit on separate cache lines.*/
+typedef struct {
+  int *segments[CONCURRENT_VECTOR_SEGMENTS]; /*NULL until first used*/
+  size_t size __attribute__((aligned(64)));  /*claimed slots*/
+  char padding[64 - sizeof(size_t)];
+} ConcurrentVector;
+
+void create_concurrent_vector(ConcurrentVector *vector);
+/*Must not race with any other call on `vector`.*/
+void destroy_concurrent_vector(ConcurrentVector *vector);
+
+/*Appends `value` and returns its index, or CONCURRENT_VECTOR_FULL if its
+ * segment cannot be allocated.*/
+size_t push_back_concurrent_vector(ConcurrentVector *vector, int value);
+/*Appends `count` values at consecutive indices with one fetch-add and
+ * returns the first index, or CONCURRENT_VECTOR_FULL.*/
+size_t append_concurrent_vector(ConcurrentVector *vector, const int *values,
+                                size_t count);
+/*Allocates the segments for the first `capacity` elements up front, so
+ * pushes below it never allocate. Returns -1 if memory runs out.*/
+int reserve_concurrent_vector(ConcurrentVector *vector, size_t capacity);
+
+static inline size_t get_size_concurrent_vector(ConcurrentVector *vector) {
+  return __atomic_load_n(&vector->size, __ATOMIC_ACQUIRE);
+}
+
+/*The segment holding `index` and the offset within it.*/
+static inline size_t locate_concurrent_vector(size_t index, size_t *offset) {
+  size_t shifted = index + CONCURRENT_VECTOR_FIRST;
+  size_t segment = (size_t)(63 - __builtin_clzll(shifted)) -
+                   CONCURRENT_VECTOR_FIRST_BITS;
+  *offset = shifted - (CONCURRENT_VECTOR_FIRST << segment);
+  return segment;
+}
+
+/*A pointer to element `index`, stable until the vector is destroyed.*/
+static inline int *get_pointer_concurrent_vector(ConcurrentVector *vector,
+                                                 size_t index) {
+  size_t offset, segment;
+  CHECK_RANGE_VECTOR(index, get_size_concurrent_vector(vector));
+  segment = locate_concurrent_vector(index, &offset);
+  return __atomic_load_n(&vector->segments[segment], __ATOMIC_ACQUIRE) +
+         offset;
+}
+
+static inline int get_index_concurrent_vector(ConcurrentVector *vector,
+                                              size_t index) {
+  return *get_pointer_concurrent_vector(vector, index);
+}
+
+static inline void set_index_concurrent_vector(ConcurrentVector *vector,
+                                               size_t index, int value) {
+  *get_pointer_concurrent_vector(vector, index) = value;
+}
+
+/*The claimed elements of segment `segment` (empty past the end), for
+ * running the Vector kernels segment by segment.*/
+VectorSpan get_segment_concurrent_vector(ConcurrentVector *vector,
+                                         size_t segment);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CONVEC_H__
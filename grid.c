@@ -0,0 +1,131 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "grid.h"
+
+/*GRID*/
+
+const int grid_neighbor_dr[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+const int grid_neighbor_dc[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+Grid create_grid(size_t rows, size_t cols, int layout) {
+  Grid grid;
+  size_t padded_rows = rows + 2, padded_cols = cols + 2;
+  int k;
+  (void)layout; /*GRID_ROW_MAJOR is the only layout*/
+  grid.rows = rows;
+  grid.cols = cols;
+  grid.layout = GRID_ROW_MAJOR;
+  grid.stride = padded_cols;
+  grid.capacity = padded_rows * padded_cols;
+  for (k = 0; k < 8; k++)
+    grid.neighbor_offsets[k] =
+        grid_neighbor_dr[k] * (ptrdiff_t)grid.stride + grid_neighbor_dc[k];
+  grid.cells = (int *)calloc(grid.capacity, sizeof(int));
+  if (grid.cells == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+  }
+  return grid;
+}
+
+void destroy_grid(Grid *grid) {
+  free(grid->cells);
+  grid->cells = NULL;
+  grid->rows = 0;
+  grid->cols = 0;
+  grid->capacity = 0;
+}
+
+/*Storage index of (row, col). Both may be -1 or one past the end to reach the
+ * halo.*/
+size_t index_grid(const Grid *grid, long row, long col) {
+  return (size_t)(row + 1) * grid->stride + (size_t)(col + 1);
+}
+
+int get_grid(const Grid *grid, long row, long col) {
+  return grid->cells[index_grid(grid, row, col)];
+}
+
+void set_grid(Grid *grid, long row, long col, int value) {
+  grid->cells[index_grid(grid, row, col)] = value;
+}
+
+void fill_grid(Grid *grid, int value) {
+  long r, c;
+  for (r = 0; r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++)
+      grid->cells[index_grid(grid, r, c)] = value;
+}
+
+void fill_halo_grid(Grid *grid, int value) {
+  long r, c, rows = (long)grid->rows, cols = (long)grid->cols;
+  for (c = -1; c <= cols; c++) {
+    grid->cells[index_grid(grid, -1, c)] = value;
+    grid->cells[index_grid(grid, rows, c)] = value;
+  }
+  for (r = 0; r < rows; r++) {
+    grid->cells[index_grid(grid, r, -1)] = value;
+    grid->cells[index_grid(grid, r, cols)] = value;
+  }
+}
+
+void load_vector_grid(Grid *grid, Vector *vector) {
+  long r, c;
+  size_t i = 0;
+  if (vector->size != grid->rows * grid->cols) {
+    fprintf(stderr, "ERROR: Vector size does not match grid size.\n");
+    return;
+  }
+  for (r = 0; r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++)
+      grid->cells[index_grid(grid, r, c)] = vector->arr[i++];
+}
+
+Vector to_vector_grid(const Grid *grid) {
+  long r, c;
+  size_t i = 0;
+  Vector vector = create_vector(grid->rows * grid->cols);
+  for (r = 0; r < (long)grid->rows; r++)
+    for (c = 0; c < (long)grid->cols; c++)
+      vector.arr[i++] = grid->cells[index_grid(grid, r, c)];
+  return vector;
+}
+
+/*Positioned just before the first cell; call `next_grid` to enter it.*/
+GridIterator begin_grid(const Grid *grid) {
+  GridIterator it;
+  it.grid = grid;
+  it.row = 0;
+  it.col = -1;
+  it.index = index_grid(grid, 0, -1);
+  return it;
+}
+
+bool next_grid(GridIterator *it) {
+  const Grid *grid = it->grid;
+  if (grid->rows == 0 || grid->cols == 0)
+    return false;
+  if (++it->col == (long)grid->cols) {
+    it->col = 0;
+    if (++it->row == (long)grid->rows)
+      return false;
+  }
+  it->index = (size_t)(it->row + 1) * grid->stride + (size_t)(it->col + 1);
+  return true;
+}
+
+/*Storage index of neighbor `k` (0..7, see `grid_neighbor_dr`), from the
+ * precomputed offsets.*/
+size_t neighbor_index_grid(const GridIterator *it, int k) {
+  return (size_t)((ptrdiff_t)it->index + it->grid->neighbor_offsets[k]);
+}
+
+int neighbor_grid(const GridIterator *it, int k) {
+  return it->grid->cells[neighbor_index_grid(it, k)];
+}
+
+int sum_neighbors_grid(const GridIterator *it) {
+  const int *center = it->grid->cells + it->index;
+  const ptrdiff_t *off = it->grid->neighbor_offsets;
+  return center[off[0]] + center[off[1]] + center[off[2]] + center[off[3]] +
+         center[off[4]] + center[off[5]] + center[off[6]] + center[off[7]];
+}
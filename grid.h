@@ -0,0 +1,71 @@
+#ifndef __GRID_H__
+#define __GRID_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h> /*Includes `ptrdiff_t` for the neighbor offsets.*/
+#include <stdint.h>
+
+#include "utils.h"
+
+/*GRID*/
+
+/*A contiguous 2-D grid of ints with a one cell halo around it, so every cell
+ * in `[0, rows) x [0, cols)` has all 8 neighbors from
+ * `print_matrix_neighbor_coordinates_rules()` in bounds. Halo cells are
+ * addressed as row/col -1 and rows/cols and are set with `fill_halo_grid`.
+ *
+ * The only layout is GRID_ROW_MAJOR: padded rows of `stride` cells, with the
+ * 8 neighbors at the constant `neighbor_offsets`. Tiled and Morton layouts
+ * were dropped because `bench_grid` ran them well below row-major for the
+ * 8-neighbor stencil; `layout` is kept so they can come back behind it.*/
+enum { GRID_ROW_MAJOR };
+
+typedef struct {
+  int *cells;
+  size_t rows, cols; /*user size, without the halo*/
+  size_t stride;     /*padded row length*/
+  size_t capacity;   /*allocated cells*/
+  int layout;
+  ptrdiff_t neighbor_offsets[8];
+} Grid;
+
+/*The 8 neighbor deltas in the same order as the printed rules, row by row,
+ * skipping the center.*/
+extern const int grid_neighbor_dr[8];
+extern const int grid_neighbor_dc[8];
+
+Grid create_grid(size_t rows, size_t cols, int layout);
+void destroy_grid(Grid *grid);
+size_t index_grid(const Grid *grid, long row, long col);
+int get_grid(const Grid *grid, long row, long col);
+void set_grid(Grid *grid, long row, long col, int value);
+void fill_grid(Grid *grid, int value);
+void fill_halo_grid(Grid *grid, int value);
+
+/*Row-major import and export of the `rows * cols` user cells.*/
+void load_vector_grid(Grid *grid, Vector *vector);
+Vector to_vector_grid(const Grid *grid);
+
+/*Walks the user cells in row-major order. `index` is the storage index of
+ * the current cell, so `grid->cells[index]` is the cell itself.*/
+typedef struct {
+  const Grid *grid;
+  long row, col;
+  size_t index;
+} GridIterator;
+
+GridIterator begin_grid(const Grid *grid);
+bool next_grid(GridIterator *it);
+size_t neighbor_index_grid(const GridIterator *it, int k);
+int neighbor_grid(const GridIterator *it, int k);
+int sum_neighbors_grid(const GridIterator *it);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GRID_H__
@@ -0,0 +1,420 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "label.h"
+
+#include <limits.h>    /*Includes `INT_MAX`, the largest label.*/
+#include <stdatomic.h> /*Includes `atomic_int` for the failure flag.*/
+#include <unistd.h>    /*Includes `sysconf` for the online CPU count.*/
+
+/*LABELING*/
+
+/*Cells and bounding box of one provisional label. Coordinates fit an int,
+ * since the whole grid does.*/
+typedef struct {
+  size_t cells;
+  int value;
+  int top, left, bottom, right;
+} LabelStats;
+
+/*The provisional labels of one row block, 1..count. A label's parent is never
+ * larger than the label, so the first label of a component is its root.*/
+typedef struct {
+  int *parent;
+  LabelStats *stats;
+  size_t count, capacity;
+  size_t offset; /*global number of local label 0*/
+} LabelBlock;
+
+typedef struct {
+  const int *cells;
+  int *labels;
+  size_t rows, cols, stride;
+  size_t block_rows, blocks;
+  int background;
+  LabelBlock *blocks_of;
+  const int *table; /*global provisional label to final label*/
+  atomic_int failed;
+} LabelRun;
+
+LabelOptions default_label_options(void) {
+  LabelOptions options;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  options.threads = cpus > 0 ? (int)cpus : 1;
+  options.pool = NULL;
+  options.block_rows = LABEL_BLOCK_ROWS;
+  options.background = 0;
+  return options;
+}
+
+/*Storage offset of column 0 of user row `row`.*/
+static size_t label_row(size_t stride, size_t row) {
+  return (row + 1) * stride + 1;
+}
+
+/*The root of `label`, halving the path on the way.*/
+static int find_label(int *parent, int label) {
+  while (parent[label] != label) {
+    parent[label] = parent[parent[label]];
+    label = parent[label];
+  }
+  return label;
+}
+
+/*Joins the trees of `a` and `b` under the smaller root and returns it.*/
+static int merge_labels(int *parent, int a, int b) {
+  a = find_label(parent, a);
+  b = find_label(parent, b);
+  if (a < b) {
+    parent[b] = a;
+    return a;
+  }
+  parent[a] = b;
+  return b;
+}
+
+/*A new label for a component starting at (row, col), 0 if out of memory.*/
+static int new_label(LabelBlock *block, int value, size_t row, size_t col) {
+  LabelStats *stats;
+  if (block->count + 1 >= block->capacity) {
+    size_t capacity = block->capacity * 2;
+    int *parent = (int *)realloc(block->parent, capacity * sizeof(int));
+    if (parent != NULL)
+      block->parent = parent;
+    stats = (LabelStats *)realloc(block->stats, capacity * sizeof(LabelStats));
+    if (stats != NULL)
+      block->stats = stats;
+    if (parent == NULL || stats == NULL)
+      return 0;
+    block->capacity = capacity;
+  }
+  block->count++;
+  block->parent[block->count] = (int)block->count;
+  stats = &block->stats[block->count];
+  stats->cells = 0;
+  stats->value = value;
+  stats->top = (int)row;
+  stats->left = (int)col;
+  stats->bottom = (int)row;
+  stats->right = (int)col;
+  return (int)block->count;
+}
+
+/*First pass over rows [lo, hi). A cell takes the label of a matching
+ * neighbor above or to the left, which are already labeled. If the cell
+ * above matches, every other matching neighbor touches it and already shares
+ * its label; otherwise the upper right neighbor may belong to a different
+ * label than the left ones, and the two are merged.*/
+static void label_block(LabelRun *run, LabelBlock *block, size_t lo,
+                        size_t hi) {
+  size_t stride = run->stride, cols = run->cols, r, c;
+  int background = run->background;
+  for (r = lo; r < hi; r++) {
+    const int *in = run->cells + label_row(stride, r), *up = in - stride;
+    int *out = run->labels + label_row(stride, r);
+    const int *out_up = out - stride;
+    bool above = r > lo;
+    for (c = 0; c < cols; c++) {
+      int v = in[c], label;
+      LabelStats *stats;
+      if (v == background) {
+        out[c] = 0;
+        continue;
+      }
+      if (above && up[c] == v) {
+        label = out_up[c];
+      } else if (above && c + 1 < cols && up[c + 1] == v) {
+        label = out_up[c + 1];
+        if (c > 0 && in[c - 1] == v)
+          label = merge_labels(block->parent, label, out[c - 1]);
+        else if (c > 0 && up[c - 1] == v)
+          label = merge_labels(block->parent, label, out_up[c - 1]);
+      } else if (above && c > 0 && up[c - 1] == v) {
+        label = out_up[c - 1];
+      } else if (c > 0 && in[c - 1] == v) {
+        label = out[c - 1];
+      } else if ((label = new_label(block, v, r, c)) == 0) {
+        atomic_store(&run->failed, 1);
+        return;
+      }
+      out[c] = label;
+      stats = &block->stats[label];
+      stats->cells++;
+      stats->bottom = (int)r;
+      if ((int)c < stats->left)
+        stats->left = (int)c;
+      if ((int)c > stats->right)
+        stats->right = (int)c;
+    }
+  }
+}
+
+static void label_blocks(size_t begin, size_t end, void *ctx) {
+  LabelRun *run = (LabelRun *)ctx;
+  size_t b;
+  for (b = begin; b < end && !atomic_load(&run->failed); b++) {
+    size_t lo = b * run->block_rows, hi = lo + run->block_rows;
+    label_block(run, &run->blocks_of[b], lo, hi < run->rows ? hi : run->rows);
+  }
+}
+
+/*Unions the first row of block `b` with the last row of the block above it,
+ * in the global table.*/
+static void merge_seam(LabelRun *run, int *table, size_t b) {
+  size_t stride = run->stride, cols = run->cols, r = b * run->block_rows, c;
+  const int *in = run->cells + label_row(stride, r), *up = in - stride;
+  const int *out = run->labels + label_row(stride, r), *out_up = out - stride;
+  int here = (int)run->blocks_of[b].offset;
+  int above = (int)run->blocks_of[b - 1].offset;
+  for (c = 0; c < cols; c++) {
+    int v = in[c];
+    if (v == run->background)
+      continue;
+    if (up[c] == v) {
+      merge_labels(table, here + out[c], above + out_up[c]);
+      continue;
+    }
+    if (c > 0 && up[c - 1] == v)
+      merge_labels(table, here + out[c], above + out_up[c - 1]);
+    if (c + 1 < cols && up[c + 1] == v)
+      merge_labels(table, here + out[c], above + out_up[c + 1]);
+  }
+}
+
+/*Second pass: provisional labels to final ones.*/
+static void relabel_blocks(size_t begin, size_t end, void *ctx) {
+  LabelRun *run = (LabelRun *)ctx;
+  size_t b, r, c;
+  for (b = begin; b < end; b++) {
+    const int *table = run->table + run->blocks_of[b].offset;
+    size_t lo = b * run->block_rows, hi = lo + run->block_rows;
+    if (hi > run->rows)
+      hi = run->rows;
+    for (r = lo; r < hi; r++) {
+      int *out = run->labels + label_row(run->stride, r);
+      for (c = 0; c < run->cols; c++)
+        out[c] = out[c] != 0 ? table[out[c]] : 0;
+    }
+  }
+}
+
+/*Numbers the roots of the table in order and sums the statistics of every
+ * provisional label into its component. Returns the component count, or
+ * SIZE_MAX if memory runs out.*/
+static size_t resolve_labels(LabelRun *run, int *table, size_t total,
+                             GridComponent **components) {
+  size_t count = 0, g, b, l;
+  /*parents come before their children, so a non-root's parent is already
+   * renumbered when the scan reaches it*/
+  for (g = 1; g <= total; g++)
+    table[g] = table[g] == (int)g ? (int)++count : table[table[g]];
+  *components = (GridComponent *)calloc(count > 0 ? count : 1,
+                                        sizeof(GridComponent));
+  if (*components == NULL)
+    return SIZE_MAX;
+  for (b = 0; b < run->blocks; b++) {
+    LabelBlock *block = &run->blocks_of[b];
+    for (l = 1; l <= block->count; l++) {
+      const LabelStats *stats = &block->stats[l];
+      GridComponent *component = &(*components)[table[block->offset + l] - 1];
+      if (component->cells == 0) {
+        component->value = stats->value;
+        component->top = stats->top;
+        component->left = stats->left;
+        component->bottom = stats->bottom;
+        component->right = stats->right;
+      }
+      component->cells += stats->cells;
+      if (stats->top < component->top)
+        component->top = stats->top;
+      if (stats->left < component->left)
+        component->left = stats->left;
+      if (stats->bottom > component->bottom)
+        component->bottom = stats->bottom;
+      if (stats->right > component->right)
+        component->right = stats->right;
+    }
+  }
+  return count;
+}
+
+int label_grid(const Grid *grid, GridLabels *labels,
+               const LabelOptions *options) {
+  LabelOptions defaults = default_label_options();
+  LabelRun run;
+  ThreadPool *own = NULL;
+  int *table = NULL;
+  size_t total = 0, b;
+  int status = 0;
+  memset(labels, 0, sizeof *labels);
+  if (grid->layout != GRID_ROW_MAJOR) {
+    fprintf(stderr, "ERROR: Labeling needs a GRID_ROW_MAJOR grid.\n");
+    return -1;
+  }
+  if (grid->capacity >= INT_MAX) {
+    fprintf(stderr, "ERROR: Grid too large to label.\n");
+    return -1;
+  }
+  if (options == NULL)
+    options = &defaults;
+  labels->labels = create_grid(grid->rows, grid->cols, GRID_ROW_MAJOR);
+  if (labels->labels.cells == NULL)
+    return -1;
+  if (grid->rows == 0 || grid->cols == 0)
+    return 0;
+
+  run.cells = grid->cells;
+  run.labels = labels->labels.cells;
+  run.rows = grid->rows;
+  run.cols = grid->cols;
+  run.stride = grid->stride;
+  run.block_rows =
+      options->block_rows > 0 ? options->block_rows : LABEL_BLOCK_ROWS;
+  run.blocks = (run.rows + run.block_rows - 1) / run.block_rows;
+  run.background = options->background;
+  run.table = NULL;
+  atomic_init(&run.failed, 0);
+  run.blocks_of = (LabelBlock *)calloc(run.blocks, sizeof(LabelBlock));
+  if (run.blocks_of == NULL)
+    atomic_store(&run.failed, 1);
+  for (b = 0; b < run.blocks && !atomic_load(&run.failed); b++) {
+    LabelBlock *block = &run.blocks_of[b];
+    block->capacity = 1024;
+    block->parent = (int *)malloc(block->capacity * sizeof(int));
+    block->stats = (LabelStats *)malloc(block->capacity * sizeof(LabelStats));
+    if (block->parent == NULL || block->stats == NULL)
+      atomic_store(&run.failed, 1);
+  }
+
+  if (!atomic_load(&run.failed)) {
+    ThreadPool *pool = options->pool;
+    if (pool == NULL && options->threads > 1 && run.blocks > 1) {
+      pool = default_thread_pool();
+      if (pool == NULL || get_threads_thread_pool(pool) != options->threads)
+        pool = own = create_thread_pool(options->threads);
+    }
+    if (pool != NULL)
+      parallel_for(pool, 0, run.blocks, 1, label_blocks, &run);
+    else
+      label_blocks(0, run.blocks, &run);
+
+    if (!atomic_load(&run.failed)) {
+      for (b = 0; b < run.blocks; b++) {
+        run.blocks_of[b].offset = total;
+        total += run.blocks_of[b].count;
+      }
+      table = (int *)malloc((total + 1) * sizeof(int));
+    }
+    if (table != NULL) {
+      size_t l;
+      table[0] = 0;
+      for (b = 0; b < run.blocks; b++)
+        for (l = 1; l <= run.blocks_of[b].count; l++)
+          table[run.blocks_of[b].offset + l] =
+              (int)run.blocks_of[b].offset + run.blocks_of[b].parent[l];
+      for (b = 1; b < run.blocks; b++)
+        merge_seam(&run, table, b);
+      labels->count = resolve_labels(&run, table, total, &labels->components);
+      if (labels->count != SIZE_MAX) {
+        run.table = table;
+        if (pool != NULL)
+          parallel_for(pool, 0, run.blocks, 1, relabel_blocks, &run);
+        else
+          relabel_blocks(0, run.blocks, &run);
+      }
+    }
+    if (table == NULL || labels->count == SIZE_MAX)
+      atomic_store(&run.failed, 1);
+  }
+
+  if (atomic_load(&run.failed)) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    destroy_grid_labels(labels);
+    status = -1;
+  }
+  free(table);
+  for (b = 0; run.blocks_of != NULL && b < run.blocks; b++) {
+    free(run.blocks_of[b].parent);
+    free(run.blocks_of[b].stats);
+  }
+  free(run.blocks_of);
+  destroy_thread_pool(own);
+  return status;
+}
+
+void destroy_grid_labels(GridLabels *labels) {
+  destroy_grid(&labels->labels);
+  free(labels->components);
+  memset(labels, 0, sizeof *labels);
+}
+
+/*FLOOD FILL*/
+
+typedef struct {
+  long row, col;
+} FloodSeed;
+
+size_t flood_fill_grid(Grid *grid, long row, long col, int value) {
+  long rows = (long)grid->rows, cols = (long)grid->cols;
+  FloodSeed *stack;
+  size_t size = 0, capacity = 256, filled = 0;
+  int old;
+  if (grid->layout != GRID_ROW_MAJOR) {
+    fprintf(stderr, "ERROR: Flood fill needs a GRID_ROW_MAJOR grid.\n");
+    return 0;
+  }
+  if (row < 0 || row >= rows || col < 0 || col >= cols)
+    return 0;
+  old = get_grid(grid, row, col);
+  if (old == value)
+    return 0;
+  stack = (FloodSeed *)malloc(capacity * sizeof(FloodSeed));
+  if (stack == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return 0;
+  }
+  stack[size].row = row;
+  stack[size++].col = col;
+  while (size > 0) {
+    FloodSeed seed = stack[--size];
+    int *cells = grid->cells + label_row(grid->stride, (size_t)seed.row);
+    long left = seed.col, right = seed.col, r, c;
+    if (cells[seed.col] != old)
+      continue; /*filled since it was pushed*/
+    while (left > 0 && cells[left - 1] == old)
+      left--;
+    while (right + 1 < cols && cells[right + 1] == old)
+      right++;
+    for (c = left; c <= right; c++)
+      cells[c] = value;
+    filled += (size_t)(right - left + 1);
+    /*one seed per run of matching cells next to the span, diagonals
+     * included*/
+    for (r = seed.row - 1; r <= seed.row + 1; r += 2) {
+      const int *next;
+      long from = left > 0 ? left - 1 : 0;
+      long to = right + 1 < cols ? right + 1 : cols - 1;
+      if (r < 0 || r >= rows)
+        continue;
+      next = grid->cells + label_row(grid->stride, (size_t)r);
+      for (c = from; c <= to; c++) {
+        if (next[c] != old || (c > from && next[c - 1] == old))
+          continue;
+        if (size == capacity) {
+          FloodSeed *grown =
+              (FloodSeed *)realloc(stack, 2 * capacity * sizeof(FloodSeed));
+          if (grown == NULL) {
+            fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+            free(stack);
+            return filled;
+          }
+          stack = grown;
+          capacity *= 2;
+        }
+        stack[size].row = r;
+        stack[size++].col = c;
+      }
+    }
+  }
+  free(stack);
+  return filled;
+}
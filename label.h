@@ -0,0 +1,76 @@
+#ifndef __LABEL_H__
+#define __LABEL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "grid.h"
+#include "threadpool.h"
+
+/*LABELING*/
+
+/*Connected components of a GRID_ROW_MAJOR grid under the 8-connectivity of
+ * `print_matrix_neighbor_coordinates_rules()`: neighboring cells holding the
+ * same value are in the same component, cells equal to the background are in
+ * none.
+ *
+ * `label_grid` is a two-pass union-find. The rows are cut into blocks that
+ * are labeled in parallel, each with its own provisional labels and
+ * equivalence table. The seams between blocks are merged on the calling
+ * thread, one row pair each, and a last parallel pass writes the final
+ * labels. Components are numbered from 1 in the order their first cell
+ * comes in a row-major scan, so the result is the same for any block size
+ * and thread count.
+ *
+ * Usage:
+ *   GridLabels labels;
+ *   if (label_grid(&image, &labels, NULL) == 0) {
+ *     printf("%zu regions\n", labels.count);
+ *     destroy_grid_labels(&labels);
+ *   }*/
+#define LABEL_BLOCK_ROWS 128
+
+typedef struct {
+  int value;    /*the cell value the component is made of*/
+  size_t cells; /*its size*/
+  long top, left, bottom, right; /*bounding box, inclusive*/
+} GridComponent;
+
+typedef struct {
+  Grid labels; /*GRID_ROW_MAJOR, 0 for background cells, else 1..count*/
+  GridComponent *components; /*components[i - 1] describes label i*/
+  size_t count;
+} GridLabels;
+
+typedef struct {
+  int threads;       /*worker threads, <= 1 runs on the calling thread*/
+  ThreadPool *pool;  /*pool to run on; NULL uses default_thread_pool() when
+                        it has `threads` threads, else a pool for the call*/
+  size_t block_rows; /*rows per block, 0 picks LABEL_BLOCK_ROWS*/
+  int background;    /*cells with this value are not labeled*/
+} LabelOptions;
+
+/*All online CPUs, LABEL_BLOCK_ROWS and background 0.*/
+LabelOptions default_label_options(void);
+
+/*Labels the user cells of `grid` into `labels`. Returns -1 with an error on
+ * stderr if the grid is not GRID_ROW_MAJOR, holds INT_MAX cells or more
+ * (halo included), or memory runs out; `labels` is then empty.*/
+int label_grid(const Grid *grid, GridLabels *labels,
+               const LabelOptions *options);
+void destroy_grid_labels(GridLabels *labels);
+
+/*Sets every cell of the 8-connected component of (row, col) to `value` and
+ * returns how many cells changed. Works span by span from an explicit stack,
+ * so its depth does not depend on the shape of the region. The grid must be
+ * GRID_ROW_MAJOR.*/
+size_t flood_fill_grid(Grid *grid, long row, long col, int value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LABEL_H__
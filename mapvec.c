@@ -0,0 +1,279 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /*for `mremap`*/
+#endif
+#include "mapvec.h"
+
+#include <fcntl.h>    /*Includes `open`.*/
+#include <stdint.h>
+#include <sys/mman.h> /*Includes `mmap`, `mremap`, `msync` and `madvise`.*/
+#include <sys/stat.h> /*Includes `fstat` for the file size.*/
+#include <unistd.h>   /*Includes `ftruncate`, `pread` and `close`.*/
+
+/*MAPPED VECTOR*/
+
+/*File layout: a MappedVectorHeader padded to HEADER_SIZE bytes, so the
+ * payload starts page aligned, then `capacity` ints. `size` is only updated
+ * by `sync_mapped_vector`, after the payload it covers is written.*/
+#define HEADER_SIZE 4096
+#define BYTE_ORDER_MARK 0x01020304u
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t element_size;
+  uint32_t byte_order; /*BYTE_ORDER_MARK as written by the creating machine*/
+  uint64_t size;
+  uint64_t reserved[4];
+} MappedVectorHeader;
+
+static const char mapvec_magic[8] = {'U', 'T', 'I', 'L', 'V', 'E', 'C', 'T'};
+
+/*Points the Vector at a new mapping of `length` bytes.*/
+static void attach_mapped_vector(MappedVector *mapped, void *base,
+                                 size_t length) {
+  mapped->base = (unsigned char *)base;
+  mapped->length = length;
+  mapped->vector.arr = (int *)(mapped->base + HEADER_SIZE);
+  mapped->vector.capacity = (length - HEADER_SIZE) / sizeof(int);
+}
+
+/*Replaces the mapping with one of `length` bytes of the (already sized)
+ * file, in place or moved by mremap where there is one.*/
+static int remap_mapped_vector(MappedVector *mapped, size_t length) {
+  void *base;
+#if defined(MREMAP_MAYMOVE)
+  base = mremap(mapped->base, mapped->length, length, MREMAP_MAYMOVE);
+#else
+  base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, mapped->fd, 0);
+  if (base != MAP_FAILED)
+    munmap(mapped->base, mapped->length);
+#endif
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Cannot remap vector file.\n");
+    return -1;
+  }
+  attach_mapped_vector(mapped, base, length);
+  return 0;
+}
+
+/*Checks a header read from `path` against this build.*/
+static bool valid_header(const MappedVectorHeader *header, size_t file_size,
+                         const char *path) {
+  if (memcmp(header->magic, mapvec_magic, sizeof mapvec_magic) != 0 ||
+      header->version != MAPPED_VECTOR_VERSION ||
+      header->header_size != HEADER_SIZE) {
+    fprintf(stderr, "ERROR: %s is not a version %d mapped vector.\n", path,
+            MAPPED_VECTOR_VERSION);
+    return false;
+  }
+  if (header->element_size != sizeof(int) ||
+      header->byte_order != BYTE_ORDER_MARK) {
+    fprintf(stderr, "ERROR: %s was written with another int layout.\n", path);
+    return false;
+  }
+  if (header->size > (file_size - HEADER_SIZE) / sizeof(int)) {
+    fprintf(stderr, "ERROR: %s is shorter than its size.\n", path);
+    return false;
+  }
+  return true;
+}
+
+int open_mapped_vector(MappedVector *mapped, const char *path, int flags) {
+  MappedVectorHeader header;
+  struct stat st;
+  bool read_only = (flags & MAPPED_VECTOR_READ_ONLY) != 0, fresh;
+  size_t length;
+  void *base;
+  int fd;
+  mapped->base = NULL;
+  mapped->fd = -1;
+  if (read_only)
+    fd = open(path, O_RDONLY);
+  else
+    fd = open(path,
+              O_RDWR | (flags & MAPPED_VECTOR_CREATE ? O_CREAT : 0) |
+                  (flags & MAPPED_VECTOR_TRUNCATE ? O_TRUNC : 0),
+              0644);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: Cannot open vector file %s.\n", path);
+    return -1;
+  }
+  if (fstat(fd, &st) != 0) {
+    fprintf(stderr, "ERROR: Cannot read vector file %s.\n", path);
+    close(fd);
+    return -1;
+  }
+  fresh = st.st_size == 0 && !read_only;
+  if (fresh) {
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, mapvec_magic, sizeof mapvec_magic);
+    header.version = MAPPED_VECTOR_VERSION;
+    header.header_size = HEADER_SIZE;
+    header.element_size = sizeof(int);
+    header.byte_order = BYTE_ORDER_MARK;
+    length = HEADER_SIZE + MAPPED_VECTOR_MIN_CAPACITY * sizeof(int);
+    if (ftruncate(fd, (off_t)length) != 0) {
+      fprintf(stderr, "ERROR: Cannot size vector file %s.\n", path);
+      close(fd);
+      return -1;
+    }
+  } else {
+    length = (size_t)st.st_size;
+    if (length < HEADER_SIZE ||
+        pread(fd, &header, sizeof header, 0) != (ssize_t)sizeof header) {
+      fprintf(stderr, "ERROR: %s is not a version %d mapped vector.\n", path,
+              MAPPED_VECTOR_VERSION);
+      close(fd);
+      return -1;
+    }
+    if (!valid_header(&header, length, path)) {
+      close(fd);
+      return -1;
+    }
+  }
+  base = mmap(NULL, length, read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+              MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Cannot map vector file %s.\n", path);
+    close(fd);
+    return -1;
+  }
+  if (fresh)
+    memcpy(base, &header, sizeof header);
+  mapped->fd = fd;
+  mapped->read_only = read_only;
+  attach_mapped_vector(mapped, base, length);
+  mapped->vector.size = (size_t)header.size;
+  return 0;
+}
+
+int close_mapped_vector(MappedVector *mapped) {
+  size_t length;
+  int status = 0;
+  if (mapped->base == NULL)
+    return 0;
+  if (!mapped->read_only)
+    status = sync_mapped_vector(mapped, true);
+  munmap(mapped->base, mapped->length);
+  length = HEADER_SIZE + mapped->vector.size * sizeof(int);
+  if (!mapped->read_only && ftruncate(mapped->fd, (off_t)length) != 0) {
+    fprintf(stderr, "ERROR: Cannot truncate vector file.\n");
+    status = -1;
+  }
+  close(mapped->fd);
+  mapped->base = NULL;
+  mapped->fd = -1;
+  mapped->vector.arr = NULL;
+  mapped->vector.size = 0;
+  mapped->vector.capacity = 0;
+  return status;
+}
+
+/*GROWTH*/
+
+int reserve_mapped_vector(MappedVector *mapped, size_t capacity) {
+  size_t length;
+  if (capacity <= mapped->vector.capacity)
+    return 0;
+  if (mapped->read_only) {
+    fprintf(stderr, "ERROR: Cannot grow a read only vector file.\n");
+    return -1;
+  }
+  if (capacity > ((size_t)-1 - HEADER_SIZE) / sizeof(int)) {
+    fprintf(stderr, "ERROR: Vector capacity %zu is too large.\n", capacity);
+    return -1;
+  }
+  length = HEADER_SIZE + capacity * sizeof(int);
+  if (ftruncate(mapped->fd, (off_t)length) != 0) {
+    fprintf(stderr, "ERROR: Cannot grow vector file to %zu bytes.\n", length);
+    return -1;
+  }
+  return remap_mapped_vector(mapped, length);
+}
+
+int resize_mapped_vector(MappedVector *mapped, size_t size) {
+  size_t old = mapped->vector.size, capacity = mapped->vector.capacity;
+  if (reserve_mapped_vector(mapped, size) != 0)
+    return -1;
+  /*ftruncate zeroes the slots past the old end of the file, so only those
+   * below the old capacity can hold stale values*/
+  if (size > old && old < capacity)
+    memset(mapped->vector.arr + old, 0,
+           ((size < capacity ? size : capacity) - old) * sizeof(int));
+  mapped->vector.size = size;
+  return 0;
+}
+
+int push_back_mapped_vector(MappedVector *mapped, int value) {
+  Vector *vector = &mapped->vector;
+  if (vector->size == vector->capacity &&
+      reserve_mapped_vector(mapped, vector->capacity > 0
+                                        ? vector->capacity * 2
+                                        : MAPPED_VECTOR_MIN_CAPACITY) != 0)
+    return -1;
+  vector->arr[vector->size++] = value;
+  return 0;
+}
+
+/*DURABILITY AND HINTS*/
+
+int sync_mapped_vector(MappedVector *mapped, bool wait) {
+  int flags = wait ? MS_SYNC : MS_ASYNC;
+  MappedVectorHeader *header = (MappedVectorHeader *)mapped->base;
+  if (mapped->base == NULL || mapped->read_only)
+    return 0;
+  /*payload first, so the header never covers unwritten elements*/
+  if (msync(mapped->base, HEADER_SIZE + mapped->vector.size * sizeof(int),
+            flags) != 0) {
+    fprintf(stderr, "ERROR: Cannot sync vector file.\n");
+    return -1;
+  }
+  header->size = mapped->vector.size;
+  if (msync(mapped->base, HEADER_SIZE, flags) != 0) {
+    fprintf(stderr, "ERROR: Cannot sync vector file.\n");
+    return -1;
+  }
+  return 0;
+}
+
+int advise_mapped_vector(MappedVector *mapped, size_t begin, size_t end,
+                         int advice) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE), first, last;
+  int flag;
+  switch (advice) {
+  case MAPPED_VECTOR_SEQUENTIAL:
+    flag = MADV_SEQUENTIAL;
+    break;
+  case MAPPED_VECTOR_RANDOM:
+    flag = MADV_RANDOM;
+    break;
+  case MAPPED_VECTOR_WILLNEED:
+    flag = MADV_WILLNEED;
+    break;
+  case MAPPED_VECTOR_DONTNEED:
+    flag = MADV_DONTNEED;
+    break;
+  case MAPPED_VECTOR_HUGEPAGE:
+#if defined(MADV_HUGEPAGE)
+    flag = MADV_HUGEPAGE;
+    break;
+#else
+    return -1;
+#endif
+  default:
+    flag = MADV_NORMAL;
+    break;
+  }
+  if (mapped->base == NULL)
+    return -1;
+  if (end > mapped->vector.capacity)
+    end = mapped->vector.capacity;
+  if (begin >= end)
+    return 0;
+  first = (HEADER_SIZE + begin * sizeof(int)) / page * page;
+  last = HEADER_SIZE + end * sizeof(int);
+  return madvise(mapped->base + first, last - first, flag) == 0 ? 0 : -1;
+}
@@ -0,0 +1,93 @@
+#ifndef __MAPVEC_H__
+#define __MAPVEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+/*MAPPED VECTOR*/
+
+/*A Vector kept in a file: a one page header (magic, version, element size,
+ * byte order, size) followed by the raw `int` payload. Opening maps the file
+ * shared, so it costs the same for any size and pages fault in as they are
+ * read; data larger than RAM works because the kernel can drop clean pages
+ * and write back dirty ones.
+ *
+ * `mapped.vector` is an ordinary Vector whose `arr` points into the mapping:
+ * reads, in-place writes, spans and the vecops.h kernels with `dst` no
+ * larger than the capacity all work on it directly. It must only grow
+ * through `reserve_mapped_vector`, `resize_mapped_vector` and
+ * `push_back_mapped_vector`, which extend the file and remap it (moving
+ * `arr`, like a Vector reallocating). Writes reach the file whenever the
+ * kernel writes pages back; `sync_mapped_vector` is the durability point
+ * that also records the size in the header.
+ *
+ * Usage:
+ *   MappedVector m;
+ *   if (open_mapped_vector(&m, "data.vec", MAPPED_VECTOR_CREATE) != 0)
+ *     return;
+ *   push_back_mapped_vector(&m, 42);
+ *   advise_mapped_vector(&m, 0, m.vector.size, MAPPED_VECTOR_SEQUENTIAL);
+ *   sum = sum_vector(&m.vector, NULL);
+ *   close_mapped_vector(&m);*/
+#define MAPPED_VECTOR_VERSION 1
+#define MAPPED_VECTOR_MIN_CAPACITY 1024 /*elements allocated at first*/
+
+/*`open_mapped_vector` flags.*/
+enum {
+  MAPPED_VECTOR_CREATE = 1,   /*create the file if it does not exist*/
+  MAPPED_VECTOR_TRUNCATE = 2, /*start empty even if it does*/
+  MAPPED_VECTOR_READ_ONLY = 4 /*map read only; writes to `arr` fault*/
+};
+
+/*`advise_mapped_vector` access patterns.*/
+enum {
+  MAPPED_VECTOR_NORMAL,
+  MAPPED_VECTOR_SEQUENTIAL, /*read ahead aggressively, drop pages behind*/
+  MAPPED_VECTOR_RANDOM,     /*no read ahead*/
+  MAPPED_VECTOR_WILLNEED,   /*start reading the range in now*/
+  MAPPED_VECTOR_DONTNEED,   /*the range can be dropped from memory*/
+  MAPPED_VECTOR_HUGEPAGE    /*back the range with transparent huge pages*/
+};
+
+typedef struct {
+  Vector vector; /*`capacity` counts the elements the file holds*/
+  unsigned char *base;
+  size_t length; /*bytes mapped: the header and the capacity*/
+  int fd;
+  bool read_only;
+} MappedVector;
+
+/*Opens or creates a mapped vector file. Returns -1 (and leaves `mapped`
+ * closed) if the file cannot be opened or mapped, or is not a version
+ * MAPPED_VECTOR_VERSION file with this machine's int size and byte order.*/
+int open_mapped_vector(MappedVector *mapped, const char *path, int flags);
+/*Syncs, trims the file to its size and unmaps it.*/
+int close_mapped_vector(MappedVector *mapped);
+
+/*Grows the file to hold at least `capacity` elements.*/
+int reserve_mapped_vector(MappedVector *mapped, size_t capacity);
+/*Sets the size; new elements are 0.*/
+int resize_mapped_vector(MappedVector *mapped, size_t size);
+/*Appends `value`, doubling the capacity when full.*/
+int push_back_mapped_vector(MappedVector *mapped, int value);
+
+/*Writes the payload and then the header back to the file. With `wait` it
+ * returns once both are on disk, so a crash after it leaves the file with at
+ * least this size and contents; without it the writes are only started.*/
+int sync_mapped_vector(MappedVector *mapped, bool wait);
+/*Hints how elements [begin, end) will be used. Returns -1 where the kernel
+ * does not support the hint; the data is unaffected either way.*/
+int advise_mapped_vector(MappedVector *mapped, size_t begin, size_t end,
+                         int advice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MAPVEC_H__
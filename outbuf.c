@@ -0,0 +1,246 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "outbuf.h"
+
+#include <errno.h>
+#include <pthread.h>  /*Includes thread specific keys for per-thread buffers.*/
+#include <sys/uio.h>  /*Includes `writev` for oversized lines.*/
+#include <unistd.h>   /*Includes `isatty` and `STDOUT_FILENO`.*/
+
+/*OUTPUT BUFFER*/
+
+typedef struct {
+  char data[OUTBUF_SIZE];
+  size_t len;
+  unsigned int lines;
+} OutputBuffer;
+
+static pthread_key_t output_key;
+static pthread_once_t output_once = PTHREAD_ONCE_INIT;
+static int output_fd = STDOUT_FILENO;
+static unsigned int output_flush_lines = 0;
+static bool output_configured = false;
+static bool output_tty; /*isatty(output_fd), checked when the fd is set*/
+
+/*Writes everything, retrying short writes and EINTR.*/
+static void write_all(const struct iovec *iov, int count) {
+  struct iovec local[4];
+  int i;
+  for (i = 0; i < count; i++)
+    local[i] = iov[i];
+  i = 0;
+  while (i < count) {
+    ssize_t n = writev(output_fd, local + i, count - i);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    while (i < count && (size_t)n >= local[i].iov_len) {
+      n -= (ssize_t)local[i].iov_len;
+      i++;
+    }
+    if (i < count) {
+      local[i].iov_base = (char *)local[i].iov_base + n;
+      local[i].iov_len -= (size_t)n;
+    }
+  }
+}
+
+static void flush_buffer(OutputBuffer *buffer) {
+  struct iovec iov;
+  if (buffer->len == 0)
+    return;
+  iov.iov_base = buffer->data;
+  iov.iov_len = buffer->len;
+  write_all(&iov, 1);
+  buffer->len = 0;
+  buffer->lines = 0;
+}
+
+static void destroy_buffer(void *arg) {
+  flush_buffer((OutputBuffer *)arg);
+  free(arg);
+}
+
+static void flush_at_exit(void) { flush_output_buffer(); }
+
+static void init_output(void) {
+  pthread_key_create(&output_key, destroy_buffer);
+  atexit(flush_at_exit);
+  if (!output_configured) {
+    output_tty = isatty(output_fd);
+    output_flush_lines = output_tty ? 1 : 0;
+  }
+}
+
+static OutputBuffer *get_buffer(void) {
+  OutputBuffer *buffer;
+  pthread_once(&output_once, init_output);
+  buffer = (OutputBuffer *)pthread_getspecific(output_key);
+  if (buffer == NULL) {
+    buffer = (OutputBuffer *)malloc(sizeof(OutputBuffer));
+    if (buffer == NULL) {
+      fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+      return NULL;
+    }
+    buffer->len = 0;
+    buffer->lines = 0;
+    pthread_setspecific(output_key, buffer);
+  }
+  return buffer;
+}
+
+/*Counts a finished line and flushes at the line threshold.*/
+static void end_lines(OutputBuffer *buffer, unsigned int lines) {
+  buffer->lines += lines;
+  if (output_flush_lines != 0 && buffer->lines >= output_flush_lines)
+    flush_buffer(buffer);
+}
+
+static unsigned int count_newlines(const char *data, size_t len) {
+  unsigned int lines = 0;
+  const char *end = data + len;
+  while ((data = (const char *)memchr(data, '\n', (size_t)(end - data))) !=
+         NULL) {
+    lines++;
+    data++;
+  }
+  return lines;
+}
+
+void set_output_buffer(int fd, unsigned int flush_lines) {
+  flush_output_buffer();
+  output_fd = fd;
+  output_tty = isatty(fd);
+  output_flush_lines = flush_lines;
+  output_configured = true;
+}
+
+bool use_color_output_buffer(void) {
+  pthread_once(&output_once, init_output);
+  return use_color_tty(output_tty);
+}
+
+void flush_output_buffer(void) {
+  OutputBuffer *buffer = get_buffer();
+  if (buffer != NULL)
+    flush_buffer(buffer);
+}
+
+void write_output_buffer(const char *data, size_t len, unsigned int lines) {
+  OutputBuffer *buffer = get_buffer();
+  if (buffer == NULL)
+    return;
+  if (len > OUTBUF_SIZE - buffer->len) {
+    struct iovec iov[2];
+    if (len <= OUTBUF_SIZE) {
+      flush_buffer(buffer);
+    } else {
+      iov[0].iov_base = buffer->data;
+      iov[0].iov_len = buffer->len;
+      iov[1].iov_base = (void *)data;
+      iov[1].iov_len = len;
+      write_all(iov, 2);
+      buffer->len = 0;
+      buffer->lines = 0;
+      return;
+    }
+  }
+  memcpy(buffer->data + buffer->len, data, len);
+  buffer->len += len;
+  end_lines(buffer, lines);
+}
+
+void vcolor_print_buffered(const char *fg, const char *bg, const char *style,
+                           const char *format, va_list args) {
+  OutputBuffer *buffer = get_buffer();
+  bool color = use_color_tty(output_tty);
+  size_t fg_len = color ? strlen(fg) : 0, bg_len = color ? strlen(bg) : 0;
+  size_t style_len = color ? strlen(style) : 0;
+  size_t prefix = fg_len + bg_len + style_len;
+  size_t reset = color ? sizeof(RESET) - 1 : 0;
+  size_t room, len;
+  char *p;
+  va_list copy;
+  int n;
+  if (buffer == NULL)
+    return;
+
+  /*format straight behind the pending bytes, leaving room for the prefix and
+   * the reset; if that does not fit, `n` is the length to make room for*/
+  va_copy(copy, args);
+  room = OUTBUF_SIZE - buffer->len;
+  p = buffer->data + buffer->len;
+  if (prefix + reset < room)
+    n = vsnprintf(p + prefix, room - prefix - reset, format, args);
+  else
+    n = vsnprintf(NULL, 0, format, args);
+  if (n < 0) {
+    va_end(copy);
+    return;
+  }
+  len = prefix + (size_t)n + reset;
+  if (prefix + reset >= room || (size_t)n >= room - prefix - reset) {
+    if (len >= OUTBUF_SIZE) {
+      char *line = (char *)malloc(len + 1);
+      if (line == NULL) {
+        fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+        va_end(copy);
+        return;
+      }
+      memcpy(line, fg, fg_len);
+      memcpy(line + fg_len, bg, bg_len);
+      memcpy(line + fg_len + bg_len, style, style_len);
+      vsnprintf(line + prefix, (size_t)n + 1, format, copy);
+      memcpy(line + prefix + n, RESET, reset);
+      write_output_buffer(line, len,
+                          count_newlines(line + prefix, (size_t)n));
+      free(line);
+      va_end(copy);
+      return;
+    }
+    flush_buffer(buffer);
+    p = buffer->data;
+    vsnprintf(p + prefix, (size_t)n + 1, format, copy);
+  }
+  va_end(copy);
+  memcpy(p, fg, fg_len);
+  memcpy(p + fg_len, bg, bg_len);
+  memcpy(p + fg_len + bg_len, style, style_len);
+  memcpy(p + prefix + n, RESET, reset);
+  buffer->len += len;
+  end_lines(buffer, count_newlines(p + prefix, (size_t)n));
+}
+
+void color_print_buffered(const char *fg, const char *bg, const char *style,
+                          const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vcolor_print_buffered(fg, bg, style, format, args);
+  va_end(args);
+}
+
+/*Same output as `debug_puts`, formatted in one pass.*/
+void debug_puts_buffered(const char *str, int line, const char *file) {
+  const char *format = use_color_output_buffer()
+                           ? "F: " CYAN "%s" RESET " L: " MAGENTA "%d" RESET
+                             " O: %s\n"
+                           : "F: %s L: %d O: %s\n";
+  char stack[512];
+  int n = snprintf(stack, sizeof stack, format, file, line, str);
+  if (n < 0)
+    return;
+  if ((size_t)n < sizeof stack) {
+    write_output_buffer(stack, (size_t)n, 1);
+  } else {
+    char *heap = (char *)malloc((size_t)n + 1);
+    if (heap == NULL) {
+      fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+      return;
+    }
+    snprintf(heap, (size_t)n + 1, format, file, line, str);
+    write_output_buffer(heap, (size_t)n, 1);
+    free(heap);
+  }
+}
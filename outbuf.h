@@ -0,0 +1,50 @@
+#ifndef __OUTBUF_H__
+#define __OUTBUF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+/*OUTPUT BUFFER*/
+
+/*Buffered versions of `color_print` and `debug_puts`. Each thread owns an
+ * OUTBUF_SIZE byte buffer; a call formats the whole escape sequence plus
+ * message line straight into it, and the buffer goes to the file descriptor
+ * with one write(2) once `flush_lines` lines are pending or the next line
+ * does not fit. A line larger than the buffer is written together with the
+ * pending bytes in one writev(2).
+ *
+ * The buffers bypass stdio: call `fflush(stdout)` before switching from
+ * printf to these functions, and `flush_output_buffer()` before switching
+ * back. A thread's buffer is flushed when the thread exits and the calling
+ * thread's buffer at `exit()`. Escape codes are left out unless the file
+ * descriptor is a terminal, as `use_color_fd` decides.*/
+#define OUTBUF_SIZE 8192
+
+/*`flush_lines` of 0 flushes only when the buffer is full. The default is the
+ * standard output, flushed every line when it is a terminal and only when
+ * full otherwise. Call before any thread starts printing.*/
+void set_output_buffer(int fd, unsigned int flush_lines);
+void flush_output_buffer(void);
+/*Whether lines for the buffer's file descriptor carry escape codes.*/
+bool use_color_output_buffer(void);
+
+void color_print_buffered(const char *fg, const char *bg, const char *style,
+                          const char *format, ...);
+void vcolor_print_buffered(const char *fg, const char *bg, const char *style,
+                           const char *format, va_list args);
+void debug_puts_buffered(const char *str, int line, const char *file);
+
+/*Appends `len` preformatted bytes containing `lines` newlines.*/
+void write_output_buffer(const char *data, size_t len, unsigned int lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __OUTBUF_H__
@@ -0,0 +1,365 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "packvec.h"
+
+#include "simd.h"
+#include "vecops.h"
+
+/*PACKED VECTOR*/
+
+/*Block layout: a difference of `bits` bits for each of the 256 elements
+ * (the first element's is 0), value i in lane i % 8 at bit (i / 8) * bits of
+ * that lane. Lane words are interleaved: lane L's word w is words[w * 8 + L],
+ * so a block takes exactly 8 * bits words and one 256 bit load fetches word
+ * w of every lane.*/
+#define LANES 8
+#define PER_LANE (PACKED_VECTOR_BLOCK / LANES)
+
+static uint32_t width_mask(unsigned int bits) {
+  return bits >= 32 ? 0xffffffffu : (1u << bits) - 1;
+}
+
+/*DECODING*/
+
+#if SIMD_AVX2
+/*Unpacks the 256 differences of a block and adds `min`. With `scan` it also
+ * takes the prefix sum from `carry`, writing the values instead.*/
+static SIMD_AVX2_TARGET void unpack_block_avx2(const uint32_t *in,
+                                               unsigned int bits, int min,
+                                               int carry, int *out,
+                                               bool scan) {
+  const __m256i mask = _mm256_set1_epi32((int)width_mask(bits));
+  const __m256i base = _mm256_set1_epi32(min);
+  const __m256i last = _mm256_set1_epi32(7);
+  __m256i c = _mm256_set1_epi32(carry);
+  __m256i w = bits > 0 ? _mm256_loadu_si256((const __m256i *)in)
+                       : _mm256_setzero_si256();
+  unsigned int shift = 0;
+  int k;
+  for (k = 0; k < PER_LANE; k++) {
+    __m256i x = _mm256_srl_epi32(w, _mm_cvtsi32_si128((int)shift));
+    shift += bits;
+    if (shift >= 32) {
+      shift -= 32;
+      /*the last value of a lane ends on a word boundary*/
+      if (k + 1 < PER_LANE) {
+        in += LANES;
+        w = _mm256_loadu_si256((const __m256i *)in);
+      }
+      if (shift > 0)
+        x = _mm256_or_si256(
+            x, _mm256_sll_epi32(w, _mm_cvtsi32_si128((int)(bits - shift))));
+    }
+    x = _mm256_add_epi32(_mm256_and_si256(x, mask), base);
+    if (scan) {
+      x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+      x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+      x = _mm256_add_epi32(
+          x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+      x = _mm256_add_epi32(x, c);
+      c = _mm256_permutevar8x32_epi32(x, last);
+    }
+    _mm256_storeu_si256((__m256i *)(out + k * LANES), x);
+  }
+}
+
+/*Prefix sums of 256 differences in place, from `carry`.*/
+static SIMD_AVX2_TARGET void scan_block_avx2(int *out, int carry) {
+  const __m256i last = _mm256_set1_epi32(7);
+  __m256i c = _mm256_set1_epi32(carry);
+  int k;
+  for (k = 0; k < PACKED_VECTOR_BLOCK; k += LANES) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(out + k));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi32(
+        x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+    x = _mm256_add_epi32(x, c);
+    c = _mm256_permutevar8x32_epi32(x, last);
+    _mm256_storeu_si256((__m256i *)(out + k), x);
+  }
+}
+#endif
+
+/*Unpacks the 256 differences of a block and adds `min`.*/
+static void unpack_block(const uint32_t *in, unsigned int bits, int min,
+                         int *out) {
+  uint32_t mask = width_mask(bits);
+  size_t i;
+  for (i = 0; i < PACKED_VECTOR_BLOCK; i++) {
+    unsigned int bit = (unsigned int)(i / LANES) * bits;
+    const uint32_t *lane = in + (bit / 32) * LANES + i % LANES;
+    uint32_t value = 0;
+    if (bits > 0) {
+      value = lane[0] >> (bit % 32);
+      if (bit % 32 + bits > 32)
+        value |= lane[LANES] << (32 - bit % 32);
+    }
+    out[i] = (int)((value & mask) + (uint32_t)min);
+  }
+}
+
+size_t decode_block_packed_vector(const PackedVector *packed, size_t block,
+                                  int *out) {
+  const PackedBlock *b = &packed->blocks[block];
+  const uint32_t *in = packed->words + b->words;
+  size_t count = packed->size - block * PACKED_VECTOR_BLOCK, e, i;
+  /*the first difference is 0, so start one `min_delta` below `first`*/
+  uint32_t carry = (uint32_t)b->first - (uint32_t)b->min_delta;
+  if (count > PACKED_VECTOR_BLOCK)
+    count = PACKED_VECTOR_BLOCK;
+#if SIMD_AVX2
+  if (simd_has_avx2()) {
+    unpack_block_avx2(in, b->bits, b->min_delta, (int)carry, out,
+                      b->exception_count == 0);
+    if (b->exception_count == 0)
+      return count;
+  } else
+#endif
+    unpack_block(in, b->bits, b->min_delta, out);
+  for (e = b->exceptions; e < b->exceptions + b->exception_count; e++)
+    out[packed->exception_positions[e]] =
+        (int)((uint32_t)out[packed->exception_positions[e]] +
+              (packed->exception_highs[e] << b->bits));
+#if SIMD_AVX2
+  if (simd_has_avx2()) {
+    scan_block_avx2(out, (int)carry);
+    return count;
+  }
+#endif
+  for (i = 0; i < PACKED_VECTOR_BLOCK; i++) {
+    carry += (uint32_t)out[i];
+    out[i] = (int)carry;
+  }
+  return count;
+}
+
+/*ENCODING*/
+
+/*Appends an exception, doubling the arrays when full.*/
+static int push_exception(PackedVector *packed, size_t *capacity,
+                          uint8_t position, uint32_t high) {
+  if (packed->exception_count == *capacity) {
+    size_t grown = *capacity > 0 ? *capacity * 2 : 64;
+    uint8_t *positions =
+        (uint8_t *)realloc(packed->exception_positions, grown);
+    uint32_t *highs;
+    if (positions == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    packed->exception_positions = positions;
+    highs = (uint32_t *)realloc(packed->exception_highs,
+                                grown * sizeof(uint32_t));
+    if (highs == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    packed->exception_highs = highs;
+    *capacity = grown;
+  }
+  packed->exception_positions[packed->exception_count] = position;
+  packed->exception_highs[packed->exception_count++] = high;
+  return 0;
+}
+
+/*The width with the smallest block: 32 bytes per bit of width plus 5 bytes
+ * per exception. Ties go to the wider, exception free side.*/
+static unsigned int pick_width(const uint32_t *offsets) {
+  size_t widths[33] = {0}, wider = 0, best_cost = (size_t)-1;
+  unsigned int bits, best = 32;
+  size_t i;
+  for (i = 0; i < PACKED_VECTOR_BLOCK; i++)
+    widths[offsets[i] == 0 ? 0 : 32 - __builtin_clz(offsets[i])]++;
+  for (bits = 32;; bits--) {
+    size_t cost = 32 * (size_t)bits + 5 * wider;
+    if (cost < best_cost) {
+      best_cost = cost;
+      best = bits;
+    }
+    if (bits == 0)
+      break;
+    wider += widths[bits];
+  }
+  return best;
+}
+
+/*Packs one block of `count` values starting at `v`.*/
+static int encode_block(PackedVector *packed, size_t *exception_capacity,
+                        const int *v, size_t count, PackedBlock *block) {
+  uint32_t offsets[PACKED_VECTOR_BLOCK];
+  uint32_t *out = packed->words + packed->word_count;
+  int min = 0;
+  unsigned int bits;
+  size_t i;
+  for (i = 1; i < count; i++) {
+    int delta = (int)((uint32_t)v[i] - (uint32_t)v[i - 1]);
+    if (i == 1 || delta < min)
+      min = delta;
+  }
+  memset(offsets, 0, sizeof offsets);
+  for (i = 1; i < count; i++)
+    offsets[i] = (uint32_t)v[i] - (uint32_t)v[i - 1] - (uint32_t)min;
+  bits = pick_width(offsets);
+
+  block->first = v[0];
+  block->min_delta = min;
+  block->bits = (uint8_t)bits;
+  block->words = (uint32_t)packed->word_count;
+  block->exceptions = (uint32_t)packed->exception_count;
+  block->exception_count = 0;
+  for (i = 0; i < count && bits < 32; i++)
+    if (offsets[i] >> bits != 0) {
+      if (push_exception(packed, exception_capacity, (uint8_t)i,
+                         offsets[i] >> bits) != 0)
+        return -1;
+      offsets[i] &= width_mask(bits);
+      block->exception_count++;
+    }
+
+  memset(out, 0, (size_t)bits * LANES * sizeof(uint32_t));
+  for (i = 0; i < PACKED_VECTOR_BLOCK && bits > 0; i++) {
+    unsigned int bit = (unsigned int)(i / LANES) * bits;
+    uint32_t *lane = out + (bit / 32) * LANES + i % LANES;
+    lane[0] |= offsets[i] << (bit % 32);
+    if (bit % 32 + bits > 32)
+      lane[LANES] |= offsets[i] >> (32 - bit % 32);
+  }
+  packed->word_count += (size_t)bits * LANES;
+  return 0;
+}
+
+int create_packed_vector(PackedVector *packed, Vector *vector) {
+  size_t n = vector->size, exception_capacity = 0, b;
+  size_t blocks = (n + PACKED_VECTOR_BLOCK - 1) / PACKED_VECTOR_BLOCK;
+  uint32_t *words;
+  memset(packed, 0, sizeof *packed);
+  if (blocks * PACKED_VECTOR_BLOCK > 0xffffffffu) {
+    fprintf(stderr, "ERROR: %zu elements are too many to pack.\n", n);
+    return -1;
+  }
+  packed->blocks =
+      (PackedBlock *)malloc((blocks > 0 ? blocks : 1) * sizeof(PackedBlock));
+  /*at most 32 bits per element; trimmed once packed*/
+  packed->words = (uint32_t *)malloc(
+      (blocks > 0 ? blocks : 1) * PACKED_VECTOR_BLOCK * sizeof(uint32_t));
+  if (packed->blocks == NULL || packed->words == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    destroy_packed_vector(packed);
+    return -1;
+  }
+  for (b = 0; b < blocks; b++) {
+    size_t begin = b * PACKED_VECTOR_BLOCK;
+    size_t count = n - begin < PACKED_VECTOR_BLOCK ? n - begin
+                                                   : PACKED_VECTOR_BLOCK;
+    if (encode_block(packed, &exception_capacity, vector->arr + begin, count,
+                     &packed->blocks[b]) != 0) {
+      destroy_packed_vector(packed);
+      return -1;
+    }
+  }
+  words = (uint32_t *)realloc(packed->words, (packed->word_count > 0
+                                                  ? packed->word_count
+                                                  : 1) *
+                                                 sizeof(uint32_t));
+  if (words != NULL)
+    packed->words = words;
+  packed->size = n;
+  packed->block_count = blocks;
+  return 0;
+}
+
+void destroy_packed_vector(PackedVector *packed) {
+  free(packed->blocks);
+  free(packed->words);
+  free(packed->exception_positions);
+  free(packed->exception_highs);
+  memset(packed, 0, sizeof *packed);
+}
+
+size_t get_bytes_packed_vector(const PackedVector *packed) {
+  return packed->block_count * sizeof(PackedBlock) +
+         packed->word_count * sizeof(uint32_t) +
+         packed->exception_count * (sizeof(uint8_t) + sizeof(uint32_t));
+}
+
+/*ACCESS*/
+
+int get_index_packed_vector(const PackedVector *packed, size_t index) {
+  int buffer[PACKED_VECTOR_BLOCK];
+  CHECK_RANGE_VECTOR(index, packed->size);
+  decode_block_packed_vector(packed, index / PACKED_VECTOR_BLOCK, buffer);
+  return buffer[index % PACKED_VECTOR_BLOCK];
+}
+
+int unpack_vector(Vector *dst, const PackedVector *packed) {
+  size_t n = packed->size, full = n / PACKED_VECTOR_BLOCK, b;
+  if (dst->capacity < n) {
+    int *arr = (int *)realloc(dst->arr, n * sizeof(int));
+    if (arr == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    dst->arr = arr;
+    dst->capacity = n;
+  }
+  for (b = 0; b < full; b++)
+    decode_block_packed_vector(packed, b, dst->arr + b * PACKED_VECTOR_BLOCK);
+  if (full < packed->block_count) {
+    int buffer[PACKED_VECTOR_BLOCK];
+    size_t count = decode_block_packed_vector(packed, full, buffer);
+    memcpy(dst->arr + full * PACKED_VECTOR_BLOCK, buffer,
+           count * sizeof(int));
+  }
+  dst->size = n;
+  return 0;
+}
+
+void begin_packed_vector(PackedVectorIterator *it, const PackedVector *packed,
+                         size_t block) {
+  it->packed = packed;
+  it->block = block;
+  it->view.arr = it->buffer;
+  it->view.size = 0;
+  it->view.capacity = PACKED_VECTOR_BLOCK;
+}
+
+bool next_packed_vector(PackedVectorIterator *it) {
+  if (it->block >= it->packed->block_count) {
+    it->view.size = 0;
+    return false;
+  }
+  it->view.size =
+      decode_block_packed_vector(it->packed, it->block++, it->buffer);
+  return true;
+}
+
+long long sum_packed_vector(const PackedVector *packed) {
+  PackedVectorIterator it;
+  long long sum = 0;
+  begin_packed_vector(&it, packed, 0);
+  while (next_packed_vector(&it))
+    sum += sum_vector(&it.view, NULL);
+  return sum;
+}
+
+size_t lower_bound_packed_vector(const PackedVector *packed, int value) {
+  int buffer[PACKED_VECTOR_BLOCK];
+  size_t lo = 0, hi = packed->block_count, count, i;
+  /*the first block whose first value is not less than `value`; the answer
+   * is in the block before it, or is its first element*/
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (packed->blocks[mid].first < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+  count = decode_block_packed_vector(packed, lo - 1, buffer);
+  for (i = 0; i < count; i++)
+    if (buffer[i] >= value)
+      break;
+  return (lo - 1) * PACKED_VECTOR_BLOCK + i;
+}
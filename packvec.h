@@ -0,0 +1,102 @@
+#ifndef __PACKVEC_H__
+#define __PACKVEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*PACKED VECTOR*/
+
+/*A read-mostly compressed copy of a Vector, for sorted id lists and other
+ * data whose neighbours are close. Elements are cut into blocks of
+ * PACKED_VECTOR_BLOCK. A block stores its first value, and the differences
+ * between neighbours less their minimum (frame of reference), bit-packed
+ * at the width that minimizes the block size. Differences wider than that
+ * are patched from a list of exceptions (PFOR), so one outlier does not
+ * widen the whole block.
+ *
+ * Values are packed 8 lanes across (value i in lane i % 8), so AVX2 unpacks
+ * 8 at a time with the same shifts; decoding fuses the unpack with the
+ * prefix sum when a block has no exceptions. Any int data round trips
+ * exactly: differences wrap around like unsigned arithmetic.
+ *
+ * The blocks double as skip pointers: `get_index_packed_vector` decodes
+ * only within one block, and for sorted data `lower_bound_packed_vector`
+ * binary searches the first values before decoding one block.
+ *
+ * Usage, streaming the blocks into the Vector kernels:
+ *   PackedVector packed;
+ *   PackedVectorIterator it;
+ *   create_packed_vector(&packed, &ids);
+ *   begin_packed_vector(&it, &packed, 0);
+ *   while (next_packed_vector(&it))
+ *     if (find_value_vector(&it.view, 42) == 42)
+ *       found = true;
+ *   destroy_packed_vector(&packed);*/
+#define PACKED_VECTOR_BLOCK 256
+
+typedef struct {
+  int first;      /*the block's first value*/
+  int min_delta;  /*frame of reference of the differences*/
+  uint32_t words; /*index of the block's first packed word*/
+  uint32_t exceptions; /*index of the block's first exception*/
+  uint16_t exception_count;
+  uint8_t bits; /*packed width, 0 to 32*/
+} PackedBlock;
+
+typedef struct {
+  size_t size;
+  size_t block_count;
+  PackedBlock *blocks;
+  uint32_t *words;
+  uint8_t *exception_positions; /*index within the block*/
+  uint32_t *exception_highs;    /*bits above the packed width*/
+  size_t word_count, exception_count;
+} PackedVector;
+
+/*One decoded block at a time. `view` is a Vector over `buffer` holding the
+ * current block; it is valid until the next call and must not grow.*/
+typedef struct {
+  const PackedVector *packed;
+  size_t block;
+  Vector view;
+  int buffer[PACKED_VECTOR_BLOCK];
+} PackedVectorIterator;
+
+/*Compresses `vector` into `packed`. Returns -1 if memory runs out or the
+ * packed words would not fit 32 bit offsets; `packed` is then empty.*/
+int create_packed_vector(PackedVector *packed, Vector *vector);
+void destroy_packed_vector(PackedVector *packed);
+/*Bytes used by the blocks, words and exceptions.*/
+size_t get_bytes_packed_vector(const PackedVector *packed);
+
+int get_index_packed_vector(const PackedVector *packed, size_t index);
+/*Writes the PACKED_VECTOR_BLOCK values of `block` to `out` (the last block
+ * fills only its elements) and returns how many there are.*/
+size_t decode_block_packed_vector(const PackedVector *packed, size_t block,
+                                  int *out);
+/*Decompresses the whole vector into `dst`, growing it to fit.*/
+int unpack_vector(Vector *dst, const PackedVector *packed);
+
+/*Starts at element `block * PACKED_VECTOR_BLOCK`.*/
+void begin_packed_vector(PackedVectorIterator *it, const PackedVector *packed,
+                         size_t block);
+/*Decodes the next block into `it->view`; false after the last one.*/
+bool next_packed_vector(PackedVectorIterator *it);
+
+long long sum_packed_vector(const PackedVector *packed);
+/*For sorted data: the index of the first element not less than `value`, or
+ * the size if there is none.*/
+size_t lower_bound_packed_vector(const PackedVector *packed, int value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PACKVEC_H__
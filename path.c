@@ -0,0 +1,595 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "path.h"
+
+#include <limits.h>    /*Includes `INT_MAX`, the largest cell number.*/
+#include <stdatomic.h> /*Includes `atomic_int` for errors in batches.*/
+#include <unistd.h>    /*Includes `sysconf` for the online CPU count.*/
+
+/*PATHFINDING*/
+
+#define PATH_NONE UINT32_MAX
+#define PATH_BUCKETS 65 /*radix heap buckets: equal keys, then one per bit*/
+
+/*A cell's search state. It belongs to the current query only when `stamp`
+ * is the query's generation (open) or one more (closed); older stamps read
+ * as unvisited.*/
+typedef struct {
+  uint64_t g;
+  uint32_t parent;
+  uint32_t stamp;
+} PathNode;
+
+typedef struct {
+  uint64_t key;
+  uint32_t node;
+} PathEntry;
+
+typedef struct {
+  PathEntry *items;
+  size_t size, capacity;
+} PathBucket;
+
+struct PathSearch {
+  const PathMap *map;
+  PathNode *nodes;
+  uint32_t generation;
+  ptrdiff_t offsets[8]; /*storage offset of each move*/
+  /*Radix heap: bucket 0 holds keys equal to `last`, bucket b > 0 the keys
+   * whose highest bit differing from `last` is bit b - 1.*/
+  PathBucket buckets[PATH_BUCKETS];
+  uint64_t last;
+  size_t size;
+  bool failed; /*a bucket could not grow*/
+  const int32_t *jumps; /*the JPS+ table when the query uses it*/
+  uint32_t goal;
+  long goal_row, goal_col; /*storage coordinates, halo included*/
+};
+
+/*Move `k` in the order of `grid_neighbor_dr`, from its row and column
+ * deltas.*/
+static int path_direction(int dr, int dc) {
+  int k = (dr + 1) * 3 + dc + 1;
+  return k > 4 ? k - 1 : k;
+}
+
+static long path_abs(long x) { return x < 0 ? -x : x; }
+
+static int path_sign(long x) { return (x > 0) - (x < 0); }
+
+/*Cost of the shortest obstacle free path over a (dr, dc) offset.*/
+static uint64_t octile(long dr, long dc) {
+  uint64_t a = (uint64_t)path_abs(dr), b = (uint64_t)path_abs(dc);
+  return a < b ? a * PATH_DIAGONAL + (b - a) * PATH_STRAIGHT
+               : b * PATH_DIAGONAL + (a - b) * PATH_STRAIGHT;
+}
+
+/*MAP*/
+
+int create_path_map(PathMap *map, const Grid *grid) {
+  size_t r, c;
+  memset(map, 0, sizeof *map);
+  if ((grid->rows + 2) * (grid->cols + 2) >= INT_MAX) {
+    fprintf(stderr, "ERROR: Grid too large for a path map.\n");
+    return -1;
+  }
+  map->rows = grid->rows;
+  map->cols = grid->cols;
+  map->stride = grid->cols + 2;
+  map->open = (uint8_t *)calloc((map->rows + 2) * map->stride, 1);
+  if (map->open == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return -1;
+  }
+  for (r = 0; r < map->rows; r++)
+    for (c = 0; c < map->cols; c++)
+      map->open[(r + 1) * map->stride + c + 1] =
+          get_grid(grid, (long)r, (long)c) >= 0;
+  return 0;
+}
+
+void destroy_path_map(PathMap *map) {
+  free(map->open);
+  free(map->jumps);
+  memset(map, 0, sizeof *map);
+}
+
+/*Whether a straight scan by `step` must stop at `cell`: a cell beside it is
+ * open while the cell behind that one is a wall, so a path may turn there
+ * that no shorter path reaches.*/
+static bool forced_straight(const uint8_t *cell, ptrdiff_t step,
+                            ptrdiff_t side) {
+  return (cell[side] && !cell[side - step]) ||
+         (cell[-side] && !cell[-side - step]);
+}
+
+/*Table entries: n > 0, the scan stops at a jump point n moves away;
+ * n <= 0, it runs -n moves into a wall. Each entry is one more than the next
+ * cell's, so cells are visited against the direction of the move, and the
+ * diagonals, which read the straight entries, come last.*/
+int build_jump_table_path_map(PathMap *map) {
+  size_t cells = (map->rows + 2) * map->stride, first = map->stride;
+  size_t last = cells - map->stride, i;
+  ptrdiff_t stride = (ptrdiff_t)map->stride;
+  int pass, k;
+  free(map->jumps);
+  map->jumps = (int32_t *)calloc(cells * 8, sizeof(int32_t));
+  if (map->jumps == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return -1;
+  }
+  for (pass = 0; pass < 2; pass++)
+    for (k = 0; k < 8; k++) {
+      int dr = grid_neighbor_dr[k], dc = grid_neighbor_dc[k];
+      ptrdiff_t vertical = dr * stride, step = vertical + dc;
+      bool diagonal = dr != 0 && dc != 0;
+      size_t n;
+      if (diagonal != (pass == 1))
+        continue;
+      for (n = first; n < last; n++) {
+        const uint8_t *cell;
+        const int32_t *after;
+        bool stop;
+        i = step > 0 ? last - 1 - (n - first) : n;
+        cell = map->open + i;
+        if (!*cell || !cell[step] ||
+            (diagonal && (!cell[vertical] || !cell[dc])))
+          continue; /*no move: the entry stays 0*/
+        after = map->jumps + (size_t)((ptrdiff_t)i + step) * 8;
+        if (diagonal)
+          stop = after[path_direction(0, dc)] > 0 ||
+                 after[path_direction(dr, 0)] > 0;
+        else
+          stop = forced_straight(cell + step, step, dr != 0 ? 1 : stride);
+        map->jumps[i * 8 + (size_t)k] =
+            stop ? 1 : after[k] > 0 ? after[k] + 1 : after[k] - 1;
+      }
+    }
+  return 0;
+}
+
+/*SEARCH*/
+
+PathSearch *create_path_search(const PathMap *map) {
+  PathSearch *search = (PathSearch *)calloc(1, sizeof(PathSearch));
+  int k;
+  if (search != NULL) {
+    search->nodes = (PathNode *)calloc((map->rows + 2) * map->stride,
+                                       sizeof(PathNode));
+    if (search->nodes == NULL) {
+      free(search);
+      search = NULL;
+    }
+  }
+  if (search == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return NULL;
+  }
+  search->map = map;
+  for (k = 0; k < 8; k++)
+    search->offsets[k] =
+        grid_neighbor_dr[k] * (ptrdiff_t)map->stride + grid_neighbor_dc[k];
+  return search;
+}
+
+void destroy_path_search(PathSearch *search) {
+  int b;
+  if (search == NULL)
+    return;
+  for (b = 0; b < PATH_BUCKETS; b++)
+    free(search->buckets[b].items);
+  free(search->nodes);
+  free(search);
+}
+
+static int bucket_of_path(uint64_t key, uint64_t last) {
+  return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+}
+
+static void add_to_bucket(PathSearch *search, int b, PathEntry entry) {
+  PathBucket *bucket = &search->buckets[b];
+  if (bucket->size == bucket->capacity) {
+    size_t capacity = bucket->capacity > 0 ? bucket->capacity * 2 : 64;
+    PathEntry *items =
+        (PathEntry *)realloc(bucket->items, capacity * sizeof(PathEntry));
+    if (items == NULL) {
+      search->failed = true;
+      return;
+    }
+    bucket->items = items;
+    bucket->capacity = capacity;
+  }
+  bucket->items[bucket->size++] = entry;
+}
+
+/*`key` may not be less than the last key popped.*/
+static void push_heap_path(PathSearch *search, uint64_t key, uint32_t node) {
+  PathEntry entry;
+  entry.key = key;
+  entry.node = node;
+  add_to_bucket(search, bucket_of_path(key, search->last), entry);
+  search->size++;
+}
+
+/*Takes an entry with the smallest key, PATH_NONE if memory runs out. When
+ * bucket 0 is empty, the lowest non-empty bucket's minimum becomes `last` and
+ * its entries move down, each to a lower bucket than before, so an entry
+ * moves at most 64 times.*/
+static uint32_t pop_heap_path(PathSearch *search) {
+  PathBucket *zero = &search->buckets[0];
+  if (zero->size == 0) {
+    PathBucket *bucket = &search->buckets[1];
+    uint64_t min;
+    size_t i;
+    while (bucket->size == 0)
+      bucket++;
+    min = bucket->items[0].key;
+    for (i = 1; i < bucket->size; i++)
+      if (bucket->items[i].key < min)
+        min = bucket->items[i].key;
+    search->last = min;
+    for (i = 0; i < bucket->size; i++)
+      add_to_bucket(search, bucket_of_path(bucket->items[i].key, min),
+                    bucket->items[i]);
+    bucket->size = 0;
+    if (search->failed)
+      return PATH_NONE;
+  }
+  search->size--;
+  return zero->items[--zero->size].node;
+}
+
+/*Offers `node` at (row, col) a path of cost `g` through `parent`.*/
+static void relax_path(PathSearch *search, uint32_t node, uint32_t parent,
+                       uint64_t g, long row, long col) {
+  PathNode *n = &search->nodes[node];
+  if (n->stamp < search->generation ||
+      (n->stamp == search->generation && g < n->g)) {
+    n->stamp = search->generation;
+    n->g = g;
+    n->parent = parent;
+    /*a JPS+ node reads its table entries when expanded, which is often
+     * soon, as equal keys come off the heap last in, first out*/
+    if (search->jumps != NULL)
+      __builtin_prefetch(search->jumps + (size_t)node * 8);
+    push_heap_path(search, g + octile(search->goal_row - row,
+                                      search->goal_col - col),
+                   node);
+  }
+}
+
+static void expand_astar(PathSearch *search, uint32_t node) {
+  const uint8_t *open = search->map->open + node;
+  long stride = (long)search->map->stride;
+  long row = (long)node / stride, col = (long)node % stride;
+  uint64_t g = search->nodes[node].g;
+  int k;
+  for (k = 0; k < 8; k++) {
+    int dr = grid_neighbor_dr[k], dc = grid_neighbor_dc[k];
+    bool diagonal = dr != 0 && dc != 0;
+    if (!open[search->offsets[k]] ||
+        (diagonal && (!open[dr * stride] || !open[dc])))
+      continue;
+    relax_path(search, (uint32_t)((ptrdiff_t)node + search->offsets[k]), node,
+               g + (diagonal ? PATH_DIAGONAL : PATH_STRAIGHT), row + dr,
+               col + dc);
+  }
+}
+
+/*The moves JPS tries from a cell reached by a (dr, dc) move: all of them
+ * from the start; after a diagonal move its two straight parts and itself;
+ * after a straight move the same move, plus a turn to each side where
+ * `forced_straight` holds. Moves into walls are left for the scans to
+ * reject.*/
+static unsigned int jump_moves(const uint8_t *cell, ptrdiff_t stride, int dr,
+                               int dc) {
+  ptrdiff_t step = dr * stride + dc, side = dr != 0 ? 1 : stride;
+  unsigned int moves;
+  int s;
+  if (dr == 0 && dc == 0)
+    return 0xff;
+  moves = 1u << path_direction(dr, dc);
+  if (dr != 0 && dc != 0)
+    return moves | 1u << path_direction(dr, 0) | 1u << path_direction(0, dc);
+  for (s = -1; s <= 1; s += 2)
+    if (cell[s * side] && !cell[s * side - step]) {
+      /*the side is a row step when moving along a row*/
+      int tr = dr != 0 ? dr : s, tc = dc != 0 ? dc : s;
+      moves |= 1u << path_direction(dr != 0 ? 0 : s, dc != 0 ? 0 : s);
+      moves |= 1u << path_direction(tr, tc);
+    }
+  return moves;
+}
+
+/*Scans from `cell` by `step` and returns how many moves it takes to the
+ * first cell where a path may turn or the goal, 0 at a wall.*/
+static long jump_straight(const uint8_t *cell, ptrdiff_t step, ptrdiff_t side,
+                          const uint8_t *goal) {
+  long moves = 0;
+  for (;;) {
+    cell += step;
+    moves++;
+    if (!*cell)
+      return 0;
+    if (cell == goal || forced_straight(cell, step, side))
+      return moves;
+  }
+}
+
+/*Scans diagonally, stopping where either straight part of the move finds
+ * something.*/
+static long jump_diagonal(const uint8_t *cell, ptrdiff_t vertical,
+                          ptrdiff_t horizontal, ptrdiff_t stride,
+                          const uint8_t *goal) {
+  long moves = 0;
+  for (;;) {
+    if (!cell[vertical] || !cell[horizontal] || !cell[vertical + horizontal])
+      return 0;
+    cell += vertical + horizontal;
+    moves++;
+    if (cell == goal || jump_straight(cell, horizontal, stride, goal) != 0 ||
+        jump_straight(cell, vertical, 1, goal) != 0)
+      return moves;
+  }
+}
+
+/*The same scan from the JPS+ table. The table knows nothing of the goal, so
+ * a scan that passes it stops there, and a diagonal scan headed towards it
+ * stops where the goal is straight ahead.*/
+static long jump_table(const PathSearch *search, uint32_t node, int k,
+                       long row, long col) {
+  int dr = grid_neighbor_dr[k], dc = grid_neighbor_dc[k];
+  int32_t moves = search->jumps[(size_t)node * 8 + (size_t)k];
+  long reach = moves > 0 ? moves : -(long)moves;
+  long ahead_r = (search->goal_row - row) * dr;
+  long ahead_c = (search->goal_col - col) * dc;
+  long to_goal = -1;
+  if (dr == 0 && search->goal_row == row)
+    to_goal = ahead_c;
+  else if (dc == 0 && search->goal_col == col)
+    to_goal = ahead_r;
+  else if (dr != 0 && dc != 0 && ahead_r > 0 && ahead_c > 0)
+    to_goal = ahead_r < ahead_c ? ahead_r : ahead_c;
+  if (to_goal > 0 && to_goal <= reach)
+    return to_goal;
+  return moves > 0 ? moves : 0;
+}
+
+static void expand_jump(PathSearch *search, uint32_t node, bool table) {
+  const PathMap *map = search->map;
+  const uint8_t *cell = map->open + node, *goal = map->open + search->goal;
+  long stride = (long)map->stride, row = (long)node / stride;
+  long col = (long)node - row * stride;
+  uint32_t parent = search->nodes[node].parent;
+  long parent_row = (long)parent / stride;
+  uint64_t g = search->nodes[node].g;
+  unsigned int moves = jump_moves(
+      cell, stride, path_sign(row - parent_row),
+      path_sign(col - ((long)parent - parent_row * stride)));
+  int k;
+  for (k = 0; k < 8; k++) {
+    int dr = grid_neighbor_dr[k], dc = grid_neighbor_dc[k];
+    bool diagonal = dr != 0 && dc != 0;
+    long steps;
+    if (!(moves & (1u << k)))
+      continue;
+    if (table)
+      steps = jump_table(search, node, k, row, col);
+    else if (diagonal)
+      steps = jump_diagonal(cell, dr * stride, dc, stride, goal);
+    else
+      steps = jump_straight(cell, search->offsets[k], dr != 0 ? 1 : stride,
+                            goal);
+    if (steps == 0)
+      continue;
+    relax_path(search,
+               (uint32_t)((ptrdiff_t)node + steps * search->offsets[k]), node,
+               g + (uint64_t)steps * (diagonal ? PATH_DIAGONAL : PATH_STRAIGHT),
+               row + steps * dr, col + steps * dc);
+  }
+}
+
+/*Stores the cells from `start` to the goal, filling in the straight and
+ * diagonal runs between jump points.*/
+static int write_path(const PathSearch *search, uint32_t start, Vector *path) {
+  const PathMap *map = search->map;
+  long stride = (long)map->stride, cols = (long)map->cols;
+  size_t length = 1, i;
+  uint32_t node;
+  for (node = search->goal; node != start;) {
+    uint32_t parent = search->nodes[node].parent;
+    long dr = path_abs((long)node / stride - (long)parent / stride);
+    long dc = path_abs((long)node % stride - (long)parent % stride);
+    length += (size_t)(dr > dc ? dr : dc);
+    node = parent;
+  }
+  if (path->capacity < length) {
+    int *arr = (int *)realloc(path->arr, length * sizeof(int));
+    if (arr == NULL) {
+      fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+      return -1;
+    }
+    path->arr = arr;
+    path->capacity = length;
+  }
+  path->size = length;
+  i = length;
+  for (node = search->goal;;) {
+    uint32_t parent = search->nodes[node].parent;
+    long row = (long)node / stride, col = (long)node % stride;
+    int dr = path_sign((long)parent / stride - row);
+    int dc = path_sign((long)parent % stride - col);
+    do {
+      path->arr[--i] = (int)((row - 1) * cols + col - 1);
+      row += dr;
+      col += dc;
+    } while (row * stride + col != (long)parent && node != start);
+    if (node == start)
+      return 0;
+    node = parent;
+  }
+}
+
+int find_path(PathSearch *search, const PathQuery *query, int method,
+              PathResult *result, Vector *path) {
+  const PathMap *map = search->map;
+  long rows = (long)map->rows, cols = (long)map->cols;
+  size_t stride = map->stride;
+  uint32_t start, node;
+  int b;
+  result->found = false;
+  result->cost = 0;
+  result->expanded = 0;
+  if (method != PATH_ASTAR && method != PATH_JPS && method != PATH_JPS_PLUS) {
+    fprintf(stderr, "ERROR: Unknown path method %d.\n", method);
+    return -1;
+  }
+  if (method == PATH_JPS_PLUS && map->jumps == NULL) {
+    fprintf(stderr, "ERROR: PATH_JPS_PLUS needs a jump table.\n");
+    return -1;
+  }
+  if (path != NULL)
+    path->size = 0;
+  if (query->start_row < 0 || query->start_row >= rows ||
+      query->start_col < 0 || query->start_col >= cols ||
+      query->goal_row < 0 || query->goal_row >= rows || query->goal_col < 0 ||
+      query->goal_col >= cols)
+    return 0;
+  start = (uint32_t)((size_t)(query->start_row + 1) * stride +
+                     (size_t)query->start_col + 1);
+  search->goal_row = query->goal_row + 1;
+  search->goal_col = query->goal_col + 1;
+  search->goal = (uint32_t)((size_t)search->goal_row * stride +
+                            (size_t)search->goal_col);
+  if (!map->open[start] || !map->open[search->goal])
+    return 0;
+
+  /*a new generation; on wrap around, forget every stamp*/
+  if (search->generation > UINT32_MAX - 4) {
+    memset(search->nodes, 0,
+           (map->rows + 2) * stride * sizeof(PathNode));
+    search->generation = 0;
+  }
+  search->generation += 2;
+  for (b = 0; b < PATH_BUCKETS; b++)
+    search->buckets[b].size = 0;
+  search->last = 0;
+  search->size = 0;
+  search->failed = false;
+  search->jumps = method == PATH_JPS_PLUS ? map->jumps : NULL;
+
+  relax_path(search, start, start, 0, query->start_row + 1,
+             query->start_col + 1);
+  while (search->size > 0 && !search->failed) {
+    PathNode *n;
+    if ((node = pop_heap_path(search)) == PATH_NONE)
+      break;
+    n = &search->nodes[node];
+    if (n->stamp != search->generation)
+      continue; /*closed by an earlier, cheaper entry*/
+    n->stamp = search->generation + 1;
+    result->expanded++;
+    if (node == search->goal) {
+      result->found = true;
+      result->cost = (double)n->g / PATH_STRAIGHT;
+      break;
+    }
+    if (method == PATH_ASTAR)
+      expand_astar(search, node);
+    else
+      expand_jump(search, node, method == PATH_JPS_PLUS);
+  }
+  if (search->failed) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    result->found = false;
+    return -1;
+  }
+  if (result->found && path != NULL)
+    return write_path(search, start, path);
+  return 0;
+}
+
+/*BATCH*/
+
+typedef struct {
+  const PathQuery *queries;
+  PathResult *results;
+  int method;
+  PathSearch **searches; /*one per pool participant*/
+  ThreadPool *pool;      /*NULL runs on the calling thread*/
+  atomic_int failed;
+} PathBatch;
+
+PathOptions default_path_options(void) {
+  PathOptions options;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  options.threads = cpus > 0 ? (int)cpus : 1;
+  options.pool = NULL;
+  return options;
+}
+
+static void run_queries(size_t begin, size_t end, void *ctx) {
+  PathBatch *batch = (PathBatch *)ctx;
+  int worker = batch->pool != NULL ? get_worker_thread_pool(batch->pool) : 0;
+  size_t i;
+  for (i = begin; i < end; i++)
+    if (find_path(batch->searches[worker], &batch->queries[i], batch->method,
+                  &batch->results[i], NULL) != 0)
+      atomic_store(&batch->failed, 1);
+}
+
+int find_paths(const PathMap *map, const PathQuery *queries, size_t count,
+               int method, PathResult *results, const PathOptions *options) {
+  PathOptions defaults = default_path_options();
+  PathBatch batch;
+  ThreadPool *own = NULL;
+  int workers = 1, t;
+  if (method != PATH_ASTAR && method != PATH_JPS && method != PATH_JPS_PLUS) {
+    fprintf(stderr, "ERROR: Unknown path method %d.\n", method);
+    return -1;
+  }
+  if (method == PATH_JPS_PLUS && map->jumps == NULL) {
+    fprintf(stderr, "ERROR: PATH_JPS_PLUS needs a jump table.\n");
+    return -1;
+  }
+  if (count == 0)
+    return 0;
+  if (options == NULL)
+    options = &defaults;
+
+  batch.queries = queries;
+  batch.results = results;
+  batch.method = method;
+  batch.pool = options->pool;
+  atomic_init(&batch.failed, 0);
+  if (batch.pool == NULL && options->threads > 1 && count > 1) {
+    batch.pool = default_thread_pool();
+    if (batch.pool == NULL ||
+        get_threads_thread_pool(batch.pool) != options->threads)
+      batch.pool = own = create_thread_pool(options->threads);
+  }
+  if (batch.pool != NULL)
+    workers = get_threads_thread_pool(batch.pool);
+  batch.searches = (PathSearch **)calloc((size_t)workers, sizeof(PathSearch *));
+  for (t = 0; batch.searches != NULL && t < workers; t++)
+    if ((batch.searches[t] = create_path_search(map)) == NULL)
+      atomic_store(&batch.failed, 1);
+  if (batch.searches == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    atomic_store(&batch.failed, 1);
+  }
+
+  if (!atomic_load(&batch.failed)) {
+    /*queries vary a lot in cost, so hand them out in small chunks*/
+    size_t grain = count / ((size_t)workers * THREAD_POOL_CHUNKS) + 1;
+    if (batch.pool != NULL)
+      parallel_for(batch.pool, 0, count, grain, run_queries, &batch);
+    else
+      run_queries(0, count, &batch);
+  }
+  for (t = 0; batch.searches != NULL && t < workers; t++)
+    destroy_path_search(batch.searches[t]);
+  free(batch.searches);
+  destroy_thread_pool(own);
+  return atomic_load(&batch.failed) ? -1 : 0;
+}
@@ -0,0 +1,107 @@
+#ifndef __PATH_H__
+#define __PATH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "threadpool.h"
+#include "utils.h"
+
+/*PATHFINDING*/
+
+/*Shortest paths on a static grid with the 8 moves of
+ * `print_matrix_neighbor_coordinates_rules()`. Negative cells are walls.
+ * Straight moves cost 1, diagonal moves sqrt(2), and a diagonal move may not
+ * cut a corner: both cells beside it must be open too. Costs are summed in
+ * fixed point, so every method finds the same optimal cost.
+ *
+ * A PathMap is the read-only part, shared by any number of threads. A
+ * PathSearch is one thread's scratch space: a node record per cell stamped
+ * with the query it belongs to, so nothing is cleared between queries, and
+ * a radix heap, which the consistent octile heuristic keeps monotone.
+ *
+ * Methods:
+ *  - PATH_ASTAR:    A* over the 8 moves.
+ *  - PATH_JPS:      Jump Point Search. Straight runs and diagonals are
+ *                   scanned without touching the heap, which only sees the
+ *                   cells where a path may turn.
+ *  - PATH_JPS_PLUS: JPS reading the scan lengths from a table built once by
+ *                   `build_jump_table_path_map` (8 ints per cell).
+ *
+ * Usage:
+ *   PathMap map;
+ *   PathQuery queries[2] = {{0, 0, 99, 99}, {5, 7, 60, 3}};
+ *   PathResult results[2];
+ *   if (create_path_map(&map, &grid) == 0) {
+ *     find_paths(&map, queries, 2, PATH_JPS, results, NULL);
+ *     destroy_path_map(&map);
+ *   }*/
+#define PATH_STRAIGHT 65536 /*a straight move in fixed point*/
+#define PATH_DIAGONAL 92682 /*a diagonal move, sqrt(2) * PATH_STRAIGHT*/
+
+enum { PATH_ASTAR, PATH_JPS, PATH_JPS_PLUS };
+
+typedef struct {
+  size_t rows, cols;
+  size_t stride;  /*cols + 2: `open` has a one cell halo of walls*/
+  uint8_t *open;  /*1 for open cells, row-major*/
+  int32_t *jumps; /*JPS+ scan lengths, 8 per cell, NULL until built*/
+} PathMap;
+
+typedef struct PathSearch PathSearch;
+
+typedef struct {
+  long start_row, start_col;
+  long goal_row, goal_col;
+} PathQuery;
+
+typedef struct {
+  bool found;
+  double cost;     /*in straight moves, 0 when not found*/
+  size_t expanded; /*nodes taken off the heap*/
+} PathResult;
+
+typedef struct {
+  int threads;      /*worker threads, <= 1 runs on the calling thread*/
+  ThreadPool *pool; /*pool to run on; NULL uses default_thread_pool() when
+                       it has `threads` threads, else a pool for the call*/
+} PathOptions;
+
+/*Reads the walls of `grid`. Returns -1 with an error on stderr if memory
+ * runs out or the grid holds INT_MAX cells or more (halo included).*/
+int create_path_map(PathMap *map, const Grid *grid);
+void destroy_path_map(PathMap *map);
+/*Builds the JPS+ table. Returns -1 if memory runs out.*/
+int build_jump_table_path_map(PathMap *map);
+
+/*Scratch space for queries on `map` from one thread at a time. NULL if
+ * memory runs out.*/
+PathSearch *create_path_search(const PathMap *map);
+void destroy_path_search(PathSearch *search);
+
+/*Answers one query. A start or goal outside the grid or on a wall is not
+ * found. With `path` not NULL, the cells of the path, start and goal
+ * included, are stored in it as `row * cols + col`. Returns -1 with an error
+ * on stderr for an unknown method, PATH_JPS_PLUS without a table, or if
+ * memory runs out.*/
+int find_path(PathSearch *search, const PathQuery *query, int method,
+              PathResult *result, Vector *path);
+
+/*All online CPUs.*/
+PathOptions default_path_options(void);
+/*Answers `count` queries in parallel, one PathSearch per thread. Returns -1
+ * as `find_path` does.*/
+int find_paths(const PathMap *map, const PathQuery *queries, size_t count,
+               int method, PathResult *results, const PathOptions *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PATH_H__
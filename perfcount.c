@@ -0,0 +1,290 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "perfcount.h"
+
+#include <errno.h>
+#include <pthread.h>   /*Includes the keys that close a thread's counters.*/
+#include <stdatomic.h> /*Includes the shared totals of each site.*/
+#include <unistd.h>    /*Includes `read`, `close` and `syscall`.*/
+
+#if defined(__linux__)
+#include <linux/perf_event.h> /*Includes the perf_event_attr layout.*/
+#include <sys/ioctl.h>        /*Includes `ioctl` to enable the group.*/
+#include <sys/syscall.h>      /*Includes `SYS_perf_event_open`.*/
+#endif
+
+/*HARDWARE COUNTERS*/
+
+/*The calling thread's group: -1 before the first use, -2 when unavailable.*/
+static _Thread_local int perf_leader = -1;
+static _Thread_local int perf_fds[PERF_COUNTERS];
+/*Position of each counter in a group read, -1 when it is missing.*/
+static _Thread_local int perf_slots[PERF_COUNTERS];
+static _Thread_local int perf_slot_count;
+/*Why the calling thread's group could not be opened.*/
+static _Thread_local const char *perf_reason = "";
+
+static pthread_key_t perf_key;
+static pthread_once_t perf_once = PTHREAD_ONCE_INIT;
+
+/*Region totals, shared by all threads.*/
+typedef struct {
+  PerfSite *site;
+  atomic_ulong count;
+  atomic_ulong totals[PERF_COUNTERS];
+} PerfTotals;
+
+static pthread_mutex_t perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static PerfTotals perf_totals[PERF_MAX_SITES];
+static atomic_int perf_site_count;
+/*counters seen missing on any thread*/
+static atomic_int perf_missing;
+
+static const char *perf_names[PERF_COUNTERS] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+static void close_perf(void *arg) {
+  int i;
+  (void)arg;
+  for (i = 0; i < PERF_COUNTERS; i++)
+    if (perf_fds[i] >= 0)
+      close(perf_fds[i]);
+}
+
+static void init_perf_key(void) { pthread_key_create(&perf_key, close_perf); }
+
+#if defined(__linux__)
+static int open_counter(uint32_t type, uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group < 0; /*the leader starts the whole group*/
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+/*Opens the calling thread's group; false when no counter can be opened.*/
+static bool open_perf(void) {
+#if defined(__linux__)
+  static const struct {
+    uint32_t type;
+    uint64_t config;
+  } events[PERF_COUNTERS] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  };
+  int i, error = 0;
+  perf_leader = -2;
+  perf_slot_count = 0;
+  for (i = 0; i < PERF_COUNTERS; i++) {
+    int group = perf_leader >= 0 ? perf_leader : -1;
+    perf_fds[i] = open_counter(events[i].type, events[i].config, group);
+    perf_slots[i] = -1;
+    if (perf_fds[i] < 0) {
+      if (error == 0)
+        error = errno;
+      atomic_fetch_or(&perf_missing, 1 << i);
+      continue;
+    }
+    if (perf_leader < 0)
+      perf_leader = perf_fds[i];
+    perf_slots[i] = perf_slot_count++;
+  }
+  if (perf_leader < 0) {
+    perf_reason = error == EACCES || error == EPERM
+                      ? "not permitted (see "
+                        "/proc/sys/kernel/perf_event_paranoid)"
+                  : error == ENOENT || error == EOPNOTSUPP
+                      ? "no hardware counters on this CPU"
+                  : error == ENOSYS ? "perf_event_open is not supported"
+                                    : "perf_event_open failed";
+    return false;
+  }
+  pthread_once(&perf_once, init_perf_key);
+  pthread_setspecific(perf_key, &perf_leader);
+  ioctl(perf_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+#else
+  int i;
+  perf_leader = -2;
+  for (i = 0; i < PERF_COUNTERS; i++)
+    perf_fds[i] = -1;
+  perf_reason = "hardware counters are only read on Linux";
+  return false;
+#endif
+}
+
+bool perf_available(void) {
+  if (perf_leader == -1)
+    open_perf();
+  return perf_leader >= 0;
+}
+
+const char *perf_unavailable_reason(void) {
+  perf_available();
+  return perf_reason;
+}
+
+bool perf_has_counter(int counter) {
+  return perf_available() && counter >= 0 && counter < PERF_COUNTERS &&
+         perf_slots[counter] >= 0;
+}
+
+bool read_perf_counters(PerfSample *sample) {
+  uint64_t data[3 + PERF_COUNTERS];
+  ssize_t expected;
+  int i;
+  if (!perf_available())
+    return false;
+  expected = (ssize_t)((size_t)(3 + perf_slot_count) * sizeof(uint64_t));
+  if (read(perf_leader, data, sizeof data) != expected)
+    return false;
+  /*layout: nr, time enabled, time running, one value per member*/
+  sample->enabled = data[1];
+  sample->running = data[2];
+  for (i = 0; i < PERF_COUNTERS; i++)
+    sample->values[i] = perf_slots[i] >= 0 ? data[3 + perf_slots[i]] : 0;
+  return true;
+}
+
+static int register_perf(PerfSite *site) {
+  int id;
+  pthread_mutex_lock(&perf_mutex);
+  id = __atomic_load_n(&site->id, __ATOMIC_RELAXED);
+  if (id == 0) {
+    int n = atomic_load(&perf_site_count);
+    if (n < PERF_MAX_SITES) {
+      perf_totals[n].site = site;
+      id = n + 1;
+      atomic_store(&perf_site_count, id);
+    } else {
+      fprintf(stderr,
+              "ERROR: More than %d counter sites, %s:%d is not counted.\n",
+              PERF_MAX_SITES, site->file, site->line);
+      id = -1;
+    }
+    __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&perf_mutex);
+  return id;
+}
+
+PerfScope begin_perf(PerfSite *site) {
+  PerfScope scope;
+  scope.site = site;
+  if (!read_perf_counters(&scope.start))
+    scope.site = NULL;
+  return scope;
+}
+
+void end_perf(PerfScope *scope) {
+  PerfSample end;
+  PerfTotals *totals;
+  double scale = 1.0;
+  int id, i;
+  if (scope->site == NULL || !read_perf_counters(&end))
+    return;
+  id = __atomic_load_n(&scope->site->id, __ATOMIC_ACQUIRE);
+  if (id == 0)
+    id = register_perf(scope->site);
+  if (id < 0)
+    return;
+  /*the group ran only part of the time: extrapolate*/
+  if (end.running > scope->start.running &&
+      end.enabled - scope->start.enabled > end.running - scope->start.running)
+    scale = (double)(end.enabled - scope->start.enabled) /
+            (double)(end.running - scope->start.running);
+  totals = &perf_totals[id - 1];
+  for (i = 0; i < PERF_COUNTERS; i++)
+    atomic_fetch_add_explicit(
+        &totals->totals[i],
+        (unsigned long)((double)(end.values[i] - scope->start.values[i]) *
+                        scale),
+        memory_order_relaxed);
+  atomic_fetch_add_explicit(&totals->count, 1, memory_order_relaxed);
+}
+
+int collect_perf_counters(PerfReport *reports, int max) {
+  int sites = atomic_load(&perf_site_count);
+  int missing = atomic_load(&perf_missing);
+  int i, c, n = 0;
+  for (i = 0; i < sites && n < max; i++) {
+    PerfReport *r = &reports[n];
+    r->count = atomic_load(&perf_totals[i].count);
+    if (r->count == 0)
+      continue;
+    r->name = perf_totals[i].site->name;
+    r->file = perf_totals[i].site->file;
+    r->line = perf_totals[i].site->line;
+    for (c = 0; c < PERF_COUNTERS; c++)
+      r->totals[c] = missing & (1 << c)
+                         ? -1.0
+                         : (double)atomic_load(&perf_totals[i].totals[c]);
+    n++;
+  }
+  return n;
+}
+
+/*Per call value of a counter, or "-" when it is missing.*/
+static const char *per_call(const PerfReport *r, int counter, char *out,
+                            size_t size) {
+  if (r->totals[counter] < 0)
+    snprintf(out, size, "%9s", "-");
+  else
+    snprintf(out, size, "%9.0f", r->totals[counter] / (double)r->count);
+  return out;
+}
+
+void report_perf_counters(void) {
+  PerfReport reports[PERF_MAX_SITES];
+  char a[32], b[32], c[32], d[32], e[32];
+  int i, n;
+  if (!perf_available()) {
+    color_print(YELLOW, "", "", "hardware counters unavailable: %s\n",
+                perf_unavailable_reason());
+    return;
+  }
+  n = collect_perf_counters(reports, PERF_MAX_SITES);
+  for (i = 0; i < n; i++) {
+    PerfReport *r = &reports[i];
+    double ipc = r->totals[PERF_CYCLES] > 0 && r->totals[PERF_INSTRUCTIONS] >= 0
+                     ? r->totals[PERF_INSTRUCTIONS] / r->totals[PERF_CYCLES]
+                     : 0;
+    color_print(CYAN, "", BOLD, "%-24s", r->name);
+    color_print(MAGENTA, "", "", " %s:%d", r->file, r->line);
+    printf("\n  n %-10llu %s: %s  %s: %s  IPC ", (unsigned long long)r->count,
+           perf_names[PERF_CYCLES], per_call(r, PERF_CYCLES, a, sizeof a),
+           perf_names[PERF_INSTRUCTIONS],
+           per_call(r, PERF_INSTRUCTIONS, b, sizeof b));
+    color_print(GREEN, "", "", "%5.2f", ipc);
+    printf("  %s: %s", perf_names[PERF_L1D_MISSES],
+           per_call(r, PERF_L1D_MISSES, c, sizeof c));
+    printf("  %s: ", perf_names[PERF_LLC_MISSES]);
+    color_print(YELLOW, "", "", "%s",
+                per_call(r, PERF_LLC_MISSES, d, sizeof d));
+    printf("  %s: ", perf_names[PERF_BRANCH_MISSES]);
+    color_print(RED, "", "", "%s",
+                per_call(r, PERF_BRANCH_MISSES, e, sizeof e));
+    printf("  (per call)\n");
+  }
+}
+
+void reset_perf_counters(void) {
+  int sites = atomic_load(&perf_site_count), i, c;
+  for (i = 0; i < sites; i++) {
+    atomic_store(&perf_totals[i].count, 0);
+    for (c = 0; c < PERF_COUNTERS; c++)
+      atomic_store(&perf_totals[i].totals[c], 0);
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef __PERFCOUNT_H__
+#define __PERFCOUNT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*HARDWARE COUNTERS*/
+
+/*Cycles, instructions, L1 data cache read misses, last level cache misses and
+ * branch misses around a region, read with perf_event_open(2). The counters
+ * of each thread are opened once as one group (scheduled together, so the
+ * ratios are consistent) and stay enabled; a region costs two read(2) calls.
+ * Counts are scaled when the kernel multiplexes the group.
+ *
+ * Where counters are not permitted (perf_event_paranoid, containers without
+ * CAP_PERFMON, virtual machines without a PMU, or not Linux) regions cost
+ * nothing and the report says why. A counter the CPU lacks is left out.
+ *
+ * Usage:
+ *   {
+ *     PERF_SCOPE("rotate");
+ *     right_rotate_n_times_vector(&v, 1000);
+ *   }
+ *   report_perf_counters();*/
+enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_COUNTERS
+};
+
+#define PERF_MAX_SITES 64
+
+typedef struct {
+  uint64_t values[PERF_COUNTERS];
+  /*enabled and running nanoseconds of the group, for multiplex scaling*/
+  uint64_t enabled, running;
+} PerfSample;
+
+typedef struct {
+  const char *name;
+  const char *file;
+  int line;
+  int id; /*0 until first use; read with __atomic builtins*/
+} PerfSite;
+
+typedef struct {
+  PerfSite *site;
+  PerfSample start;
+} PerfScope;
+
+#define PERF_SITE_INIT(name) {(name), __FILE__, __LINE__, 0}
+
+/*Whether the calling thread's counters could be opened. The first call per
+ * thread opens them.*/
+bool perf_available(void);
+/*Why the calling thread's counters are unavailable, or "" when they are.*/
+const char *perf_unavailable_reason(void);
+/*Whether counter `counter` is part of the calling thread's group.*/
+bool perf_has_counter(int counter);
+
+/*Reads the calling thread's counters; false when unavailable.*/
+bool read_perf_counters(PerfSample *sample);
+
+PerfScope begin_perf(PerfSite *site);
+void end_perf(PerfScope *scope);
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+
+/*Counts until the enclosing block exits.*/
+#define PERF_SCOPE(name)                                                       \
+  static PerfSite PERF_CONCAT(perf_site_, __LINE__) = PERF_SITE_INIT(name);    \
+  PerfScope PERF_CONCAT(perf_scope_, __LINE__)                                 \
+      __attribute__((cleanup(end_perf))) =                                     \
+          begin_perf(&PERF_CONCAT(perf_site_, __LINE__))
+
+#define PERF_BEGIN(var, name)                                                  \
+  static PerfSite var##_perf_site = PERF_SITE_INIT(name);                      \
+  PerfScope var = begin_perf(&var##_perf_site)
+#define PERF_END(var) end_perf(&var)
+
+/*Per region totals, summed over threads.*/
+typedef struct {
+  const char *name;
+  const char *file;
+  int line;
+  uint64_t count;
+  double totals[PERF_COUNTERS]; /*negative for counters that were missing*/
+} PerfReport;
+
+int collect_perf_counters(PerfReport *reports, int max);
+/*Prints one line per region in the layout of `report_timers`: calls, then
+ * per call cycles, instructions, IPC and misses.*/
+void report_perf_counters(void);
+void reset_perf_counters(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PERFCOUNT_H__
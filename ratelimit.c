@@ -0,0 +1,148 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "ratelimit.h"
+
+#include <pthread.h> /*Includes the mutex over the site list.*/
+#include <time.h>    /*Includes `clock_gettime` for the token bucket.*/
+
+/*RATE LIMITED DEBUG OUTPUT*/
+
+bool rate_limit_enabled = true;
+
+/*The mutex guards the site list and the `last`, `reported` and `next_site`
+ * fields of every site. It is only taken to list a site and to print.*/
+static pthread_mutex_t rate_limit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static RateLimitSite *rate_limit_sites;
+static uint64_t rate_limit_interval = 10000000000u; /*ns, 0 is off*/
+static uint64_t rate_limit_next_report;             /*ns, 0 until first use*/
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void set_rate_limit_enabled(bool enabled) {
+  __atomic_store_n(&rate_limit_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+void set_rate_limit_interval(double seconds) {
+  uint64_t interval = seconds > 0 ? (uint64_t)(seconds * 1e9) : 0;
+  __atomic_store_n(&rate_limit_interval, interval, __ATOMIC_RELAXED);
+  /*off never comes due, so token bucket calls do not poll*/
+  __atomic_store_n(&rate_limit_next_report, interval > 0 ? 0 : UINT64_MAX,
+                   __ATOMIC_RELAXED);
+}
+
+/*Adds `site` to the list once. The mutex must be held.*/
+static void list_site(RateLimitSite *site) {
+  if (site->registered)
+    return;
+  site->registered = true;
+  site->next_site = rate_limit_sites;
+  rate_limit_sites = site;
+}
+
+void register_rate_limit(RateLimitSite *site) {
+  pthread_mutex_lock(&rate_limit_mutex);
+  list_site(site);
+  pthread_mutex_unlock(&rate_limit_mutex);
+}
+
+void poll_rate_limits(uint64_t now) {
+  uint64_t interval = __atomic_load_n(&rate_limit_interval, __ATOMIC_RELAXED);
+  uint64_t next = __atomic_load_n(&rate_limit_next_report, __ATOMIC_RELAXED);
+  if (interval == 0)
+    return;
+  if (now == 0)
+    now = now_ns();
+  /*the first poll starts the clock; of the threads that see the interval
+   * pass, the one that moves the time on prints*/
+  if (next == 0) {
+    __atomic_compare_exchange_n(&rate_limit_next_report, &next,
+                                now + interval, false, __ATOMIC_RELAXED,
+                                __ATOMIC_RELAXED);
+    return;
+  }
+  if (now < next ||
+      !__atomic_compare_exchange_n(&rate_limit_next_report, &next,
+                                   now + interval, false, __ATOMIC_RELAXED,
+                                   __ATOMIC_RELAXED))
+    return;
+  report_rate_limits();
+}
+
+/*The bucket is kept as a single "theoretical arrival time" (GCRA): a call is
+ * allowed when that time is at most `burst` intervals ahead of now, and
+ * allowing it pushes the time one interval further. A suppressed call only
+ * loads it; allowed calls, at most `per_second` of them, write it.*/
+bool token_rate_limit(RateLimitSite *site, double per_second,
+                      unsigned int burst) {
+  uint64_t interval, now, next, start;
+  if (!__atomic_load_n(&rate_limit_enabled, __ATOMIC_RELAXED))
+    return false;
+  if (__atomic_fetch_add(&site->calls, 1, __ATOMIC_RELAXED) == 0)
+    register_rate_limit(site);
+  if (per_second <= 0)
+    return false;
+  interval = (uint64_t)(1e9 / per_second);
+  now = now_ns();
+  next = __atomic_load_n(&site->next, __ATOMIC_RELAXED);
+  do {
+    start = next > now ? next : now;
+    if (start - now > (uint64_t)(burst > 0 ? burst - 1 : 0) * interval) {
+      if (now >= __atomic_load_n(&rate_limit_next_report, __ATOMIC_RELAXED))
+        poll_rate_limits(now);
+      return false;
+    }
+  } while (!__atomic_compare_exchange_n(&site->next, &next, start + interval,
+                                        true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED));
+  return true;
+}
+
+void emit_rate_limited(RateLimitSite *site, const char *str, int line,
+                       const char *file) {
+  unsigned long calls, suppressed;
+  pthread_mutex_lock(&rate_limit_mutex);
+  list_site(site);
+  calls = __atomic_load_n(&site->calls, __ATOMIC_RELAXED);
+  suppressed = calls > site->last + 1 ? calls - site->last - 1 : 0;
+  site->last = calls;
+  __atomic_fetch_add(&site->printed, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&rate_limit_mutex);
+  if (use_color())
+    printf("F: " CYAN "%s" RESET " L: " MAGENTA "%d" RESET " O: %s", file,
+           line, str);
+  else
+    printf("F: %s L: %d O: %s", file, line, str);
+  if (suppressed > 0)
+    printf(" (%lu suppressed)", suppressed);
+  putchar('\n');
+  poll_rate_limits(0);
+}
+
+int report_rate_limits(void) {
+  RateLimitSite *site;
+  int sites = 0;
+  pthread_mutex_lock(&rate_limit_mutex);
+  for (site = rate_limit_sites; site != NULL; site = site->next_site) {
+    unsigned long calls = __atomic_load_n(&site->calls, __ATOMIC_RELAXED);
+    unsigned long printed = __atomic_load_n(&site->printed, __ATOMIC_RELAXED);
+    unsigned long suppressed = calls > printed ? calls - printed : 0;
+    unsigned long reported = site->reported;
+    if (suppressed <= reported)
+      continue;
+    site->reported = suppressed;
+    sites++;
+    if (use_color())
+      printf("F: " CYAN "%s" RESET " L: " MAGENTA "%d" RESET
+             " O: %lu calls suppressed, %lu since the last report\n",
+             site->file, site->line, suppressed, suppressed - reported);
+    else
+      printf("F: %s L: %d O: %lu calls suppressed, %lu since the last report\n",
+             site->file, site->line, suppressed, suppressed - reported);
+  }
+  pthread_mutex_unlock(&rate_limit_mutex);
+  return sites;
+}
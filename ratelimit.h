@@ -0,0 +1,110 @@
+#ifndef __RATELIMIT_H__
+#define __RATELIMIT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*RATE LIMITED DEBUG OUTPUT*/
+
+/*`debug_puts` for hot loops. Every call site gets a static RateLimitSite and
+ * one of two policies:
+ *  - DEBUG_PUTS_SAMPLED(str, first, every): the first `first` calls of the
+ *    site print, then one call in `every` (0 prints nothing more), counted
+ *    over all threads.
+ *  - DEBUG_PUTS_RATE(str, per_second, burst): a token bucket of `burst`
+ *    messages refilled at `per_second`, shared by all threads.
+ * A suppressed call costs one relaxed atomic fetch-add on the site's call
+ * counter, plus for the token bucket a clock read and a load of the time the
+ * next call is allowed. With `set_rate_limit_enabled(false)` a call is one
+ * relaxed atomic load.
+ *
+ * A printed line ends with the number of calls suppressed since the site's
+ * previous line. Every `set_rate_limit_interval` seconds (10 by default) the
+ * next rate limited call that prints, and every 4096th call of a sampled site
+ * or any call of a token bucket site otherwise, also prints the summary of
+ * `report_rate_limits`, so sites that print nothing more still report.
+ *
+ * The fields are plain and accessed with __atomic builtins, so the header
+ * also compiles as C++.*/
+#define RATE_LIMIT_POLL 4096 /*sampled calls between looks at the clock*/
+
+typedef struct RateLimitSite {
+  unsigned long calls;   /*every call of every thread*/
+  uint64_t next;         /*token bucket: time the next call is allowed, ns*/
+  unsigned long printed; /*lines printed*/
+  unsigned long last;    /*calls at the previous printed line*/
+  unsigned long reported; /*suppressed calls already reported*/
+  bool registered;        /*listed for `report_rate_limits`*/
+  const char *file;
+  int line;
+  struct RateLimitSite *next_site;
+} RateLimitSite;
+
+/*A site for the calling file and line.*/
+#define RATE_LIMIT_SITE_INIT {0, 0, 0, 0, 0, false, __FILE__, __LINE__, NULL}
+
+extern bool rate_limit_enabled;
+
+void set_rate_limit_enabled(bool enabled);
+/*Seconds between the periodic summaries, 0 turns them off.*/
+void set_rate_limit_interval(double seconds);
+
+/*Lists `site` for the reports; called by the first call of the site.*/
+void register_rate_limit(RateLimitSite *site);
+/*Prints the summary if the interval has passed at `now` (ns, 0 reads the
+ * clock).*/
+void poll_rate_limits(uint64_t now);
+
+/*The policies, usable on their own to guard any statement. A true return
+ * must be followed by `emit_rate_limited` (the macros below do that).*/
+static inline bool sample_rate_limit(RateLimitSite *site, unsigned long first,
+                                     unsigned long every) {
+  unsigned long n;
+  if (!__atomic_load_n(&rate_limit_enabled, __ATOMIC_RELAXED))
+    return false;
+  n = __atomic_fetch_add(&site->calls, 1, __ATOMIC_RELAXED);
+  if (n < first || (every != 0 && (n - first) % every == 0))
+    return true;
+  if (n == 0)
+    register_rate_limit(site);
+  else if (n % RATE_LIMIT_POLL == 0)
+    poll_rate_limits(0);
+  return false;
+}
+bool token_rate_limit(RateLimitSite *site, double per_second,
+                      unsigned int burst);
+
+/*Prints `str` like `debug_puts` with the suppressed count, then the summary
+ * if it is due.*/
+void emit_rate_limited(RateLimitSite *site, const char *str, int line,
+                       const char *file);
+
+/*Prints one line per site that suppressed calls since the last report, with
+ * its total, and returns the number of such sites.*/
+int report_rate_limits(void);
+
+#define DEBUG_PUTS_SAMPLED(str, first, every)                                  \
+  do {                                                                         \
+    static RateLimitSite rate_limit_site_ = RATE_LIMIT_SITE_INIT;              \
+    if (sample_rate_limit(&rate_limit_site_, (first), (every)))                \
+      emit_rate_limited(&rate_limit_site_, (str), __LINE__, __FILE__);         \
+  } while (0)
+
+#define DEBUG_PUTS_RATE(str, per_second, burst)                                \
+  do {                                                                         \
+    static RateLimitSite rate_limit_site_ = RATE_LIMIT_SITE_INIT;              \
+    if (token_rate_limit(&rate_limit_site_, (per_second), (burst)))            \
+      emit_rate_limited(&rate_limit_site_, (str), __LINE__, __FILE__);         \
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RATELIMIT_H__
@@ -0,0 +1,120 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "searchvec.h"
+
+/*SEARCH INDEX*/
+
+/*Places sorted[i..] at the nodes of the subtree under `k`, in order, and
+ * returns the next unused position.*/
+static size_t fill_subtree(SearchIndex *index, const int *sorted, size_t i,
+                           size_t k) {
+  if (k <= index->size) {
+    i = fill_subtree(index, sorted, i, 2 * k);
+    index->keys[k] = sorted[i];
+    index->ranks[k] = (uint32_t)i;
+    i = fill_subtree(index, sorted, i + 1, 2 * k + 1);
+  }
+  return i;
+}
+
+int create_search_index(SearchIndex *index, Vector *sorted) {
+  size_t n = sorted->size, i, bytes;
+  memset(index, 0, sizeof *index);
+  for (i = 1; i < n; i++)
+    if (sorted->arr[i - 1] > sorted->arr[i]) {
+      fprintf(stderr, "ERROR: Search index built from an unsorted vector.\n");
+      return -1;
+    }
+  if (n >= UINT32_MAX) {
+    fprintf(stderr, "ERROR: Search index over 2^32 elements.\n");
+    return -1;
+  }
+  /*aligned, so the 16 nodes four levels below a node share a cache line*/
+  bytes = ((n + 1) * sizeof(int) + 63) / 64 * 64;
+  index->keys = (int *)aligned_alloc(64, bytes);
+  index->ranks = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+  if (index->keys == NULL || index->ranks == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    destroy_search_index(index);
+    return -1;
+  }
+  index->size = n;
+  index->keys[0] = 0;
+  index->ranks[0] = (uint32_t)n;
+  fill_subtree(index, sorted->arr, 0, 1);
+  while (((size_t)2 << index->levels) <= n + 1)
+    index->levels++;
+  return 0;
+}
+
+void destroy_search_index(SearchIndex *index) {
+  free(index->keys);
+  free(index->ranks);
+  memset(index, 0, sizeof *index);
+}
+
+/*One step down from node `k`: to 2k when keys[k] >= value, else 2k + 1.*/
+#define SEARCH_STEP(keys, k, value) (2 * (k) + (size_t)((keys)[k] < (value)))
+
+/*The node of the first key not less than `value`, 0 for none. The descent
+ * leaves the tree after a run of right turns (1 bits) past the answer and
+ * one left turn (0 bit), which the final shift undoes.*/
+static inline size_t finish_search(const SearchIndex *index, size_t k,
+                                   int value) {
+  /*the last level is partial: step only from nodes that exist*/
+  size_t at = k <= index->size ? k : 0;
+  k = k <= index->size ? SEARCH_STEP(index->keys, at, value) : k;
+  return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+}
+
+static size_t search_node(const SearchIndex *index, int value) {
+  const int *keys = index->keys;
+  size_t k = 1;
+  unsigned int level;
+  for (level = 0; level < index->levels; level++) {
+    __builtin_prefetch(keys + 16 * k); /*never faults, even past the end*/
+    k = SEARCH_STEP(keys, k, value);
+  }
+  return finish_search(index, k, value);
+}
+
+size_t lower_bound_search_index(const SearchIndex *index, int value) {
+  return index->ranks[search_node(index, value)];
+}
+
+size_t find_search_index(const SearchIndex *index, int value) {
+  size_t k = search_node(index, value);
+  return k != 0 && index->keys[k] == value ? index->ranks[k] : index->size;
+}
+
+/*SEARCH_INDEX_BATCH searches descending together, one level at a time.*/
+static void search_batch(const SearchIndex *index, const int *values,
+                         size_t *positions) {
+  const int *keys = index->keys;
+  size_t k[SEARCH_INDEX_BATCH];
+  unsigned int level;
+  int j;
+  for (j = 0; j < SEARCH_INDEX_BATCH; j++)
+    k[j] = 1;
+  for (level = 0; level < index->levels; level++)
+    for (j = 0; j < SEARCH_INDEX_BATCH; j++) {
+      __builtin_prefetch(keys + 16 * k[j]);
+      k[j] = SEARCH_STEP(keys, k[j], values[j]);
+    }
+  for (j = 0; j < SEARCH_INDEX_BATCH; j++) {
+    k[j] = finish_search(index, k[j], values[j]);
+    __builtin_prefetch(index->ranks + k[j]);
+  }
+  for (j = 0; j < SEARCH_INDEX_BATCH; j++)
+    positions[j] = index->ranks[k[j]];
+}
+
+void lower_bound_batch_search_index(const SearchIndex *index,
+                                    const int *values, size_t count,
+                                    size_t *positions) {
+  size_t i = 0;
+  for (; i + SEARCH_INDEX_BATCH <= count; i += SEARCH_INDEX_BATCH)
+    search_batch(index, values + i, positions + i);
+  for (; i < count; i++)
+    positions[i] = lower_bound_search_index(index, values[i]);
+}
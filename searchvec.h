@@ -0,0 +1,70 @@
+#ifndef __SEARCHVEC_H__
+#define __SEARCHVEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*SEARCH INDEX*/
+
+/*A read-only copy of a sorted Vector laid out for searching. Binary search
+ * over a large array misses the cache at nearly every step, and each step
+ * waits for the one before. The index stores the keys in Eytzinger order,
+ * the breadth-first order of the implicit search tree: node k has children
+ * 2k and 2k + 1, so the top levels, which every search visits, share a few
+ * cache lines, and the 16 great-grandchildren of a node (four levels down)
+ * are one aligned cache line that the search prefetches while it works on
+ * the levels between.
+ *
+ * The descent is branchless: the next node is computed from a comparison,
+ * so there is nothing to mispredict. Every search runs the same number of
+ * steps, which lets `lower_bound_batch_search_index` advance
+ * SEARCH_INDEX_BATCH queries a level at a time, keeping that many cache
+ * misses in flight instead of one.
+ *
+ * Results are positions in the sorted Vector, as with a binary search over
+ * it.
+ *
+ * Usage:
+ *   SearchIndex index;
+ *   if (create_search_index(&index, &sorted_ids) == 0) {
+ *     lower_bound_batch_search_index(&index, queries, count, positions);
+ *     destroy_search_index(&index);
+ *   }*/
+#define SEARCH_INDEX_BATCH 16 /*queries in flight per batch*/
+
+typedef struct {
+  size_t size;
+  int *keys;       /*keys[1..size] in Eytzinger order, keys[0] unused*/
+  uint32_t *ranks; /*position in the sorted Vector of each node; ranks[0]
+                      is `size`, the answer when no key is large enough*/
+  unsigned int levels; /*full levels of the tree*/
+} SearchIndex;
+
+/*Builds the index from `sorted`, which must be in non-decreasing order.
+ * Returns -1 with an error on stderr if it is not, if it has 2^32 or more
+ * elements, or if memory runs out.*/
+int create_search_index(SearchIndex *index, Vector *sorted);
+void destroy_search_index(SearchIndex *index);
+
+/*The position of the first element not less than `value`, or the size if
+ * there is none.*/
+size_t lower_bound_search_index(const SearchIndex *index, int value);
+/*The position of an element equal to `value`, or the size.*/
+size_t find_search_index(const SearchIndex *index, int value);
+/*`lower_bound_search_index` of every value, SEARCH_INDEX_BATCH at a
+ * time.*/
+void lower_bound_batch_search_index(const SearchIndex *index,
+                                    const int *values, size_t count,
+                                    size_t *positions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SEARCHVEC_H__
@@ -0,0 +1,32 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+/*SIMD DISPATCH*/
+
+/*Where the AVX2 kernels come from:
+ *  - built with -mavx2 or -march=x86-64-v3/native: always used;
+ *  - built with -DUTILS_FMV on x86 (the release default): compiled as
+ *    separate target("avx2") functions and chosen at run time when the CPU
+ *    has AVX2, so one binary serves old and new machines;
+ *  - otherwise only the scalar (or NEON) paths exist.
+ * Kernels are written as `static SIMD_AVX2_TARGET` functions guarded by
+ * `#if SIMD_AVX2` and called when `simd_has_avx2()`.*/
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#define SIMD_AVX2_TARGET
+#define simd_has_avx2() 1
+#elif defined(UTILS_FMV) && (defined(__x86_64__) || defined(__i386__)) &&    \
+    defined(__GNUC__)
+#define SIMD_AVX2 1
+#define SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#define simd_has_avx2() __builtin_cpu_supports("avx2")
+#else
+#define SIMD_AVX2 0
+#define simd_has_avx2() 0
+#endif
+
+#if SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#endif // __SIMD_H__
@@ -0,0 +1,210 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "snapvec.h"
+
+#include <sched.h> /*Includes `sched_yield` for writers waiting on readers.*/
+
+/*SNAPSHOT VECTOR*/
+
+/*A replaced version, freed once no reader is older than `epoch`.*/
+struct SnapshotRetired {
+  Vector *version;
+  size_t epoch;
+  SnapshotRetired *next;
+};
+
+/*A heap copy of `source` with room for `capacity` elements.*/
+static Vector *copy_version(Vector *source, size_t capacity) {
+  Vector *version = (Vector *)malloc(sizeof(Vector));
+  size_t size = source != NULL ? source->size : 0;
+  if (version != NULL) {
+    version->size = size;
+    version->capacity = capacity > size ? capacity : size;
+    version->arr = (int *)malloc(
+        (version->capacity > 0 ? version->capacity : 1) * sizeof(int));
+    if (version->arr == NULL) {
+      free(version);
+      version = NULL;
+    } else if (size > 0) {
+      memcpy(version->arr, source->arr, size * sizeof(int));
+    }
+  }
+  if (version == NULL)
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+  return version;
+}
+
+static void free_version(Vector *version) {
+  free(version->arr);
+  free(version);
+}
+
+int create_snapshot_vector(SnapshotVector *vector, Vector *initial) {
+  Vector *version = copy_version(initial, 0);
+  int i;
+  if (version == NULL)
+    return -1;
+  memset(vector, 0, sizeof *vector);
+  vector->current = version;
+  pthread_mutex_init(&vector->lock, NULL);
+  for (i = 0; i < SNAPSHOT_VECTOR_READERS; i++)
+    vector->readers[i].epoch = SNAPSHOT_VECTOR_OFFLINE;
+  return 0;
+}
+
+void destroy_snapshot_vector(SnapshotVector *vector) {
+  SnapshotRetired *node = vector->retired;
+  while (node != NULL) {
+    SnapshotRetired *next = node->next;
+    free_version(node->version);
+    free(node);
+    node = next;
+  }
+  free_version(vector->current);
+  pthread_mutex_destroy(&vector->lock);
+  memset(vector, 0, sizeof *vector);
+}
+
+int register_snapshot_vector(SnapshotVector *vector) {
+  int i;
+  for (i = 0; i < SNAPSHOT_VECTOR_READERS; i++) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&vector->readers[i].used, &expected, 1,
+                                    false, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_SEQ_CST)) {
+      online_snapshot_vector(vector, i);
+      return i;
+    }
+  }
+  fprintf(stderr, "ERROR: More than %d snapshot vector readers.\n",
+          SNAPSHOT_VECTOR_READERS);
+  return -1;
+}
+
+void unregister_snapshot_vector(SnapshotVector *vector, int reader) {
+  offline_snapshot_vector(vector, reader);
+  __atomic_store_n(&vector->readers[reader].used, 0, __ATOMIC_RELEASE);
+}
+
+void offline_snapshot_vector(SnapshotVector *vector, int reader) {
+  __atomic_store_n(&vector->readers[reader].epoch, SNAPSHOT_VECTOR_OFFLINE,
+                   __ATOMIC_RELEASE);
+}
+
+void online_snapshot_vector(SnapshotVector *vector, int reader) {
+  quiescent_snapshot_vector(vector, reader);
+  /*pairs with the fence in `publish_locked`: either the writer sees this
+   * reader online, or the reader's next load sees the new version*/
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*The oldest epoch an online reader may still be in.*/
+static size_t oldest_reader(SnapshotVector *vector) {
+  size_t oldest = SNAPSHOT_VECTOR_OFFLINE;
+  int i;
+  for (i = 0; i < SNAPSHOT_VECTOR_READERS; i++) {
+    size_t epoch =
+        __atomic_load_n(&vector->readers[i].epoch, __ATOMIC_ACQUIRE);
+    if (epoch < oldest)
+      oldest = epoch;
+  }
+  return oldest;
+}
+
+/*Frees the versions retired at or before the oldest reader's epoch. The
+ * list is newest first, so they are a suffix of it.*/
+static void reclaim_locked(SnapshotVector *vector) {
+  size_t oldest = oldest_reader(vector);
+  SnapshotRetired **link = &vector->retired;
+  while (*link != NULL && (*link)->epoch > oldest)
+    link = &(*link)->next;
+  while (*link != NULL) {
+    SnapshotRetired *node = *link;
+    *link = node->next;
+    free_version(node->version);
+    free(node);
+    vector->retired_count--;
+  }
+}
+
+/*Waits for the readers until fewer than `limit` versions are retired.*/
+static void wait_locked(SnapshotVector *vector, size_t limit) {
+  reclaim_locked(vector);
+  while (vector->retired_count >= limit && vector->retired_count > 0) {
+    sched_yield();
+    reclaim_locked(vector);
+  }
+}
+
+static int publish_locked(SnapshotVector *vector, Vector *version) {
+  SnapshotRetired *node = (SnapshotRetired *)malloc(sizeof *node);
+  size_t epoch;
+  if (node == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  node->version = __atomic_load_n(&vector->current, __ATOMIC_RELAXED);
+  __atomic_store_n(&vector->current, version, __ATOMIC_RELEASE);
+  epoch = __atomic_load_n(&vector->epoch, __ATOMIC_RELAXED) + 1;
+  __atomic_store_n(&vector->epoch, epoch, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  node->epoch = epoch;
+  node->next = vector->retired;
+  vector->retired = node;
+  vector->retired_count++;
+  wait_locked(vector, SNAPSHOT_VECTOR_PENDING);
+  return 0;
+}
+
+int publish_snapshot_vector(SnapshotVector *vector, Vector *next) {
+  Vector *version = (Vector *)malloc(sizeof(Vector));
+  int status;
+  if (version == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  *version = *next;
+  pthread_mutex_lock(&vector->lock);
+  status = publish_locked(vector, version);
+  pthread_mutex_unlock(&vector->lock);
+  if (status != 0) {
+    free(version);
+    return -1;
+  }
+  next->arr = NULL;
+  next->size = 0;
+  next->capacity = 0;
+  return 0;
+}
+
+int update_snapshot_vector(SnapshotVector *vector, SnapshotUpdate fn,
+                           void *ctx) {
+  Vector *current, *copy;
+  int status;
+  pthread_mutex_lock(&vector->lock);
+  current = __atomic_load_n(&vector->current, __ATOMIC_RELAXED);
+  /*room to grow a little without reallocating*/
+  copy = copy_version(current, current->size + current->size / 2 + 16);
+  status = copy == NULL ? -1 : fn(copy, ctx);
+  if (status == 0)
+    status = publish_locked(vector, copy);
+  if (status != 0 && copy != NULL)
+    free_version(copy);
+  pthread_mutex_unlock(&vector->lock);
+  return status;
+}
+
+size_t reclaim_snapshot_vector(SnapshotVector *vector) {
+  size_t remaining;
+  pthread_mutex_lock(&vector->lock);
+  reclaim_locked(vector);
+  remaining = vector->retired_count;
+  pthread_mutex_unlock(&vector->lock);
+  return remaining;
+}
+
+void synchronize_snapshot_vector(SnapshotVector *vector) {
+  pthread_mutex_lock(&vector->lock);
+  wait_locked(vector, 1);
+  pthread_mutex_unlock(&vector->lock);
+}
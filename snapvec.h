@@ -0,0 +1,113 @@
+#ifndef __SNAPVEC_H__
+#define __SNAPVEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+/*SNAPSHOT VECTOR*/
+
+/*A Vector published read-copy-update style, for tables that every thread
+ * reads and that change rarely. Readers get the current version with one
+ * acquire load and no lock; a writer copies the version, changes the copy
+ * and swaps it in. A replaced version is freed only once every registered
+ * reader has passed a quiescent point after the swap (quiescent state based
+ * reclamation), so a reader may use a snapshot until its next quiescent
+ * point, which is a load and a store on its own cache line.
+ *
+ * Readers register once per thread and mark quiescent points where they
+ * hold no snapshot (between requests, say). A reader about to block goes
+ * offline so that writers do not wait for it. Writers take turns on a
+ * mutex; a publish frees what it can without waiting, and waits for the
+ * readers only when SNAPSHOT_VECTOR_PENDING versions are already retired.
+ * Writers must not wait from a thread that is itself an online reader.
+ *
+ * Usage:
+ *   reader = register_snapshot_vector(&config);
+ *   for (;;) {
+ *     Vector *table = read_snapshot_vector(&config);
+ *     ... serve a request from `table` ...
+ *     quiescent_snapshot_vector(&config, reader);
+ *   }
+ * and on a writer:
+ *   update_snapshot_vector(&config, add_entry, &entry);*/
+#define SNAPSHOT_VECTOR_READERS 64 /*threads registered at once*/
+#define SNAPSHOT_VECTOR_PENDING 8  /*retired versions before a publish waits*/
+#define SNAPSHOT_VECTOR_OFFLINE ((size_t)-1)
+
+typedef struct SnapshotRetired SnapshotRetired;
+
+/*One registered reader: the last epoch it saw at a quiescent point, on its
+ * own cache line. The shared fields are accessed with __atomic builtins.*/
+typedef struct {
+  size_t epoch __attribute__((aligned(64))); /*or SNAPSHOT_VECTOR_OFFLINE*/
+  int used;
+} SnapshotReaderSlot;
+
+typedef struct {
+  Vector *current __attribute__((aligned(64)));
+  size_t epoch; /*bumped by every publish*/
+  pthread_mutex_t lock; /*serializes writers*/
+  SnapshotRetired *retired; /*replaced versions, newest first*/
+  size_t retired_count;
+  SnapshotReaderSlot readers[SNAPSHOT_VECTOR_READERS];
+} SnapshotVector;
+
+/*Changes `copy`, a private copy of the current version; a nonzero return
+ * drops the copy instead of publishing it.*/
+typedef int (*SnapshotUpdate)(Vector *copy, void *ctx);
+
+/*Starts with a copy of `initial` (empty for NULL). Returns -1 if memory
+ * runs out.*/
+int create_snapshot_vector(SnapshotVector *vector, Vector *initial);
+/*Frees every version; no reader may still use one.*/
+void destroy_snapshot_vector(SnapshotVector *vector);
+
+/*Registers the calling thread as an online reader and returns its slot, or
+ * -1 when all SNAPSHOT_VECTOR_READERS are taken.*/
+int register_snapshot_vector(SnapshotVector *vector);
+void unregister_snapshot_vector(SnapshotVector *vector, int reader);
+
+/*The current version, valid until the reader's next quiescent point or
+ * going offline. It must not be changed.*/
+static inline Vector *read_snapshot_vector(SnapshotVector *vector) {
+  return __atomic_load_n(&vector->current, __ATOMIC_ACQUIRE);
+}
+
+/*Declares that `reader` holds no snapshot.*/
+static inline void quiescent_snapshot_vector(SnapshotVector *vector,
+                                             int reader) {
+  __atomic_store_n(&vector->readers[reader].epoch,
+                   __atomic_load_n(&vector->epoch, __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELEASE);
+}
+
+/*A quiescent point that lasts until `online_snapshot_vector`, for a reader
+ * about to block.*/
+void offline_snapshot_vector(SnapshotVector *vector, int reader);
+void online_snapshot_vector(SnapshotVector *vector, int reader);
+
+/*Publishes the contents of `next`, which is left empty. Returns -1 if
+ * memory runs out; `next` is then unchanged.*/
+int publish_snapshot_vector(SnapshotVector *vector, Vector *next);
+/*Copies the current version, lets `fn` change the copy and publishes it.
+ * Returns -1 if memory runs out, or `fn`'s nonzero return.*/
+int update_snapshot_vector(SnapshotVector *vector, SnapshotUpdate fn,
+                           void *ctx);
+/*Frees the retired versions no reader can hold any more and returns how
+ * many remain.*/
+size_t reclaim_snapshot_vector(SnapshotVector *vector);
+/*Waits until every online reader has passed a quiescent point since the
+ * last publish, then frees all retired versions.*/
+void synchronize_snapshot_vector(SnapshotVector *vector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SNAPVEC_H__
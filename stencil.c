@@ -0,0 +1,381 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "stencil.h"
+
+#include <unistd.h> /*Includes `sysconf` for the online CPU count.*/
+
+#include "simd.h"
+
+/*BUILT-IN KERNELS*/
+
+/*Each built-in has a scalar `cell` function, which is also the reference the
+ * vector path must agree with, and a `row` function that runs 8 columns per
+ * AVX2 iteration (see simd.h) and finishes the tail with `cell`.*/
+
+static int life_cell(const int *up, const int *mid, const int *down,
+                     void *ctx) {
+  int sum = up[-1] + up[0] + up[1] + mid[-1] + mid[1] + down[-1] + down[0] +
+            down[1];
+  (void)ctx;
+  return sum == 3 || (sum == 2 && mid[0] == 1);
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t life_row_avx2(const int *up, const int *mid,
+                                             const int *down, int *out,
+                                             size_t cols) {
+  size_t c = 0;
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256i three = _mm256_set1_epi32(3);
+  for (; c + 8 <= cols; c += 8) {
+    __m256i self = _mm256_loadu_si256((const __m256i *)(mid + c));
+    __m256i sum = _mm256_add_epi32(
+        _mm256_add_epi32(
+            _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *)(up + c - 1)),
+                _mm256_loadu_si256((const __m256i *)(up + c))),
+            _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *)(up + c + 1)),
+                _mm256_loadu_si256((const __m256i *)(mid + c - 1)))),
+        _mm256_add_epi32(
+            _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *)(mid + c + 1)),
+                _mm256_loadu_si256((const __m256i *)(down + c - 1))),
+            _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *)(down + c)),
+                _mm256_loadu_si256((const __m256i *)(down + c + 1)))));
+    __m256i born = _mm256_cmpeq_epi32(sum, three);
+    __m256i stay = _mm256_and_si256(_mm256_cmpeq_epi32(sum, two),
+                                    _mm256_cmpeq_epi32(self, one));
+    _mm256_storeu_si256((__m256i *)(out + c),
+                        _mm256_and_si256(_mm256_or_si256(born, stay), one));
+  }
+  return c;
+}
+#endif
+
+static void life_row(const int *up, const int *mid, const int *down, int *out,
+                     size_t cols, void *ctx) {
+  size_t c = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    c = life_row_avx2(up, mid, down, out, cols);
+#endif
+  for (; c < cols; c++)
+    out[c] = life_cell(up + c, mid + c, down + c, ctx);
+}
+
+static int blur_cell(const int *up, const int *mid, const int *down,
+                     void *ctx) {
+  (void)ctx;
+  return (up[-1] + 2 * up[0] + up[1] + 2 * mid[-1] + 4 * mid[0] +
+          2 * mid[1] + down[-1] + 2 * down[0] + down[1]) >>
+         4;
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t blur_row_avx2(const int *up, const int *mid,
+                                             const int *down, int *out,
+                                             size_t cols) {
+  size_t c = 0;
+  for (; c + 8 <= cols; c += 8) {
+    /*1 2 1 horizontally per row, then 1 2 1 vertically*/
+    __m256i u = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(up + c - 1)),
+                         _mm256_loadu_si256((const __m256i *)(up + c + 1))),
+        _mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(up + c)), 1));
+    __m256i m = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(mid + c - 1)),
+                         _mm256_loadu_si256((const __m256i *)(mid + c + 1))),
+        _mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(mid + c)), 1));
+    __m256i d = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(down + c - 1)),
+                         _mm256_loadu_si256((const __m256i *)(down + c + 1))),
+        _mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(down + c)), 1));
+    __m256i sum =
+        _mm256_add_epi32(_mm256_add_epi32(u, d), _mm256_slli_epi32(m, 1));
+    _mm256_storeu_si256((__m256i *)(out + c), _mm256_srai_epi32(sum, 4));
+  }
+  return c;
+}
+#endif
+
+static void blur_row(const int *up, const int *mid, const int *down, int *out,
+                     size_t cols, void *ctx) {
+  size_t c = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    c = blur_row_avx2(up, mid, down, out, cols);
+#endif
+  for (; c < cols; c++)
+    out[c] = blur_cell(up + c, mid + c, down + c, ctx);
+}
+
+static int max_int(int a, int b) { return a > b ? a : b; }
+
+static int flood_cell(const int *up, const int *mid, const int *down,
+                      void *ctx) {
+  int m;
+  (void)ctx;
+  if (mid[0] < 0)
+    return mid[0];
+  m = max_int(max_int(up[-1], up[0]), up[1]);
+  m = max_int(m, max_int(max_int(mid[-1], mid[0]), mid[1]));
+  m = max_int(m, max_int(max_int(down[-1], down[0]), down[1]));
+  return m;
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t flood_row_avx2(const int *up, const int *mid,
+                                              const int *down, int *out,
+                                              size_t cols) {
+  size_t c = 0;
+  const __m256i zero = _mm256_setzero_si256();
+  for (; c + 8 <= cols; c += 8) {
+    __m256i self = _mm256_loadu_si256((const __m256i *)(mid + c));
+    __m256i m = _mm256_max_epi32(
+        _mm256_max_epi32(
+            _mm256_max_epi32(
+                _mm256_loadu_si256((const __m256i *)(up + c - 1)),
+                _mm256_loadu_si256((const __m256i *)(up + c))),
+            _mm256_max_epi32(
+                _mm256_loadu_si256((const __m256i *)(up + c + 1)),
+                _mm256_loadu_si256((const __m256i *)(mid + c - 1)))),
+        _mm256_max_epi32(
+            _mm256_max_epi32(
+                _mm256_max_epi32(
+                    self, _mm256_loadu_si256((const __m256i *)(mid + c + 1))),
+                _mm256_loadu_si256((const __m256i *)(down + c - 1))),
+            _mm256_max_epi32(
+                _mm256_loadu_si256((const __m256i *)(down + c)),
+                _mm256_loadu_si256((const __m256i *)(down + c + 1)))));
+    __m256i wall = _mm256_cmpgt_epi32(zero, self);
+    _mm256_storeu_si256((__m256i *)(out + c),
+                        _mm256_blendv_epi8(m, self, wall));
+  }
+  return c;
+}
+#endif
+
+static void flood_row(const int *up, const int *mid, const int *down, int *out,
+                      size_t cols, void *ctx) {
+  size_t c = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    c = flood_row_avx2(up, mid, down, out, cols);
+#endif
+  for (; c < cols; c++)
+    out[c] = flood_cell(up + c, mid + c, down + c, ctx);
+}
+
+const StencilKernel stencil_life_kernel = {life_cell, life_row, NULL};
+const StencilKernel stencil_blur_kernel = {blur_cell, blur_row, NULL};
+const StencilKernel stencil_flood_kernel = {flood_cell, flood_row, NULL};
+
+/*ENGINE*/
+
+StencilOptions default_stencil_options(void) {
+  StencilOptions options;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  options.threads = cpus > 0 ? (int)cpus : 1;
+  options.block_rows = 64;
+  options.time_steps = 1;
+  options.pool = NULL;
+  return options;
+}
+
+/*State shared by all workers of one `run_stencil` call. Each pass advances
+ * `depth` steps from `src` into `dst`, one row block per pool item.*/
+typedef struct {
+  StencilKernel kernel;
+  int *buffers[2];
+  size_t rows, cols, stride;
+  size_t block_rows, blocks;
+  int max_depth;
+  int depth;
+  const int *src;
+  int *dst;
+  ThreadPool *pool; /*NULL runs on the calling thread*/
+  int **scratch;    /*per pool participant, for time tiling*/
+} StencilRun;
+
+/*Pointer to column 0 of user row `row` (-1 and `rows` are the halo rows).*/
+static int *row_at(int *cells, size_t stride, long row) {
+  return cells + (size_t)(row + 1) * stride + 1;
+}
+
+static void apply_row(const StencilKernel *kernel, const int *up,
+                      const int *mid, const int *down, int *out, size_t cols) {
+  size_t c;
+  if (kernel->row != NULL) {
+    kernel->row(up, mid, down, out, cols, kernel->ctx);
+    return;
+  }
+  for (c = 0; c < cols; c++)
+    out[c] = kernel->cell(up + c, mid + c, down + c, kernel->ctx);
+}
+
+/*Advances rows [lo, hi) by `depth` steps from `src` into `dst`. With depth > 1
+ * the block plus `depth` rows of overlap on each side is copied into two
+ * scratch buffers and stepped there, shrinking the valid region by one row
+ * per side each step, so the block is read from memory once per pass.*/
+static void run_block(StencilRun *run, const int *src, int *dst, long lo,
+                      long hi, int depth, int *scratch) {
+  long rows = (long)run->rows, r, first, last;
+  size_t stride = run->stride;
+  int *a, *b;
+  int s;
+  if (depth == 1) {
+    for (r = lo; r < hi; r++)
+      apply_row(&run->kernel, row_at((int *)src, stride, r - 1),
+                row_at((int *)src, stride, r),
+                row_at((int *)src, stride, r + 1), row_at(dst, stride, r),
+                run->cols);
+    return;
+  }
+  a = scratch;
+  b = scratch + (run->block_rows + 2 * (size_t)run->max_depth + 2) * stride;
+  /*scratch row i holds user row base + i - 1*/
+  first = lo - depth < -1 ? -1 : lo - depth;
+  last = hi + depth > rows + 1 ? rows + 1 : hi + depth;
+  {
+    long base = lo - depth;
+    size_t bytes = (size_t)(last - first) * stride * sizeof(int);
+    memcpy(row_at(a, stride, first - base) - 1,
+           row_at((int *)src, stride, first) - 1, bytes);
+    memcpy(row_at(b, stride, first - base) - 1,
+           row_at((int *)src, stride, first) - 1, bytes);
+    for (s = 1; s <= depth; s++) {
+      long from = lo - depth + s < 0 ? 0 : lo - depth + s;
+      long to = hi + depth - s > rows ? rows : hi + depth - s;
+      int *t;
+      for (r = from; r < to; r++)
+        apply_row(&run->kernel, row_at(a, stride, r - 1 - base),
+                  row_at(a, stride, r - base), row_at(a, stride, r + 1 - base),
+                  row_at(b, stride, r - base), run->cols);
+      t = a;
+      a = b;
+      b = t;
+    }
+    for (r = lo; r < hi; r++)
+      memcpy(row_at(dst, stride, r), row_at(a, stride, r - base),
+             run->cols * sizeof(int));
+  }
+}
+
+static void run_blocks(size_t begin, size_t end, void *ctx) {
+  StencilRun *run = (StencilRun *)ctx;
+  int worker = run->pool != NULL ? get_worker_thread_pool(run->pool) : 0;
+  int *scratch = run->scratch != NULL ? run->scratch[worker] : NULL;
+  size_t block;
+  for (block = begin; block < end; block++) {
+    long lo = (long)(block * run->block_rows);
+    long hi = lo + (long)run->block_rows;
+    if (hi > (long)run->rows)
+      hi = (long)run->rows;
+    run_block(run, run->src, run->dst, lo, hi, run->depth, scratch);
+  }
+}
+
+/*Frees the per worker scratch rows; NULL entries and a NULL array are fine.*/
+static void free_scratch(int **scratch, int workers) {
+  int t;
+  if (scratch == NULL)
+    return;
+  for (t = 0; t < workers; t++)
+    free(scratch[t]);
+  free(scratch);
+}
+
+int run_stencil(Grid *grid, StencilKernel kernel, int steps,
+                const StencilOptions *options) {
+  StencilOptions defaults = default_stencil_options();
+  StencilRun run;
+  ThreadPool *own = NULL;
+  Grid back;
+  int workers = 1, t, passes, pass;
+  if (grid->layout != GRID_ROW_MAJOR) {
+    fprintf(stderr, "ERROR: Stencil needs a GRID_ROW_MAJOR grid.\n");
+    return -1;
+  }
+  if (kernel.cell == NULL && kernel.row == NULL) {
+    fprintf(stderr, "ERROR: Stencil kernel has no function.\n");
+    return -1;
+  }
+  if (steps <= 0 || grid->rows == 0 || grid->cols == 0)
+    return 0;
+  if (options == NULL)
+    options = &defaults;
+
+  run.kernel = kernel;
+  run.rows = grid->rows;
+  run.cols = grid->cols;
+  run.stride = grid->stride;
+  run.block_rows = options->block_rows > 0 ? options->block_rows : 64;
+  run.blocks = (run.rows + run.block_rows - 1) / run.block_rows;
+  run.max_depth = options->time_steps > 1 ? options->time_steps : 1;
+  passes = (steps + run.max_depth - 1) / run.max_depth;
+
+  run.pool = options->pool;
+  if (run.pool == NULL && options->threads > 1 && run.blocks > 1) {
+    run.pool = default_thread_pool();
+    if (run.pool == NULL ||
+        get_threads_thread_pool(run.pool) != options->threads)
+      run.pool = own = create_thread_pool(options->threads);
+  }
+  if (run.pool != NULL)
+    workers = get_threads_thread_pool(run.pool);
+  run.scratch = NULL;
+  if (run.max_depth > 1) {
+    size_t rows = 2 * (run.block_rows + 2 * (size_t)run.max_depth + 2);
+    run.scratch = (int **)calloc((size_t)workers, sizeof(int *));
+    if (run.scratch == NULL) {
+      fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+      destroy_thread_pool(own);
+      return -1;
+    }
+    for (t = 0; t < workers; t++) {
+      run.scratch[t] = (int *)malloc(rows * run.stride * sizeof(int));
+      if (run.scratch[t] == NULL) {
+        fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+        free_scratch(run.scratch, workers);
+        destroy_thread_pool(own);
+        return -1;
+      }
+    }
+  }
+
+  /*the back buffer starts as a full copy so both halos agree*/
+  back = create_grid(grid->rows, grid->cols, GRID_ROW_MAJOR);
+  if (back.cells == NULL) {
+    free_scratch(run.scratch, workers);
+    destroy_thread_pool(own);
+    return -1;
+  }
+  memcpy(back.cells, grid->cells, grid->capacity * sizeof(int));
+  run.buffers[0] = grid->cells;
+  run.buffers[1] = back.cells;
+
+  for (pass = 0; pass < passes; pass++) {
+    int left = steps - pass * run.max_depth;
+    run.depth = left < run.max_depth ? left : run.max_depth;
+    run.src = run.buffers[pass % 2];
+    run.dst = run.buffers[(pass + 1) % 2];
+    if (run.pool != NULL)
+      parallel_for(run.pool, 0, run.blocks, 1, run_blocks, &run);
+    else
+      run_blocks(0, run.blocks, &run);
+  }
+
+  /*an odd number of passes leaves the result in the back buffer*/
+  if (passes % 2 == 1) {
+    int *cells = grid->cells;
+    grid->cells = back.cells;
+    back.cells = cells;
+  }
+  destroy_grid(&back);
+  free_scratch(run.scratch, workers);
+  destroy_thread_pool(own);
+  return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef __STENCIL_H__
+#define __STENCIL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "grid.h"
+#include "threadpool.h"
+
+/*STENCIL*/
+
+/*A kernel computes a cell's next value from its 3x3 neighborhood, laid out as
+ * in `print_matrix_neighbor_coordinates_rules()`. `up`, `mid` and `down` point
+ * at the cell's column in rows r - 1, r and r + 1, so `up[-1]` is (-1, -1) and
+ * `down[1]` is (1, 1).
+ *
+ * `cell` is called once per cell. A kernel may also provide `row`, which
+ * computes `cols` cells at once into `out` and is used instead of `cell` when
+ * present; the built-in kernels use it to vectorize across columns.*/
+typedef int (*StencilCell)(const int *up, const int *mid, const int *down,
+                           void *ctx);
+typedef void (*StencilRow)(const int *up, const int *mid, const int *down,
+                           int *out, size_t cols, void *ctx);
+
+typedef struct {
+  StencilCell cell;
+  StencilRow row;
+  void *ctx;
+} StencilKernel;
+
+/*Game of Life on 0/1 cells.*/
+extern const StencilKernel stencil_life_kernel;
+/*3x3 Gaussian blur, weights 1 2 1 / 2 4 2 / 1 2 1, divided by 16.*/
+extern const StencilKernel stencil_blur_kernel;
+/*Flood step: negative cells are walls and keep their value, every other cell
+ * takes the maximum of its 3x3 neighborhood.*/
+extern const StencilKernel stencil_flood_kernel;
+
+typedef struct {
+  int threads;       /*worker threads, <= 1 runs on the calling thread*/
+  ThreadPool *pool;  /*pool to run on; NULL uses default_thread_pool() when
+                        it has `threads` threads, else a pool for the call*/
+  size_t block_rows; /*rows per work item, 0 picks a default*/
+  int time_steps;    /*steps fused per pass over a block, 1 disables time
+                        tiling*/
+} StencilOptions;
+
+StencilOptions default_stencil_options(void);
+
+/*Applies `kernel` `steps` times to the user cells of a GRID_ROW_MAJOR grid,
+ * double buffered, leaving the result in `grid`. The halo is the fixed
+ * boundary and is never written. Returns -1 if the grid cannot be used or
+ * the buffers cannot be allocated, leaving `grid` untouched.*/
+int run_stencil(Grid *grid, StencilKernel kernel, int steps,
+                const StencilOptions *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __STENCIL_H__
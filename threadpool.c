@@ -0,0 +1,435 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "threadpool.h"
+
+#include <pthread.h>   /*Includes POSIX threads for the workers.*/
+#include <sched.h>     /*Includes `sched_yield` for idle workers.*/
+#include <stdatomic.h> /*Includes atomics for the deques and parking.*/
+#include <stdint.h>
+#include <unistd.h> /*Includes `sysconf` for the online CPU count.*/
+
+#if defined(__linux__)
+#include <linux/futex.h> /*Includes `FUTEX_WAIT_PRIVATE` for parking.*/
+#include <sys/syscall.h> /*Includes `SYS_futex`.*/
+#endif
+
+/*THREAD POOL*/
+
+/*Rounds of failed steals before an idle worker yields, and before it
+ * parks.*/
+#define SPIN_ROUNDS 64
+#define YIELD_ROUNDS 128
+
+/*One `parallel_for` or `parallel_reduce` call. The range is cut into
+ * `chunks` chunks of `grain` items; `remaining` counts the chunks not yet
+ * run, and the caller helps until it reaches 0.*/
+typedef struct {
+  size_t begin, end, grain;
+  ParallelForBody body;
+  ParallelReduceBody reduce; /*set for reductions instead of `body`*/
+  unsigned char *partials;   /*one `size` byte partial per chunk*/
+  size_t size;
+  void *ctx;
+  atomic_size_t remaining;
+} ThreadPoolJob;
+
+/*Chunks [first, last) of `job`. Deque slots hold tasks by value in relaxed
+ * atomics: a thief may read a slot while the owner reuses it, but then its
+ * CAS on `top` fails and it drops what it read.*/
+typedef struct {
+  _Atomic(ThreadPoolJob *) job;
+  atomic_size_t first, last;
+} ThreadPoolSlot;
+
+typedef struct {
+  ThreadPoolJob *job;
+  size_t first, last;
+} ThreadPoolTask;
+
+/*A participant: its Chase-Lev deque (the owner pushes and pops at `bottom`,
+ * thieves take from `top`), on its own cache lines.*/
+typedef struct {
+  _Alignas(64) atomic_long top;
+  _Alignas(64) atomic_long bottom;
+  ThreadPoolSlot slots[THREAD_POOL_DEQUE];
+  ThreadPool *pool;
+  int index;
+  unsigned int seed; /*victim choice, owner only*/
+  pthread_t thread;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+  int threads;
+  ThreadPoolWorker *workers; /*[0] is the calling thread*/
+  pthread_mutex_t caller;    /*held by the outside thread acting as [0]*/
+  atomic_bool stopping;
+  _Alignas(64) atomic_uint epoch; /*bumped to wake parked workers*/
+  atomic_int sleepers;
+#if !defined(__linux__)
+  pthread_mutex_t park_mutex;
+  pthread_cond_t park_cond;
+#endif
+};
+
+static _Thread_local ThreadPoolWorker *local_worker;
+
+static void relax_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/*DEQUE*/
+
+/*Returns false when the deque is full; the caller runs the task itself.*/
+static bool push_deque(ThreadPoolWorker *worker, const ThreadPoolTask *task) {
+  long b = atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&worker->top, memory_order_acquire);
+  ThreadPoolSlot *slot = &worker->slots[b & (THREAD_POOL_DEQUE - 1)];
+  if (b - t >= THREAD_POOL_DEQUE)
+    return false;
+  atomic_store_explicit(&slot->job, task->job, memory_order_relaxed);
+  atomic_store_explicit(&slot->first, task->first, memory_order_relaxed);
+  atomic_store_explicit(&slot->last, task->last, memory_order_relaxed);
+  atomic_store_explicit(&worker->bottom, b + 1, memory_order_release);
+  return true;
+}
+
+static void read_slot(const ThreadPoolWorker *worker, long index,
+                      ThreadPoolTask *task) {
+  ThreadPoolSlot *slot =
+      (ThreadPoolSlot *)&worker->slots[index & (THREAD_POOL_DEQUE - 1)];
+  task->job = atomic_load_explicit(&slot->job, memory_order_relaxed);
+  task->first = atomic_load_explicit(&slot->first, memory_order_relaxed);
+  task->last = atomic_load_explicit(&slot->last, memory_order_relaxed);
+}
+
+/*Owner only: takes the newest task.*/
+static bool pop_deque(ThreadPoolWorker *worker, ThreadPoolTask *task) {
+  long b = atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+  long t;
+  bool taken = true;
+  atomic_store_explicit(&worker->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  t = atomic_load_explicit(&worker->top, memory_order_relaxed);
+  if (t > b) {
+    atomic_store_explicit(&worker->bottom, b + 1, memory_order_relaxed);
+    return false;
+  }
+  read_slot(worker, b, task);
+  if (t == b) {
+    /*the last task: race the thieves for it*/
+    taken = atomic_compare_exchange_strong_explicit(
+        &worker->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&worker->bottom, b + 1, memory_order_relaxed);
+  }
+  return taken;
+}
+
+/*Any thread: takes the oldest task, which is the largest range.*/
+static bool steal_deque(ThreadPoolWorker *worker, ThreadPoolTask *task) {
+  long t = atomic_load_explicit(&worker->top, memory_order_acquire);
+  long b;
+  atomic_thread_fence(memory_order_seq_cst);
+  b = atomic_load_explicit(&worker->bottom, memory_order_acquire);
+  if (t >= b)
+    return false;
+  read_slot(worker, t, task);
+  return atomic_compare_exchange_strong_explicit(
+      &worker->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static bool has_work(ThreadPool *pool) {
+  int i;
+  for (i = 0; i < pool->threads; i++)
+    if (atomic_load(&pool->workers[i].top) <
+        atomic_load(&pool->workers[i].bottom))
+      return true;
+  return false;
+}
+
+/*PARKING*/
+
+static void park_worker(ThreadPool *pool) {
+  unsigned int seen = atomic_load(&pool->epoch);
+  atomic_fetch_add(&pool->sleepers, 1);
+  /*a push after this sees the sleeper and bumps the epoch; one before it
+   * is found here*/
+  if (!has_work(pool) && !atomic_load(&pool->stopping)) {
+#if defined(__linux__)
+    syscall(SYS_futex, (unsigned int *)&pool->epoch, FUTEX_WAIT_PRIVATE, seen,
+            NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&pool->park_mutex);
+    while (atomic_load(&pool->epoch) == seen)
+      pthread_cond_wait(&pool->park_cond, &pool->park_mutex);
+    pthread_mutex_unlock(&pool->park_mutex);
+#endif
+  }
+  atomic_fetch_sub(&pool->sleepers, 1);
+}
+
+static void wake_workers(ThreadPool *pool, bool all) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&pool->sleepers) == 0)
+    return;
+#if defined(__linux__)
+  atomic_fetch_add(&pool->epoch, 1);
+  syscall(SYS_futex, (unsigned int *)&pool->epoch, FUTEX_WAKE_PRIVATE,
+          all ? INT32_MAX : 1, NULL, NULL, 0);
+#else
+  pthread_mutex_lock(&pool->park_mutex);
+  atomic_fetch_add(&pool->epoch, 1);
+  if (all)
+    pthread_cond_broadcast(&pool->park_cond);
+  else
+    pthread_cond_signal(&pool->park_cond);
+  pthread_mutex_unlock(&pool->park_mutex);
+#endif
+}
+
+/*SCHEDULING*/
+
+static void run_chunks(ThreadPoolJob *job, size_t first, size_t last) {
+  size_t c;
+  for (c = first; c < last; c++) {
+    size_t lo = job->begin + c * job->grain;
+    size_t hi = job->end - lo > job->grain ? lo + job->grain : job->end;
+    if (job->reduce != NULL)
+      job->reduce(lo, hi, job->partials + c * job->size, job->ctx);
+    else
+      job->body(lo, hi, job->ctx);
+  }
+}
+
+/*Keeps the left half and offers the right half to thieves until one chunk
+ * is left (or the deque is full), then runs it.*/
+static void run_task(ThreadPoolWorker *self, ThreadPoolTask task) {
+  while (task.last - task.first > 1) {
+    ThreadPoolTask right;
+    right.job = task.job;
+    right.first = task.first + (task.last - task.first) / 2;
+    right.last = task.last;
+    if (!push_deque(self, &right))
+      break;
+    wake_workers(self->pool, false);
+    task.last = right.first;
+  }
+  run_chunks(task.job, task.first, task.last);
+  atomic_fetch_sub_explicit(&task.job->remaining, task.last - task.first,
+                            memory_order_release);
+}
+
+static bool steal_task(ThreadPoolWorker *self, ThreadPoolTask *task) {
+  ThreadPool *pool = self->pool;
+  int start, i;
+  self->seed = self->seed * 1103515245u + 12345u;
+  start = (int)((self->seed >> 16) % (unsigned int)pool->threads);
+  for (i = 0; i < pool->threads; i++) {
+    ThreadPoolWorker *victim = &pool->workers[(start + i) % pool->threads];
+    if (victim != self && steal_deque(victim, task))
+      return true;
+  }
+  return false;
+}
+
+static bool find_task(ThreadPoolWorker *self, ThreadPoolTask *task) {
+  return pop_deque(self, task) || steal_task(self, task);
+}
+
+static void *worker_main(void *arg) {
+  ThreadPoolWorker *self = (ThreadPoolWorker *)arg;
+  ThreadPool *pool = self->pool;
+  int idle = 0;
+  local_worker = self;
+  while (!atomic_load_explicit(&pool->stopping, memory_order_relaxed)) {
+    ThreadPoolTask task;
+    if (find_task(self, &task)) {
+      run_task(self, task);
+      idle = 0;
+    } else if (++idle < SPIN_ROUNDS) {
+      relax_cpu();
+    } else if (idle < YIELD_ROUNDS) {
+      sched_yield();
+    } else {
+      park_worker(pool);
+      idle = 0;
+    }
+  }
+  return NULL;
+}
+
+/*Runs `job` with the calling thread as a participant, helping with any task
+ * until every chunk of `job` has finished.*/
+static void run_job(ThreadPool *pool, ThreadPoolJob *job, size_t chunks) {
+  ThreadPoolWorker *saved = local_worker, *self;
+  ThreadPoolTask root;
+  bool outside = saved == NULL || saved->pool != pool;
+  int idle = 0;
+  if (outside) {
+    pthread_mutex_lock(&pool->caller);
+    local_worker = &pool->workers[0];
+  }
+  self = local_worker;
+  atomic_init(&job->remaining, chunks);
+  root.job = job;
+  root.first = 0;
+  root.last = chunks;
+  run_task(self, root);
+  while (atomic_load_explicit(&job->remaining, memory_order_acquire) > 0) {
+    ThreadPoolTask task;
+    if (find_task(self, &task)) {
+      run_task(self, task);
+      idle = 0;
+    } else if (++idle < SPIN_ROUNDS) {
+      relax_cpu();
+    } else {
+      sched_yield();
+    }
+  }
+  if (outside) {
+    local_worker = saved;
+    pthread_mutex_unlock(&pool->caller);
+  }
+}
+
+/*Chunk size for `grain` 0: THREAD_POOL_CHUNKS chunks per thread, at least
+ * THREAD_POOL_MIN_GRAIN items each.*/
+static size_t pick_grain(const ThreadPool *pool, size_t items, size_t grain) {
+  size_t chunks = (size_t)pool->threads * THREAD_POOL_CHUNKS;
+  if (grain > 0)
+    return grain;
+  grain = (items + chunks - 1) / chunks;
+  return grain > THREAD_POOL_MIN_GRAIN ? grain : THREAD_POOL_MIN_GRAIN;
+}
+
+/*POOL*/
+
+ThreadPool *create_thread_pool(int threads) {
+  ThreadPool *pool;
+  size_t bytes;
+  int i;
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+  pool = (ThreadPool *)aligned_alloc(64, sizeof(ThreadPool));
+  bytes = (size_t)threads * sizeof(ThreadPoolWorker);
+  if (pool == NULL || (pool->workers = (ThreadPoolWorker *)aligned_alloc(
+                           64, bytes)) == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    free(pool);
+    return NULL;
+  }
+  memset(pool->workers, 0, bytes);
+  pool->threads = threads;
+  pthread_mutex_init(&pool->caller, NULL);
+  atomic_init(&pool->stopping, false);
+  atomic_init(&pool->epoch, 0);
+  atomic_init(&pool->sleepers, 0);
+#if !defined(__linux__)
+  pthread_mutex_init(&pool->park_mutex, NULL);
+  pthread_cond_init(&pool->park_cond, NULL);
+#endif
+  for (i = 0; i < threads; i++) {
+    ThreadPoolWorker *worker = &pool->workers[i];
+    atomic_init(&worker->top, 0);
+    atomic_init(&worker->bottom, 0);
+    worker->pool = pool;
+    worker->index = i;
+    worker->seed = 2654435761u * (unsigned int)(i + 1);
+  }
+  for (i = 1; i < threads; i++) {
+    if (pthread_create(&pool->workers[i].thread, NULL, worker_main,
+                       &pool->workers[i]) != 0) {
+      fprintf(stderr, "ERROR: Cannot start thread pool worker %d.\n", i);
+      pool->threads = i; /*only the started ones are joined*/
+      destroy_thread_pool(pool);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+void destroy_thread_pool(ThreadPool *pool) {
+  int i;
+  if (pool == NULL)
+    return;
+  atomic_store(&pool->stopping, true);
+  wake_workers(pool, true);
+  for (i = 1; i < pool->threads; i++)
+    pthread_join(pool->workers[i].thread, NULL);
+  pthread_mutex_destroy(&pool->caller);
+#if !defined(__linux__)
+  pthread_mutex_destroy(&pool->park_mutex);
+  pthread_cond_destroy(&pool->park_cond);
+#endif
+  free(pool->workers);
+  free(pool);
+}
+
+static ThreadPool *shared_pool;
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+
+static void create_shared_pool(void) { shared_pool = create_thread_pool(0); }
+
+ThreadPool *default_thread_pool(void) {
+  pthread_once(&shared_once, create_shared_pool);
+  return shared_pool;
+}
+
+int get_threads_thread_pool(const ThreadPool *pool) { return pool->threads; }
+
+int get_worker_thread_pool(const ThreadPool *pool) {
+  return local_worker != NULL && local_worker->pool == pool
+             ? local_worker->index
+             : -1;
+}
+
+/*LOOPS*/
+
+void parallel_for(ThreadPool *pool, size_t begin, size_t end, size_t grain,
+                  ParallelForBody body, void *ctx) {
+  ThreadPoolJob job;
+  if (end <= begin)
+    return;
+  job.begin = begin;
+  job.end = end;
+  job.grain = pick_grain(pool, end - begin, grain);
+  job.body = body;
+  job.reduce = NULL;
+  job.partials = NULL;
+  job.size = 0;
+  job.ctx = ctx;
+  run_job(pool, &job, (end - begin + job.grain - 1) / job.grain);
+}
+
+int parallel_reduce(ThreadPool *pool, size_t begin, size_t end, size_t grain,
+                    size_t size, const void *identity, ParallelReduceBody body,
+                    ParallelJoin join, void *result, void *ctx) {
+  ThreadPoolJob job;
+  size_t chunks, c;
+  memcpy(result, identity, size);
+  if (end <= begin)
+    return 0;
+  job.begin = begin;
+  job.end = end;
+  job.grain = pick_grain(pool, end - begin, grain);
+  job.body = NULL;
+  job.reduce = body;
+  job.size = size;
+  job.ctx = ctx;
+  chunks = (end - begin + job.grain - 1) / job.grain;
+  job.partials = (unsigned char *)malloc(chunks * size);
+  if (job.partials == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  for (c = 0; c < chunks; c++)
+    memcpy(job.partials + c * size, identity, size);
+  run_job(pool, &job, chunks);
+  for (c = 0; c < chunks; c++)
+    join(result, job.partials + c * size, ctx);
+  free(job.partials);
+  return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "utils.h"
+
+/*THREAD POOL*/
+
+/*A work-stealing pool for data parallel loops. Every participant owns a
+ * Chase-Lev deque: it pushes and pops work at the bottom, idle participants
+ * steal from the top. `parallel_for` splits its range in halves lazily, a
+ * participant keeps the left half and pushes the right one, so a loop only
+ * produces as many tasks as there are idle threads asking for them.
+ *
+ * The thread calling `parallel_for` takes part as participant 0; a pool of
+ * `threads` runs `threads - 1` worker threads. Idle workers spin briefly,
+ * then park on a futex (a condition variable outside Linux). Loops may be
+ * nested; calls from several outside threads take turns.
+ *
+ * Usage:
+ *   static void scale(size_t begin, size_t end, void *ctx) {
+ *     Vector *v = ctx;
+ *     size_t i;
+ *     for (i = begin; i < end; i++)
+ *       v->arr[i] *= 3;
+ *   }
+ *   parallel_for(default_thread_pool(), 0, v.size, 0, scale, &v);*/
+#define THREAD_POOL_DEQUE 256 /*tasks per deque; when full they run inline*/
+#define THREAD_POOL_CHUNKS 8  /*chunks per thread picked by grain 0*/
+#define THREAD_POOL_MIN_GRAIN 1024 /*items per chunk at least, for grain 0*/
+
+typedef struct ThreadPool ThreadPool;
+
+/*Runs items [begin, end).*/
+typedef void (*ParallelForBody)(size_t begin, size_t end, void *ctx);
+/*Folds items [begin, end) into `partial`, which starts as the identity.*/
+typedef void (*ParallelReduceBody)(size_t begin, size_t end, void *partial,
+                                   void *ctx);
+/*Folds `from` into `into`.*/
+typedef void (*ParallelJoin)(void *into, const void *from, void *ctx);
+
+/*A pool of `threads` participants, the online CPU count for 0. Returns
+ * NULL if the workers cannot be started.*/
+ThreadPool *create_thread_pool(int threads);
+/*Must not race with loops running on the pool.*/
+void destroy_thread_pool(ThreadPool *pool);
+/*One pool sized to the online CPUs, shared by the whole program and started
+ * on first use.*/
+ThreadPool *default_thread_pool(void);
+int get_threads_thread_pool(const ThreadPool *pool);
+/*The participant running the calling thread, 0 to threads - 1, or -1 off
+ * the pool. Bodies use it to index per thread scratch space.*/
+int get_worker_thread_pool(const ThreadPool *pool);
+
+/*Calls `body` on disjoint subranges covering [begin, end) and returns once
+ * all have finished. `grain` is the most items per call (the last call may
+ * get fewer); 0 picks THREAD_POOL_CHUNKS chunks per thread of at least
+ * THREAD_POOL_MIN_GRAIN items.*/
+void parallel_for(ThreadPool *pool, size_t begin, size_t end, size_t grain,
+                  ParallelForBody body, void *ctx);
+
+/*Reduces [begin, end) into `result` (`size` bytes): each chunk of `grain`
+ * items folds into its own copy of `identity`, then the chunks are joined in
+ * index order on the calling thread, so the result does not depend on
+ * scheduling. Returns -1 if the partials cannot be allocated.*/
+int parallel_reduce(ThreadPool *pool, size_t begin, size_t end, size_t grain,
+                    size_t size, const void *identity, ParallelReduceBody body,
+                    ParallelJoin join, void *result, void *ctx);
+
+/*Example usage, summing a Vector:*/
+/*static void add(size_t begin, size_t end, void *partial, void *ctx) {*/
+/*  long long *sum = partial;*/
+/*  VectorSpan span = get_span_vector(ctx, begin, end);*/
+/*  size_t i;*/
+/*  for (i = 0; i < span.size; i++) *sum += span.data[i];*/
+/*}*/
+/*static void join(void *into, const void *from, void *ctx) {*/
+/*  *(long long *)into += *(const long long *)from;*/
+/*}*/
+/*long long zero = 0, sum;*/
+/*parallel_reduce(pool, 0, v.size, 0, sizeof sum, &zero, add, join, &sum,*/
+/*                &v);*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __THREADPOOL_H__
@@ -0,0 +1,318 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "timing.h"
+
+#include <pthread.h>   /*Includes the registry mutex and thread exit keys.*/
+#include <stdatomic.h> /*Includes the relaxed counters of the stats.*/
+
+/*SCOPED TIMERS*/
+
+/*One thread's stats for one site. Only the owning thread writes (plain
+ * load + store, no read-modify-write); the report reads them concurrently,
+ * hence the relaxed atomics.*/
+typedef struct {
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t total;
+  atomic_uint_fast64_t min;
+  atomic_uint_fast64_t max;
+  atomic_uint_fast64_t buckets[TIMER_BUCKETS];
+} TimerStats;
+
+typedef struct TimerThread {
+  _Atomic(TimerStats *) stats[TIMER_MAX_SITES]; /*indexed by site id - 1*/
+  struct TimerThread *next;
+} TimerThread;
+
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*guarded by timer_mutex*/
+static TimerSite *timer_sites[TIMER_MAX_SITES];
+static int timer_site_count;
+static TimerThread *timer_threads;
+static TimerStats *timer_retired[TIMER_MAX_SITES]; /*from exited threads*/
+
+static pthread_key_t timer_key;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static _Thread_local TimerThread *local_timers;
+
+/*The TSC and the monotonic clock at the first registration, to convert.*/
+static uint64_t calibrate_ticks, calibrate_ns;
+
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*Values below 16 get their own bucket; above, 16 buckets per power of two.*/
+static int bucket_of(uint64_t ticks) {
+  int e;
+  if (ticks < 16)
+    return (int)ticks;
+  e = 63 - __builtin_clzll(ticks);
+  return (e - 3) * 16 + (int)((ticks >> (e - 4)) & 15);
+}
+
+/*The middle of a bucket.*/
+static double bucket_value(int bucket) {
+  int e, sub;
+  if (bucket < 16)
+    return bucket;
+  e = bucket / 16 + 3;
+  sub = bucket % 16;
+  return (double)((uint64_t)(16 + sub) << (e - 4)) +
+         (double)((uint64_t)1 << (e - 4)) / 2;
+}
+
+static void add(atomic_uint_fast64_t *counter, uint64_t value) {
+  atomic_store_explicit(
+      counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+      memory_order_relaxed);
+}
+
+static uint64_t get(atomic_uint_fast64_t *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void merge_stats(TimerStats *into, TimerStats *from) {
+  int b;
+  if (get(&from->count) == 0)
+    return;
+  if (get(&into->count) == 0 || get(&from->min) < get(&into->min))
+    atomic_store(&into->min, get(&from->min));
+  if (get(&from->max) > get(&into->max))
+    atomic_store(&into->max, get(&from->max));
+  add(&into->count, get(&from->count));
+  add(&into->total, get(&from->total));
+  for (b = 0; b < TIMER_BUCKETS; b++)
+    add(&into->buckets[b], get(&from->buckets[b]));
+}
+
+static TimerStats *create_stats(void) {
+  TimerStats *stats = (TimerStats *)calloc(1, sizeof(TimerStats));
+  if (stats == NULL)
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+  return stats;
+}
+
+/*Thread exit: fold the thread's stats into `timer_retired`.*/
+static void retire_thread(void *arg) {
+  TimerThread *thread = (TimerThread *)arg, **link;
+  int i;
+  pthread_mutex_lock(&timer_mutex);
+  for (link = &timer_threads; *link != thread; link = &(*link)->next)
+    ;
+  *link = thread->next;
+  for (i = 0; i < TIMER_MAX_SITES; i++) {
+    TimerStats *stats = atomic_load(&thread->stats[i]);
+    if (stats == NULL)
+      continue;
+    if (timer_retired[i] == NULL)
+      timer_retired[i] = create_stats();
+    if (timer_retired[i] != NULL)
+      merge_stats(timer_retired[i], stats);
+    free(stats);
+  }
+  pthread_mutex_unlock(&timer_mutex);
+  free(thread);
+}
+
+static void init_timer_key(void) {
+  pthread_key_create(&timer_key, retire_thread);
+}
+
+static TimerThread *get_thread(void) {
+  TimerThread *thread;
+  if (local_timers != NULL)
+    return local_timers;
+  thread = (TimerThread *)calloc(1, sizeof(TimerThread));
+  if (thread == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return NULL;
+  }
+  pthread_once(&timer_once, init_timer_key);
+  pthread_setspecific(timer_key, thread);
+  pthread_mutex_lock(&timer_mutex);
+  thread->next = timer_threads;
+  timer_threads = thread;
+  pthread_mutex_unlock(&timer_mutex);
+  local_timers = thread;
+  return thread;
+}
+
+/*Gives `site` the next id, or -1 when TIMER_MAX_SITES are taken.*/
+static int register_timer(TimerSite *site) {
+  int id;
+  pthread_mutex_lock(&timer_mutex);
+  id = __atomic_load_n(&site->id, __ATOMIC_RELAXED);
+  if (id == 0) {
+    if (timer_site_count == 0) {
+      calibrate_ticks = timer_ticks();
+      calibrate_ns = monotonic_ns();
+    }
+    if (timer_site_count < TIMER_MAX_SITES) {
+      timer_sites[timer_site_count++] = site;
+      id = timer_site_count;
+    } else {
+      fprintf(stderr, "ERROR: More than %d timer sites, %s:%d is not timed.\n",
+              TIMER_MAX_SITES, site->file, site->line);
+      id = -1;
+    }
+    __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&timer_mutex);
+  return id;
+}
+
+void record_timer(TimerSite *site, uint64_t ticks) {
+  int id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+  TimerThread *thread;
+  TimerStats *stats;
+  if (id == 0)
+    id = register_timer(site);
+  if (id < 0 || (thread = get_thread()) == NULL)
+    return;
+  stats = atomic_load_explicit(&thread->stats[id - 1], memory_order_relaxed);
+  if (stats == NULL) {
+    if ((stats = create_stats()) == NULL)
+      return;
+    atomic_store_explicit(&thread->stats[id - 1], stats, memory_order_release);
+  }
+  if (get(&stats->count) == 0 || ticks < get(&stats->min))
+    atomic_store_explicit(&stats->min, ticks, memory_order_relaxed);
+  if (ticks > get(&stats->max))
+    atomic_store_explicit(&stats->max, ticks, memory_order_relaxed);
+  add(&stats->total, ticks);
+  add(&stats->buckets[bucket_of(ticks)], 1);
+  add(&stats->count, 1);
+}
+
+double timer_tick_ns(void) {
+#ifdef TIMING_TSC
+  uint64_t ns, ticks;
+  pthread_mutex_lock(&timer_mutex);
+  if (timer_site_count == 0) {
+    calibrate_ticks = timer_ticks();
+    calibrate_ns = monotonic_ns();
+  }
+  ns = calibrate_ns;
+  ticks = calibrate_ticks;
+  pthread_mutex_unlock(&timer_mutex);
+  /*a short baseline makes a poor ratio; give it at least 10 ms*/
+  while (monotonic_ns() - ns < 10000000u) {
+    struct timespec ts = {0, 1000000};
+    nanosleep(&ts, NULL);
+  }
+  ns = monotonic_ns() - ns;
+  return (double)ns / (double)(timer_ticks() - ticks);
+#else
+  return 1.0;
+#endif
+}
+
+static double percentile(TimerStats *stats, double q, double tick_ns) {
+  uint64_t count = get(&stats->count), seen = 0;
+  uint64_t rank = (uint64_t)(q * (double)count + 0.999999);
+  double value;
+  int b;
+  if (rank == 0)
+    rank = 1;
+  for (b = 0; b < TIMER_BUCKETS; b++) {
+    seen += get(&stats->buckets[b]);
+    if (seen >= rank)
+      break;
+  }
+  value = bucket_value(b);
+  if (value < (double)get(&stats->min))
+    value = (double)get(&stats->min);
+  if (value > (double)get(&stats->max))
+    value = (double)get(&stats->max);
+  return value * tick_ns;
+}
+
+int collect_timers(TimerReport *reports, int max) {
+  double tick_ns = timer_tick_ns();
+  TimerStats *merged = create_stats();
+  TimerThread *thread;
+  int i, n = 0;
+  if (merged == NULL)
+    return 0;
+  pthread_mutex_lock(&timer_mutex);
+  for (i = 0; i < timer_site_count && n < max; i++) {
+    TimerReport *r = &reports[n];
+    memset(merged, 0, sizeof(TimerStats));
+    if (timer_retired[i] != NULL)
+      merge_stats(merged, timer_retired[i]);
+    for (thread = timer_threads; thread != NULL; thread = thread->next) {
+      TimerStats *stats =
+          atomic_load_explicit(&thread->stats[i], memory_order_acquire);
+      if (stats != NULL)
+        merge_stats(merged, stats);
+    }
+    if (get(&merged->count) == 0)
+      continue;
+    r->name = timer_sites[i]->name;
+    r->file = timer_sites[i]->file;
+    r->line = timer_sites[i]->line;
+    r->count = get(&merged->count);
+    r->total = (double)get(&merged->total) * tick_ns;
+    r->min = (double)get(&merged->min) * tick_ns;
+    r->max = (double)get(&merged->max) * tick_ns;
+    r->mean = r->total / (double)r->count;
+    r->p50 = percentile(merged, 0.5, tick_ns);
+    r->p90 = percentile(merged, 0.9, tick_ns);
+    r->p99 = percentile(merged, 0.99, tick_ns);
+    r->p999 = percentile(merged, 0.999, tick_ns);
+    n++;
+  }
+  pthread_mutex_unlock(&timer_mutex);
+  free(merged);
+  return n;
+}
+
+/*Formats nanoseconds with a unit that keeps 3-4 significant digits.*/
+static const char *format_ns(double ns, char *out, size_t size) {
+  if (ns < 1e3)
+    snprintf(out, size, "%6.0f ns", ns);
+  else if (ns < 1e6)
+    snprintf(out, size, "%6.2f us", ns / 1e3);
+  else if (ns < 1e9)
+    snprintf(out, size, "%6.2f ms", ns / 1e6);
+  else
+    snprintf(out, size, "%6.2f s ", ns / 1e9);
+  return out;
+}
+
+void report_timers(void) {
+  TimerReport reports[TIMER_MAX_SITES];
+  char a[16], b[16], c[16], d[16], e[16];
+  int i, n = collect_timers(reports, TIMER_MAX_SITES);
+  for (i = 0; i < n; i++) {
+    TimerReport *r = &reports[i];
+    color_print(CYAN, "", BOLD, "%-24s", r->name);
+    color_print(MAGENTA, "", "", " %s:%d", r->file, r->line);
+    printf("\n  n %-10llu mean %s  p50 ", (unsigned long long)r->count,
+           format_ns(r->mean, a, sizeof a));
+    color_print(GREEN, "", "", "%s", format_ns(r->p50, b, sizeof b));
+    printf("  p90 %s  p99 ", format_ns(r->p90, c, sizeof c));
+    color_print(YELLOW, "", "", "%s", format_ns(r->p99, d, sizeof d));
+    printf("  p99.9 %s  max ", format_ns(r->p999, e, sizeof e));
+    color_print(RED, "", "", "%s", format_ns(r->max, a, sizeof a));
+    printf("  total %s\n", format_ns(r->total, b, sizeof b));
+  }
+}
+
+void reset_timers(void) {
+  TimerThread *thread;
+  int i;
+  pthread_mutex_lock(&timer_mutex);
+  for (i = 0; i < timer_site_count; i++) {
+    if (timer_retired[i] != NULL)
+      memset(timer_retired[i], 0, sizeof(TimerStats));
+    for (thread = timer_threads; thread != NULL; thread = thread->next) {
+      TimerStats *stats = atomic_load(&thread->stats[i]);
+      if (stats != NULL)
+        memset(stats, 0, sizeof(TimerStats));
+    }
+  }
+  pthread_mutex_unlock(&timer_mutex);
+}
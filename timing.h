@@ -0,0 +1,134 @@
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h> /*Includes `clock_gettime` for the portable clock.*/
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(TIMING_USE_CLOCK)
+#include <x86intrin.h> /*Includes `__rdtsc`.*/
+#define TIMING_TSC
+#endif
+
+#include "utils.h"
+
+/*SCOPED TIMERS*/
+
+/*Latency instrumentation for hot paths. Each timed call site owns a static
+ * TimerSite; every thread accumulates count, total, min, max and an HDR style
+ * histogram (16 sub-buckets per power of two, about 6% resolution) for the
+ * site in thread-local storage, so recording takes no lock and shares no
+ * cache line. `report_timers` merges the threads and prints the percentiles.
+ *
+ * Ticks come from the TSC on x86 (converted to nanoseconds against
+ * CLOCK_MONOTONIC when reporting) and from clock_gettime elsewhere or with
+ * -DTIMING_USE_CLOCK.
+ *
+ * Usage:
+ *   void handle(Vector *v) {
+ *     TIMER_SCOPE("handle");           // stops at the end of the block
+ *     ...
+ *   }
+ *   TIMER_BEGIN(push, "push_back");   // or an explicit pair
+ *   push_back_vector(&v, 1);
+ *   TIMER_END(push);
+ *   report_timers();*/
+#define TIMER_MAX_SITES 256
+#define TIMER_BUCKETS 976 /*16 exact values, then 16 per power of two*/
+
+typedef struct {
+  const char *name;
+  const char *file;
+  int line;
+  int id; /*0 until first use; read with __atomic builtins*/
+} TimerSite;
+
+typedef struct {
+  TimerSite *site;
+  uint64_t start;
+} TimerScope;
+
+#define TIMER_SITE_INIT(name) {(name), __FILE__, __LINE__, 0}
+
+static inline uint64_t timer_ticks(void) {
+#ifdef TIMING_TSC
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*Adds one measurement of `ticks` to the calling thread's stats for `site`.*/
+void record_timer(TimerSite *site, uint64_t ticks);
+
+static inline TimerScope begin_timer(TimerSite *site) {
+  TimerScope scope;
+  scope.site = site;
+  scope.start = timer_ticks();
+  return scope;
+}
+
+static inline void end_timer(TimerScope *scope) {
+  record_timer(scope->site, timer_ticks() - scope->start);
+}
+
+#define TIMER_CONCAT_(a, b) a##b
+#define TIMER_CONCAT(a, b) TIMER_CONCAT_(a, b)
+
+#ifdef __cplusplus
+struct TimerGuard {
+  TimerScope scope;
+  explicit TimerGuard(TimerSite *site) : scope(begin_timer(site)) {}
+  ~TimerGuard() { end_timer(&scope); }
+};
+
+#define TIMER_SCOPE(name)                                                      \
+  static TimerSite TIMER_CONCAT(timer_site_, __LINE__) =                       \
+      TIMER_SITE_INIT(name);                                                   \
+  TimerGuard TIMER_CONCAT(timer_scope_, __LINE__)(                             \
+      &TIMER_CONCAT(timer_site_, __LINE__))
+#else
+/*Stops the timer when the enclosing block exits, including by return.*/
+#define TIMER_SCOPE(name)                                                      \
+  static TimerSite TIMER_CONCAT(timer_site_, __LINE__) =                       \
+      TIMER_SITE_INIT(name);                                                   \
+  TimerScope TIMER_CONCAT(timer_scope_, __LINE__)                              \
+      __attribute__((cleanup(end_timer))) =                                    \
+          begin_timer(&TIMER_CONCAT(timer_site_, __LINE__))
+#endif
+
+#define TIMER_BEGIN(var, name)                                                 \
+  static TimerSite var##_timer_site = TIMER_SITE_INIT(name);                   \
+  TimerScope var = begin_timer(&var##_timer_site)
+#define TIMER_END(var) end_timer(&var)
+
+/*Merged stats of one site across all threads, in nanoseconds.*/
+typedef struct {
+  const char *name;
+  const char *file;
+  int line;
+  uint64_t count;
+  double total, min, max, mean;
+  double p50, p90, p99, p999;
+} TimerReport;
+
+/*Fills `reports` with up to `max` sites that recorded something and returns
+ * how many.*/
+int collect_timers(TimerReport *reports, int max);
+/*Prints one colored line per site with count, mean and percentiles.*/
+void report_timers(void);
+/*Clears every thread's stats. Must not race with recording.*/
+void reset_timers(void);
+/*Nanoseconds per tick of `timer_ticks`.*/
+double timer_tick_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TIMING_H__
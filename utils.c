@@ -1,7 +1,11 @@
 #define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
                            features for this file*/
+#define UTILS_DEFINE_ACCESSORS /*Emits the exported Vector accessors here.*/
 #include "utils.h"
 
+#include <stdatomic.h> /*Includes atomics for the cached color decision.*/
+#include <unistd.h>    /*Includes `isatty` and `STDOUT_FILENO`.*/
+
 void print_matrix_neighbor_coordinates_rules(void) {
   puts("|---------|---------|---------|");
   puts("|(-1, -1) | (-1, 0) | (-1, 1) |");
@@ -16,9 +20,64 @@ void print_matrix_neighbor_coordinates_rules(void) {
   /*puts("[ (r + 1, c - 1) ][ (r + 1, c + 0) ][ (r + 1, c + 1) ]");*/
 }
 
+static atomic_int color_mode = COLOR_AUTO;
+/*-1 until read, then whether NO_COLOR leaves colors on*/
+static atomic_int color_allowed = -1;
+/*-1 until checked, then whether stdout is a terminal*/
+static atomic_int color_stdout_tty = -1;
+
+bool use_color_tty(bool tty) {
+  int mode = atomic_load_explicit(&color_mode, memory_order_relaxed);
+  int allowed;
+  if (mode != COLOR_AUTO)
+    return mode == COLOR_ALWAYS;
+  allowed = atomic_load_explicit(&color_allowed, memory_order_relaxed);
+  if (allowed < 0) {
+    const char *no_color = getenv("NO_COLOR");
+    allowed = no_color == NULL || no_color[0] == '\0';
+    atomic_store_explicit(&color_allowed, allowed, memory_order_relaxed);
+  }
+  return allowed && tty;
+}
+
+bool use_color_fd(int fd) { return use_color_tty(isatty(fd)); }
+
+bool use_color(void) {
+  int tty = atomic_load_explicit(&color_stdout_tty, memory_order_relaxed);
+  if (tty < 0) {
+    tty = isatty(STDOUT_FILENO);
+    atomic_store_explicit(&color_stdout_tty, tty, memory_order_relaxed);
+  }
+  return use_color_tty(tty);
+}
+
+void set_color_mode(int mode) {
+  if (mode == COLOR_AUTO) { /*look at the environment and stdout again*/
+    atomic_store(&color_allowed, -1);
+    atomic_store(&color_stdout_tty, -1);
+  }
+  atomic_store(&color_mode, mode);
+}
+
+void style_print(const ColorStyle *style, const char *format, ...) {
+  va_list args;
+  bool color = use_color();
+  va_start(args, format);
+  if (color)
+    fwrite(style->seq, 1, style->len, stdout);
+  vprintf(format, args);
+  if (color)
+    fputs(RESET, stdout);
+  va_end(args);
+}
+
 void debug_puts(char *str, int lineNumber, char *fileName) {
-  printf("F: %s%s%s ", CYAN, fileName, RESET);
-  printf("L: %s%d%s ", MAGENTA, lineNumber, RESET);
+  if (use_color()) {
+    printf("F: %s%s%s ", CYAN, fileName, RESET);
+    printf("L: %s%d%s ", MAGENTA, lineNumber, RESET);
+  } else {
+    printf("F: %s L: %d ", fileName, lineNumber);
+  }
   printf("O: %s", str);
   putchar('\n');
 }
@@ -492,10 +551,8 @@ system zeroes out memory.
 /*VECTOR*/
 Vector create_vector(size_t size) {
   Vector vector;
-  if (size < 0)
-    size = 1;
   vector.size = size;
-  vector.capacity = size * 2;
+  vector.capacity = size > 0 ? size * 2 : 1;
   vector.arr = (int *)malloc(vector.capacity * sizeof(int));
   if (vector.arr == NULL) {
     fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
@@ -511,7 +568,7 @@ void destroy_vector(Vector *vector) {
 }
 
 void expand_capacity_vector(Vector *vector) {
-  vector->capacity *= 2;
+  vector->capacity = vector->capacity > 0 ? vector->capacity * 2 : 1;
   printf("Expand capacity to %lu", vector->capacity);
   vector->arr = (int *)realloc(vector->arr, vector->capacity * sizeof(int));
   if (vector->arr == NULL) {
@@ -519,20 +576,32 @@ void expand_capacity_vector(Vector *vector) {
   }
 }
 
-size_t get_size_vector(Vector *vector) { return vector->size; }
+/*Out of line, so the checked accessors only carry a compare and a call.*/
+void range_error_vector(size_t index, size_t size) {
+  fprintf(stderr, "ERROR: Index %zu out of range for size %zu.\n", index,
+          size);
+  abort();
+}
 
-int get_index_vector(Vector *vector, size_t index) {
-  if (index < 0 || index >= vector->size) {
-    fprintf(stderr, "ERROR: Index out of range.\n");
-  }
-  return vector->arr[index];
+int try_get_index_vector(Vector *vector, size_t index, int *value) {
+  if (index >= vector->size)
+    return -1;
+  *value = vector->arr[index];
+  return 0;
 }
 
-void set_index_vector(Vector *vector, size_t index, int value) {
-  if (index < 0 || index >= vector->size) {
-    fprintf(stderr, "ERROR: Index out of range.\n");
-  }
+int try_set_index_vector(Vector *vector, size_t index, int value) {
+  if (index >= vector->size)
+    return -1;
   vector->arr[index] = value;
+  return 0;
+}
+
+int try_pop_vector(Vector *vector, size_t index, int *value) {
+  if (index >= vector->size)
+    return -1;
+  *value = pop_vector(vector, index);
+  return 0;
 }
 
 void print_vector(Vector *vector) {
@@ -552,27 +621,16 @@ int find_value_vector(Vector *vector, int value) {
   return -1;
 }
 
-int get_front_vector(Vector *vector) { return vector->arr[0]; }
-int get_back_vector(Vector *vector) { return vector->arr[vector->size - 1]; }
-
-void push_back_vector(Vector *vector, int value) {
-  if (vector->size == vector->capacity)
-    expand_capacity_vector(vector);
-  vector->arr[vector->size++] = value;
-}
-
 void insert_vector(Vector *vector, size_t index, int value) {
-  if (index < 0 || index >= vector->size) {
-    fprintf(stderr, "ERROR: Index out of range.\n");
-  }
+  CHECK_RANGE_VECTOR(index, vector->size + 1); /*index == size appends*/
 
   if (vector->size == vector->capacity)
     expand_capacity_vector(vector);
 
   // Shift all the data to right first
   size_t i;
-  for (i = vector->size - 1; i >= index; i++)
-    vector->arr[i + 1] = vector->arr[i];
+  for (i = vector->size; i > index; i--)
+    vector->arr[i] = vector->arr[i - 1];
 
   vector->arr[index] = value;
   vector->size++;
@@ -583,8 +641,8 @@ void right_rotate_vector(Vector *vector) {
   int last_element = vector->arr[vector->size - 1];
   // right shift first size-1 elements
   size_t i;
-  for (i = vector->size - 2; i >= 0; i--)
-    vector->arr[i + 1] = vector->arr[i];
+  for (i = vector->size - 1; i > 0; i--)
+    vector->arr[i] = vector->arr[i - 1];
   vector->arr[0] = last_element;
 }
 
@@ -610,10 +668,7 @@ void right_rotate_n_times_vector(Vector *vector, int times) {
 }
 
 int pop_vector(Vector *vector, size_t index) {
-
-  if (index < 0 || index >= vector->size) {
-    fprintf(stderr, "ERROR: Index out of range.\n");
-  }
+  CHECK_RANGE_VECTOR(index, vector->size);
   int value = vector->arr[index];
 
   // Shift all the data to left
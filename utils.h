@@ -88,6 +88,42 @@ extern "C" {
  * black\n"*/
 /*RESET);*/
 
+/*COLOR OUTPUT*/
+
+/*Colors are only worth their bytes on a terminal, so each destination
+ * decides for itself: on when it is a TTY and NO_COLOR is unset or empty, off
+ * otherwise (redirected logs carry no escape codes). `use_color` answers for
+ * stdout and checks it once; `use_color_fd` checks `fd` on every call, and
+ * `use_color_tty` takes a TTY test the caller has cached. `set_color_mode`
+ * overrides all three.*/
+enum { COLOR_AUTO, COLOR_ALWAYS, COLOR_NEVER };
+
+bool use_color(void);
+bool use_color_fd(int fd);
+bool use_color_tty(bool tty);
+void set_color_mode(int mode);
+
+/*A style handle: fg, bg and style composed at compile time into one escape
+ * sequence, printed with a single write (or not at all when colors are off).
+ * The arguments must be string literals.*/
+typedef struct {
+  const char *seq;
+  size_t len;
+} ColorStyle;
+
+#define COLOR_STYLE(fg, bg, style) {fg bg style, sizeof(fg bg style) - 1}
+
+/*The escape string of a handle and the reset, or "" when colors are off.*/
+#define STYLE_SEQ(handle) (use_color() ? (handle).seq : "")
+#define COLOR_RESET (use_color() ? RESET : "")
+
+/*Example usage:*/
+/*static const ColorStyle warning = COLOR_STYLE(RED, BG_YELLOW, BOLD);*/
+/*style_print(&warning, "Disk %d%% full\n", 93);*/
+/*printf("%sWarning!%s\n", STYLE_SEQ(warning), COLOR_RESET);*/
+
+void style_print(const ColorStyle *style, const char *format, ...);
+
 /*a simple color_print helper function that takes foreground color, background
  * color, style, and your message, and automatically prints it with a reset at
  * the end:*/
@@ -96,10 +132,13 @@ extern "C" {
 static inline void color_print(const char *fg, const char *bg,
                                const char *style, const char *format, ...) {
   va_list args;
+  bool color = use_color();
   va_start(args, format);
-  printf("%s%s%s", fg, bg, style); // Apply colors and styles
-  vprintf(format, args);           // Print the actual message
-  printf(RESET);                   // Reset colors/styles after
+  if (color)
+    printf("%s%s%s", fg, bg, style); // Apply colors and styles
+  vprintf(format, args);             // Print the actual message
+  if (color)
+    fputs(RESET, stdout); // Reset colors/styles after
   va_end(args);
 }
 
@@ -184,23 +223,62 @@ exit_crash(unsigned int i); /* function guaranteed to crash (Writes to NULL).*/
 
 /*VECTOR*/
 
+/*The accessors are `static inline` so a caller in any translation unit
+ * compiles `get_index_vector(&v, i)` down to the load itself, without LTO.
+ * The growth and error paths they reach stay out of line in utils.c.
+ *
+ * For a single-file drop-in, `make utils_single.h` amalgamates every header
+ * and source of the library; define UTILS_IMPLEMENTATION in exactly one file
+ * before including it:
+ *   #define UTILS_IMPLEMENTATION
+ *   #include "utils_single.h"*/
+
+/*Bounds checking is chosen at compile time with VECTOR_CHECKS:
+ *   1  an index out of range prints the index and size and aborts
+ *   0  no checks at all; the accessors are a bare load or store
+ * It defaults to 0 under NDEBUG (`make release`) and 1 otherwise. The try_
+ * functions always check and return -1 instead, for callers that recover.
+ * Hot loops can take the whole array with `get_data_vector` or a bounds
+ * checked slice with `get_span_vector` and index it with no calls.*/
+#ifndef VECTOR_CHECKS
+#ifdef NDEBUG
+#define VECTOR_CHECKS 0
+#else
+#define VECTOR_CHECKS 1
+#endif
+#endif
+
+#if VECTOR_CHECKS
+#define CHECK_RANGE_VECTOR(index, size)                                        \
+  do {                                                                         \
+    if ((index) >= (size))                                                     \
+      range_error_vector(index, size);                                         \
+  } while (0)
+#else
+#define CHECK_RANGE_VECTOR(index, size) ((void)0)
+#endif
+
 typedef struct {
   int *arr;
   size_t size;     /*user size*/
   size_t capacity; /*actual size*/
 } Vector;
 
+/*A view of `size` elements of a Vector, valid until the Vector grows.*/
+typedef struct {
+  int *data;
+  size_t size;
+} VectorSpan;
+
 Vector create_vector(size_t size);
 void destroy_vector(Vector *vector);
 void expand_capacity_vector(Vector *vector);
-size_t get_size_vector(Vector *vector);
-int get_index_vector(Vector *vector, size_t index);
-void set_index_vector(Vector *vector, size_t index, int value);
+#if defined(__GNUC__)
+__attribute__((noreturn, cold))
+#endif
+void range_error_vector(size_t index, size_t size);
 void print_vector(Vector *vector);
 int find_value_vector(Vector *vector, int value);
-int get_front_vector(Vector *vector);
-int get_back_vector(Vector *vector);
-void push_back_vector(Vector *vector, int value);
 void insert_vector(Vector *vector, size_t index, int value);
 void right_rotate_vector(Vector *vector);
 void left_rotate_vector(Vector *vector);
@@ -208,6 +286,76 @@ void right_rotate_n_times_vector(Vector *vector, int times);
 int pop_vector(Vector *vector, size_t index);
 int find_transposition_vector(Vector *vector, int value);
 
+/*Checked in every build: 0 on success, -1 when `index` is out of range.*/
+int try_get_index_vector(Vector *vector, size_t index, int *value);
+int try_set_index_vector(Vector *vector, size_t index, int value);
+int try_pop_vector(Vector *vector, size_t index, int *value);
+
+/*The hot accessors are exported functions of the library. Define
+ * UTILS_INLINE before including utils.h to get them as static inline
+ * functions instead, so every call is the load itself even without LTO;
+ * utils_single.h does. utils.c defines UTILS_DEFINE_ACCESSORS to emit the
+ * exported definitions.*/
+#ifdef UTILS_INLINE
+#define UTILS_ACCESSOR static inline
+#else
+#define UTILS_ACCESSOR
+#endif
+
+#if defined(UTILS_INLINE) || defined(UTILS_DEFINE_ACCESSORS)
+UTILS_ACCESSOR size_t get_size_vector(Vector *vector) { return vector->size; }
+
+UTILS_ACCESSOR int get_index_vector(Vector *vector, size_t index) {
+  CHECK_RANGE_VECTOR(index, vector->size);
+  return vector->arr[index];
+}
+
+UTILS_ACCESSOR void set_index_vector(Vector *vector, size_t index, int value) {
+  CHECK_RANGE_VECTOR(index, vector->size);
+  vector->arr[index] = value;
+}
+
+UTILS_ACCESSOR int get_front_vector(Vector *vector) {
+  CHECK_RANGE_VECTOR((size_t)0, vector->size);
+  return vector->arr[0];
+}
+UTILS_ACCESSOR int get_back_vector(Vector *vector) {
+  CHECK_RANGE_VECTOR(vector->size - 1, vector->size);
+  return vector->arr[vector->size - 1];
+}
+
+UTILS_ACCESSOR void push_back_vector(Vector *vector, int value) {
+  if (vector->size == vector->capacity)
+    expand_capacity_vector(vector);
+  vector->arr[vector->size++] = value;
+}
+#else
+size_t get_size_vector(Vector *vector);
+int get_index_vector(Vector *vector, size_t index);
+void set_index_vector(Vector *vector, size_t index, int value);
+int get_front_vector(Vector *vector);
+int get_back_vector(Vector *vector);
+void push_back_vector(Vector *vector, int value);
+#endif
+
+/*The elements, `get_size_vector` of them.*/
+static inline int *get_data_vector(Vector *vector) { return vector->arr; }
+
+/*Elements [begin, end).*/
+static inline VectorSpan get_span_vector(Vector *vector, size_t begin,
+                                         size_t end) {
+  VectorSpan span;
+  CHECK_RANGE_VECTOR(end, vector->size + 1);
+  CHECK_RANGE_VECTOR(begin, end + 1);
+  span.data = vector->arr + begin;
+  span.size = end - begin;
+  return span;
+}
+
+/*Example usage:*/
+/*VectorSpan s = get_span_vector(&v, 0, get_size_vector(&v));*/
+/*for (i = 0; i < s.size; i++) sum += s.data[i];*/
+
 #ifdef __cplusplus
 }
 #endif
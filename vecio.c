@@ -0,0 +1,710 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "vecio.h"
+
+#include <errno.h>
+#include <fcntl.h>    /*Includes `open` and `posix_fadvise`.*/
+#include <stdint.h>
+#include <sys/stat.h> /*Includes `fstat` to tell regular files from pipes.*/
+#include <unistd.h>   /*Includes `read`, `write` and `pread`.*/
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> /*Includes the ring layout and IORING_OP_READ.*/
+#include <sys/mman.h>       /*Includes `mmap` for the rings.*/
+#include <sys/syscall.h>    /*Includes `__NR_io_uring_setup`.*/
+#if defined(IORING_FEAT_FAST_POLL) && defined(__NR_io_uring_enter)
+#define VECTOR_IO_URING 1
+#endif
+#endif
+#endif
+#ifndef VECTOR_IO_URING
+#define VECTOR_IO_URING 0
+#endif
+
+/*VECTOR I/O*/
+
+/*Every buffer has CARRY bytes in front, where the unfinished token at the
+ * end of the previous chunk is copied, and PAD zero bytes after the data,
+ * which stop digit runs and keep 8 byte loads inside the allocation.*/
+#define CARRY 64
+#define PAD 16
+
+VectorIOOptions default_vector_io_options(void) {
+  VectorIOOptions options;
+  options.chunk = VECTOR_IO_CHUNK;
+  options.io_uring = true;
+  return options;
+}
+
+static size_t chunk_size(const VectorIOOptions *options) {
+  size_t chunk = options != NULL ? options->chunk : VECTOR_IO_CHUNK;
+  if (chunk == 0)
+    chunk = VECTOR_IO_CHUNK;
+  return (chunk + 4095) / 4096 * 4096;
+}
+
+/*Reads until `len` bytes or the end of the file; -1 on error.*/
+static long long read_full(int fd, char *data, size_t len, long long offset,
+                           bool positioned) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = positioned
+                    ? pread(fd, data + done, len - done, (off_t)offset + done)
+                    : read(fd, data + done, len - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    done += (size_t)n;
+  }
+  return (long long)done;
+}
+
+static int write_full(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+/*IO_URING*/
+
+#if VECTOR_IO_URING
+/*A two entry ring driven with raw system calls: one read per buffer in
+ * flight at a time, tagged with the buffer index.*/
+typedef struct {
+  int fd;
+  unsigned int *sq_tail, *sq_mask, *sq_array;
+  unsigned int *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring, *cq_ring;
+  size_t sq_size, cq_size, sqes_size;
+} IoRing;
+
+static int setup_ring(IoRing *ring) {
+  struct io_uring_params params;
+  bool single;
+  memset(&params, 0, sizeof params);
+  ring->fd = (int)syscall(__NR_io_uring_setup, 2, &params);
+  if (ring->fd < 0)
+    return -1;
+  single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (single && ring->cq_size > ring->sq_size)
+    ring->sq_size = ring->cq_size;
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sq_ring = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = single ? ring->sq_ring
+                         : mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size,
+                                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                                           ring->fd, IORING_OFF_SQES);
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED ||
+      ring->sqes == MAP_FAILED) {
+    if (ring->sq_ring != MAP_FAILED)
+      munmap(ring->sq_ring, ring->sq_size);
+    if (!single && ring->cq_ring != MAP_FAILED)
+      munmap(ring->cq_ring, ring->cq_size);
+    if (ring->sqes != MAP_FAILED)
+      munmap(ring->sqes, ring->sqes_size);
+    close(ring->fd);
+    return -1;
+  }
+  if (single)
+    ring->cq_size = 0; /*unmapped with the submission ring*/
+  ring->sq_tail = (unsigned int *)((char *)ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask =
+      (unsigned int *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_array =
+      (unsigned int *)((char *)ring->sq_ring + params.sq_off.array);
+  ring->cq_head = (unsigned int *)((char *)ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (unsigned int *)((char *)ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask =
+      (unsigned int *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes =
+      (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+  return 0;
+}
+
+static void close_ring(IoRing *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_size > 0)
+    munmap(ring->cq_ring, ring->cq_size);
+  munmap(ring->sq_ring, ring->sq_size);
+  close(ring->fd);
+}
+
+static int submit_read(IoRing *ring, int fd, char *data, size_t len,
+                       long long offset, int tag) {
+  unsigned int tail = *ring->sq_tail, index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof *sqe);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)data;
+  sqe->len = (uint32_t)len;
+  sqe->off = (uint64_t)offset;
+  sqe->user_data = (uint64_t)tag;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) == 1 ? 0
+                                                                      : -1;
+}
+
+/*Takes one completion, waiting for it if none is ready.*/
+static int reap_read(IoRing *ring, int *tag, long long *result) {
+  for (;;) {
+    unsigned int head = *ring->cq_head;
+    if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      *tag = (int)cqe->user_data;
+      *result = cqe->res;
+      __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+      return 0;
+    }
+    if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+                NULL, 0) < 0 &&
+        errno != EINTR)
+      return -1;
+  }
+}
+#endif
+
+/*CHUNK READER*/
+
+typedef struct {
+  int fd;
+  const char *path;
+  size_t chunk;
+  char *memory[2];
+  long long start[2]; /*file offset of each buffer's data*/
+  long long offset;   /*file offset of the next read*/
+  int next;           /*buffer handed out by the next `next_chunk`*/
+  bool end;           /*a read came up short: no more reads*/
+  bool regular;
+#if VECTOR_IO_URING
+  IoRing ring;
+  bool use_ring;
+  bool pending[2];
+  bool done[2];
+  long long result[2];
+#endif
+} ChunkReader;
+
+static char *chunk_data(ChunkReader *reader, int b) {
+  return reader->memory[b] + CARRY;
+}
+
+static void close_reader(ChunkReader *reader) {
+#if VECTOR_IO_URING
+  if (reader->use_ring) {
+    int tag;
+    long long result;
+    /*the kernel may still write into the buffers*/
+    while ((reader->pending[0] && !reader->done[0]) ||
+           (reader->pending[1] && !reader->done[1])) {
+      if (reap_read(&reader->ring, &tag, &result) != 0)
+        break;
+      reader->done[tag] = true;
+    }
+    close_ring(&reader->ring);
+  }
+#endif
+  free(reader->memory[0]);
+  free(reader->memory[1]);
+  if (reader->fd >= 0)
+    close(reader->fd);
+}
+
+#if VECTOR_IO_URING
+static void submit_chunk(ChunkReader *reader, int b) {
+  reader->start[b] = reader->offset;
+  reader->offset += (long long)reader->chunk;
+  reader->done[b] = false;
+  reader->pending[b] =
+      submit_read(&reader->ring, reader->fd, chunk_data(reader, b),
+                  reader->chunk, reader->start[b], b) == 0;
+}
+#endif
+
+static int open_reader(ChunkReader *reader, const char *path,
+                       const VectorIOOptions *options) {
+  struct stat st;
+  memset(reader, 0, sizeof *reader);
+  reader->path = path;
+  reader->chunk = chunk_size(options);
+  reader->fd = open(path, O_RDONLY);
+  if (reader->fd < 0) {
+    fprintf(stderr, "ERROR: Cannot open %s.\n", path);
+    return -1;
+  }
+  reader->memory[0] = (char *)malloc(CARRY + reader->chunk + PAD);
+  reader->memory[1] = (char *)malloc(CARRY + reader->chunk + PAD);
+  if (reader->memory[0] == NULL || reader->memory[1] == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    close_reader(reader);
+    return -1;
+  }
+  reader->regular = fstat(reader->fd, &st) == 0 && S_ISREG(st.st_mode);
+#if defined(POSIX_FADV_SEQUENTIAL)
+  if (reader->regular)
+    posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#if VECTOR_IO_URING
+  if (reader->regular && (options == NULL || options->io_uring) &&
+      setup_ring(&reader->ring) == 0) {
+    reader->use_ring = true;
+    submit_chunk(reader, 0);
+    submit_chunk(reader, 1);
+  }
+#endif
+  return 0;
+}
+
+#if VECTOR_IO_URING
+/*Waits for the ring read into buffer `b`; -1 if the kernel rejected it.*/
+static long long wait_chunk(ChunkReader *reader, int b) {
+  while (reader->pending[b] && !reader->done[b]) {
+    int tag;
+    long long result;
+    if (reap_read(&reader->ring, &tag, &result) != 0)
+      return -1;
+    reader->done[tag] = true;
+    reader->result[tag] = result;
+  }
+  return reader->pending[b] ? reader->result[b] : -1;
+}
+#endif
+
+/*Hands out the next chunk and its length (0 at the end of the file), with
+ * PAD zero bytes after it. Returns NULL on a read error.*/
+static char *next_chunk(ChunkReader *reader, size_t *length) {
+  int b = reader->next;
+  char *data = chunk_data(reader, b);
+  long long got;
+  reader->next = 1 - b;
+#if VECTOR_IO_URING
+  if (reader->use_ring) {
+    got = wait_chunk(reader, b);
+    reader->pending[b] = false;
+    if (got < 0 && reader->start[b] == 0) {
+      /*no IORING_OP_READ on this kernel: go back to read(2) from the start*/
+      wait_chunk(reader, 1 - b);
+      reader->pending[1 - b] = false;
+      close_ring(&reader->ring);
+      reader->use_ring = false;
+      got = read_full(reader->fd, data, reader->chunk, 0, false);
+    } else if (got >= 0 && (size_t)got < reader->chunk && got > 0) {
+      /*a short read need not be the end: finish the chunk in place*/
+      long long rest = read_full(reader->fd, data + got, reader->chunk - got,
+                                 reader->start[b] + got, true);
+      got = rest < 0 ? -1 : got + rest;
+    }
+  } else
+#endif
+    got = reader->end ? 0
+                      : read_full(reader->fd, data, reader->chunk, 0, false);
+  if (got < 0) {
+    fprintf(stderr, "ERROR: Cannot read %s.\n", reader->path);
+    return NULL;
+  }
+  if ((size_t)got < reader->chunk)
+    reader->end = true;
+  memset(data + got, 0, PAD);
+  *length = (size_t)got;
+  return data;
+}
+
+/*Gives the buffer of the current chunk back for the read after the next
+ * one; its data must no longer be needed.*/
+static void release_chunk(ChunkReader *reader) {
+#if VECTOR_IO_URING
+  if (reader->use_ring && !reader->end)
+    submit_chunk(reader, 1 - reader->next);
+#else
+  (void)reader;
+#endif
+}
+
+/*TEXT PARSING*/
+
+typedef struct {
+  VectorBatch fn;
+  void *ctx;
+  const char *path;
+  long long count;
+  size_t used;
+  bool stopped;
+  int batch[VECTOR_IO_BATCH];
+} TextStream;
+
+static bool flush_batch(TextStream *stream) {
+  if (stream->used > 0 && !stream->stopped) {
+    stream->count += (long long)stream->used;
+    stream->stopped = stream->fn(stream->batch, stream->used, stream->ctx) != 0;
+  }
+  stream->used = 0;
+  return !stream->stopped;
+}
+
+static bool is_separator(unsigned char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == ',';
+}
+
+/*How many of the (up to) 8 bytes in `x`, from the lowest, are digits.*/
+static unsigned int digit_run(uint64_t x, const char *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  /*a byte is a digit when its high nibble is 3 and its low nibble plus 6
+   * does not carry into bit 4*/
+  uint64_t bad = ((x & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull) |
+                 (((x & 0x0F0F0F0F0F0F0F0Full) + 0x0606060606060606ull) &
+                  0x1010101010101010ull);
+  (void)p;
+  bad = (((bad & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | bad) &
+        0x8080808080808080ull;
+  return bad == 0 ? 8 : (unsigned int)__builtin_ctzll(bad) / 8;
+#else
+  unsigned int n = 0;
+  (void)x;
+  while (n < 8 && (unsigned int)(p[n] - '0') < 10)
+    n++;
+  return n;
+#endif
+}
+
+/*The value of the first `n` (1 to 8) digits in `x`.*/
+static uint64_t parse_digits(uint64_t x, unsigned int n, const char *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  /*digits to the top bytes, then pairs, quads and the whole 8 in three
+   * multiplies*/
+  (void)p;
+  x = (x - 0x3030303030303030ull) << (8 * (8 - n));
+  x = x * 10 + (x >> 8);
+  return (((x & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+          (((x >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >>
+         32;
+#else
+  uint64_t value = 0;
+  unsigned int i;
+  (void)x;
+  for (i = 0; i < n; i++)
+    value = value * 10 + (uint64_t)(p[i] - '0');
+  return value;
+#endif
+}
+
+/*Parses [p, end); `end` is followed by PAD zero bytes. Unless `last`, stops
+ * at a token that reaches `end`, which may go on in the next chunk. Returns
+ * where it stopped, or NULL on a malformed token (`base` is the file offset
+ * of `p`, for the message).*/
+static const char *parse_text(TextStream *stream, const char *p,
+                              const char *end, bool last, long long base) {
+  const char *from = p;
+  while (p < end && !stream->stopped) {
+    const char *token = p;
+    bool negative = false;
+    uint64_t x, value;
+    unsigned int n;
+    if (is_separator((unsigned char)*p)) {
+      p++;
+      continue;
+    }
+    if (*p == '-' || *p == '+') {
+      negative = *p == '-';
+      p++;
+    }
+    memcpy(&x, p, sizeof x);
+    n = digit_run(x, p);
+    value = n > 0 ? parse_digits(x, n, p) : 0;
+    p += n;
+    if (n == 8)
+      while ((unsigned int)(*p - '0') < 10 && value <= 2147483648u)
+        value = value * 10 + (uint64_t)(*p++ - '0');
+    if (p >= end && !last)
+      return token;
+    if (value > (negative ? 2147483648u : 2147483647u)) {
+      fprintf(stderr, "ERROR: Integer out of range at byte %lld of %s.\n",
+              base + (token - from), stream->path);
+      return NULL;
+    }
+    if (n == 0 || (p < end && !is_separator((unsigned char)*p))) {
+      fprintf(stderr, "ERROR: Unexpected '%c' at byte %lld of %s.\n",
+              *p != '\0' ? *p : '?', base + (p - from), stream->path);
+      return NULL;
+    }
+    stream->batch[stream->used++] =
+        negative ? (int)(0u - (uint32_t)value) : (int)value;
+    if (stream->used == VECTOR_IO_BATCH)
+      flush_batch(stream);
+  }
+  return p;
+}
+
+long long stream_text_vector(const char *path, VectorBatch fn, void *ctx,
+                             const VectorIOOptions *options) {
+  ChunkReader reader;
+  TextStream *stream;
+  long long offset = 0, count;
+  size_t carried = 0;
+  bool failed = false;
+  if (open_reader(&reader, path, options) != 0)
+    return -1;
+  stream = (TextStream *)malloc(sizeof *stream);
+  if (stream == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    close_reader(&reader);
+    return -1;
+  }
+  stream->fn = fn;
+  stream->ctx = ctx;
+  stream->path = path;
+  stream->count = 0;
+  stream->used = 0;
+  stream->stopped = false;
+  for (;;) {
+    size_t length;
+    char *data = next_chunk(&reader, &length);
+    const char *rest;
+    bool last;
+    if (data == NULL) {
+      failed = true;
+      break;
+    }
+    last = length == 0 || reader.end;
+    rest = parse_text(stream, data - carried, data + length, last,
+                      offset - (long long)carried);
+    if (rest == NULL) {
+      failed = true;
+      break;
+    }
+    offset += (long long)length;
+    carried = (size_t)(data + length - rest);
+    if (last || stream->stopped)
+      break;
+    if (carried > CARRY) {
+      fprintf(stderr, "ERROR: Integer too long at byte %lld of %s.\n",
+              offset - (long long)carried, path);
+      failed = true;
+      break;
+    }
+    memcpy(chunk_data(&reader, reader.next) - carried, rest, carried);
+    release_chunk(&reader);
+  }
+  if (!failed)
+    flush_batch(stream);
+  count = failed ? -1 : stream->count;
+  free(stream);
+  close_reader(&reader);
+  return count;
+}
+
+long long stream_binary_vector(const char *path, VectorBatch fn, void *ctx,
+                               const VectorIOOptions *options) {
+  ChunkReader reader;
+  long long count = 0;
+  bool stopped = false;
+  if (open_reader(&reader, path, options) != 0)
+    return -1;
+  while (!stopped) {
+    size_t length, i;
+    const char *data = next_chunk(&reader, &length);
+    if (data == NULL) {
+      count = -1;
+      break;
+    }
+    if (length % sizeof(int) != 0) {
+      fprintf(stderr, "ERROR: %s is not a whole number of ints.\n", path);
+      count = -1;
+      break;
+    }
+    /*chunks are 4 KiB multiples, so only the last one is short*/
+    for (i = 0; i < length / sizeof(int) && !stopped; i += VECTOR_IO_BATCH) {
+      size_t n = length / sizeof(int) - i;
+      if (n > VECTOR_IO_BATCH)
+        n = VECTOR_IO_BATCH;
+      count += (long long)n;
+      stopped = fn((const int *)data + i, n, ctx) != 0;
+    }
+    if (reader.end)
+      break;
+    release_chunk(&reader);
+  }
+  close_reader(&reader);
+  return count;
+}
+
+/*LOAD AND SAVE*/
+
+/*Appends a batch, doubling the capacity as needed.*/
+static int append_batch(const int *values, size_t count, void *ctx) {
+  Vector *vector = (Vector *)ctx;
+  if (vector->size + count > vector->capacity) {
+    size_t capacity = vector->capacity > 0 ? vector->capacity : 1;
+    int *arr;
+    while (capacity < vector->size + count)
+      capacity *= 2;
+    arr = (int *)realloc(vector->arr, capacity * sizeof(int));
+    if (arr == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    vector->arr = arr;
+    vector->capacity = capacity;
+  }
+  memcpy(vector->arr + vector->size, values, count * sizeof(int));
+  vector->size += count;
+  return 0;
+}
+
+int load_text_vector(Vector *vector, const char *path,
+                     const VectorIOOptions *options) {
+  long long count;
+  vector->size = 0;
+  count = stream_text_vector(path, append_batch, vector, options);
+  return count >= 0 && (size_t)count == vector->size ? 0 : -1;
+}
+
+int load_binary_vector(Vector *vector, const char *path,
+                       const VectorIOOptions *options) {
+  struct stat st;
+  long long count;
+  int fd = open(path, O_RDONLY);
+  vector->size = 0;
+  if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    /*the size is known: one allocation, read straight into the array*/
+    size_t n = (size_t)st.st_size / sizeof(int);
+    long long got;
+    if ((size_t)st.st_size % sizeof(int) != 0) {
+      fprintf(stderr, "ERROR: %s is not a whole number of ints.\n", path);
+      close(fd);
+      return -1;
+    }
+    if (n > vector->capacity) {
+      int *arr = (int *)realloc(vector->arr, n * sizeof(int));
+      if (arr == NULL) {
+        fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+        close(fd);
+        return -1;
+      }
+      vector->arr = arr;
+      vector->capacity = n;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    got = read_full(fd, (char *)vector->arr, n * sizeof(int), 0, false);
+    close(fd);
+    if (got != (long long)(n * sizeof(int))) {
+      fprintf(stderr, "ERROR: Cannot read %s.\n", path);
+      return -1;
+    }
+    vector->size = n;
+    return 0;
+  }
+  if (fd >= 0)
+    close(fd);
+  count = stream_binary_vector(path, append_batch, vector, options);
+  return count >= 0 && (size_t)count == vector->size ? 0 : -1;
+}
+
+static int open_output(const char *path) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    fprintf(stderr, "ERROR: Cannot open %s.\n", path);
+  return fd;
+}
+
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*Writes `value` and a newline at `out`, at most 12 bytes; returns the end.*/
+static char *format_int(char *out, int value) {
+  uint32_t v = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  unsigned int digits = 1;
+  char *p;
+  uint32_t t;
+  for (t = v; t >= 10; t /= 10)
+    digits++;
+  if (value < 0)
+    *out++ = '-';
+  p = out + digits;
+  *p = '\n';
+  while (v >= 100) {
+    uint32_t pair = v % 100;
+    v /= 100;
+    p -= 2;
+    memcpy(p, digit_pairs + 2 * pair, 2);
+  }
+  if (v >= 10) {
+    p -= 2;
+    memcpy(p, digit_pairs + 2 * v, 2);
+  } else {
+    *--p = (char)('0' + v);
+  }
+  return out + digits + 1;
+}
+
+int save_text_vector(Vector *vector, const char *path,
+                     const VectorIOOptions *options) {
+  size_t chunk = chunk_size(options), i;
+  char *buffer, *p;
+  int fd, status = 0;
+  buffer = (char *)malloc(chunk);
+  if (buffer == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  fd = open_output(path);
+  if (fd < 0) {
+    free(buffer);
+    return -1;
+  }
+  p = buffer;
+  for (i = 0; i < vector->size && status == 0; i++) {
+    if ((size_t)(p - buffer) > chunk - 12) {
+      status = write_full(fd, buffer, (size_t)(p - buffer));
+      p = buffer;
+    }
+    p = format_int(p, vector->arr[i]);
+  }
+  if (status == 0)
+    status = write_full(fd, buffer, (size_t)(p - buffer));
+  if (status != 0)
+    fprintf(stderr, "ERROR: Cannot write %s.\n", path);
+  free(buffer);
+  close(fd);
+  return status;
+}
+
+int save_binary_vector(Vector *vector, const char *path,
+                       const VectorIOOptions *options) {
+  size_t chunk = chunk_size(options), bytes = vector->size * sizeof(int), i;
+  const char *data = (const char *)vector->arr;
+  int fd = open_output(path), status = 0;
+  if (fd < 0)
+    return -1;
+  for (i = 0; i < bytes && status == 0; i += chunk)
+    status = write_full(fd, data + i, bytes - i < chunk ? bytes - i : chunk);
+  if (status != 0)
+    fprintf(stderr, "ERROR: Cannot write %s.\n", path);
+  close(fd);
+  return status;
+}
@@ -0,0 +1,71 @@
+#ifndef __VECIO_H__
+#define __VECIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+/*VECTOR I/O*/
+
+/*Bulk load and save for Vector without stdio. Text files hold decimal ints
+ * separated by spaces, tabs, commas or newlines (saved one per line);
+ * binary files hold the raw native ints and nothing else.
+ *
+ * Files are read in chunks of `chunk` bytes into two buffers. With
+ * `io_uring` set, the read of the next chunk runs in the kernel while the
+ * current one is parsed (Linux 5.6 or newer, regular files); everywhere else
+ * each chunk is read with read(2) after asking the kernel for sequential
+ * read ahead. The parser takes 8 digits at a time from one 64 bit load.
+ *
+ * `stream_*` functions hand the values to `fn` in batches of at most
+ * VECTOR_IO_BATCH, so a file of any size is read in memory bounded by two
+ * chunks and one batch.
+ *
+ * Usage:
+ *   Vector v = create_vector(0);
+ *   if (load_text_vector(&v, "ids.txt", NULL) == 0)
+ *     save_binary_vector(&v, "ids.bin", NULL);*/
+#define VECTOR_IO_CHUNK (1 << 20) /*default bytes per read or write*/
+#define VECTOR_IO_BATCH 4096      /*values per `stream_*` callback*/
+
+typedef struct {
+  size_t chunk; /*bytes per read or write, rounded up to 4 KiB*/
+  bool io_uring;
+} VectorIOOptions;
+
+/*Gets `count` values; returns nonzero to stop the stream early.*/
+typedef int (*VectorBatch)(const int *values, size_t count, void *ctx);
+
+/*VECTOR_IO_CHUNK chunks, io_uring on.*/
+VectorIOOptions default_vector_io_options(void);
+
+/*Replace the contents of `vector` with the file's values (growing its
+ * capacity), or write them out. `options` NULL uses the defaults. Return -1
+ * with an error on stderr if the file cannot be read or written or is
+ * malformed: a character other than a digit, sign or separator, an int out
+ * of range, or a binary size that is not a whole number of ints.*/
+int load_text_vector(Vector *vector, const char *path,
+                     const VectorIOOptions *options);
+int save_text_vector(Vector *vector, const char *path,
+                     const VectorIOOptions *options);
+int load_binary_vector(Vector *vector, const char *path,
+                       const VectorIOOptions *options);
+int save_binary_vector(Vector *vector, const char *path,
+                       const VectorIOOptions *options);
+
+/*Return how many values were passed to `fn`, or -1 on the errors above.*/
+long long stream_text_vector(const char *path, VectorBatch fn, void *ctx,
+                             const VectorIOOptions *options);
+long long stream_binary_vector(const char *path, VectorBatch fn, void *ctx,
+                               const VectorIOOptions *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __VECIO_H__
@@ -0,0 +1,614 @@
+#define NO_MEMORY_DEBUG /*A preprocessor directive that disables debug         \
+                           features for this file*/
+#include "vecops.h"
+
+#include <limits.h>
+#include <pthread.h> /*Includes `pthread_once` for the filter table.*/
+#include <stdint.h>
+
+#include "simd.h"
+
+/*BLOCK KERNELS*/
+
+/*Each kernel runs over one block of the array. The AVX2 versions handle
+ * whole groups of 8 and return how many elements they did; the scalar loop
+ * finishes the rest and is the whole kernel without AVX2. Additions go
+ * through unsigned so overflow wraps instead of being undefined.*/
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t sum_block_avx2(const int *a, size_t n,
+                                              long long *sum) {
+  __m256i low = _mm256_setzero_si256(), high = _mm256_setzero_si256();
+  long long lanes[4];
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x));
+    __m256i hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1));
+    low = _mm256_add_epi64(low, lo);
+    high = _mm256_add_epi64(high, hi);
+  }
+  _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(low, high));
+  *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return i;
+}
+#endif
+
+static long long sum_block(const int *a, size_t n) {
+  long long sum = 0;
+  size_t i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = sum_block_avx2(a, n, &sum);
+#endif
+  for (; i < n; i++)
+    sum += a[i];
+  return sum;
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t min_max_block_avx2(const int *a, size_t n,
+                                                  int *min, int *max) {
+  __m256i lo = _mm256_set1_epi32(*min), hi = _mm256_set1_epi32(*max);
+  int lanes[16];
+  size_t i = 0;
+  int k;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    lo = _mm256_min_epi32(lo, x);
+    hi = _mm256_max_epi32(hi, x);
+  }
+  _mm256_storeu_si256((__m256i *)lanes, lo);
+  _mm256_storeu_si256((__m256i *)(lanes + 8), hi);
+  for (k = 0; k < 8; k++) {
+    if (lanes[k] < *min)
+      *min = lanes[k];
+    if (lanes[k + 8] > *max)
+      *max = lanes[k + 8];
+  }
+  return i;
+}
+#endif
+
+static void min_max_block(const int *a, size_t n, int *min, int *max) {
+  size_t i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = min_max_block_avx2(a, n, min, max);
+#endif
+  for (; i < n; i++) {
+    if (a[i] < *min)
+      *min = a[i];
+    if (a[i] > *max)
+      *max = a[i];
+  }
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t affine_block_avx2(int *dst, const int *src,
+                                                 size_t n, int mul, int add) {
+  const __m256i m = _mm256_set1_epi32(mul), b = _mm256_set1_epi32(add);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm256_add_epi32(_mm256_mullo_epi32(x, m), b));
+  }
+  return i;
+}
+#endif
+
+static void affine_block(int *dst, const int *src, size_t n, int mul,
+                         int add) {
+  size_t i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = affine_block_avx2(dst, src, n, mul, add);
+#endif
+  for (; i < n; i++)
+    dst[i] =
+        (int)((unsigned int)src[i] * (unsigned int)mul + (unsigned int)add);
+}
+
+#if SIMD_AVX2
+/*Prefix sums of 8 lanes: two shifted adds within each 128 bit half, then
+ * the low half's total is added to the high half.*/
+static SIMD_AVX2_TARGET size_t scan_block_avx2(int *dst, const int *src,
+                                               size_t n, unsigned int *carry,
+                                               bool inclusive) {
+  __m256i c = _mm256_set1_epi32((int)*carry);
+  const __m256i last = _mm256_set1_epi32(7);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i in = _mm256_loadu_si256((const __m256i *)(src + i)), x = in;
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi32(
+        x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+    x = _mm256_add_epi32(x, c);
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        inclusive ? x : _mm256_sub_epi32(x, in));
+    c = _mm256_permutevar8x32_epi32(x, last);
+  }
+  *carry = (unsigned int)_mm256_cvtsi256_si32(c);
+  return i;
+}
+#endif
+
+/*Scans `n` elements starting from `carry` and returns the carry out.*/
+static unsigned int scan_block(int *dst, const int *src, size_t n,
+                               unsigned int carry, bool inclusive) {
+  size_t i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = scan_block_avx2(dst, src, n, &carry, inclusive);
+#endif
+  for (; i < n; i++) {
+    unsigned int value = (unsigned int)src[i];
+    carry += value;
+    dst[i] = (int)(inclusive ? carry : carry - value);
+  }
+  return carry;
+}
+
+/*Histogram: AVX2 has no scatter, so the vector part computes 8 bins at a
+ * time, with values outside the bins clamped to a spare bin, and the
+ * increments go round robin to 4 sub-histograms so repeated bins do not
+ * wait on each other's stores. The sub-histograms live on the stack, which
+ * limits the AVX2 path to HISTOGRAM_AVX2_BINS bins.*/
+#define HISTOGRAM_AVX2_BINS 256
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t histogram_block_avx2(const int *a, size_t n,
+                                                    int lo, unsigned int shift,
+                                                    size_t *counts,
+                                                    size_t bins) {
+  size_t sub[4][HISTOGRAM_AVX2_BINS + 1];
+  const __m256i base = _mm256_set1_epi32(lo);
+  const __m256i spare = _mm256_set1_epi32((int)bins);
+  const __m128i count = _mm_cvtsi32_si128((int)shift);
+  unsigned int lanes[8];
+  size_t i = 0, b;
+  if (bins > HISTOGRAM_AVX2_BINS)
+    return 0;
+  memset(sub, 0, sizeof(sub));
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i bin = _mm256_srl_epi32(_mm256_sub_epi32(x, base), count);
+    bin = _mm256_or_si256(bin, _mm256_cmpgt_epi32(base, x));
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_min_epu32(bin, spare));
+    sub[0][lanes[0]]++;
+    sub[1][lanes[1]]++;
+    sub[2][lanes[2]]++;
+    sub[3][lanes[3]]++;
+    sub[0][lanes[4]]++;
+    sub[1][lanes[5]]++;
+    sub[2][lanes[6]]++;
+    sub[3][lanes[7]]++;
+  }
+  for (b = 0; b < bins; b++)
+    counts[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+  return i;
+}
+#endif
+
+static void histogram_block(const int *a, size_t n, int lo, unsigned int shift,
+                            size_t *counts, size_t bins) {
+  size_t i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = histogram_block_avx2(a, n, lo, shift, counts, bins);
+#endif
+  for (; i < n; i++) {
+    size_t bin = ((unsigned int)a[i] - (unsigned int)lo) >> shift;
+    if (a[i] >= lo && bin < bins)
+      counts[bin]++;
+  }
+}
+
+/*Filter: x is kept when (unsigned)(x - lo) <= (unsigned)(hi - lo). The AVX2
+ * path packs the kept lanes to the front with one permute; `filter_table`
+ * holds the lane order for each of the 256 masks, 4 bits per lane.*/
+static uint32_t filter_table[256];
+static pthread_once_t filter_once = PTHREAD_ONCE_INIT;
+
+static void build_filter_table(void) {
+  unsigned int mask, lane, k;
+  for (mask = 0; mask < 256; mask++) {
+    uint32_t order = 0;
+    for (lane = 0, k = 0; lane < 8; lane++)
+      if (mask >> lane & 1)
+        order |= (uint32_t)lane << (4 * k++);
+    filter_table[mask] = order;
+  }
+}
+
+#if SIMD_AVX2
+static SIMD_AVX2_TARGET size_t count_block_avx2(const int *a, size_t n, int lo,
+                                                unsigned int range,
+                                                size_t *count) {
+  const __m256i base = _mm256_set1_epi32(lo);
+  const __m256i top = _mm256_set1_epi32((int)range);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                 base);
+    __m256i keep = _mm256_cmpeq_epi32(_mm256_max_epu32(d, top), top);
+    *count += (size_t)__builtin_popcount(
+        (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(keep)));
+  }
+  return i;
+}
+
+/*Stops before a store would pass `limit` elements of output.*/
+static SIMD_AVX2_TARGET size_t filter_block_avx2(int *dst, const int *src,
+                                                 size_t n, int lo,
+                                                 unsigned int range,
+                                                 size_t limit, size_t *out) {
+  const __m256i base = _mm256_set1_epi32(lo);
+  const __m256i top = _mm256_set1_epi32((int)range);
+  const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+  const __m256i seven = _mm256_set1_epi32(7);
+  size_t i = 0;
+  for (; i + 8 <= n && *out + 8 <= limit; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i keep = _mm256_cmpeq_epi32(
+        _mm256_max_epu32(_mm256_sub_epi32(x, base), top), top);
+    unsigned int mask =
+        (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(keep));
+    __m256i order = _mm256_and_si256(
+        _mm256_srlv_epi32(_mm256_set1_epi32((int)filter_table[mask]), shifts),
+        seven);
+    _mm256_storeu_si256((__m256i *)(dst + *out),
+                        _mm256_permutevar8x32_epi32(x, order));
+    *out += (size_t)__builtin_popcount(mask);
+  }
+  return i;
+}
+#endif
+
+static size_t count_block(const int *a, size_t n, int lo, unsigned int range) {
+  size_t count = 0, i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = count_block_avx2(a, n, lo, range, &count);
+#endif
+  for (; i < n; i++)
+    count += (unsigned int)a[i] - (unsigned int)lo <= range;
+  return count;
+}
+
+/*Writes the kept values of `src` to `dst` and returns how many. Stores stay
+ * below `limit`; `dst` may be `src`.*/
+static size_t filter_block(int *dst, const int *src, size_t n, int lo,
+                           unsigned int range, size_t limit) {
+  size_t out = 0, i = 0;
+#if SIMD_AVX2
+  if (simd_has_avx2())
+    i = filter_block_avx2(dst, src, n, lo, range, limit, &out);
+#else
+  (void)limit;
+#endif
+  for (; i < n; i++)
+    if ((unsigned int)src[i] - (unsigned int)lo <= range)
+      dst[out++] = src[i];
+  return out;
+}
+
+/*DRIVER*/
+
+/*Grows `dst` to hold `size` elements and sets its size.*/
+static int fit_vector(Vector *dst, size_t size) {
+  if (dst->capacity < size) {
+    int *arr = (int *)realloc(dst->arr, (size > 0 ? size : 1) * sizeof(int));
+    if (arr == NULL) {
+      fprintf(stderr, RED "MEM ERROR: REALLOC returns NULL" RESET);
+      return -1;
+    }
+    dst->arr = arr;
+    dst->capacity = size;
+  }
+  dst->size = size;
+  return 0;
+}
+
+/*Items per block: the whole input below VECTOR_PARALLEL_MIN or without a
+ * pool, else 4 blocks per pool thread.*/
+static size_t block_items(size_t n, ThreadPool *pool) {
+  size_t blocks;
+  if (pool == NULL || n < VECTOR_PARALLEL_MIN)
+    return n > 0 ? n : 1;
+  blocks = (size_t)get_threads_thread_pool(pool) * 4;
+  return (n + blocks - 1) / blocks;
+}
+
+/*Runs `body` over [0, n) in blocks of `grain`.*/
+static void run_vector_blocks(ThreadPool *pool, size_t n, size_t grain,
+                              ParallelForBody body, void *ctx) {
+  if (n <= grain)
+    body(0, n, ctx);
+  else
+    parallel_for(pool, 0, n, grain, body, ctx);
+}
+
+typedef struct {
+  int *dst;
+  const int *src;
+  VectorMap fn;
+  void *ctx;
+  int mul, add;
+  int lo;
+  unsigned int shift, range;
+  size_t bins, grain;
+  bool inclusive;
+  unsigned int *carries; /*scan: per block, in then out*/
+  size_t *offsets;       /*filter: per block*/
+} VectorJob;
+
+static void map_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  size_t i;
+  for (i = begin; i < end; i++)
+    job->dst[i] = job->fn(job->src[i], job->ctx);
+}
+
+static void affine_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  affine_block(job->dst + begin, job->src + begin, end - begin, job->mul,
+               job->add);
+}
+
+static void sum_body(size_t begin, size_t end, void *partial, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  *(long long *)partial += sum_block(job->src + begin, end - begin);
+}
+
+static void sum_join(void *into, const void *from, void *ctx) {
+  (void)ctx;
+  *(long long *)into += *(const long long *)from;
+}
+
+static void min_max_body(size_t begin, size_t end, void *partial, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  int *range = (int *)partial;
+  min_max_block(job->src + begin, end - begin, &range[0], &range[1]);
+}
+
+static void min_max_join(void *into, const void *from, void *ctx) {
+  int *a = (int *)into;
+  const int *b = (const int *)from;
+  (void)ctx;
+  if (b[0] < a[0])
+    a[0] = b[0];
+  if (b[1] > a[1])
+    a[1] = b[1];
+}
+
+static void histogram_body(size_t begin, size_t end, void *partial,
+                           void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  histogram_block(job->src + begin, end - begin, job->lo, job->shift,
+                  (size_t *)partial, job->bins);
+}
+
+static void histogram_join(void *into, const void *from, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  size_t b;
+  for (b = 0; b < job->bins; b++)
+    ((size_t *)into)[b] += ((const size_t *)from)[b];
+}
+
+/*Two pass scan: block totals, a serial scan of the totals, then every block
+ * scans from its carry.*/
+static void scan_total_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  job->carries[begin / job->grain] =
+      (unsigned int)sum_block(job->src + begin, end - begin);
+}
+
+static void scan_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  scan_block(job->dst + begin, job->src + begin, end - begin,
+             job->carries[begin / job->grain], job->inclusive);
+}
+
+/*Two pass filter: kept counts per block, a serial scan into output
+ * offsets, then every block writes from its offset.*/
+static void filter_count_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  job->offsets[begin / job->grain + 1] =
+      count_block(job->src + begin, end - begin, job->lo, job->range);
+}
+
+static void filter_body(size_t begin, size_t end, void *ctx) {
+  VectorJob *job = (VectorJob *)ctx;
+  size_t block = begin / job->grain;
+  size_t offset = job->offsets[block];
+  filter_block(job->dst + offset, job->src + begin, end - begin, job->lo,
+               job->range, job->offsets[block + 1] - offset);
+}
+
+/*MAP AND REDUCE*/
+
+int map_vector(Vector *dst, Vector *src, VectorMap fn, void *ctx,
+               ThreadPool *pool) {
+  VectorJob job;
+  size_t n = src->size;
+  if (fit_vector(dst, n) != 0)
+    return -1;
+  job.dst = dst->arr;
+  job.src = src->arr;
+  job.fn = fn;
+  job.ctx = ctx;
+  run_vector_blocks(pool, n, block_items(n, pool), map_body, &job);
+  return 0;
+}
+
+int affine_vector(Vector *dst, Vector *src, int mul, int add,
+                  ThreadPool *pool) {
+  VectorJob job;
+  size_t n = src->size;
+  if (fit_vector(dst, n) != 0)
+    return -1;
+  job.dst = dst->arr;
+  job.src = src->arr;
+  job.mul = mul;
+  job.add = add;
+  run_vector_blocks(pool, n, block_items(n, pool), affine_body, &job);
+  return 0;
+}
+
+long long sum_vector(Vector *vector, ThreadPool *pool) {
+  VectorJob job;
+  size_t n = vector->size;
+  long long zero = 0, sum;
+  if (n < VECTOR_PARALLEL_MIN || pool == NULL)
+    return sum_block(vector->arr, n);
+  job.src = vector->arr;
+  if (parallel_reduce(pool, 0, n, block_items(n, pool), sizeof sum, &zero,
+                      sum_body, sum_join, &sum, &job) != 0)
+    return sum_block(vector->arr, n);
+  return sum;
+}
+
+int min_max_vector(Vector *vector, int *min, int *max, ThreadPool *pool) {
+  VectorJob job;
+  size_t n = vector->size;
+  int identity[2] = {INT_MAX, INT_MIN}, range[2] = {INT_MAX, INT_MIN};
+  if (n == 0)
+    return -1;
+  job.src = vector->arr;
+  if (n < VECTOR_PARALLEL_MIN || pool == NULL ||
+      parallel_reduce(pool, 0, n, block_items(n, pool), sizeof range,
+                      identity, min_max_body, min_max_join, range, &job) != 0)
+    min_max_block(vector->arr, n, &range[0], &range[1]);
+  *min = range[0];
+  *max = range[1];
+  return 0;
+}
+
+/*SCAN*/
+
+static int scan_vector(Vector *dst, Vector *src, bool inclusive,
+                       ThreadPool *pool) {
+  VectorJob job;
+  size_t n = src->size, grain = block_items(n, pool), blocks, b;
+  unsigned int carry = 0;
+  if (fit_vector(dst, n) != 0)
+    return -1;
+  if (n <= grain) {
+    scan_block(dst->arr, src->arr, n, 0, inclusive);
+    return 0;
+  }
+  blocks = (n + grain - 1) / grain;
+  job.dst = dst->arr;
+  job.src = src->arr;
+  job.grain = grain;
+  job.inclusive = inclusive;
+  job.carries = (unsigned int *)malloc(blocks * sizeof(unsigned int));
+  if (job.carries == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  parallel_for(pool, 0, n, grain, scan_total_body, &job);
+  for (b = 0; b < blocks; b++) {
+    unsigned int total = job.carries[b];
+    job.carries[b] = carry;
+    carry += total;
+  }
+  parallel_for(pool, 0, n, grain, scan_body, &job);
+  free(job.carries);
+  return 0;
+}
+
+int inclusive_scan_vector(Vector *dst, Vector *src, ThreadPool *pool) {
+  return scan_vector(dst, src, true, pool);
+}
+
+int exclusive_scan_vector(Vector *dst, Vector *src, ThreadPool *pool) {
+  return scan_vector(dst, src, false, pool);
+}
+
+/*HISTOGRAM AND FILTER*/
+
+int histogram_vector(Vector *vector, int lo, unsigned int shift,
+                     size_t *counts, size_t bins, ThreadPool *pool) {
+  VectorJob job;
+  size_t n = vector->size;
+  size_t *zero;
+  int status;
+  memset(counts, 0, bins * sizeof(size_t));
+  if (shift > 31)
+    shift = 31;
+  if (n < VECTOR_PARALLEL_MIN || pool == NULL) {
+    histogram_block(vector->arr, n, lo, shift, counts, bins);
+    return 0;
+  }
+  zero = (size_t *)calloc(bins > 0 ? bins : 1, sizeof(size_t));
+  if (zero == NULL) {
+    fprintf(stderr, RED "MEM ERROR: CALLOC returns NULL" RESET);
+    return -1;
+  }
+  job.src = vector->arr;
+  job.lo = lo;
+  job.shift = shift;
+  job.bins = bins;
+  status = parallel_reduce(pool, 0, n, block_items(n, pool),
+                           bins * sizeof(size_t), zero, histogram_body,
+                           histogram_join, counts, &job);
+  free(zero);
+  return status;
+}
+
+int filter_vector(Vector *dst, Vector *src, int lo, int hi, ThreadPool *pool) {
+  VectorJob job;
+  size_t n = src->size, grain = block_items(n, pool), blocks, b;
+  int *out;
+  pthread_once(&filter_once, build_filter_table);
+  if (hi < lo) {
+    dst->size = 0;
+    return 0;
+  }
+  job.lo = lo;
+  job.range = (unsigned int)hi - (unsigned int)lo;
+  if (n <= grain) {
+    /*one block writes behind its reads, so in place is fine*/
+    if (fit_vector(dst, n) != 0)
+      return -1;
+    dst->size = filter_block(dst->arr, src->arr, n, lo, job.range, n);
+    return 0;
+  }
+  blocks = (n + grain - 1) / grain;
+  job.src = src->arr;
+  job.grain = grain;
+  job.offsets = (size_t *)malloc((blocks + 1) * sizeof(size_t));
+  if (job.offsets == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    return -1;
+  }
+  job.offsets[0] = 0;
+  parallel_for(pool, 0, n, grain, filter_count_body, &job);
+  for (b = 1; b <= blocks; b++)
+    job.offsets[b] += job.offsets[b - 1];
+  /*blocks write ahead of other blocks' reads, so in place gets a new array*/
+  out = dst == src ? (int *)malloc((n > 0 ? n : 1) * sizeof(int)) : NULL;
+  if (dst == src && out == NULL) {
+    fprintf(stderr, RED "MEM ERROR: MALLOC returns NULL" RESET);
+    free(job.offsets);
+    return -1;
+  }
+  if (dst != src && fit_vector(dst, job.offsets[blocks]) != 0) {
+    free(job.offsets);
+    return -1;
+  }
+  job.dst = out != NULL ? out : dst->arr;
+  parallel_for(pool, 0, n, grain, filter_body, &job);
+  if (out != NULL) {
+    free(dst->arr);
+    dst->arr = out;
+    dst->capacity = n;
+  }
+  dst->size = job.offsets[blocks];
+  free(job.offsets);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef __VECOPS_H__
+#define __VECOPS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "threadpool.h"
+#include "utils.h"
+
+/*VECTOR KERNELS*/
+
+/*Whole-Vector loops: map, reduce, prefix sums, histogram and filter. Each
+ * works on blocks of the array with AVX2 where available (see simd.h), and
+ * spreads the blocks over `pool` for inputs of VECTOR_PARALLEL_MIN elements
+ * or more; `pool` NULL runs on the calling thread.
+ *
+ * Integer arithmetic wraps around like unsigned arithmetic and every result
+ * is the same whatever the pool size or schedule. Functions writing `dst`
+ * size it to fit (growing its capacity) and return -1 if that fails; `dst`
+ * may be `src`.*/
+#define VECTOR_PARALLEL_MIN (1u << 16)
+
+typedef int (*VectorMap)(int value, void *ctx);
+
+/*dst[i] = fn(src[i], ctx). Not vectorized: `fn` is called per element.*/
+int map_vector(Vector *dst, Vector *src, VectorMap fn, void *ctx,
+               ThreadPool *pool);
+/*dst[i] = src[i] * mul + add.*/
+int affine_vector(Vector *dst, Vector *src, int mul, int add,
+                  ThreadPool *pool);
+
+long long sum_vector(Vector *vector, ThreadPool *pool);
+/*Returns -1 for an empty vector.*/
+int min_max_vector(Vector *vector, int *min, int *max, ThreadPool *pool);
+
+/*dst[i] = src[0] + ... + src[i].*/
+int inclusive_scan_vector(Vector *dst, Vector *src, ThreadPool *pool);
+/*dst[i] = src[0] + ... + src[i - 1], dst[0] = 0.*/
+int exclusive_scan_vector(Vector *dst, Vector *src, ThreadPool *pool);
+
+/*counts[b] = how many values fall in bin b = (value - lo) >> shift, for
+ * b < bins; values outside the bins are not counted.*/
+int histogram_vector(Vector *vector, int lo, unsigned int shift,
+                     size_t *counts, size_t bins, ThreadPool *pool);
+
+/*Keeps the values in [lo, hi], in order.*/
+int filter_vector(Vector *dst, Vector *src, int lo, int hi, ThreadPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __VECOPS_H__